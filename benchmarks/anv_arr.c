@@ -0,0 +1,210 @@
+#include "../include/anv_bench_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define ANV_ARR_IMPLEMENTATION
+#include "../include/anv_arr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Every op runs over a whole array of count items per iteration, so that
+ * results are comparable across sizes: look at items_per_s.
+ */
+typedef enum arr_op {
+    ARR_OP_PUSH,
+    ARR_OP_POP,
+    ARR_OP_GET,
+    ARR_OP_INSERT,
+    ARR_OP_REMOVE,
+    ARR_OP_SWAP,
+    ARR_OP_SHRINK_TO_FIT,
+    ARR_OPS_COUNT
+} arr_op;
+
+typedef struct arr_params {
+    arr_op op;
+    size_t item_sz;
+    size_t count;
+} arr_params;
+
+static const char *const op_names[ARR_OPS_COUNT] = {
+    "push", "pop", "get", "insert", "remove", "swap", "shrink_to_fit",
+};
+
+static const size_t item_sizes[] = { 4, 16, 64, 256 };
+static const size_t counts[] = { 100, 10000, 1000000, 100000000 };
+
+#define MAX_ITEM_SZ 256
+#define MAX_CASES                                                              \
+    (ARR_OPS_COUNT * (sizeof(item_sizes) / sizeof(item_sizes[0]))              \
+     * (sizeof(counts) / sizeof(counts[0])))
+
+static unsigned char item[MAX_ITEM_SZ];
+
+static anv_arr_t
+filled_arr(const arr_params *params, size_t capacity)
+{
+    anv_arr_t arr = anv_arr_new(capacity, params->item_sz);
+    if (arr) {
+        anv_arr_resize(arr, params->count);
+    }
+    return arr;
+}
+
+ANV_BENCH_CASE(bench_arr)
+{
+    const arr_params *params = state->arg;
+    const size_t n = params->count;
+    // insert doubles the array, leave room for it.
+    anv_arr_t arr = params->op == ARR_OP_PUSH ? NULL
+                                               : filled_arr(params, n * 2);
+    if (params->op != ARR_OP_PUSH && (!arr || anv_arr_length(arr) != n)) {
+        if (arr) {
+            anv_arr_destroy(arr);
+        }
+        anv_bench_skip(state, "out of memory");
+        return;
+    }
+    state->items_per_iteration = (double)n;
+    state->bytes_per_iteration = (double)(n * params->item_sz);
+
+    switch (params->op) {
+        case ARR_OP_PUSH:
+            // growth included: the array starts empty every time.
+            ANV_BENCH_LOOP(state)
+            {
+                arr = anv_arr_new(1, params->item_sz);
+                for (size_t i = 0; i < n; ++i) {
+                    anv_arr_push(arr, item);
+                }
+                anv_bench_clobber_memory();
+                anv_arr_destroy(arr);
+            }
+            return;
+        case ARR_OP_POP:
+            ANV_BENCH_LOOP(state)
+            {
+                anv_bench_pause(state);
+                anv_arr_resize(arr, n);
+                anv_bench_resume(state);
+                for (size_t i = 0; i < n; ++i) {
+                    anv_bench_do_not_optimize(anv_arr_pop(arr, void));
+                }
+            }
+            break;
+        case ARR_OP_GET:
+            ANV_BENCH_LOOP(state)
+            {
+                for (size_t i = 0; i < n; ++i) {
+                    anv_bench_do_not_optimize(anv_arr_get(arr, void, i));
+                }
+            }
+            break;
+        case ARR_OP_INSERT:
+            ANV_BENCH_LOOP(state)
+            {
+                anv_bench_pause(state);
+                anv_arr_resize(arr, n);
+                anv_bench_resume(state);
+                for (size_t i = 0; i < n; ++i) {
+                    anv_arr_insert(arr, i, item);
+                }
+                anv_bench_clobber_memory();
+            }
+            break;
+        case ARR_OP_REMOVE:
+            ANV_BENCH_LOOP(state)
+            {
+                anv_bench_pause(state);
+                anv_arr_resize(arr, n);
+                anv_bench_resume(state);
+                for (size_t i = 0; i < n; ++i) {
+                    anv_arr_remove(arr, (n - i) / 2);
+                }
+                anv_bench_clobber_memory();
+            }
+            break;
+        case ARR_OP_SWAP:
+            ANV_BENCH_LOOP(state)
+            {
+                for (size_t i = 0; i < n; ++i) {
+                    anv_arr_swap(arr, i, n - 1 - i);
+                }
+                anv_bench_clobber_memory();
+            }
+            break;
+        case ARR_OP_SHRINK_TO_FIT:
+            // one shrink of the whole array per iteration.
+            state->items_per_iteration = 1;
+            ANV_BENCH_LOOP(state)
+            {
+                anv_bench_pause(state);
+                anv_arr_reserve(arr, n * 2);
+                anv_bench_resume(state);
+                anv_arr_shrink_to_fit(arr);
+                anv_bench_clobber_memory();
+            }
+            break;
+        default:
+            anv_bench_skip(state, "unknown op");
+            break;
+    }
+    anv_arr_destroy(arr);
+}
+
+int
+main(int argc, char **argv)
+{
+    // 1e8 items arrays are opt-in, they need GBs of memory.
+    size_t max_items = 1000000;
+    size_t max_mb = 1024;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--max-items=", 12) == 0) {
+            max_items = (size_t)strtoull(argv[i] + 12, NULL, 10);
+        } else if (strncmp(argv[i], "--max-mb=", 9) == 0) {
+            max_mb = (size_t)strtoull(argv[i] + 9, NULL, 10);
+        }
+    }
+
+    static arr_params params[MAX_CASES];
+    static char names[MAX_CASES][64];
+    static anv_bench_case cases[MAX_CASES];
+    size_t cases_count = 0;
+    for (size_t op = 0; op < ARR_OPS_COUNT; ++op) {
+        for (size_t s = 0; s < sizeof(item_sizes) / sizeof(item_sizes[0]);
+             ++s) {
+            for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+                // worst case is insert, with 2 * count items.
+                size_t mb = counts[c] * item_sizes[s] * 2 / (1024 * 1024);
+                if (counts[c] > max_items || mb > max_mb) {
+                    continue;
+                }
+                arr_params *p = &params[cases_count];
+                p->op = (arr_op)op;
+                p->item_sz = item_sizes[s];
+                p->count = counts[c];
+                snprintf(
+                    names[cases_count],
+                    sizeof(names[0]),
+                    "%s/%uB/%lu",
+                    op_names[op],
+                    (unsigned)p->item_sz,
+                    (unsigned long)p->count
+                );
+                anv_bench_case *bench_case = &cases[cases_count];
+                bench_case->name = names[cases_count];
+                bench_case->bench = bench_arr;
+                bench_case->arg = p;
+                ++cases_count;
+            }
+        }
+    }
+
+    anv_bench_config config = { 0 };
+    anv_bench_config_from_args(&config, argc, argv);
+    return ANV_BENCH_RUN_CASES("anv_arr", cases, cases_count, stdout, &config)
+        ? 1
+        : 0;
+}
@@ -0,0 +1,150 @@
+#include "../include/anv_bench_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#include "../include/anv_metalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Same workloads with libc and metalloc, with the metadata of a typical
+ * container (2 size_t).
+ */
+typedef struct meta {
+    size_t length;
+    size_t capacity;
+} meta;
+
+#define BLOCKS_COUNT 1024
+#define REALLOC_MIN_SZ 16
+#define REALLOC_MAX_SZ 65536
+
+static void *blocks[BLOCKS_COUNT];
+
+static const size_t sizes[] = { 16, 64, 256, 4096 };
+
+ANV_BENCH_CASE(bench_malloc_free)
+{
+    const size_t sz = *(const size_t *)state->arg;
+    state->items_per_iteration = BLOCKS_COUNT;
+    ANV_BENCH_LOOP(state)
+    {
+        for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+            blocks[i] = malloc(sz);
+        }
+        anv_bench_clobber_memory();
+        for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+            free(blocks[i]);
+        }
+    }
+}
+
+ANV_BENCH_CASE(bench_meta_malloc_free)
+{
+    const size_t sz = *(const size_t *)state->arg;
+    meta m = { 0, sz };
+    state->items_per_iteration = BLOCKS_COUNT;
+    ANV_BENCH_LOOP(state)
+    {
+        for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+            blocks[i] = anv_meta_malloc(&m, sizeof(m), sz);
+        }
+        anv_bench_clobber_memory();
+        for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+            anv_meta_free(blocks[i]);
+        }
+    }
+}
+
+/*
+ * Grow a block by doubling from REALLOC_MIN_SZ to REALLOC_MAX_SZ, like
+ * containers do.
+ */
+ANV_BENCH_CASE(bench_realloc_grow)
+{
+    state->items_per_iteration = 12;
+    ANV_BENCH_LOOP(state)
+    {
+        void *mem = malloc(REALLOC_MIN_SZ);
+        for (size_t sz = REALLOC_MIN_SZ * 2; sz <= REALLOC_MAX_SZ; sz *= 2) {
+            mem = realloc(mem, sz);
+        }
+        anv_bench_do_not_optimize(mem);
+        free(mem);
+    }
+}
+
+ANV_BENCH_CASE(bench_meta_realloc_grow)
+{
+    meta m = { 0, REALLOC_MIN_SZ };
+    state->items_per_iteration = 12;
+    ANV_BENCH_LOOP(state)
+    {
+        void *mem = anv_meta_malloc(&m, sizeof(m), REALLOC_MIN_SZ);
+        for (size_t sz = REALLOC_MIN_SZ * 2; sz <= REALLOC_MAX_SZ; sz *= 2) {
+            mem = anv_meta_realloc(mem, sz);
+        }
+        anv_bench_do_not_optimize(mem);
+        anv_meta_free(mem);
+    }
+}
+
+ANV_BENCH_CASE(bench_meta_get)
+{
+    meta m = { 0, 64 };
+    for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+        blocks[i] = anv_meta_malloc(&m, sizeof(m), 64);
+    }
+    state->items_per_iteration = BLOCKS_COUNT;
+    ANV_BENCH_LOOP(state)
+    {
+        for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+            anv_bench_do_not_optimize(anv_meta_get(blocks[i]));
+        }
+    }
+    for (size_t i = 0; i < BLOCKS_COUNT; ++i) {
+        anv_meta_free(blocks[i]);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    anv_bench_case cases[] = {
+        ANV_BENCH_REGISTER_ARG("malloc_free/16B", bench_malloc_free, &sizes[0]),
+        ANV_BENCH_REGISTER_ARG(
+            "meta_malloc_free/16B", bench_meta_malloc_free, &sizes[0]
+        ),
+        ANV_BENCH_REGISTER_ARG("malloc_free/64B", bench_malloc_free, &sizes[1]),
+        ANV_BENCH_REGISTER_ARG(
+            "meta_malloc_free/64B", bench_meta_malloc_free, &sizes[1]
+        ),
+        ANV_BENCH_REGISTER_ARG(
+            "malloc_free/256B", bench_malloc_free, &sizes[2]
+        ),
+        ANV_BENCH_REGISTER_ARG(
+            "meta_malloc_free/256B", bench_meta_malloc_free, &sizes[2]
+        ),
+        ANV_BENCH_REGISTER_ARG(
+            "malloc_free/4096B", bench_malloc_free, &sizes[3]
+        ),
+        ANV_BENCH_REGISTER_ARG(
+            "meta_malloc_free/4096B", bench_meta_malloc_free, &sizes[3]
+        ),
+        ANV_BENCH_REGISTER(bench_realloc_grow),
+        ANV_BENCH_REGISTER(bench_meta_realloc_grow),
+        ANV_BENCH_REGISTER(bench_meta_get),
+    };
+
+    anv_bench_config config = { 0 };
+    anv_bench_config_from_args(&config, argc, argv);
+    return ANV_BENCH_RUN_CASES(
+               "anv_metalloc",
+               cases,
+               sizeof(cases) / sizeof(cases[0]),
+               stdout,
+               &config
+           )
+        ? 1
+        : 0;
+}
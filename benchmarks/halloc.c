@@ -0,0 +1,106 @@
+#include "../include/anv_bench_2.h"
+
+#define HALLOC_IMPLEMENTATION
+#include "../repackages/halloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Trees of nodes_count blocks where every block has FANOUT children, built
+ * level by level. Build and teardown are measured separately, the other half
+ * is paused.
+ */
+#define FANOUT 8
+#define NODE_SZ 32
+#define ARENA_CHUNK_SZ 65536
+
+typedef struct tree_params {
+    size_t nodes_count;
+    int use_arena;
+} tree_params;
+
+static void **nodes;
+
+static void *
+build_tree(const tree_params *params)
+{
+    void *root = params->use_arena ? h_arena_new(NODE_SZ, ARENA_CHUNK_SZ)
+                                   : h_malloc(NODE_SZ);
+    nodes[0] = root;
+    for (size_t i = 1; i < params->nodes_count; ++i) {
+        void *parent = nodes[(i - 1) / FANOUT];
+        if (params->use_arena) {
+            nodes[i] = h_arena_malloc(parent, NODE_SZ);
+        } else {
+            nodes[i] = h_malloc(NODE_SZ);
+            hattach(nodes[i], parent);
+        }
+    }
+    return root;
+}
+
+ANV_BENCH_CASE(bench_tree_build)
+{
+    const tree_params *params = state->arg;
+    state->items_per_iteration = (double)params->nodes_count;
+    ANV_BENCH_LOOP(state)
+    {
+        void *root = build_tree(params);
+        anv_bench_pause(state);
+        h_free(root);
+        anv_bench_resume(state);
+    }
+}
+
+ANV_BENCH_CASE(bench_tree_teardown)
+{
+    const tree_params *params = state->arg;
+    state->items_per_iteration = (double)params->nodes_count;
+    ANV_BENCH_LOOP(state)
+    {
+        anv_bench_pause(state);
+        void *root = build_tree(params);
+        anv_bench_resume(state);
+        h_free(root);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    static const tree_params small = { 1000, 0 };
+    static const tree_params small_arena = { 1000, 1 };
+    static const tree_params big = { 100000, 0 };
+    static const tree_params big_arena = { 100000, 1 };
+    anv_bench_case cases[] = {
+        ANV_BENCH_REGISTER_ARG("build/1000", bench_tree_build, &small),
+        ANV_BENCH_REGISTER_ARG(
+            "build_arena/1000", bench_tree_build, &small_arena
+        ),
+        ANV_BENCH_REGISTER_ARG("build/100000", bench_tree_build, &big),
+        ANV_BENCH_REGISTER_ARG(
+            "build_arena/100000", bench_tree_build, &big_arena
+        ),
+        ANV_BENCH_REGISTER_ARG("teardown/1000", bench_tree_teardown, &small),
+        ANV_BENCH_REGISTER_ARG(
+            "teardown_arena/1000", bench_tree_teardown, &small_arena
+        ),
+        ANV_BENCH_REGISTER_ARG("teardown/100000", bench_tree_teardown, &big),
+        ANV_BENCH_REGISTER_ARG(
+            "teardown_arena/100000", bench_tree_teardown, &big_arena
+        ),
+    };
+
+    nodes = malloc(big.nodes_count * sizeof(*nodes));
+    if (!nodes) {
+        return 1;
+    }
+    anv_bench_config config = { 0 };
+    anv_bench_config_from_args(&config, argc, argv);
+    int errors = ANV_BENCH_RUN_CASES(
+        "halloc", cases, sizeof(cases) / sizeof(cases[0]), stdout, &config
+    );
+    free(nodes);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,588 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_arena (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_arena
+
+Region (bump) allocator for objects sharing the same lifetime.
+
+Memory is carved sequentially out of big chunks. Single allocations are never
+returned to the system: the whole arena is released at once with
+anv_arena_reset (O(1), chunks are kept and reused) or anv_arena_destroy.
+
+Advantages:
+- allocating is a pointer bump most of the time
+- objects allocated together end up next to each other in memory
+- freeing thousands of objects is a single reset
+
+Drawbacks:
+- memory of single objects is only reclaimed when it is the last allocation
+- an arena object must not be moved in memory after anv_arena_init
+
+```
+== brief overview ==
+
+|next|cap|used|-----alloc1-----|-alloc2-|---alloc3---|.........free.........|
+                                                     ^last alloc, can grow in
+                                                      place (anv_arena_realloc)
+```
+
+Markers (anv_arena_mark/anv_arena_rewind) save the current position and later
+release everything allocated after it, like a stack.
+
+The last allocation can be grown in place with anv_arena_realloc as long as it
+still fits inside its chunk, which makes a growing anv_arr in an arena cheap.
+
+## Metalloc and anv_arr integration
+
+anv_arena_allocator returns an anv_meta_allocator backed by the arena, usable
+with anv_meta_malloc_with or as anv_arr_options.allocator. Blocks freed with
+anv_meta_free simply stay in the arena until the next reset.
+
+## Dependencies
+
+- anv_metalloc.h (only for anv_meta_allocator)
+
+## Include usage
+
+```c
+// only if metalloc define is not already present somewhere else.
+#define ANV_METALLOC_IMPLEMENTATION
+
+#define ANV_ARENA_IMPLEMENTATION
+#include "anv_arena.h"
+```
+
+## Examples
+
+### Batch of arrays
+
+```c
+anv_arena arena;
+anv_arena_init(&arena, 0);
+
+for (int batch = 0; batch < batches_count; ++batch) {
+    anv_arr_options options = {
+        .arr_capacity = 16,
+        .item_sz = sizeof(int),
+        .allocator = anv_arena_allocator(&arena),
+    };
+    for (int i = 0; i < 1000; ++i) {
+        arrays[i] = anv_arr_new_with_options(&options);
+        // fill and use arrays...
+    }
+    // no need to destroy each array.
+    anv_arena_reset(&arena);
+}
+
+anv_arena_destroy(&arena);
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_ARENA_H
+#define ANV_ARENA_H
+
+#include <stddef.h> /* for size_t */
+
+#include "anv_metalloc.h"
+
+/**
+ * Default size in bytes of each arena chunk.
+ */
+#ifndef ANV_ARENA_DEFAULT_CHUNK_SIZE
+#define ANV_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#endif
+
+/**
+ * Alignment of memory returned by anv_arena_alloc, enough for any basic type.
+ */
+#ifndef ANV_ARENA_ALIGNMENT
+#define ANV_ARENA_ALIGNMENT 16
+#endif
+
+typedef struct anv_arena__chunk anv_arena__chunk;
+
+/**
+ * Arena object, can live anywhere (e.g. on the stack) but must not be moved
+ * after anv_arena_init: its allocator points back to it.
+ * @note All fields are private.
+ */
+typedef struct anv_arena {
+    /** First allocated chunk. */
+    anv_arena__chunk *first;
+    /** Chunk currently used for allocations, NULL when none yet. */
+    anv_arena__chunk *current;
+    /** Last allocation made, can be grown in place or released. */
+    void *last;
+    /** Min capacity of newly allocated chunks. */
+    size_t chunk_sz;
+    /** See anv_arena_allocator. */
+    anv_meta_allocator allocator;
+} anv_arena;
+
+/**
+ * Position inside an arena, see anv_arena_mark.
+ */
+typedef struct anv_arena_marker {
+    anv_arena__chunk *chunk;
+    size_t used;
+} anv_arena_marker;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a new empty arena. No memory is allocated until the first
+ * allocation.
+ * @param arena Arena to initialize.
+ * @param chunk_sz Min size in bytes of each chunk, 0 for
+ *                 ANV_ARENA_DEFAULT_CHUNK_SIZE.
+ */
+void anv_arena_init(anv_arena *arena, size_t chunk_sz);
+
+/**
+ * Free all memory owned by the arena. The arena can be reused only after
+ * calling anv_arena_init again.
+ * @param arena Arena to destroy, NULL is a no-op.
+ */
+void anv_arena_destroy(anv_arena *arena);
+
+/**
+ * Allocate sz bytes aligned to ANV_ARENA_ALIGNMENT.
+ * @param arena Arena to allocate from.
+ * @param sz Size in bytes, always > 0.
+ * @return New memory, NULL on invalid params or internal alloc errors.
+ */
+void *anv_arena_alloc(anv_arena *arena, size_t sz);
+
+/**
+ * Allocate sz bytes aligned to alignment bytes.
+ * @param arena Arena to allocate from.
+ * @param sz Size in bytes, always > 0.
+ * @param alignment Must be a power of 2.
+ * @return New memory, NULL on invalid params or internal alloc errors.
+ */
+void *anv_arena_alloc_aligned(anv_arena *arena, size_t sz, size_t alignment);
+
+/**
+ * Resize memory previously allocated from the arena.
+ *
+ * When mem is the last allocation and the new size still fits in its chunk
+ * mem is grown (or shrunk) in place. Otherwise a new block is allocated and
+ * the data copied over, the old block stays in the arena until the next reset.
+ *
+ * @param arena Arena mem was allocated from.
+ * @param mem Memory to resize, NULL behaves like anv_arena_alloc.
+ * @param new_sz New size in bytes, always > 0.
+ * @return Resized memory, NULL on invalid params or internal alloc errors. On
+ *         errors mem is left untouched.
+ */
+void *anv_arena_realloc(anv_arena *arena, void *mem, size_t new_sz);
+
+/**
+ * Release memory allocated from the arena. Only the last allocation is
+ * actually reclaimed, this is a no-op for any other block.
+ * @param arena Arena mem was allocated from.
+ * @param mem Memory to release, NULL is a no-op.
+ */
+void anv_arena_free(anv_arena *arena, void *mem);
+
+/**
+ * Save the current arena position.
+ * @param arena Arena to mark.
+ * @return Marker for anv_arena_rewind.
+ */
+anv_arena_marker anv_arena_mark(const anv_arena *arena);
+
+/**
+ * Release everything allocated after marker was taken. Chunks are kept for
+ * later allocations.
+ * @warning Markers taken after marker are invalidated.
+ * @param arena Arena marker was taken from.
+ * @param marker Position to go back to.
+ */
+void anv_arena_rewind(anv_arena *arena, anv_arena_marker marker);
+
+/**
+ * Release everything allocated from the arena in O(1). Chunks are kept for
+ * later allocations.
+ * @param arena Arena to reset.
+ */
+void anv_arena_reset(anv_arena *arena);
+
+/**
+ * Get the number of bytes currently in use, alignment padding included.
+ * @param arena Arena to inspect.
+ */
+size_t anv_arena_used(const anv_arena *arena);
+
+/**
+ * Get a metalloc allocator backed by the arena, valid as long as the arena.
+ * @param arena Arena to allocate from.
+ */
+const anv_meta_allocator *anv_arena_allocator(anv_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_ARENA_IMPLEMENTATION
+
+#include <stdlib.h> /* for malloc(), free() */
+#include <string.h> /* for memcpy() */
+
+#ifndef anv_arena__assert
+#include <assert.h>
+#define anv_arena__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_ARENA__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_ARENA__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_ARENA__LIKELY(x)   (x)
+#define ANV_ARENA__UNLIKELY(x) (x)
+#endif
+
+#define ANV_ARENA__SIZE_MAX ((size_t)-1)
+
+struct anv_arena__chunk {
+    anv_arena__chunk *next;
+    size_t capacity;
+    size_t used;
+};
+
+#define ANV_ARENA__CHUNK_HEADER_SZ                                             \
+    ((sizeof(anv_arena__chunk) + ANV_ARENA_ALIGNMENT - 1)                      \
+     / ANV_ARENA_ALIGNMENT * ANV_ARENA_ALIGNMENT)
+
+#define ANV_ARENA__CHUNK_DATA(chunk)                                           \
+    ((unsigned char *)(chunk) + ANV_ARENA__CHUNK_HEADER_SZ)
+
+static void *
+anv_arena__meta_malloc(void *ctx, size_t sz)
+{
+    return anv_arena_alloc((anv_arena *)ctx, sz);
+}
+
+static void *
+anv_arena__meta_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    return anv_arena_realloc((anv_arena *)ctx, mem, new_sz);
+}
+
+static void
+anv_arena__meta_free(void *ctx, void *mem)
+{
+    anv_arena_free((anv_arena *)ctx, mem);
+}
+
+/*
+ * Bump allocate from chunk, NULL if it does not fit.
+ */
+static void *
+anv_arena__bump(anv_arena__chunk *chunk, size_t sz, size_t alignment)
+{
+    size_t addr = (size_t)ANV_ARENA__CHUNK_DATA(chunk) + chunk->used;
+    size_t pad = (alignment - (addr & (alignment - 1))) & (alignment - 1);
+    size_t available = chunk->capacity - chunk->used;
+    if (pad > available || sz > available - pad) {
+        return NULL;
+    }
+    chunk->used += pad + sz;
+    return (void *)(addr + pad);
+}
+
+/*
+ * Move to the next chunk able to store min_capacity bytes, reusing chunks kept
+ * by a previous reset when big enough.
+ */
+static anv_arena__chunk *
+anv_arena__next_chunk(anv_arena *arena, size_t min_capacity)
+{
+    anv_arena__chunk *next
+        = arena->current ? arena->current->next : arena->first;
+    if (next && next->capacity >= min_capacity) {
+        next->used = 0;
+        arena->current = next;
+        return next;
+    }
+
+    size_t capacity
+        = min_capacity > arena->chunk_sz ? min_capacity : arena->chunk_sz;
+    if (ANV_ARENA__UNLIKELY(
+            capacity > ANV_ARENA__SIZE_MAX - ANV_ARENA__CHUNK_HEADER_SZ
+        )) {
+        return NULL;
+    }
+    anv_arena__chunk *chunk
+        = (anv_arena__chunk *)malloc(ANV_ARENA__CHUNK_HEADER_SZ + capacity);
+    if (ANV_ARENA__UNLIKELY(!chunk)) {
+        return NULL;
+    }
+    chunk->next = next;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    if (arena->current) {
+        arena->current->next = chunk;
+    } else {
+        arena->first = chunk;
+    }
+    arena->current = chunk;
+    return chunk;
+}
+
+/*
+ * Find the chunk, up to the current one, holding mem.
+ */
+static anv_arena__chunk *
+anv_arena__find_chunk(const anv_arena *arena, void *mem)
+{
+    for (anv_arena__chunk *chunk = arena->first; chunk; chunk = chunk->next) {
+        unsigned char *data = ANV_ARENA__CHUNK_DATA(chunk);
+        if ((unsigned char *)mem >= data
+            && (unsigned char *)mem < data + chunk->used) {
+            return chunk;
+        }
+        if (chunk == arena->current) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void
+anv_arena_init(anv_arena *arena, size_t chunk_sz)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+    arena->chunk_sz = chunk_sz ? chunk_sz : ANV_ARENA_DEFAULT_CHUNK_SIZE;
+    arena->allocator.malloc_fn = anv_arena__meta_malloc;
+    arena->allocator.realloc_fn = anv_arena__meta_realloc;
+    arena->allocator.free_fn = anv_arena__meta_free;
+    arena->allocator.ctx = arena;
+}
+
+void
+anv_arena_destroy(anv_arena *arena)
+{
+    if (!arena) {
+        return;
+    }
+    anv_arena__chunk *chunk = arena->first;
+    while (chunk) {
+        anv_arena__chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+}
+
+void *
+anv_arena_alloc(anv_arena *arena, size_t sz)
+{
+    return anv_arena_alloc_aligned(arena, sz, ANV_ARENA_ALIGNMENT);
+}
+
+void *
+anv_arena_alloc_aligned(anv_arena *arena, size_t sz, size_t alignment)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return NULL;
+    }
+    if (ANV_ARENA__UNLIKELY(sz == 0)) {
+        anv_arena__assert(0, "trying to allocate 0 bytes is not supported");
+        return NULL;
+    }
+    if (ANV_ARENA__UNLIKELY(
+            alignment == 0 || (alignment & (alignment - 1)) != 0
+        )) {
+        anv_arena__assert(0, "alignment must be a power of 2");
+        return NULL;
+    }
+
+    void *mem = NULL;
+    if (ANV_ARENA__LIKELY(arena->current != NULL)) {
+        mem = anv_arena__bump(arena->current, sz, alignment);
+    }
+    if (ANV_ARENA__UNLIKELY(!mem)) {
+        // worst case padding needed to align inside a fresh chunk.
+        size_t extra = alignment - 1;
+        if (ANV_ARENA__UNLIKELY(sz > ANV_ARENA__SIZE_MAX - extra)) {
+            return NULL;
+        }
+        anv_arena__chunk *chunk = anv_arena__next_chunk(arena, sz + extra);
+        if (ANV_ARENA__UNLIKELY(!chunk)) {
+            return NULL;
+        }
+        mem = anv_arena__bump(chunk, sz, alignment);
+    }
+    arena->last = mem;
+    return mem;
+}
+
+void *
+anv_arena_realloc(anv_arena *arena, void *mem, size_t new_sz)
+{
+    if (!mem) {
+        return anv_arena_alloc(arena, new_sz);
+    }
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return NULL;
+    }
+    if (ANV_ARENA__UNLIKELY(new_sz == 0)) {
+        anv_arena__assert(0, "trying to allocate 0 bytes is not supported");
+        return NULL;
+    }
+
+    anv_arena__chunk *chunk = NULL;
+    if (mem == arena->last) {
+        chunk = arena->current;
+        size_t offset
+            = (size_t)((unsigned char *)mem - ANV_ARENA__CHUNK_DATA(chunk));
+        if (new_sz <= chunk->capacity - offset) {
+            chunk->used = offset + new_sz;
+            return mem;
+        }
+    } else {
+        chunk = anv_arena__find_chunk(arena, mem);
+        if (ANV_ARENA__UNLIKELY(!chunk)) {
+            anv_arena__assert(0, "memory not allocated from this arena");
+            return NULL;
+        }
+    }
+
+    // The old size is not known: everything from mem up to the end of the used
+    // part of its chunk is at least as big and always safe to read.
+    size_t old_sz_max = (size_t)(ANV_ARENA__CHUNK_DATA(chunk) + chunk->used
+                                 - (unsigned char *)mem);
+    void *new_mem = anv_arena_alloc(arena, new_sz);
+    if (ANV_ARENA__UNLIKELY(!new_mem)) {
+        return NULL;
+    }
+    memcpy(new_mem, mem, new_sz < old_sz_max ? new_sz : old_sz_max);
+    return new_mem;
+}
+
+void
+anv_arena_free(anv_arena *arena, void *mem)
+{
+    if (!arena || !mem) {
+        return;
+    }
+    if (mem == arena->last) {
+        arena->current->used
+            = (size_t)((unsigned char *)mem
+                       - ANV_ARENA__CHUNK_DATA(arena->current));
+        arena->last = NULL;
+    }
+}
+
+anv_arena_marker
+anv_arena_mark(const anv_arena *arena)
+{
+    anv_arena_marker marker = { NULL, 0 };
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return marker;
+    }
+    marker.chunk = arena->current;
+    marker.used = arena->current ? arena->current->used : 0;
+    return marker;
+}
+
+void
+anv_arena_rewind(anv_arena *arena, anv_arena_marker marker)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return;
+    }
+    if (!marker.chunk) {
+        anv_arena_reset(arena);
+        return;
+    }
+    arena->current = marker.chunk;
+    arena->current->used = marker.used;
+    arena->last = NULL;
+}
+
+void
+anv_arena_reset(anv_arena *arena)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return;
+    }
+    arena->current = arena->first;
+    if (arena->current) {
+        arena->current->used = 0;
+    }
+    arena->last = NULL;
+}
+
+size_t
+anv_arena_used(const anv_arena *arena)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return 0;
+    }
+    size_t used = 0;
+    for (anv_arena__chunk *chunk = arena->first; chunk; chunk = chunk->next) {
+        used += chunk->used;
+        if (chunk == arena->current) {
+            break;
+        }
+    }
+    return used;
+}
+
+const anv_meta_allocator *
+anv_arena_allocator(anv_arena *arena)
+{
+    if (ANV_ARENA__UNLIKELY(!arena)) {
+        anv_arena__assert(0, "invalid null arena");
+        return NULL;
+    }
+    return &arena->allocator;
+}
+
+#endif /* ANV_ARENA_IMPLEMENTATION */
+
+#endif /* ANV_ARENA_H */
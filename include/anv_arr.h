@@ -36,6 +36,20 @@ An array self-contains within a single alloc all its elements + extra info
 Once the array's reaches max initial capacity, the next item's insert will
 automatically trigger an array expansion to accomodate the new item.
 
+By default arrays grow geometrically (2x, see anv_arr_reallocator_2x) so that
+pushing N items only costs O(log N) reallocations. The default growth policy
+can be changed at compile time by defining ANV_ARR_DEFAULT_REALLOCATOR before
+including the implementation:
+
+```c
+#define ANV_ARR_DEFAULT_REALLOCATOR anv_arr_reallocator_1_5x
+#define ANV_ARR_IMPLEMENTATION
+#include "anv_arr.h"
+```
+
+When the final number of items is known beforehand, prefer anv_arr_reserve or
+anv_arr_resize to allocate all the needed memory at once.
+
 All array's items are fully stored inside the array as a contiguous block of
 memory using memcpy/memset.
 
@@ -51,20 +65,98 @@ another type of runtime error. The correct way to address this is to ensure
 no asserts are triggered during development (meaning no invalid parameters are
 passed to methods).
 
+## Trusted mode
+
+All methods validate the passed array with anv_meta_get before doing any work,
+which means reading the metadata size and the check bytes on every call.
+Defining ANV_ARR_TRUSTED before including the implementation skips these checks
+(see anv_meta_get_unchecked). Only do this once the code is known to never pass
+arrays which were not created by anv_arr_new. The inline accessors
+(anv_arr_data, anv_arr_end, anv_arr_foreach) follow ANV_ARR_TRUSTED as defined
+wherever the header is included.
+
+For tight loops prefer anv_arr_data/anv_arr_begin/anv_arr_end or
+anv_arr_foreach: the array is validated once and items are then accessed
+through a plain typed pointer.
+
+## Memory usage
+
+anv_arr_get_usage reports how the memory of a single array is spent: items,
+unused capacity (slack) and header overhead.
+
+Define ANV_ARR_ENABLE_STATS before including the implementation to also keep
+process wide counters of created arrays, reallocations and growths plus
+histograms of how many times arrays grew and how long they were when
+destroyed (see anv_arr_stats_snapshot), meant to pick initial capacities and
+growth policies from real workloads. Define ANV_METALLOC_ENABLE_STATS as well
+for byte level allocator stats. Without the define no counter is compiled in.
+
+## Saving and mapping
+
+anv_arr_save writes an array to a file as a fixed header (see
+anv_arr_file_header) followed by the raw items. anv_arr_map_readonly maps such
+a file back as a read-only array without copying or pushing a single item:
+only the pages actually read are loaded. Systems without mmap or
+MapViewOfFile read the whole file into the heap instead. Files can only be
+mapped by hosts with the same byte order and item layout as the one which saved
+them. Views are read-only: all methods which would modify them fail.
+
 ## Dependencies
 
 - anv_metalloc.h
+- anv_hhoh.h (Windows only)
 
 ## Include usage
 
 ```c
 // only if metalloc define is not already present somewhere else.
 #define ANV_METALLOC_IMPLEMENTATION
+// windows only, if hhoh define is not already present somewhere else.
+#define ANV_HHOH_IMPLEMENTATION
 
 #define ANV_ARR_IMPLEMENTATION
 #include "anv_arr.h"
 ```
 
+## Sorting
+
+- anv_arr_sort: generic in-place introsort (quicksort + heapsort fallback +
+  insertion sort for small ranges). Items of 4, 8 and 16 bytes are swapped with
+  plain word moves.
+- ANV_ARR_DEFINE_SORT: generates a sort function specialized for a given item
+  type with an inlined comparator.
+- anv_arr_sort_radix: LSD radix sort for arrays sorted by an integer key found
+  at a fixed offset inside each item.
+- anv_arr_sort_parallel: multi-threaded merge sort for very large arrays,
+  available only when ANV_ARR_ENABLE_THREADS is defined (requires POSIX threads,
+  link with -pthread).
+
+## Searching
+
+All search methods expect the array to be sorted with the same compare function
+used for the lookup, the searched key is always passed as first param to it.
+
+- anv_arr_bsearch, anv_arr_lower_bound, anv_arr_upper_bound: plain binary
+  searches, anv_arr_insert_sorted keeps an array sorted while inserting.
+- anv_arr_lower_bound_branchless, ANV_ARR_DEFINE_LOWER_BOUND: binary search
+  without data dependent branches which prefetches the next midpoints, faster on
+  big arrays where each step misses the cache.
+- anv_arr_eytzinger_new: builds a read-only copy of a sorted array in Eytzinger
+  layout, meant for read-mostly lookup tables. Search it with
+  anv_arr_eytzinger_bsearch and anv_arr_eytzinger_lower_bound.
+
+## Inline arrays
+
+Short-lived arrays which usually hold few items can start inside a caller
+owned buffer (see anv_arr_new_inline and ANV_ARR_INLINE_BUFFER), they move to
+the heap only once they outgrow it.
+
+## Typed arrays
+
+ANV_ARR_DEFINE(name, type) generates a typed array and a set of inline methods
+(name_push, name_at, ...) working with items by value. Typed arrays are regular
+anv_arr arrays and can be passed to all the other anv_arr methods as well.
+
 ## Examples
 
 ```c
@@ -110,17 +202,10 @@ main(void)
 #ifndef ANV_ARR_H
 #define ANV_ARR_H
 
-/*
-TODO: anv_arr missing methods list
-- remove_slow (delete entry at index and traslate all after to keep order)
-- pop_first_slow (return and remove first entry, always uses delete_slow)
-- push_first (add to head and move existing at spot to last)
-- push_first_slow (add to head and traslate all to keep order)
-- replace (replace item at index)
-- sorting algorithms (qsort, etc)
-*/
-
 #include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint32_t, uint64_t */
+
+#include "anv_metalloc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -151,6 +236,15 @@ typedef enum anv_arr_result {
      * Two indexes collide with each-other (e.g. are most likely equal).
      */
     ANV_ARR_RESULT_INDEX_COLLISION = 11,
+    /**
+     * A file could not be opened, read, written or mapped.
+     */
+    ANV_ARR_RESULT_IO_ERROR = 12,
+    /**
+     * A file is not an array saved by anv_arr_save, or was saved by an
+     * incompatible version or host.
+     */
+    ANV_ARR_RESULT_BAD_FORMAT = 13,
 } anv_arr_result;
 
 /**
@@ -181,10 +275,106 @@ typedef size_t (*anv_arr_reallocator_fn)(size_t old_capacity);
  * to expand the array to.
  * @note A default reallocator is present by default and can be re-assigned by
  *       passing NULL as a parameter.
+ * @note The reallocator is shared by all arrays in the process which do not
+ *       have their own growth_fn (see anv_arr_options) and changing it while
+ *       other threads are using arrays is a data race. Prefer per-array
+ *       growth callbacks whenever possible.
  * @param fn Custom reallocator fn to assign.
  */
 void anv_arr_config_reallocator_fn(anv_arr_reallocator_fn fn);
 
+/**
+ * Built-in reallocator which grows the array's capacity by 8 items at a time.
+ * @note Pushing N items with this policy costs O(N) reallocations, only use it
+ *       for arrays which never grow much past their initial capacity.
+ */
+size_t anv_arr_reallocator_linear(size_t old_capacity);
+
+/**
+ * Built-in geometric reallocator which grows the array's capacity by 1.5x.
+ */
+size_t anv_arr_reallocator_1_5x(size_t old_capacity);
+
+/**
+ * Built-in geometric reallocator which doubles the array's capacity.
+ * This is the default reallocator (see ANV_ARR_DEFAULT_REALLOCATOR).
+ */
+size_t anv_arr_reallocator_2x(size_t old_capacity);
+
+/**
+ * Per-array growth callback used to determine the new size to assign to an
+ * existing array when it has reached max capacity.
+ *
+ * Growth fn example:
+ * @code{.c}
+ * size_t
+ * my_custom_growth(void *user_ctx, size_t old_capacity)
+ * {
+ *     size_t step = *(size_t *)user_ctx;
+ *     return old_capacity + step;
+ * }
+ * @endcode
+ *
+ * @param user_ctx User context set with anv_arr_options growth_ctx.
+ * @param old_capacity The previous array's max capacity.
+ * @return The new array's max capacity, which must be > old_capacity.
+ */
+typedef size_t (*anv_arr_growth_fn)(void *user_ctx, size_t old_capacity);
+
+/**
+ * Array creation options (see anv_arr_new_with_options).
+ *
+ * Example:
+ * @code{.c}
+ * anv_arr_t arr = anv_arr_new_with_options(&(anv_arr_options) {
+ *     .arr_capacity = 16,
+ *     .item_sz = sizeof(item_t),
+ *     .growth_fn = my_custom_growth,
+ *     .growth_ctx = &my_step,
+ * });
+ * @endcode
+ */
+typedef struct anv_arr_options {
+    /** Initial array's max capacity, always > 0. */
+    size_t arr_capacity;
+    /** Size of an item to be inserted in the array, always > 0. */
+    size_t item_sz;
+    /**
+     * Optional growth callback for this array only. When NULL, the global
+     * reallocator is used (see anv_arr_config_reallocator_fn).
+     */
+    anv_arr_growth_fn growth_fn;
+    /** Optional user context passed as is to growth_fn. */
+    void *growth_ctx;
+    /**
+     * Optional caller owned buffer to store the array in, declare it with
+     * ANV_ARR_INLINE_BUFFER. The array's capacity is then given by the buffer
+     * size and arr_capacity is ignored. See anv_arr_new_inline.
+     */
+    void *inline_buffer;
+    /** Size in bytes of inline_buffer. */
+    size_t inline_buffer_sz;
+    /**
+     * Optional allocator for the array's memory, NULL for the metalloc default
+     * one (see anv_meta_set_default_allocator). Inline arrays outgrowing their
+     * buffer always move to the default allocator.
+     */
+    const anv_meta_allocator *allocator;
+    /**
+     * Optional alignment in bytes of the array's first item, 0 for none. Must
+     * be a power of 2, e.g. ANV_ARR_CACHE_LINE_SIZE. Ignored for inline arrays.
+     */
+    size_t alignment;
+} anv_arr_options;
+
+/**
+ * Cache line size assumed by anv_arr, use it as anv_arr_options.alignment to
+ * make the array's items start on a cache line boundary.
+ */
+#ifndef ANV_ARR_CACHE_LINE_SIZE
+#define ANV_ARR_CACHE_LINE_SIZE 64
+#endif
+
 /**
  * Allocate a new array with initial max capacity.
  * @param arr_capacity Initial array's max capacity, always > 0.
@@ -193,6 +383,59 @@ void anv_arr_config_reallocator_fn(anv_arr_reallocator_fn fn);
  */
 anv_arr_t anv_arr_new(size_t arr_capacity, size_t item_sz);
 
+/**
+ * Allocate a new array with custom options.
+ * @param options Array options, see anv_arr_options.
+ * @return New array, NULL on invalid params or internal alloc errors.
+ */
+anv_arr_t anv_arr_new_with_options(const anv_arr_options *options);
+
+/**
+ * Size in bytes of a buffer able to store an inline array of capacity items.
+ */
+#define ANV_ARR_INLINE_BUFFER_SIZE(capacity, item_sz)                          \
+    ANV_META_BUFFER_SIZE(                                                      \
+        sizeof(anv_arr__metadata), ((capacity) + 1) * (item_sz)                \
+    )
+
+/**
+ * Declare a correctly aligned buffer named name able to store an inline array
+ * of capacity items.
+ */
+#define ANV_ARR_INLINE_BUFFER(name, capacity, item_sz)                         \
+    size_t name[(ANV_ARR_INLINE_BUFFER_SIZE(capacity, item_sz)                 \
+                 + sizeof(size_t) - 1)                                         \
+                / sizeof(size_t)]
+
+/**
+ * Create a new array stored inside a caller owned buffer (e.g. on the stack or
+ * inside a struct). No allocation happens until the array outgrows the buffer,
+ * then all items are moved to the heap and the buffer is no longer used.
+ *
+ * The array must still be destroyed with anv_arr_destroy, which frees its heap
+ * memory if it ever moved there. The buffer must outlive the array.
+ *
+ * Example:
+ * @code{.c}
+ * ANV_ARR_INLINE_BUFFER(buffer, 16, sizeof(item_t));
+ * anv_arr_t arr = anv_arr_new_inline(buffer, sizeof(buffer), sizeof(item_t));
+ * // ... up to 16 items can be pushed without allocating.
+ * anv_arr_destroy(arr);
+ * @endcode
+ *
+ * @param buffer Buffer where to store the array, see ANV_ARR_INLINE_BUFFER.
+ * @param buffer_sz Size in bytes of buffer.
+ * @param item_sz Size of an item to be inserted in the array.
+ * @return New array, NULL if the buffer is too small for at least 1 item.
+ */
+anv_arr_t anv_arr_new_inline(void *buffer, size_t buffer_sz, size_t item_sz);
+
+/**
+ * Check whether the array is still stored in its caller owned buffer.
+ * @return 1 if inline, 0 if the array is allocated on the heap.
+ */
+int anv_arr_is_inline(anv_arr_t arr);
+
 /**
  * Destroy an array.
  */
@@ -204,6 +447,114 @@ void anv_arr_destroy(anv_arr_t arr);
  */
 size_t anv_arr_length(anv_arr_t arr);
 
+/**
+ * Get max number of items the array can store before needing to expand.
+ * @return 0 if cannot determine array capacity.
+ */
+size_t anv_arr_capacity(anv_arr_t arr);
+
+/**
+ * Get number of reallocations performed to expand the array's capacity since
+ * its creation (automatic growths and anv_arr_reserve/anv_arr_resize calls).
+ * @note Useful to tune initial capacities and growth policies.
+ * @return 0 if cannot determine array growth count.
+ */
+size_t anv_arr_grow_count(anv_arr_t arr);
+
+/**
+ * Memory used by a single array (see anv_arr_get_usage).
+ */
+typedef struct anv_arr_usage {
+    /** Bytes of the items currently stored. */
+    size_t item_bytes;
+    /** Bytes reserved for items, i.e. capacity * item size. */
+    size_t capacity_bytes;
+    /** Reserved but unused bytes, i.e. capacity_bytes - item_bytes. */
+    size_t slack_bytes;
+    /**
+     * Bytes spent on anything but items: metalloc header, array metadata,
+     * alignment padding and the swap slot. 0 for the header of inline arrays.
+     */
+    size_t overhead_bytes;
+    /** Same as anv_arr_grow_count. */
+    size_t grow_count;
+} anv_arr_usage;
+
+/**
+ * Get the memory used by the array.
+ * @param out_usage Filled on success.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_get_usage(anv_arr_t arr, anv_arr_usage *out_usage);
+
+#ifdef ANV_ARR_ENABLE_STATS
+/**
+ * Buckets count of anv_arr_stats histograms.
+ */
+#define ANV_ARR_STATS_BUCKETS 32
+
+/**
+ * Process wide anv_arr counters (see ANV_ARR_ENABLE_STATS).
+ */
+typedef struct anv_arr_stats {
+    size_t created_count;
+    size_t destroyed_count;
+    size_t live_count;
+    /** Capacity bytes of live arrays, swap slots excluded. */
+    size_t live_capacity_bytes;
+    /** All successful reallocations: growths and shrinks. */
+    size_t realloc_count;
+    /** Reallocations which expanded the capacity (see anv_arr_grow_count). */
+    size_t grow_count;
+    /** Growths which moved the array to a new address. */
+    size_t grow_moves;
+    /**
+     * Destroyed arrays by their grow count, the last bucket also holds all
+     * arrays which grew more often.
+     */
+    size_t grow_count_histogram[ANV_ARR_STATS_BUCKETS];
+    /**
+     * Destroyed arrays by their final length: bucket 0 holds lengths 0 and 1,
+     * bucket i lengths in [2^i, 2^(i+1)) and the last bucket everything
+     * longer.
+     */
+    size_t length_histogram[ANV_ARR_STATS_BUCKETS];
+} anv_arr_stats;
+
+/**
+ * Copy current counters to out_stats. Counters are read one by one, while
+ * other threads use arrays they might not be consistent with each other.
+ */
+void anv_arr_stats_snapshot(anv_arr_stats *out_stats);
+
+/**
+ * Zero all counters but live ones.
+ */
+void anv_arr_stats_reset(void);
+#endif
+
+anv_arr_result anv_arr__reserve(anv_arr_t *refarr, size_t capacity);
+
+/**
+ * Ensure the array can store at least capacity items without any further
+ * reallocation. Does nothing if the array's capacity is already large enough.
+ * @param capacity Min array's capacity to reserve.
+ * @return Status code.
+ */
+#define anv_arr_reserve(arr, capacity)                                         \
+    anv_arr__reserve((void *)&(arr), capacity)
+
+anv_arr_result anv_arr__resize(anv_arr_t *refarr, size_t length);
+
+/**
+ * Change the array's length. New items are zeroed, exceeding items are
+ * dropped. The array is reallocated at most once and only when length exceeds
+ * the current capacity.
+ * @param length New array's length.
+ * @return Status code.
+ */
+#define anv_arr_resize(arr, length) anv_arr__resize((void *)&(arr), length)
+
 anv_arr_result anv_arr__insert(anv_arr_t *refarr, size_t index, void *item);
 
 /**
@@ -223,6 +574,34 @@ anv_arr_result anv_arr__insert(anv_arr_t *refarr, size_t index, void *item);
 #define anv_arr_insert_new(arr, index, type, fields)                           \
     anv_arr_insert(arr, index, &(type)fields)
 
+anv_arr_result
+anv_arr__insert_slow(anv_arr_t *refarr, size_t index, void *item);
+
+/**
+ * Insert item at index and translate all the items after it by one spot.
+ * This method guarantees items order at the cost of moving the array's tail.
+ * @param item Object to insert, can be NULL but it's not recommended.
+ * @return Status code.
+ */
+#define anv_arr_insert_slow(arr, index, item)                                  \
+    anv_arr__insert_slow((void *)&(arr), index, item)
+
+/**
+ * Add item to the head of the array and move the old first item to last.
+ * This method does not guarantee items order.
+ * @param item Object to insert, can be NULL but it's not recommended.
+ * @return Status code.
+ */
+#define anv_arr_push_first(arr, item) anv_arr_insert(arr, 0, item)
+
+/**
+ * Add item to the head of the array and translate all the items by one spot.
+ * This method guarantees items order.
+ * @param item Object to insert, can be NULL but it's not recommended.
+ * @return Status code.
+ */
+#define anv_arr_push_first_slow(arr, item) anv_arr_insert_slow(arr, 0, item)
+
 anv_arr_result anv_arr__push(anv_arr_t *refarr, void *item);
 
 /**
@@ -253,6 +632,46 @@ anv_arr_result anv_arr__push(anv_arr_t *refarr, void *item);
  */
 #define anv_arr_push_new(arr, type, fields) anv_arr_push(arr, &(type)fields)
 
+anv_arr_result anv_arr__push_n(anv_arr_t *refarr, void *items, size_t count);
+
+/**
+ * Push count contiguous items to the end of the array.
+ * The array is expanded at most once and all items are copied at once.
+ * @param items Pointer to the first of count contiguous items to insert. Can
+ *              be NULL to push count zeroed items.
+ * @param count Number of items to push.
+ * @return Status code.
+ */
+#define anv_arr_push_n(arr, items, count)                                      \
+    anv_arr__push_n((void *)&(arr), items, count)
+
+anv_arr_result anv_arr__insert_range(
+    anv_arr_t *refarr, size_t index, void *items, size_t count
+);
+
+/**
+ * Insert count contiguous items starting at index and move the old items found
+ * in their spots at the end of the array.
+ * This method does not guarantee items order (same as anv_arr_insert).
+ * The array is expanded at most once and all items are copied at once.
+ * @param items Pointer to the first of count contiguous items to insert. Can
+ *              be NULL to insert count zeroed items.
+ * @param count Number of items to insert.
+ * @return Status code.
+ */
+#define anv_arr_insert_range(arr, index, items, count)                         \
+    anv_arr__insert_range((void *)&(arr), index, items, count)
+
+anv_arr_result anv_arr__extend(anv_arr_t *refdst, anv_arr_t src);
+
+/**
+ * Push all items of src array to the end of dst array.
+ * Both arrays must have the same item size. Extending an array with itself is
+ * supported.
+ * @return Status code.
+ */
+#define anv_arr_extend(dst, src) anv_arr__extend((void *)&(dst), src)
+
 void *anv_arr__pop(anv_arr_t arr);
 
 /**
@@ -261,6 +680,16 @@ void *anv_arr__pop(anv_arr_t arr);
  */
 #define anv_arr_pop(arr, type) ((type *)anv_arr__pop(arr))
 
+void *anv_arr__pop_first_slow(anv_arr_t arr);
+
+/**
+ * Get and remove first item from array while keeping items order.
+ * @note Same as anv_arr_pop, the returned item is only valid until the next
+ *       array modification.
+ * @return NULL, if the array is empty.
+ */
+#define anv_arr_pop_first_slow(arr, type) ((type *)anv_arr__pop_first_slow(arr))
+
 void *anv_arr__get(anv_arr_t arr, size_t index);
 
 /**
@@ -282,6 +711,45 @@ void *anv_arr__get(anv_arr_t arr, size_t index);
  */
 #define anv_arr_get(arr, type, index) ((type *)anv_arr__get(arr, index))
 
+/**
+ * Get a typed pointer to the first item of the array.
+ * Items are contiguous so the returned pointer can be indexed as a plain C
+ * array up to anv_arr_length items. The pointer is invalidated by any
+ * operation which may reallocate the array.
+ * @return NULL if arr is not a valid array.
+ */
+#define anv_arr_data(arr, type) ((type *)anv_arr__data(arr))
+
+/**
+ * Get a typed pointer to the first item of the array, same as anv_arr_data.
+ */
+#define anv_arr_begin(arr, type) anv_arr_data(arr, type)
+
+/**
+ * Get a typed pointer one past the last item of the array.
+ */
+#define anv_arr_end(arr, type) ((type *)anv_arr__end(arr))
+
+/**
+ * Iterate over all array items with it being a (type *) to the current item.
+ * The array is validated only once before the loop, then the iteration runs on
+ * a plain pointer range the compiler is free to unroll and vectorize.
+ * The array must not be reallocated (e.g. pushing items) while iterating.
+ *
+ * Example:
+ * @code{.c}
+ * int sum = 0;
+ * anv_arr_foreach(arr, item_t, it) {
+ *     sum += it->a;
+ * }
+ * @endcode
+ */
+#define anv_arr_foreach(arr, type, it)                                         \
+    for (type *it = anv_arr_begin(arr, type),                                  \
+              *it##__end = it ? (type *)anv_arr__end_unchecked(it) : it;       \
+         it != it##__end;                                                      \
+         ++it)
+
 /**
  * Swap the 2 items found at the 2 passed indexes.
  * This method performs no allocations during the swap.
@@ -297,6 +765,57 @@ anv_arr_result anv_arr_swap(anv_arr_t arr, size_t index_a, size_t index_b);
  */
 anv_arr_result anv_arr_remove(anv_arr_t arr, size_t index);
 
+/**
+ * Replace the item found at index with a new one.
+ * This method performs no allocations.
+ * @param item Object to insert, can be NULL but it's not recommended.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_replace(anv_arr_t arr, size_t index, void *item);
+
+/**
+ * Delete an item from the array at the specified index and translate all the
+ * items after it by one spot.
+ * This method guarantees items order.
+ * This method performs no allocations.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_remove_slow(anv_arr_t arr, size_t index);
+
+/**
+ * Predicate callback used to select items in the array.
+ * @param user_ctx User context passed as is.
+ * @param item Item to check.
+ * @return Non-zero if the item matches.
+ */
+typedef int (*anv_arr_predicate_fn)(void *user_ctx, void *item);
+
+/**
+ * Delete all items matching the predicate.
+ * This method guarantees items order and performs a single linear pass over
+ * the array, each kept item is moved at most once.
+ * This method performs no allocations.
+ * @param pred Predicate returning non-zero for items to remove.
+ * @param user_ctx User context passed as is to pred.
+ * @param out_removed Optional number of removed items.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_remove_if(
+    anv_arr_t arr,
+    anv_arr_predicate_fn pred,
+    void *user_ctx,
+    size_t *out_removed
+);
+
+/**
+ * Delete count items from the array starting at the specified index.
+ * The created hole is filled with the last items of the array.
+ * This method does not guarantee items order (same as anv_arr_remove).
+ * This method performs no allocations.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_remove_range(anv_arr_t arr, size_t index, size_t count);
+
 anv_arr_result anv_arr__shrink_to_fit(anv_arr_t *refarr);
 
 /**
@@ -305,345 +824,2986 @@ anv_arr_result anv_arr__shrink_to_fit(anv_arr_t *refarr);
  */
 #define anv_arr_shrink_to_fit(arr) anv_arr__shrink_to_fit((void *)&(arr))
 
-#ifdef __cplusplus
-}
-#endif
+/**
+ * Compare callback used to sort arrays, same as the one used by qsort.
+ * @return < 0 if a goes before b, 0 if a and b are equal and > 0 otherwise.
+ */
+typedef int (*anv_arr_compare_fn)(const void *a, const void *b);
 
-#ifdef ANV_ARR_IMPLEMENTATION
+/**
+ * Sort array in place with an introsort (not stable).
+ * This method performs no allocations.
+ * @param cmp Items compare function.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_sort(anv_arr_t arr, anv_arr_compare_fn cmp);
 
-#include "anv_metalloc.h"
+/**
+ * Sort array in place with an LSD radix sort using an unsigned or signed
+ * integer key found at key_offset bytes inside each item (stable).
+ * @note This method temporarily allocates a buffer as big as the array.
+ * @param key_offset Offset of the key inside each item (e.g. offsetof).
+ * @param key_sz Key size, must be 1, 2, 4 or 8 bytes.
+ * @param is_signed Non-zero if the key is a signed integer.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_sort_radix(
+    anv_arr_t arr, size_t key_offset, size_t key_sz, int is_signed
+);
 
-#ifndef anv_arr__assert
-#include <assert.h>
-#define anv_arr__assert(cond, msg) assert((cond) && (msg))
+#ifdef ANV_ARR_ENABLE_THREADS
+/**
+ * Arrays shorter than this are never sorted in parallel.
+ */
+#ifndef ANV_ARR_PARALLEL_SORT_THRESHOLD
+#define ANV_ARR_PARALLEL_SORT_THRESHOLD 65536
 #endif
 
-#ifdef __GNUC__
-#define ANV_ARR__LIKELY(x)   __builtin_expect((x), 1)
-#define ANV_ARR__UNLIKELY(x) __builtin_expect((x), 0)
-#else
-#define ANV_ARR__LIKELY(x)   (x)
-#define ANV_ARR__UNLIKELY(x) (x)
+/**
+ * Sort array using up to n_threads threads (not stable).
+ * The array is split in n_threads chunks which are sorted concurrently and
+ * then merged together in parallel rounds.
+ * Falls back to anv_arr_sort for arrays shorter than
+ * ANV_ARR_PARALLEL_SORT_THRESHOLD or when n_threads <= 1.
+ * @note This method temporarily allocates a buffer as big as the array.
+ * @param cmp Items compare function, must be thread-safe.
+ * @param n_threads Max number of threads to use (capped to 64).
+ * @return Status code.
+ */
+anv_arr_result
+anv_arr_sort_parallel(anv_arr_t arr, anv_arr_compare_fn cmp, size_t n_threads);
 #endif
 
-typedef struct anv_arr__metadata {
-    size_t arr_sz;
-    size_t arr_capacity;
-    size_t item_sz;
-    // This is used to perform swaps without having to allocate extra memory.
-    // Always leave as last element in the struct.
-    // Always access with ANV_ARR__TMP_ITEM(metadata).
-    void *tmp_item;
-} anv_arr__metadata;
-
-#define ANV_ARR__TMP_ITEM_OFFSET    offsetof(anv_arr__metadata, tmp_item)
-#define ANV_ARR__TMP_ITEM(metadata) ((metadata) + ANV_ARR__TMP_ITEM_OFFSET)
+/**
+ * Find the index of the first item not lower than key in a sorted array.
+ * @param key Object to search, passed as first param to cmp.
+ * @param cmp Compare function used to sort the array.
+ * @return Index in [0, length], length if all items are lower than key.
+ */
+size_t
+anv_arr_lower_bound(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp);
 
-static size_t
-anv_arr__reallocator_default(size_t old_capacity)
-{
-    return old_capacity + 8;
-}
+/**
+ * Find the index of the first item greater than key in a sorted array.
+ * @param key Object to search, passed as first param to cmp.
+ * @param cmp Compare function used to sort the array.
+ * @return Index in [0, length], length if no item is greater than key.
+ */
+size_t
+anv_arr_upper_bound(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp);
+
+/**
+ * Same as anv_arr_lower_bound but the search loop has no data dependent
+ * branches and prefetches both possible next midpoints at each step.
+ * Prefer it for large arrays which do not fit in cache.
+ */
+size_t anv_arr_lower_bound_branchless(
+    anv_arr_t arr, const void *key, anv_arr_compare_fn cmp
+);
+
+void *anv_arr__bsearch(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp);
+
+/**
+ * Find an item equal to key in a sorted array using a binary search.
+ * If multiple items are equal to key, the first one is returned.
+ *
+ * Example:
+ * @code{.c}
+ * item_t key = { .a = 42 };
+ * item_t *it = anv_arr_bsearch(arr, item_t, &key, cmp_item);
+ * @endcode
+ *
+ * @return NULL if no item is equal to key or an internal error happened.
+ */
+#define anv_arr_bsearch(arr, type, key, cmp)                                   \
+    ((type *)anv_arr__bsearch(arr, key, cmp))
+
+anv_arr_result
+anv_arr__insert_sorted(anv_arr_t *refarr, void *item, anv_arr_compare_fn cmp);
+
+/**
+ * Insert item in an already sorted array keeping it sorted.
+ * Items equal to the new one are kept before it (stable).
+ * @param item Object to insert, cannot be NULL.
+ * @param cmp Compare function used to sort the array.
+ * @return Status code.
+ */
+#define anv_arr_insert_sorted(arr, item, cmp)                                  \
+    anv_arr__insert_sorted((void *)&(arr), item, cmp)
+
+/**
+ * Create a read-only copy of a sorted array with its items stored in
+ * Eytzinger (BFS) order. Lookups on this layout access memory in a cache
+ * friendly way and can prefetch several levels ahead.
+ * The returned array is read-only and has its length as capacity: methods
+ * which would modify it fail with ANV_ARR_RESULT_INVALID_PARAMS, as they do
+ * on mapped views. Search it only with the anv_arr_eytzinger_* methods and
+ * destroy it with anv_arr_destroy.
+ * @param sorted_arr Array sorted by the compare fn used for the lookups.
+ * @return New array, NULL on error.
+ */
+anv_arr_t anv_arr_eytzinger_new(anv_arr_t sorted_arr);
+
+void *anv_arr__eytzinger_lower_bound(
+    anv_arr_t eyt_arr, const void *key, anv_arr_compare_fn cmp
+);
+
+/**
+ * Find the first item not lower than key in an Eytzinger array.
+ * @return NULL if all items are lower than key.
+ */
+#define anv_arr_eytzinger_lower_bound(arr, type, key, cmp)                     \
+    ((type *)anv_arr__eytzinger_lower_bound(arr, key, cmp))
+
+void *anv_arr__eytzinger_bsearch(
+    anv_arr_t eyt_arr, const void *key, anv_arr_compare_fn cmp
+);
+
+/**
+ * Find an item equal to key in an Eytzinger array.
+ * @return NULL if no item is equal to key.
+ */
+#define anv_arr_eytzinger_bsearch(arr, type, key, cmp)                         \
+    ((type *)anv_arr__eytzinger_bsearch(arr, key, cmp))
+
+/**
+ * Version of the file layout written by anv_arr_save.
+ */
+#define ANV_ARR_FILE_VERSION 1
+
+/**
+ * Written in the header to detect files saved by a host with a different byte
+ * order.
+ */
+#define ANV_ARR_FILE_BYTE_ORDER 0x01020304u
+
+/**
+ * Header at the start of the files written by anv_arr_save, the raw items
+ * follow at data_offset. All fields are stored in host byte order.
+ */
+typedef struct anv_arr_file_header {
+    /** "ANVARR" padded with zeroes. */
+    char magic[8];
+    uint32_t version;
+    /** ANV_ARR_FILE_BYTE_ORDER. */
+    uint32_t byte_order;
+    uint64_t item_sz;
+    uint64_t length;
+    /** Capacity of the saved array, only length items are stored. */
+    uint64_t capacity;
+    /** Offset of the first item from the start of the file. */
+    uint64_t data_offset;
+} anv_arr_file_header;
+
+/**
+ * Write all the array's items to a file in a single pass, see
+ * anv_arr_file_header for the layout.
+ * @param filename File to create or overwrite.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_save(anv_arr_t arr, const char *filename);
+
+/**
+ * Open a file written by anv_arr_save as a read-only array without copying
+ * its items: the file is memory mapped and items are loaded by the OS on first
+ * access. The file only needs read access. Where memory mapping is not
+ * available the view is not zero-copy: the whole file is read into a heap
+ * block with a single fread.
+ *
+ * The view has the saved length as capacity and can be passed to all the
+ * methods which do not modify the array (length, get, data, foreach, sorted
+ * searches, anv_arr_eytzinger_new, ...). Its memory is write protected:
+ * methods which would modify it (push, insert, set, remove, swap, sort, ...)
+ * fail with ANV_ARR_RESULT_INVALID_PARAMS and pop methods return NULL.
+ * anv_arr_shrink_to_fit does nothing. Destroy it with anv_arr_destroy.
+ *
+ * @param filename File written by anv_arr_save.
+ * @param out_arr Set to the new array on success, NULL otherwise.
+ * @return Status code.
+ */
+anv_arr_result anv_arr_map_readonly(const char *filename, anv_arr_t *out_arr);
+
+/**
+ * Check whether the array is a view created by anv_arr_map_readonly.
+ * @return 1 if mapped, 0 otherwise.
+ */
+int anv_arr_is_mapped(anv_arr_t arr);
+
+/**
+ * Check whether the array rejects modifications: mapped views and arrays
+ * created by anv_arr_eytzinger_new.
+ * @return 1 if read-only, 0 otherwise.
+ */
+int anv_arr_is_readonly(anv_arr_t arr);
+
+#ifdef __GNUC__
+#define ANV_ARR__LIKELY(x)      __builtin_expect((x), 1)
+#define ANV_ARR__UNLIKELY(x)    __builtin_expect((x), 0)
+#define ANV_ARR__MAYBE_UNUSED   __attribute__((unused))
+#define ANV_ARR__PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define ANV_ARR__LIKELY(x)      (x)
+#define ANV_ARR__UNLIKELY(x)    (x)
+#define ANV_ARR__MAYBE_UNUSED
+#define ANV_ARR__PREFETCH(addr) ((void)(addr))
+#endif
+
+/**
+ * Array metadata stored by metalloc right before the array's items.
+ * Internal, it's public only so that the inline methods generated by
+ * ANV_ARR_DEFINE can access it directly.
+ */
+typedef struct anv_arr__metadata {
+    size_t arr_sz;
+    size_t arr_capacity;
+    size_t item_sz;
+    size_t grow_count;
+    anv_arr_growth_fn growth_fn;
+    void *growth_ctx;
+    // Non-zero while the array lives in a caller owned buffer.
+    int is_inline;
+    // Non-zero for read-only views created by anv_arr_map_readonly.
+    int is_mapped;
+    // Non-zero for mapped views and anv_arr_eytzinger_new arrays.
+    int is_readonly;
+} anv_arr__metadata;
+
+/**
+ * Mapped views live in read-only memory, their metadata included, and
+ * Eytzinger arrays lose their order if modified: every mutating method
+ * rejects them.
+ */
+#define ANV_ARR__IS_READONLY(metadata) ((metadata)->is_readonly)
+
+// Also used by the generated functions below.
+#ifndef anv_arr__assert
+#include <assert.h>
+#define anv_arr__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+// Also used by the inline accessors below, so ANV_ARR_TRUSTED applies to
+// them where they are expanded, not where the implementation is.
+#ifdef ANV_ARR_TRUSTED
+#define anv_arr__meta_get(arr) anv_meta_get_unchecked(arr)
+#else
+#define anv_arr__meta_get(arr) anv_meta_get(arr)
+#endif
+
+ANV_ARR__MAYBE_UNUSED static inline void *
+anv_arr__data(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return NULL;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return NULL;
+    }
+    return arr;
+}
+
+// arr must be already validated.
+ANV_ARR__MAYBE_UNUSED static inline void *
+anv_arr__end_unchecked(anv_arr_t arr)
+{
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_meta_get_unchecked(arr);
+    return (char *)arr + metadata->arr_sz * metadata->item_sz;
+}
+
+ANV_ARR__MAYBE_UNUSED static inline void *
+anv_arr__end(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return NULL;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return NULL;
+    }
+    return (char *)arr + metadata->arr_sz * metadata->item_sz;
+}
+
+/**
+ * Ranges shorter than this are sorted with an insertion sort.
+ */
+#define ANV_ARR__SORT_INSERTION_THRESHOLD 16
+
+ANV_ARR__MAYBE_UNUSED static size_t
+anv_arr__log2(size_t n)
+{
+    size_t res = 0;
+    while (n >>= 1) {
+        ++res;
+    }
+    return res;
+}
+
+/**
+ * Generate a static sort function specialized for arrays of type items.
+ *
+ * The generated comparator is inlined and items are swapped by value, which
+ * lets the compiler use plain register moves instead of memcpy calls.
+ *
+ * Example:
+ * @code{.c}
+ * #define int_less(a, b) (*(a) < *(b))
+ * ANV_ARR_DEFINE_SORT(sort_ints, int, int_less)
+ *
+ * anv_arr_t arr = anv_arr_new(10, sizeof(int));
+ * // ...
+ * sort_ints(arr);
+ * @endcode
+ *
+ * Read-only arrays (see anv_arr_is_readonly) are left untouched.
+ *
+ * @param name Name of the generated function: void name(anv_arr_t arr).
+ * @param type Type of the items stored in the array.
+ * @param less Function or function-like macro taking 2 (type *) and returning
+ *             non-zero if the first item goes before the second one.
+ */
+#define ANV_ARR_DEFINE_SORT(name, type, less)                                  \
+    static void name##__insertion(type *base, size_t n)                        \
+    {                                                                          \
+        for (size_t i = 1; i < n; ++i) {                                       \
+            type item = base[i];                                               \
+            size_t j = i;                                                      \
+            for (; j > 0 && less(&item, &base[j - 1]); --j) {                  \
+                base[j] = base[j - 1];                                         \
+            }                                                                  \
+            base[j] = item;                                                    \
+        }                                                                      \
+    }                                                                          \
+    static void name##__sift_down(type *base, size_t root, size_t n)           \
+    {                                                                          \
+        size_t child;                                                          \
+        while ((child = 2 * root + 1) < n) {                                   \
+            if (child + 1 < n && less(&base[child], &base[child + 1])) {       \
+                ++child;                                                       \
+            }                                                                  \
+            if (!less(&base[root], &base[child])) {                            \
+                return;                                                        \
+            }                                                                  \
+            type tmp = base[root];                                             \
+            base[root] = base[child];                                          \
+            base[child] = tmp;                                                 \
+            root = child;                                                      \
+        }                                                                      \
+    }                                                                          \
+    static void name##__heap(type *base, size_t n)                             \
+    {                                                                          \
+        for (size_t i = n / 2; i-- > 0;) {                                     \
+            name##__sift_down(base, i, n);                                     \
+        }                                                                      \
+        for (size_t end = n - 1; end > 0; --end) {                             \
+            type tmp = base[0];                                                \
+            base[0] = base[end];                                               \
+            base[end] = tmp;                                                   \
+            name##__sift_down(base, 0, end);                                   \
+        }                                                                      \
+    }                                                                          \
+    static void name##__intro(type *base, size_t n, size_t depth)              \
+    {                                                                          \
+        while (n > ANV_ARR__SORT_INSERTION_THRESHOLD) {                        \
+            if (depth-- == 0) {                                                \
+                name##__heap(base, n);                                         \
+                return;                                                        \
+            }                                                                  \
+            type tmp;                                                          \
+            size_t mid = n / 2;                                                \
+            size_t last = n - 1;                                               \
+            if (less(&base[mid], &base[0])) {                                  \
+                tmp = base[mid], base[mid] = base[0], base[0] = tmp;           \
+            }                                                                  \
+            if (less(&base[last], &base[mid])) {                               \
+                tmp = base[last], base[last] = base[mid], base[mid] = tmp;     \
+                if (less(&base[mid], &base[0])) {                              \
+                    tmp = base[mid], base[mid] = base[0], base[0] = tmp;       \
+                }                                                              \
+            }                                                                  \
+            tmp = base[mid], base[mid] = base[0], base[0] = tmp;               \
+            type pivot = base[0];                                              \
+            size_t i = 1;                                                      \
+            size_t j = last;                                                   \
+            for (;;) {                                                         \
+                while (less(&base[i], &pivot)) {                               \
+                    ++i;                                                       \
+                }                                                              \
+                while (less(&pivot, &base[j])) {                               \
+                    --j;                                                       \
+                }                                                              \
+                if (i >= j) {                                                  \
+                    break;                                                     \
+                }                                                              \
+                tmp = base[i], base[i] = base[j], base[j] = tmp;               \
+                ++i;                                                           \
+                --j;                                                           \
+            }                                                                  \
+            if (j != 0) {                                                      \
+                base[0] = base[j];                                             \
+                base[j] = pivot;                                               \
+            }                                                                  \
+            if (j < n - j - 1) {                                               \
+                name##__intro(base, j, depth);                                 \
+                base += j + 1;                                                 \
+                n -= j + 1;                                                    \
+            } else {                                                           \
+                name##__intro(base + j + 1, n - j - 1, depth);                 \
+                n = j;                                                         \
+            }                                                                  \
+        }                                                                      \
+        name##__insertion(base, n);                                            \
+    }                                                                          \
+    ANV_ARR__MAYBE_UNUSED static void name(anv_arr_t arr)                      \
+    {                                                                          \
+        size_t n = anv_arr_length(arr);                                        \
+        if (n <= 1) {                                                          \
+            return;                                                            \
+        }                                                                      \
+        anv_arr__metadata *metadata                                            \
+            = (anv_arr__metadata *)anv_meta_get_unchecked(arr);                \
+        if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {               \
+            anv_arr__assert(0, "read-only arrays cannot be modified");         \
+            return;                                                            \
+        }                                                                      \
+        name##__intro((type *)arr, n, 2 * anv_arr__log2(n));                   \
+    }
+
+/**
+ * Generate a static lower bound function specialized for sorted arrays of type
+ * items: size_t name(anv_arr_t arr, type *key).
+ *
+ * The generated search is branchless with an inlined comparator, same as
+ * anv_arr_lower_bound_branchless.
+ *
+ * Example:
+ * @code{.c}
+ * #define int_less(a, b) (*(a) < *(b))
+ * ANV_ARR_DEFINE_LOWER_BOUND(lower_bound_ints, int, int_less)
+ *
+ * int key = 42;
+ * size_t index = lower_bound_ints(arr, &key);
+ * @endcode
+ *
+ * @param name Name of the generated function.
+ * @param type Type of the items stored in the array.
+ * @param less Function or function-like macro taking 2 (type *) and returning
+ *             non-zero if the first item goes before the second one.
+ */
+#define ANV_ARR_DEFINE_LOWER_BOUND(name, type, less)                           \
+    ANV_ARR__MAYBE_UNUSED static size_t name(anv_arr_t arr, type *key)         \
+    {                                                                          \
+        size_t n = anv_arr_length(arr);                                        \
+        if (n == 0) {                                                          \
+            return 0;                                                          \
+        }                                                                      \
+        type *first = (type *)arr;                                             \
+        type *base = first;                                                    \
+        while (n > 1) {                                                        \
+            size_t half = n / 2;                                               \
+            ANV_ARR__PREFETCH(base + half / 2);                                \
+            ANV_ARR__PREFETCH(base + half + half / 2);                         \
+            base = less(&base[half], key) ? base + half : base;                \
+            n -= half;                                                         \
+        }                                                                      \
+        return (size_t)(base - first) + (less(base, key) ? 1 : 0);             \
+    }
+
+anv_arr_result anv_arr__grow_to(anv_arr_t *refarr, size_t min_capacity);
+
+/**
+ * Generate a typed array: name is a (type *) pointing to the first item, which
+ * is at the same time a regular anv_arr_t usable with every other anv_arr
+ * method, along with static inline methods specialized for type items.
+ *
+ * Items are passed by value and their size is a compile-time constant, so
+ * accessing and copying them compiles down to plain loads and stores. Only
+ * growing the array goes through a regular anv_arr function call.
+ *
+ * Generated methods:
+ * - name name_new(size_t capacity)
+ * - void name_destroy(name arr)
+ * - size_t name_length(name arr)
+ * - size_t name_capacity(name arr)
+ * - type *name_at(name arr, size_t index): NULL if index is out of bounds.
+ * - anv_arr_result name_set(name arr, size_t index, type value)
+ * - anv_arr_result name_reserve(name *refarr, size_t capacity)
+ * - anv_arr_result name_push(name *refarr, type value)
+ * - type *name_pop(name arr): same semantics as anv_arr_pop.
+ * - void name_clear(name arr)
+ *
+ * @note Same as in ANV_ARR_TRUSTED mode, generated methods do not validate
+ *       the passed array: it must be a valid non NULL array created by
+ *       name_new (or anv_arr_new with sizeof(type) items). Read-only arrays
+ *       are still rejected: set and push fail, pop returns NULL and clear
+ *       does nothing.
+ *
+ * Example:
+ * @code{.c}
+ * ANV_ARR_DEFINE(int_arr, int)
+ *
+ * int_arr arr = int_arr_new(16);
+ * for (int i = 0; i < 100; ++i) {
+ *     int_arr_push(&arr, i);
+ * }
+ * int last = arr[int_arr_length(arr) - 1];
+ * int_arr_destroy(arr);
+ * @endcode
+ *
+ * @param name Name of the generated array type and methods prefix.
+ * @param type Type of the items stored in the array.
+ */
+#define ANV_ARR_DEFINE(name, type)                                             \
+    typedef type *name;                                                        \
+    static inline name name##_new(size_t capacity)                             \
+    {                                                                          \
+        return (name)anv_arr_new(capacity, sizeof(type));                      \
+    }                                                                          \
+    static inline void name##_destroy(name arr)                                \
+    {                                                                          \
+        anv_arr_destroy(arr);                                                  \
+    }                                                                          \
+    static inline size_t name##_length(name arr)                               \
+    {                                                                          \
+        return ((anv_arr__metadata *)anv_meta_get_unchecked(arr))->arr_sz;     \
+    }                                                                          \
+    static inline size_t name##_capacity(name arr)                             \
+    {                                                                          \
+        return ((anv_arr__metadata *)anv_meta_get_unchecked(arr))              \
+            ->arr_capacity;                                                    \
+    }                                                                          \
+    static inline type *name##_at(name arr, size_t index)                      \
+    {                                                                          \
+        return index < name##_length(arr) ? arr + index : NULL;                \
+    }                                                                          \
+    static inline anv_arr_result name##_set(                                   \
+        name arr, size_t index, type value                                     \
+    )                                                                          \
+    {                                                                          \
+        anv_arr__metadata *metadata                                            \
+            = (anv_arr__metadata *)anv_meta_get_unchecked(arr);                \
+        if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {               \
+            return ANV_ARR_RESULT_INVALID_PARAMS;                              \
+        }                                                                      \
+        if (ANV_ARR__UNLIKELY(index >= metadata->arr_sz)) {                    \
+            return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;                         \
+        }                                                                      \
+        arr[index] = value;                                                    \
+        return ANV_ARR_RESULT_OK;                                              \
+    }                                                                          \
+    static inline anv_arr_result name##_reserve(name *refarr, size_t capacity) \
+    {                                                                          \
+        anv_arr_t arr = *refarr;                                               \
+        anv_arr_result res = anv_arr__reserve(&arr, capacity);                 \
+        *refarr = (name)arr;                                                   \
+        return res;                                                            \
+    }                                                                          \
+    static inline anv_arr_result name##_push(name *refarr, type value)         \
+    {                                                                          \
+        anv_arr__metadata *metadata                                            \
+            = (anv_arr__metadata *)anv_meta_get_unchecked(*refarr);            \
+        if (ANV_ARR__UNLIKELY(metadata->arr_sz == metadata->arr_capacity)) {   \
+            anv_arr_t arr = *refarr;                                           \
+            anv_arr_result res = anv_arr__grow_to(&arr, metadata->arr_sz + 1); \
+            if (res != ANV_ARR_RESULT_OK) {                                    \
+                return res;                                                    \
+            }                                                                  \
+            *refarr = (name)arr;                                               \
+            metadata = (anv_arr__metadata *)anv_meta_get_unchecked(arr);       \
+        }                                                                      \
+        (*refarr)[metadata->arr_sz++] = value;                                 \
+        return ANV_ARR_RESULT_OK;                                              \
+    }                                                                          \
+    static inline type *name##_pop(name arr)                                   \
+    {                                                                          \
+        anv_arr__metadata *metadata                                            \
+            = (anv_arr__metadata *)anv_meta_get_unchecked(arr);                \
+        if (metadata->arr_sz == 0 || ANV_ARR__IS_READONLY(metadata)) {         \
+            return NULL;                                                       \
+        }                                                                      \
+        return arr + --metadata->arr_sz;                                       \
+    }                                                                          \
+    static inline void name##_clear(name arr)                                  \
+    {                                                                          \
+        anv_arr__metadata *metadata                                            \
+            = (anv_arr__metadata *)anv_meta_get_unchecked(arr);                \
+        if (!ANV_ARR__IS_READONLY(metadata)) {                                 \
+            metadata->arr_sz = 0;                                              \
+        }                                                                      \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_ARR_IMPLEMENTATION
+
+#include <stdio.h> /* for fopen(), fwrite(), fread() */
+#include <stdlib.h> /* for malloc(), free() */
+#include <string.h> /* for memcpy(), memset() */
+
+/*
+ * Memory mapping used by anv_arr_map_readonly, files are read in a heap buffer
+ * elsewhere.
+ */
+#if defined(_WIN32)
+#define ANV_ARR__HAS_MAPVIEW
+#include "anv_hhoh.h"
+#elif defined(__unix__) || defined(__APPLE__)
+#define ANV_ARR__HAS_MMAP
+#include <fcntl.h> /* for open() */
+#include <sys/mman.h> /* for mmap(), mprotect(), munmap() */
+#include <sys/stat.h> /* for fstat() */
+#include <unistd.h> /* for close() */
+#endif
+
+#ifndef ANV_ARR_DEFAULT_REALLOCATOR
+#define ANV_ARR_DEFAULT_REALLOCATOR anv_arr_reallocator_2x
+#endif
+
+#define ANV_ARR__SIZE_MAX ((size_t)-1)
+
+// Every array allocates one extra item slot past its capacity. This empty spot
+// is used to perform swaps and such operations without having to allocate
+// extra memory, while keeping the metadata header small for large items.
+#define ANV_ARR__TMP_ITEM(arr, metadata)                                       \
+    ((void *)((size_t)(arr)                                                    \
+              + (metadata)->item_sz * (metadata)->arr_capacity))
+
+#define ANV_ARR__FILE_MAGIC "ANVARR\0"
+
+// Room left by anv_arr_save between the file header and the items, so that a
+// view can store its metalloc header right before them. Also keeps items
+// aligned inside the mapping.
+#define ANV_ARR__FILE_DATA_OFFSET 256
+
+#define ANV_ARR__VIEW_ALIGNMENT 16
+
+/*
+ * Stored right before the metadata of mapped arrays.
+ */
+typedef struct anv_arr__mapping {
+    void *base;
+    size_t sz;
+} anv_arr__mapping;
+
+static anv_arr__mapping
+anv_arr__get_mapping(const anv_arr__metadata *metadata)
+{
+    anv_arr__mapping mapping;
+    memcpy(
+        &mapping,
+        (const unsigned char *)metadata - sizeof(anv_arr__mapping),
+        sizeof(anv_arr__mapping)
+    );
+    return mapping;
+}
+
+/*
+ * Map the whole file copy-on-write, pages stay shared with the OS file cache
+ * until written.
+ */
+static void *
+anv_arr__map_file(const char *filename, size_t *out_sz)
+{
+#if defined(ANV_ARR__HAS_MMAP)
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t sz = (size_t)st.st_size;
+    void *base = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    *out_sz = sz;
+    return base;
+#elif defined(ANV_ARR__HAS_MAPVIEW)
+    ANV_HANDLE hd;
+    // GENERIC_READ is enough for copy-on-write mappings.
+    if (!anv_hhoh_open_read(&hd, filename, 0)) {
+        return NULL;
+    }
+    LARGE_INTEGER file_sz;
+    if (!GetFileSizeEx(hd.handle, &file_sz) || file_sz.QuadPart <= 0
+        || (unsigned long long)file_sz.QuadPart > ANV_ARR__SIZE_MAX) {
+        anv_hhoh_close_win32(&hd);
+        return NULL;
+    }
+    HANDLE mapping
+        = CreateFileMapping(hd.handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    anv_hhoh_close_win32(&hd);
+    if (!mapping) {
+        return NULL;
+    }
+    // the view keeps the mapping alive.
+    void *base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!base) {
+        return NULL;
+    }
+    *out_sz = (size_t)file_sz.QuadPart;
+    return base;
+#else
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return NULL;
+    }
+    long file_sz = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        file_sz = ftell(file);
+    }
+    if (file_sz <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    size_t sz = (size_t)file_sz;
+    void *base = malloc(sz);
+    if (base && fread(base, 1, sz, file) != sz) {
+        free(base);
+        base = NULL;
+    }
+    fclose(file);
+    if (base) {
+        *out_sz = sz;
+    }
+    return base;
+#endif
+}
+
+static int
+anv_arr__protect_file(void *base, size_t sz)
+{
+#if defined(ANV_ARR__HAS_MMAP)
+    return mprotect(base, sz, PROT_READ) == 0;
+#elif defined(ANV_ARR__HAS_MAPVIEW)
+    DWORD old_protect;
+    return VirtualProtect(base, sz, PAGE_READONLY, &old_protect) != 0;
+#else
+    (void)base;
+    (void)sz;
+    return 1;
+#endif
+}
+
+static void
+anv_arr__unmap_file(void *base, size_t sz)
+{
+#if defined(ANV_ARR__HAS_MMAP)
+    munmap(base, sz);
+#elif defined(ANV_ARR__HAS_MAPVIEW)
+    (void)sz;
+    UnmapViewOfFile(base);
+#else
+    (void)sz;
+    free(base);
+#endif
+}
+
+size_t
+anv_arr_reallocator_linear(size_t old_capacity)
+{
+    return old_capacity + 8;
+}
+
+size_t
+anv_arr_reallocator_1_5x(size_t old_capacity)
+{
+    // small arrays (capacity can even be 0 after a shrink_to_fit) would barely
+    // grow with a multiplier alone.
+    if (old_capacity < 8) {
+        return old_capacity + 8;
+    }
+    if (ANV_ARR__UNLIKELY(old_capacity > ANV_ARR__SIZE_MAX / 3 * 2)) {
+        return ANV_ARR__SIZE_MAX;
+    }
+    return old_capacity + old_capacity / 2;
+}
+
+size_t
+anv_arr_reallocator_2x(size_t old_capacity)
+{
+    if (old_capacity < 8) {
+        return old_capacity + 8;
+    }
+    if (ANV_ARR__UNLIKELY(old_capacity > ANV_ARR__SIZE_MAX / 2)) {
+        return ANV_ARR__SIZE_MAX;
+    }
+    return old_capacity * 2;
+}
 
 static anv_arr_reallocator_fn anv_arr__reallocator
-    = anv_arr__reallocator_default;
+    = ANV_ARR_DEFAULT_REALLOCATOR;
+
+#ifdef ANV_ARR_ENABLE_STATS
+static anv_arr_stats anv_arr__stats;
+
+#define ANV_ARR__STAT_ADD(field, n)                                            \
+    ANV_META__COUNTER_ADD(anv_arr__stats.field, n)
+#define ANV_ARR__STAT_SUB(field, n)                                            \
+    ANV_META__COUNTER_SUB(anv_arr__stats.field, n)
+#define ANV_ARR__STAT_LOAD(field) ANV_META__COUNTER_LOAD(anv_arr__stats.field)
+#define ANV_ARR__STAT_STORE(field, n)                                          \
+    ANV_META__COUNTER_STORE(anv_arr__stats.field, n)
+
+static void
+anv_arr__stats_created(const anv_arr__metadata *metadata)
+{
+    ANV_ARR__STAT_ADD(created_count, 1);
+    ANV_ARR__STAT_ADD(live_count, 1);
+    ANV_ARR__STAT_ADD(
+        live_capacity_bytes, metadata->arr_capacity * metadata->item_sz
+    );
+}
+
+static void
+anv_arr__stats_destroyed(const anv_arr__metadata *metadata)
+{
+    ANV_ARR__STAT_ADD(destroyed_count, 1);
+    ANV_ARR__STAT_SUB(live_count, 1);
+    ANV_ARR__STAT_SUB(
+        live_capacity_bytes, metadata->arr_capacity * metadata->item_sz
+    );
+    size_t grows = metadata->grow_count < ANV_ARR_STATS_BUCKETS
+        ? metadata->grow_count
+        : ANV_ARR_STATS_BUCKETS - 1;
+    ANV_ARR__STAT_ADD(grow_count_histogram[grows], 1);
+    size_t bucket = anv_arr__log2(metadata->arr_sz);
+    if (bucket >= ANV_ARR_STATS_BUCKETS) {
+        bucket = ANV_ARR_STATS_BUCKETS - 1;
+    }
+    ANV_ARR__STAT_ADD(length_histogram[bucket], 1);
+}
+
+static void
+anv_arr__stats_reallocated(
+    size_t old_capacity, size_t new_capacity, size_t item_sz
+)
+{
+    ANV_ARR__STAT_ADD(realloc_count, 1);
+    if (new_capacity >= old_capacity) {
+        ANV_ARR__STAT_ADD(
+            live_capacity_bytes, (new_capacity - old_capacity) * item_sz
+        );
+    } else {
+        ANV_ARR__STAT_SUB(
+            live_capacity_bytes, (old_capacity - new_capacity) * item_sz
+        );
+    }
+}
+
+void
+anv_arr_stats_snapshot(anv_arr_stats *out_stats)
+{
+    if (ANV_ARR__UNLIKELY(!out_stats)) {
+        anv_arr__assert(0, "invalid null stats");
+        return;
+    }
+    out_stats->created_count = ANV_ARR__STAT_LOAD(created_count);
+    out_stats->destroyed_count = ANV_ARR__STAT_LOAD(destroyed_count);
+    out_stats->live_count = ANV_ARR__STAT_LOAD(live_count);
+    out_stats->live_capacity_bytes = ANV_ARR__STAT_LOAD(live_capacity_bytes);
+    out_stats->realloc_count = ANV_ARR__STAT_LOAD(realloc_count);
+    out_stats->grow_count = ANV_ARR__STAT_LOAD(grow_count);
+    out_stats->grow_moves = ANV_ARR__STAT_LOAD(grow_moves);
+    for (size_t i = 0; i < ANV_ARR_STATS_BUCKETS; ++i) {
+        out_stats->grow_count_histogram[i]
+            = ANV_ARR__STAT_LOAD(grow_count_histogram[i]);
+        out_stats->length_histogram[i]
+            = ANV_ARR__STAT_LOAD(length_histogram[i]);
+    }
+}
+
+void
+anv_arr_stats_reset(void)
+{
+    ANV_ARR__STAT_STORE(created_count, 0);
+    ANV_ARR__STAT_STORE(destroyed_count, 0);
+    ANV_ARR__STAT_STORE(realloc_count, 0);
+    ANV_ARR__STAT_STORE(grow_count, 0);
+    ANV_ARR__STAT_STORE(grow_moves, 0);
+    for (size_t i = 0; i < ANV_ARR_STATS_BUCKETS; ++i) {
+        ANV_ARR__STAT_STORE(grow_count_histogram[i], 0);
+        ANV_ARR__STAT_STORE(length_histogram[i], 0);
+    }
+}
+#endif
+
+void
+anv_arr_config_reallocator_fn(anv_arr_reallocator_fn fn)
+{
+    if (!fn) {
+        anv_arr__reallocator = ANV_ARR_DEFAULT_REALLOCATOR;
+    } else {
+        anv_arr__reallocator = fn;
+    }
+}
+
+anv_arr_t
+anv_arr_new(size_t arr_capacity, size_t item_sz)
+{
+    anv_arr_options options = {
+        .arr_capacity = arr_capacity,
+        .item_sz = item_sz,
+        .growth_fn = NULL,
+        .growth_ctx = NULL,
+        .inline_buffer = NULL,
+        .inline_buffer_sz = 0,
+        .allocator = NULL,
+        .alignment = 0,
+    };
+    return anv_arr_new_with_options(&options);
+}
+
+anv_arr_t
+anv_arr_new_inline(void *buffer, size_t buffer_sz, size_t item_sz)
+{
+    anv_arr_options options = {
+        .arr_capacity = 0,
+        .item_sz = item_sz,
+        .growth_fn = NULL,
+        .growth_ctx = NULL,
+        .inline_buffer = buffer,
+        .inline_buffer_sz = buffer_sz,
+        .allocator = NULL,
+        .alignment = 0,
+    };
+    return anv_arr_new_with_options(&options);
+}
+
+anv_arr_t
+anv_arr_new_with_options(const anv_arr_options *options)
+{
+    if (ANV_ARR__UNLIKELY(!options)) {
+        anv_arr__assert(0, "invalid null options");
+        return NULL;
+    }
+
+    size_t arr_capacity = options->arr_capacity;
+    size_t item_sz = options->item_sz;
+    anv_arr__metadata metadata = {
+        .arr_sz = 0,
+        .arr_capacity = arr_capacity,
+        .item_sz = item_sz,
+        .grow_count = 0,
+        .growth_fn = options->growth_fn,
+        .growth_ctx = options->growth_ctx,
+        .is_inline = 0,
+        .is_mapped = 0,
+        .is_readonly = 0,
+    };
+    anv_meta_size_t meta_sz = sizeof(anv_arr__metadata);
+    // Heap arrays need room for at least one item, inline ones get their
+    // capacity from the buffer size instead.
+    if (ANV_ARR__UNLIKELY(
+            !options->inline_buffer && (arr_capacity == 0 || item_sz == 0)
+        )) {
+        return NULL;
+    }
+    if (ANV_ARR__UNLIKELY(
+            item_sz && arr_capacity >= ANV_ARR__SIZE_MAX / item_sz
+        )) {
+        return NULL;
+    }
+    // Note: the extra item is the swap slot, see ANV_ARR__TMP_ITEM.
+    size_t data_sz = item_sz * (arr_capacity + 1);
+    void *arr;
+    if (options->inline_buffer) {
+        if (ANV_ARR__UNLIKELY(item_sz == 0)) {
+            anv_arr__assert(0, "item size cannot be 0");
+            return NULL;
+        }
+        size_t buffer_sz = options->inline_buffer_sz;
+        size_t header_sz = ANV_META_BUFFER_SIZE(meta_sz, 0);
+        if (ANV_ARR__UNLIKELY(buffer_sz < header_sz + 2 * item_sz)) {
+            anv_arr__assert(0, "inline buffer too small for a single item");
+            return NULL;
+        }
+        metadata.arr_capacity = (buffer_sz - header_sz) / item_sz - 1;
+        metadata.is_inline = 1;
+        arr = anv_meta_init_buffer(
+            options->inline_buffer, buffer_sz, &metadata, meta_sz
+        );
+    } else if (options->alignment) {
+        arr = anv_meta_malloc_aligned_with(
+            options->allocator,
+            &metadata,
+            meta_sz,
+            data_sz,
+            options->alignment
+        );
+    } else {
+        arr = anv_meta_malloc_with(
+            options->allocator, &metadata, meta_sz, data_sz
+        );
+    }
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        return NULL;
+    }
+#ifdef ANV_ARR_ENABLE_STATS
+    anv_arr__stats_created((anv_arr__metadata *)anv_meta_get_unchecked(arr));
+#endif
+    return arr;
+}
+
+int
+anv_arr_is_mapped(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return metadata->is_mapped;
+}
+
+int
+anv_arr_is_readonly(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return ANV_ARR__IS_READONLY(metadata);
+}
+
+int
+anv_arr_is_inline(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return metadata->is_inline;
+}
+
+void
+anv_arr_destroy(anv_arr_t arr)
+{
+#ifdef ANV_ARR_ENABLE_STATS
+    if (arr && anv_meta_isvalid(arr)) {
+        anv_arr__stats_destroyed((anv_arr__metadata *)anv_arr__meta_get(arr));
+    }
+#endif
+    if (arr && anv_meta_isvalid(arr)) {
+        anv_arr__metadata *metadata
+            = (anv_arr__metadata *)anv_arr__meta_get(arr);
+        // Inline arrays memory is owned by the caller.
+        if (metadata->is_inline) {
+            return;
+        }
+        if (metadata->is_mapped) {
+            anv_arr__mapping mapping = anv_arr__get_mapping(metadata);
+            anv_arr__unmap_file(mapping.base, mapping.sz);
+            return;
+        }
+    }
+    anv_meta_free(arr);
+}
+
+size_t
+anv_arr_length(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return metadata->arr_sz;
+}
+
+size_t
+anv_arr_capacity(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return metadata->arr_capacity;
+}
+
+size_t
+anv_arr_grow_count(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+    return metadata->grow_count;
+}
+
+anv_arr_result
+anv_arr_get_usage(anv_arr_t arr, anv_arr_usage *out_usage)
+{
+    if (ANV_ARR__UNLIKELY(!arr || !out_usage)) {
+        anv_arr__assert(0, "invalid null array or usage");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    out_usage->item_bytes = metadata->arr_sz * metadata->item_sz;
+    out_usage->capacity_bytes = metadata->arr_capacity * metadata->item_sz;
+    out_usage->slack_bytes = out_usage->capacity_bytes - out_usage->item_bytes;
+    // swap slot + everything before the first item.
+    out_usage->overhead_bytes = metadata->item_sz
+        + (metadata->is_inline ? 0 : (size_t)anv_meta_get_offset(arr));
+    if (metadata->is_mapped) {
+        // no swap slot, the file header comes before the first item.
+        out_usage->overhead_bytes = (size_t)arr
+            - (size_t)anv_arr__get_mapping(metadata).base;
+    }
+    out_usage->grow_count = metadata->grow_count;
+    return ANV_ARR_RESULT_OK;
+}
+
+static void *
+anv_arr__get_internal(anv_arr_t arr, size_t index, anv_arr__metadata *metadata)
+{
+    return (void *)((size_t)arr + metadata->item_sz * index);
+}
+
+static void
+anv_arr__set_internal(
+    anv_arr_t arr, size_t index, anv_arr__metadata *metadata, void *item
+)
+{
+    void *spot = (void *)((size_t)arr + metadata->item_sz * index);
+    if (item) {
+        memcpy(spot, item, metadata->item_sz);
+    } else {
+        memset(spot, 0, metadata->item_sz);
+    }
+}
+
+static void
+anv_arr__move_internal(
+    anv_arr_t arr,
+    anv_arr__metadata *metadata,
+    size_t from_idx,
+    size_t to_idx,
+    size_t count
+)
+{
+    if (count > 0 && from_idx != to_idx) {
+        memmove(
+            anv_arr__get_internal(arr, to_idx, metadata),
+            anv_arr__get_internal(arr, from_idx, metadata),
+            metadata->item_sz * count
+        );
+    }
+}
+
+static void
+anv_arr__set_range_internal(
+    anv_arr_t arr,
+    size_t index,
+    anv_arr__metadata *metadata,
+    void *items,
+    size_t count
+)
+{
+    void *spot = (void *)((size_t)arr + metadata->item_sz * index);
+    // items may be a range of arr itself.
+    if (items) {
+        memmove(spot, items, metadata->item_sz * count);
+    } else {
+        memset(spot, 0, metadata->item_sz * count);
+    }
+}
+
+static void *
+anv_arr__move_to_heap(
+    anv_arr_t arr, anv_arr__metadata *metadata, size_t new_capacity
+)
+{
+    anv_meta_size_t meta_sz = anv_meta_getsz(arr);
+    void *heap_arr = anv_meta_malloc(
+        NULL, meta_sz, metadata->item_sz * (new_capacity + 1)
+    );
+    if (ANV_ARR__UNLIKELY(!heap_arr)) {
+        return NULL;
+    }
+    anv_arr__metadata *heap_metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(heap_arr);
+    memcpy(heap_metadata, metadata, meta_sz);
+    heap_metadata->is_inline = 0;
+    size_t count
+        = metadata->arr_sz < new_capacity ? metadata->arr_sz : new_capacity;
+    memcpy(heap_arr, arr, metadata->item_sz * count);
+    return heap_arr;
+}
+
+static anv_arr_result
+anv_arr__reallocate(
+    anv_arr_t *refarr, anv_arr__metadata **refmetadata, size_t new_capacity
+)
+{
+    if (ANV_ARR__UNLIKELY(
+            new_capacity >= ANV_ARR__SIZE_MAX / (*refmetadata)->item_sz
+        )) {
+        return ANV_ARR_RESULT_ALLOC_ERROR;
+    }
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(*refmetadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    void *resized_arr;
+    if ((*refmetadata)->is_inline) {
+        resized_arr
+            = anv_arr__move_to_heap(*refarr, *refmetadata, new_capacity);
+    } else {
+        resized_arr = anv_meta_realloc(
+            *refarr, (*refmetadata)->item_sz * (new_capacity + 1)
+        );
+    }
+    if (ANV_ARR__UNLIKELY(!resized_arr)) {
+        return ANV_ARR_RESULT_ALLOC_ERROR;
+    }
+    // during reallocations the metadata might be moved somewhere else, we
+    // retrieve it again and propagate it upwards where needed.
+    anv_arr__metadata *new_metadata_loc
+        = (anv_arr__metadata *)anv_arr__meta_get(resized_arr);
+#ifdef ANV_ARR_ENABLE_STATS
+    anv_arr__stats_reallocated(
+        new_metadata_loc->arr_capacity, new_capacity, new_metadata_loc->item_sz
+    );
+#endif
+    *refmetadata = new_metadata_loc;
+    new_metadata_loc->arr_capacity = new_capacity;
+    *refarr = resized_arr;
+    return ANV_ARR_RESULT_OK;
+}
+
+static anv_arr_result
+anv_arr__reallocate_grow(
+    anv_arr_t *refarr, anv_arr__metadata **refmetadata, size_t new_capacity
+)
+{
+#ifdef ANV_ARR_ENABLE_STATS
+    anv_arr_t old_arr = *refarr;
+#endif
+    anv_arr_result res = anv_arr__reallocate(refarr, refmetadata, new_capacity);
+    if (res == ANV_ARR_RESULT_OK) {
+        (*refmetadata)->grow_count++;
+#ifdef ANV_ARR_ENABLE_STATS
+        ANV_ARR__STAT_ADD(grow_count, 1);
+        if (*refarr != old_arr) {
+            ANV_ARR__STAT_ADD(grow_moves, 1);
+        }
+#endif
+    }
+    return res;
+}
+
+/**
+ * Expand the array following the current reallocator policy until it can
+ * store at least min_capacity items. Only one reallocation is ever performed.
+ */
+static anv_arr_result
+anv_arr__grow(
+    anv_arr_t *refarr, anv_arr__metadata **refmetadata, size_t min_capacity
+)
+{
+    size_t new_capacity = (*refmetadata)->arr_capacity;
+    if (new_capacity >= min_capacity) {
+        return ANV_ARR_RESULT_OK;
+    }
+    anv_arr_growth_fn growth_fn = (*refmetadata)->growth_fn;
+    void *growth_ctx = (*refmetadata)->growth_ctx;
+    while (new_capacity < min_capacity) {
+        size_t next_capacity = growth_fn
+            ? growth_fn(growth_ctx, new_capacity)
+            : anv_arr__reallocator(new_capacity);
+        if (ANV_ARR__UNLIKELY(next_capacity <= new_capacity)) {
+            anv_arr__assert(0, "reallocator must return a bigger capacity");
+            return ANV_ARR_RESULT_ALLOC_ERROR;
+        }
+        new_capacity = next_capacity;
+    }
+    return anv_arr__reallocate_grow(refarr, refmetadata, new_capacity);
+}
+
+/*
+ * Items passed to the methods below may be items of the array itself, which
+ * growing the array moves: get their offset in arr to find them again
+ * afterwards, ANV_ARR__SIZE_MAX if they live elsewhere.
+ */
+static size_t
+anv_arr__self_offset(
+    anv_arr_t arr, anv_arr__metadata *metadata, const void *items
+)
+{
+    // items before arr wrap around to huge offsets.
+    size_t offset = (size_t)items - (size_t)arr;
+    if (!items || offset >= metadata->arr_sz * metadata->item_sz) {
+        return ANV_ARR__SIZE_MAX;
+    }
+    return offset;
+}
+
+static void *
+anv_arr__self_rebase(anv_arr_t arr, void *items, size_t offset)
+{
+    return offset == ANV_ARR__SIZE_MAX ? items
+                                       : (void *)((size_t)arr + offset);
+}
+
+static anv_arr_result
+anv_arr__push_internal(
+    anv_arr_t *refarr, anv_arr__metadata **refmetadata, void *item
+)
+{
+    if ((*refmetadata)->arr_sz >= (*refmetadata)->arr_capacity) {
+        size_t offset = anv_arr__self_offset(*refarr, *refmetadata, item);
+        anv_arr_result res
+            = anv_arr__grow(refarr, refmetadata, (*refmetadata)->arr_sz + 1);
+        if (res != ANV_ARR_RESULT_OK) {
+            return res;
+        }
+        item = anv_arr__self_rebase(*refarr, item, offset);
+    }
+
+    anv_arr__set_internal(
+        *refarr, (*refmetadata)->arr_sz++, (*refmetadata), item
+    );
+    return ANV_ARR_RESULT_OK;
+}
+
+static anv_arr_result
+anv_arr__push_n_internal(
+    anv_arr_t *refarr,
+    anv_arr__metadata **refmetadata,
+    void *items,
+    size_t count
+)
+{
+    if (ANV_ARR__UNLIKELY(count > ANV_ARR__SIZE_MAX - (*refmetadata)->arr_sz)) {
+        return ANV_ARR_RESULT_ALLOC_ERROR;
+    }
+    size_t new_sz = (*refmetadata)->arr_sz + count;
+    if (new_sz > (*refmetadata)->arr_capacity) {
+        size_t offset = anv_arr__self_offset(*refarr, *refmetadata, items);
+        anv_arr_result res = anv_arr__grow(refarr, refmetadata, new_sz);
+        if (res != ANV_ARR_RESULT_OK) {
+            return res;
+        }
+        items = anv_arr__self_rebase(*refarr, items, offset);
+    }
+
+    anv_arr__set_range_internal(
+        *refarr, (*refmetadata)->arr_sz, *refmetadata, items, count
+    );
+    (*refmetadata)->arr_sz = new_sz;
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr__insert(anv_arr_t *refarr, size_t index, void *item)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Inserting at index 0 for empty arrays is a supported special case.
+    if (index != 0 && index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    // Empty array have no existing item to move.
+    if (metadata->arr_sz == 0) {
+        return anv_arr__push_internal(refarr, &metadata, item);
+    } else {
+        // Here it's import that we push the new item to last before
+        // updating the current item. This ensure the old item value is memcpyed
+        // to the new location.
+        void *old_item = anv_arr__get_internal(*refarr, index, metadata);
+        size_t offset = anv_arr__self_offset(*refarr, metadata, item);
+        anv_arr_result res
+            = anv_arr__push_internal(refarr, &metadata, old_item);
+        if (res == ANV_ARR_RESULT_OK) {
+            item = anv_arr__self_rebase(*refarr, item, offset);
+            anv_arr__set_internal(*refarr, index, metadata, item);
+        }
+        return res;
+    }
+}
+
+anv_arr_result
+anv_arr__insert_slow(anv_arr_t *refarr, size_t index, void *item)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Inserting at index 0 for empty arrays is a supported special case.
+    if (index != 0 && index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    size_t tail = metadata->arr_sz - index;
+    anv_arr_result res = anv_arr__push_n_internal(refarr, &metadata, NULL, 1);
+    if (res != ANV_ARR_RESULT_OK) {
+        return res;
+    }
+    anv_arr__move_internal(*refarr, metadata, index, index + 1, tail);
+    anv_arr__set_internal(*refarr, index, metadata, item);
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr__push(anv_arr_t *refarr, void *item)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    return anv_arr__push_internal(refarr, &metadata, item);
+}
+
+anv_arr_result
+anv_arr__push_n(anv_arr_t *refarr, void *items, size_t count)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    return anv_arr__push_n_internal(refarr, &metadata, items, count);
+}
+
+anv_arr_result
+anv_arr__insert_range(
+    anv_arr_t *refarr, size_t index, void *items, size_t count
+)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Inserting at index 0 for empty arrays is a supported special case.
+    if (index != 0 && index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    size_t old_sz = metadata->arr_sz;
+    // Only the old items occupying the spots of the new ones have to be moved.
+    size_t moved = old_sz - index < count ? old_sz - index : count;
+
+    // Reserve space for the new items at the end of the array first, this
+    // guarantees at most one reallocation. The moved items are then copied
+    // to the last spots of the array which never overlap with their old ones,
+    // nor with items if they are taken from the array itself.
+    size_t offset = anv_arr__self_offset(*refarr, metadata, items);
+    anv_arr_result res
+        = anv_arr__push_n_internal(refarr, &metadata, NULL, count);
+    if (res != ANV_ARR_RESULT_OK) {
+        return res;
+    }
+    items = anv_arr__self_rebase(*refarr, items, offset);
+    if (moved > 0) {
+        memcpy(
+            anv_arr__get_internal(*refarr, old_sz + count - moved, metadata),
+            anv_arr__get_internal(*refarr, index, metadata),
+            metadata->item_sz * moved
+        );
+    }
+    anv_arr__set_range_internal(*refarr, index, metadata, items, count);
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr__extend(anv_arr_t *refdst, anv_arr_t src)
+{
+    if (ANV_ARR__UNLIKELY(!refdst || !*refdst || !src)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refdst);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refdst a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *src_metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(src);
+    if (ANV_ARR__UNLIKELY(!src_metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is src a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(metadata->item_sz != src_metadata->item_sz)) {
+        anv_arr__assert(0, "cannot extend arrays with different item sizes");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Self extension is handled as any push of the array own items.
+    return anv_arr__push_n_internal(
+        refdst, &metadata, src, src_metadata->arr_sz
+    );
+}
+
+void *
+anv_arr__pop(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return NULL;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return NULL;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return NULL;
+    }
+
+    if (metadata->arr_sz == 0) {
+        return NULL;
+    }
+    void *item = anv_arr__get_internal(arr, metadata->arr_sz - 1, metadata);
+    metadata->arr_sz--;
+    return item;
+}
+
+void *
+anv_arr__pop_first_slow(anv_arr_t arr)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return NULL;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return NULL;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return NULL;
+    }
+
+    if (metadata->arr_sz == 0) {
+        return NULL;
+    }
+
+    // The popped item is parked in the spot freed at the end of the array,
+    // same as anv_arr_pop does.
+    void *tmp_item = ANV_ARR__TMP_ITEM(arr, metadata);
+    memcpy(tmp_item, arr, metadata->item_sz);
+    anv_arr__move_internal(arr, metadata, 1, 0, metadata->arr_sz - 1);
+    metadata->arr_sz--;
+    anv_arr__set_internal(arr, metadata->arr_sz, metadata, tmp_item);
+    return anv_arr__get_internal(arr, metadata->arr_sz, metadata);
+}
+
+void *
+anv_arr__get(anv_arr_t arr, size_t index)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return NULL;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return NULL;
+    }
+
+    if (index >= metadata->arr_sz) {
+        return NULL;
+    }
+    return anv_arr__get_internal(arr, index, metadata);
+}
+
+static void
+anv_arr__swap_items(void *item_a, void *item_b, size_t item_sz, void *tmp_item)
+{
+    // Common fixed item sizes are swapped using plain word moves, the compiler
+    // turns these constant sized memcpy calls into register loads/stores.
+    switch (item_sz) {
+        case 4: {
+            uint32_t tmp;
+            memcpy(&tmp, item_a, 4);
+            memcpy(item_a, item_b, 4);
+            memcpy(item_b, &tmp, 4);
+            break;
+        }
+        case 8: {
+            uint64_t tmp;
+            memcpy(&tmp, item_a, 8);
+            memcpy(item_a, item_b, 8);
+            memcpy(item_b, &tmp, 8);
+            break;
+        }
+        case 16: {
+            uint64_t tmp[2];
+            memcpy(tmp, item_a, 16);
+            memcpy(item_a, item_b, 16);
+            memcpy(item_b, tmp, 16);
+            break;
+        }
+        default:
+            memcpy(tmp_item, item_a, item_sz);
+            memcpy(item_a, item_b, item_sz);
+            memcpy(item_b, tmp_item, item_sz);
+            break;
+    }
+}
+
+static void
+anv_arr__swap_internal(
+    anv_arr_t arr, anv_arr__metadata *metadata, size_t index_a, size_t index_b
+)
+{
+    anv_arr__swap_items(
+        anv_arr__get_internal(arr, index_a, metadata),
+        anv_arr__get_internal(arr, index_b, metadata),
+        metadata->item_sz,
+        ANV_ARR__TMP_ITEM(arr, metadata)
+    );
+}
+
+anv_arr_result
+anv_arr_swap(anv_arr_t arr, size_t index_a, size_t index_b)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (index_a == index_b) {
+        return ANV_ARR_RESULT_INDEX_COLLISION;
+    }
+    if (index_a >= metadata->arr_sz || index_b >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    anv_arr__swap_internal(arr, metadata, index_a, index_b);
+    return ANV_ARR_RESULT_OK;
+}
+
+static void
+anv_arr__copy_internal(
+    anv_arr_t arr, anv_arr__metadata *metadata, size_t from_idx, size_t to_idx
+)
+{
+    void *from_item = anv_arr__get_internal(arr, from_idx, metadata);
+    void *to_item = anv_arr__get_internal(arr, to_idx, metadata);
+    memcpy(to_item, from_item, metadata->item_sz);
+}
+
+anv_arr_result
+anv_arr_remove(anv_arr_t arr, size_t index)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    anv_arr__copy_internal(arr, metadata, metadata->arr_sz - 1, index);
+    metadata->arr_sz--;
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr_replace(anv_arr_t arr, size_t index, void *item)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    anv_arr__set_internal(arr, index, metadata, item);
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr_remove_slow(anv_arr_t arr, size_t index)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (index >= metadata->arr_sz) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
 
-void
-anv_arr_config_reallocator_fn(anv_arr_reallocator_fn fn)
+    anv_arr__move_internal(
+        arr, metadata, index + 1, index, metadata->arr_sz - index - 1
+    );
+    metadata->arr_sz--;
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr_remove_if(
+    anv_arr_t arr,
+    anv_arr_predicate_fn pred,
+    void *user_ctx,
+    size_t *out_removed
+)
 {
-    if (!fn) {
-        anv_arr__reallocator = anv_arr__reallocator_default;
-    } else {
-        anv_arr__reallocator = fn;
+    if (out_removed) {
+        *out_removed = 0;
+    }
+
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_ARR__UNLIKELY(!pred)) {
+        anv_arr__assert(0, "invalid null predicate");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Kept items are compacted in runs: each contiguous run of kept items is
+    // moved with a single memmove once the next removed item (or the array's
+    // end) is found.
+    size_t write_idx = 0;
+    size_t run_start = 0;
+    for (size_t i = 0; i <= metadata->arr_sz; ++i) {
+        if (i < metadata->arr_sz
+            && !pred(user_ctx, anv_arr__get_internal(arr, i, metadata))) {
+            continue;
+        }
+        anv_arr__move_internal(
+            arr, metadata, run_start, write_idx, i - run_start
+        );
+        write_idx += i - run_start;
+        run_start = i + 1;
+    }
+
+    if (out_removed) {
+        *out_removed = metadata->arr_sz - write_idx;
     }
+    metadata->arr_sz = write_idx;
+    return ANV_ARR_RESULT_OK;
 }
 
-anv_arr_t
-anv_arr_new(size_t arr_capacity, size_t item_sz)
+anv_arr_result
+anv_arr_remove_range(anv_arr_t arr, size_t index, size_t count)
 {
-    anv_arr__metadata metadata = {
-        .arr_sz = 0,
-        .arr_capacity = arr_capacity,
-        .item_sz = item_sz,
-        .tmp_item = NULL,
-    };
-    // Note: the weird metadata size calculation is to make tmp_item of the
-    // exact size of an item to insert. This empty spot is used to perform swaps
-    // and such operations without having to allocate extra memory.
-    // Always access tmp_item with ANV_ARR__TMP_ITEM(metadata).
-    void *arr = anv_meta_malloc(
-        &metadata,
-        sizeof(anv_arr__metadata) + item_sz - sizeof(void *),
-        item_sz * arr_capacity
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (index > metadata->arr_sz || count > metadata->arr_sz - index) {
+        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    // Fill the hole with the last items which are not being removed, src and
+    // dst spots never overlap.
+    size_t tail = metadata->arr_sz - index - count;
+    size_t moved = tail < count ? tail : count;
+    if (moved > 0) {
+        memcpy(
+            anv_arr__get_internal(arr, index, metadata),
+            anv_arr__get_internal(arr, metadata->arr_sz - moved, metadata),
+            metadata->item_sz * moved
+        );
+    }
+    metadata->arr_sz -= count;
+    return ANV_ARR_RESULT_OK;
+}
+
+anv_arr_result
+anv_arr__shrink_to_fit(anv_arr_t *refarr)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    // Moving an inline array to the heap to shrink it would waste memory.
+    if (metadata->is_inline || ANV_ARR__IS_READONLY(metadata)) {
+        return ANV_ARR_RESULT_OK;
+    }
+    return anv_arr__reallocate(refarr, &metadata, metadata->arr_sz);
+}
+
+anv_arr_result
+anv_arr__grow_to(anv_arr_t *refarr, size_t min_capacity)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    return anv_arr__grow(refarr, &metadata, min_capacity);
+}
+
+anv_arr_result
+anv_arr__reserve(anv_arr_t *refarr, size_t capacity)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (capacity <= metadata->arr_capacity) {
+        return ANV_ARR_RESULT_OK;
+    }
+    return anv_arr__reallocate_grow(refarr, &metadata, capacity);
+}
+
+anv_arr_result
+anv_arr__resize(anv_arr_t *refarr, size_t length)
+{
+    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (length > metadata->arr_capacity) {
+        anv_arr_result res
+            = anv_arr__reallocate_grow(refarr, &metadata, length);
+        if (res != ANV_ARR_RESULT_OK) {
+            return res;
+        }
+    }
+
+    if (length > metadata->arr_sz) {
+        memset(
+            anv_arr__get_internal(*refarr, metadata->arr_sz, metadata),
+            0,
+            metadata->item_sz * (length - metadata->arr_sz)
+        );
+    }
+    metadata->arr_sz = length;
+    return ANV_ARR_RESULT_OK;
+}
+
+typedef struct anv_arr__sort_ctx {
+    unsigned char *base;
+    size_t item_sz;
+    anv_arr_compare_fn cmp;
+    // Scratch space of item_sz bytes used for swaps.
+    void *tmp_item;
+} anv_arr__sort_ctx;
+
+#define ANV_ARR__SORT_AT(ctx, index) ((ctx)->base + (ctx)->item_sz * (index))
+
+static void
+anv_arr__sort_swap(anv_arr__sort_ctx *ctx, size_t index_a, size_t index_b)
+{
+    anv_arr__swap_items(
+        ANV_ARR__SORT_AT(ctx, index_a),
+        ANV_ARR__SORT_AT(ctx, index_b),
+        ctx->item_sz,
+        ctx->tmp_item
     );
-    return arr;
 }
 
-void
-anv_arr_destroy(anv_arr_t arr)
-{
-    anv_meta_free(arr);
+static int
+anv_arr__sort_cmp(anv_arr__sort_ctx *ctx, size_t index_a, size_t index_b)
+{
+    return ctx->cmp(
+        ANV_ARR__SORT_AT(ctx, index_a), ANV_ARR__SORT_AT(ctx, index_b)
+    );
+}
+
+static void
+anv_arr__sort_insertion(anv_arr__sort_ctx *ctx, size_t lo, size_t hi)
+{
+    for (size_t i = lo + 1; i < hi; ++i) {
+        size_t j = i;
+        for (; j > lo && anv_arr__sort_cmp(ctx, j - 1, j) > 0; --j) {
+            anv_arr__sort_swap(ctx, j - 1, j);
+        }
+    }
+}
+
+static void
+anv_arr__sort_sift_down(
+    anv_arr__sort_ctx *ctx, size_t lo, size_t root, size_t n
+)
+{
+    size_t child;
+    while ((child = 2 * root + 1) < n) {
+        if (child + 1 < n
+            && anv_arr__sort_cmp(ctx, lo + child, lo + child + 1) < 0) {
+            ++child;
+        }
+        if (anv_arr__sort_cmp(ctx, lo + root, lo + child) >= 0) {
+            return;
+        }
+        anv_arr__sort_swap(ctx, lo + root, lo + child);
+        root = child;
+    }
+}
+
+static void
+anv_arr__sort_heap(anv_arr__sort_ctx *ctx, size_t lo, size_t hi)
+{
+    size_t n = hi - lo;
+    for (size_t i = n / 2; i-- > 0;) {
+        anv_arr__sort_sift_down(ctx, lo, i, n);
+    }
+    for (size_t end = n - 1; end > 0; --end) {
+        anv_arr__sort_swap(ctx, lo, lo + end);
+        anv_arr__sort_sift_down(ctx, lo, 0, end);
+    }
+}
+
+/**
+ * Partition [lo, hi) around the median of its first, middle and last items.
+ * @return Final pivot index.
+ */
+static size_t
+anv_arr__sort_partition(anv_arr__sort_ctx *ctx, size_t lo, size_t hi)
+{
+    size_t mid = lo + (hi - lo) / 2;
+    size_t last = hi - 1;
+
+    if (anv_arr__sort_cmp(ctx, mid, lo) < 0) {
+        anv_arr__sort_swap(ctx, mid, lo);
+    }
+    if (anv_arr__sort_cmp(ctx, last, mid) < 0) {
+        anv_arr__sort_swap(ctx, last, mid);
+        if (anv_arr__sort_cmp(ctx, mid, lo) < 0) {
+            anv_arr__sort_swap(ctx, mid, lo);
+        }
+    }
+
+    // The pivot is parked at lo while partitioning, the last item is always
+    // >= pivot and acts as sentinel.
+    anv_arr__sort_swap(ctx, mid, lo);
+    size_t i = lo + 1;
+    size_t j = last;
+    for (;;) {
+        while (anv_arr__sort_cmp(ctx, i, lo) < 0) {
+            ++i;
+        }
+        while (anv_arr__sort_cmp(ctx, lo, j) < 0) {
+            --j;
+        }
+        if (i >= j) {
+            break;
+        }
+        anv_arr__sort_swap(ctx, i, j);
+        ++i;
+        --j;
+    }
+    // j stops at lo when no item is smaller than the pivot.
+    if (j != lo) {
+        anv_arr__sort_swap(ctx, lo, j);
+    }
+    return j;
+}
+
+static void
+anv_arr__sort_intro(anv_arr__sort_ctx *ctx, size_t lo, size_t hi, size_t depth)
+{
+    while (hi - lo > ANV_ARR__SORT_INSERTION_THRESHOLD) {
+        // Too many bad pivots, switch to heapsort to keep O(n log n).
+        if (depth-- == 0) {
+            anv_arr__sort_heap(ctx, lo, hi);
+            return;
+        }
+        size_t p = anv_arr__sort_partition(ctx, lo, hi);
+        // Recurse on the smaller part only to keep stack usage O(log n).
+        if (p - lo < hi - p - 1) {
+            anv_arr__sort_intro(ctx, lo, p, depth);
+            lo = p + 1;
+        } else {
+            anv_arr__sort_intro(ctx, p + 1, hi, depth);
+            hi = p;
+        }
+    }
+    anv_arr__sort_insertion(ctx, lo, hi);
+}
+
+static void
+anv_arr__sort_range(anv_arr__sort_ctx *ctx, size_t lo, size_t hi)
+{
+    if (hi - lo > 1) {
+        anv_arr__sort_intro(ctx, lo, hi, 2 * anv_arr__log2(hi - lo));
+    }
+}
+
+anv_arr_result
+anv_arr_sort(anv_arr_t arr, anv_arr_compare_fn cmp)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__sort_ctx ctx = {
+        .base = (unsigned char *)arr,
+        .item_sz = metadata->item_sz,
+        .cmp = cmp,
+        .tmp_item = ANV_ARR__TMP_ITEM(arr, metadata),
+    };
+    anv_arr__sort_range(&ctx, 0, metadata->arr_sz);
+    return ANV_ARR_RESULT_OK;
+}
+
+static uint64_t
+anv_arr__radix_key(const unsigned char *item, size_t key_offset, size_t key_sz)
+{
+    switch (key_sz) {
+        case 1:
+            return *(item + key_offset);
+        case 2: {
+            uint16_t key;
+            memcpy(&key, item + key_offset, 2);
+            return key;
+        }
+        case 4: {
+            uint32_t key;
+            memcpy(&key, item + key_offset, 4);
+            return key;
+        }
+        default: {
+            uint64_t key;
+            memcpy(&key, item + key_offset, 8);
+            return key;
+        }
+    }
+}
+
+anv_arr_result
+anv_arr_sort_radix(
+    anv_arr_t arr, size_t key_offset, size_t key_sz, int is_signed
+)
+{
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_ARR__UNLIKELY(
+            key_sz != 1 && key_sz != 2 && key_sz != 4 && key_sz != 8
+        )) {
+        anv_arr__assert(0, "radix key size must be 1, 2, 4 or 8 bytes");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+
+    size_t item_sz = metadata->item_sz;
+    size_t n = metadata->arr_sz;
+    if (ANV_ARR__UNLIKELY(key_offset + key_sz > item_sz)) {
+        anv_arr__assert(0, "radix key exceeds item size");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    if (n < 2) {
+        return ANV_ARR_RESULT_OK;
+    }
+
+    unsigned char *buffer = (unsigned char *)malloc(item_sz * n);
+    if (ANV_ARR__UNLIKELY(!buffer)) {
+        return ANV_ARR_RESULT_ALLOC_ERROR;
+    }
+
+    // Flipping the sign bit maps signed keys to unsigned ones keeping order.
+    uint64_t sign_flip = is_signed ? (uint64_t)1 << (key_sz * 8 - 1) : 0;
+
+    // All digits histograms are computed with a single pass over the array.
+    size_t hist[8][256];
+    memset(hist, 0, sizeof(hist));
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char *item = (unsigned char *)arr + item_sz * i;
+        uint64_t key = anv_arr__radix_key(item, key_offset, key_sz) ^ sign_flip;
+        for (size_t d = 0; d < key_sz; ++d) {
+            hist[d][(key >> (d * 8)) & 0xff]++;
+        }
+    }
+
+    uint64_t first_key
+        = anv_arr__radix_key((unsigned char *)arr, key_offset, key_sz)
+        ^ sign_flip;
+    unsigned char *src = (unsigned char *)arr;
+    unsigned char *dst = buffer;
+    for (size_t d = 0; d < key_sz; ++d) {
+        // Skip digits shared by all keys, they would not change the order.
+        if (hist[d][(first_key >> (d * 8)) & 0xff] == n) {
+            continue;
+        }
+
+        size_t offsets[256];
+        size_t sum = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            offsets[b] = sum;
+            sum += hist[d][b];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            unsigned char *item = src + item_sz * i;
+            uint64_t key
+                = anv_arr__radix_key(item, key_offset, key_sz) ^ sign_flip;
+            size_t pos = offsets[(key >> (d * 8)) & 0xff]++;
+            memcpy(dst + item_sz * pos, item, item_sz);
+        }
+
+        unsigned char *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != (unsigned char *)arr) {
+        memcpy(arr, src, item_sz * n);
+    }
+    free(buffer);
+    return ANV_ARR_RESULT_OK;
 }
 
 size_t
-anv_arr_length(anv_arr_t arr)
+anv_arr_lower_bound(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp)
 {
     if (ANV_ARR__UNLIKELY(!arr)) {
         anv_arr__assert(0, "invalid null array");
         return 0;
     }
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return 0;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
         return 0;
     }
-    return metadata->arr_sz;
-}
 
-static void *
-anv_arr__get_internal(anv_arr_t arr, size_t index, anv_arr__metadata *metadata)
-{
-    return (void *)((size_t)arr + metadata->item_sz * index);
+    size_t lo = 0;
+    size_t hi = metadata->arr_sz;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp(key, anv_arr__get_internal(arr, mid, metadata)) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
 }
 
-static void
-anv_arr__set_internal(
-    anv_arr_t arr, size_t index, anv_arr__metadata *metadata, void *item
-)
+size_t
+anv_arr_upper_bound(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp)
 {
-    void *spot = (void *)((size_t)arr + metadata->item_sz * index);
-    if (item) {
-        memcpy(spot, item, metadata->item_sz);
-    } else {
-        memset(spot, 0, metadata->item_sz);
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
+    }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return 0;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+
+    size_t lo = 0;
+    size_t hi = metadata->arr_sz;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp(key, anv_arr__get_internal(arr, mid, metadata)) >= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    return lo;
 }
 
-static anv_arr_result
-anv_arr__reallocate(
-    anv_arr_t *refarr, anv_arr__metadata **refmetadata, size_t new_capacity
+size_t
+anv_arr_lower_bound_branchless(
+    anv_arr_t arr, const void *key, anv_arr_compare_fn cmp
 )
 {
-    void *resized_arr
-        = anv_meta_realloc(*refarr, (*refmetadata)->item_sz * new_capacity);
-    if (ANV_ARR__UNLIKELY(!resized_arr)) {
-        return ANV_ARR_RESULT_ALLOC_ERROR;
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        anv_arr__assert(0, "invalid null array");
+        return 0;
     }
-    // during reallocations the metadata might be moved somewhere else, we
-    // retrieve it again and propagate it upwards where needed.
-    anv_arr__metadata *new_metadata_loc
-        = (anv_arr__metadata *)anv_meta_get(resized_arr);
-    *refmetadata = new_metadata_loc;
-    new_metadata_loc->arr_capacity = new_capacity;
-    *refarr = resized_arr;
-    return ANV_ARR_RESULT_OK;
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return 0;
+    }
+
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
+    if (ANV_ARR__UNLIKELY(!metadata)) {
+        anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
+        return 0;
+    }
+
+    size_t n = metadata->arr_sz;
+    if (n == 0) {
+        return 0;
+    }
+
+    size_t item_sz = metadata->item_sz;
+    unsigned char *base = (unsigned char *)arr;
+    while (n > 1) {
+        size_t half = n / 2;
+        // Whatever the compare result, one of these is the next midpoint.
+        ANV_ARR__PREFETCH(base + item_sz * (half / 2));
+        ANV_ARR__PREFETCH(base + item_sz * (half + half / 2));
+        base = cmp(key, base + item_sz * half) > 0 ? base + item_sz * half
+                                                   : base;
+        n -= half;
+    }
+    size_t index = (size_t)(base - (unsigned char *)arr) / item_sz;
+    return index + (cmp(key, base) > 0 ? 1 : 0);
 }
 
-static anv_arr_result
-anv_arr__push_internal(
-    anv_arr_t *refarr, anv_arr__metadata **refmetadata, void *item
-)
+void *
+anv_arr__bsearch(anv_arr_t arr, const void *key, anv_arr_compare_fn cmp)
 {
-    if ((*refmetadata)->arr_sz >= (*refmetadata)->arr_capacity) {
-        size_t new_capacity
-            = anv_arr__reallocator((*refmetadata)->arr_capacity);
-        anv_arr_result res
-            = anv_arr__reallocate(refarr, refmetadata, new_capacity);
-        if (res != ANV_ARR_RESULT_OK) {
-            return res;
-        }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return NULL;
     }
 
-    anv_arr__set_internal(
-        *refarr, (*refmetadata)->arr_sz++, (*refmetadata), item
-    );
-    return ANV_ARR_RESULT_OK;
+    size_t index = anv_arr_lower_bound(arr, key, cmp);
+    void *item = anv_arr__get(arr, index);
+    if (!item || cmp(key, item) != 0) {
+        return NULL;
+    }
+    return item;
 }
 
 anv_arr_result
-anv_arr__insert(anv_arr_t *refarr, size_t index, void *item)
+anv_arr__insert_sorted(anv_arr_t *refarr, void *item, anv_arr_compare_fn cmp)
 {
     if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
         anv_arr__assert(0, "invalid null array");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
+    if (ANV_ARR__UNLIKELY(!item)) {
+        anv_arr__assert(0, "invalid null item");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
 
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(*refarr);
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(*refarr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
 
-    // Inserting at index 0 for empty arrays is a supported special case.
-    if (index != 0 && index >= metadata->arr_sz) {
-        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
     }
 
-    // Empty array have no existing item to move.
-    if (metadata->arr_sz == 0) {
-        return anv_arr__push_internal(refarr, &metadata, item);
-    } else {
-        // Here it's import that we push the new item to last before
-        // updating the current item. This ensure the old item value is memcpyed
-        // to the new location.
-        void *old_item = anv_arr__get_internal(*refarr, index, metadata);
-        anv_arr_result res
-            = anv_arr__push_internal(refarr, &metadata, old_item);
-        if (res == ANV_ARR_RESULT_OK) {
-            anv_arr__set_internal(*refarr, index, metadata, item);
-        }
+    size_t index = anv_arr_upper_bound(*refarr, item, cmp);
+    size_t tail = metadata->arr_sz - index;
+    anv_arr_result res = anv_arr__push_n_internal(refarr, &metadata, NULL, 1);
+    if (res != ANV_ARR_RESULT_OK) {
         return res;
     }
+    anv_arr__move_internal(*refarr, metadata, index, index + 1, tail);
+    anv_arr__set_internal(*refarr, index, metadata, item);
+    return ANV_ARR_RESULT_OK;
 }
 
-anv_arr_result
-anv_arr__push(anv_arr_t *refarr, void *item)
+static size_t
+anv_arr__eytzinger_build(
+    unsigned char *dst,
+    const unsigned char *src,
+    size_t item_sz,
+    size_t n,
+    size_t src_index,
+    size_t k
+)
 {
-    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
-        anv_arr__assert(0, "invalid null array");
-        return ANV_ARR_RESULT_INVALID_PARAMS;
-    }
-
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(*refarr);
-    if (ANV_ARR__UNLIKELY(!metadata)) {
-        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
-        return ANV_ARR_RESULT_INVALID_PARAMS;
+    // In-order visit of the implicit tree, k is the 1-based node index.
+    if (k <= n) {
+        src_index
+            = anv_arr__eytzinger_build(dst, src, item_sz, n, src_index, 2 * k);
+        memcpy(dst + item_sz * (k - 1), src + item_sz * src_index, item_sz);
+        src_index = anv_arr__eytzinger_build(
+            dst, src, item_sz, n, src_index + 1, 2 * k + 1
+        );
     }
-
-    return anv_arr__push_internal(refarr, &metadata, item);
+    return src_index;
 }
 
-void *
-anv_arr__pop(anv_arr_t arr)
+anv_arr_t
+anv_arr_eytzinger_new(anv_arr_t sorted_arr)
 {
-    if (ANV_ARR__UNLIKELY(!arr)) {
+    if (ANV_ARR__UNLIKELY(!sorted_arr)) {
         anv_arr__assert(0, "invalid null array");
         return NULL;
     }
 
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(arr);
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(sorted_arr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
         return NULL;
     }
 
-    if (metadata->arr_sz == 0) {
+    size_t n = metadata->arr_sz;
+    anv_arr_options options = {
+        .arr_capacity = n > 0 ? n : 1,
+        .item_sz = metadata->item_sz,
+        .growth_fn = metadata->growth_fn,
+        .growth_ctx = metadata->growth_ctx,
+        .allocator = anv_meta_get_allocator(sorted_arr),
+        .alignment = anv_meta_get_alignment(sorted_arr),
+    };
+    anv_arr_t eyt_arr = anv_arr_new_with_options(&options);
+    if (ANV_ARR__UNLIKELY(!eyt_arr)) {
         return NULL;
     }
-    void *item = anv_arr__get_internal(arr, metadata->arr_sz - 1, metadata);
-    metadata->arr_sz--;
-    return item;
+
+    anv_arr__eytzinger_build(
+        (unsigned char *)eyt_arr,
+        (const unsigned char *)sorted_arr,
+        metadata->item_sz,
+        n,
+        0,
+        1
+    );
+    anv_arr__metadata *eyt_metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(eyt_arr);
+    eyt_metadata->arr_sz = n;
+    // Like mapped views, full and read-only: typed pushes take the grow path
+    // which rejects them.
+    eyt_metadata->arr_capacity = n;
+    eyt_metadata->is_readonly = 1;
+    return eyt_arr;
 }
 
 void *
-anv_arr__get(anv_arr_t arr, size_t index)
+anv_arr__eytzinger_lower_bound(
+    anv_arr_t eyt_arr, const void *key, anv_arr_compare_fn cmp
+)
 {
-    if (ANV_ARR__UNLIKELY(!arr)) {
+    if (ANV_ARR__UNLIKELY(!eyt_arr)) {
         anv_arr__assert(0, "invalid null array");
         return NULL;
     }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return NULL;
+    }
 
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(arr);
+    anv_arr__metadata *metadata
+        = (anv_arr__metadata *)anv_arr__meta_get(eyt_arr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
         return NULL;
     }
 
-    if (index >= metadata->arr_sz) {
+    size_t n = metadata->arr_sz;
+    size_t item_sz = metadata->item_sz;
+    unsigned char *base = (unsigned char *)eyt_arr;
+    size_t k = 1;
+    while (k <= n) {
+        // Descendants 4 levels below are stored contiguously from 16k.
+        if (16 * k <= n) {
+            ANV_ARR__PREFETCH(base + item_sz * (16 * k - 1));
+        }
+        k = 2 * k + (cmp(key, base + item_sz * (k - 1)) > 0 ? 1 : 0);
+    }
+    // Go back up to the last node where the search went left.
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+    if (k == 0) {
         return NULL;
     }
-    return anv_arr__get_internal(arr, index, metadata);
+    return base + item_sz * (k - 1);
 }
 
-static void
-anv_arr__swap_internal(
-    anv_arr_t arr, anv_arr__metadata *metadata, size_t index_a, size_t index_b
+void *
+anv_arr__eytzinger_bsearch(
+    anv_arr_t eyt_arr, const void *key, anv_arr_compare_fn cmp
 )
 {
-    void *tmp_item = ANV_ARR__TMP_ITEM(metadata);
-    void *item_a = anv_arr__get_internal(arr, index_a, metadata);
-    void *item_b = anv_arr__get_internal(arr, index_b, metadata);
-
-    memcpy(tmp_item, item_a, metadata->item_sz);
-    memcpy(item_a, item_b, metadata->item_sz);
-    memcpy(item_b, tmp_item, metadata->item_sz);
+    void *item = anv_arr__eytzinger_lower_bound(eyt_arr, key, cmp);
+    if (!item || cmp(key, item) != 0) {
+        return NULL;
+    }
+    return item;
 }
 
 anv_arr_result
-anv_arr_swap(anv_arr_t arr, size_t index_a, size_t index_b)
+anv_arr_save(anv_arr_t arr, const char *filename)
 {
-    if (ANV_ARR__UNLIKELY(!arr)) {
-        anv_arr__assert(0, "invalid null array");
+    if (ANV_ARR__UNLIKELY(!arr || !filename)) {
+        anv_arr__assert(0, "invalid null array or filename");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
-
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(arr);
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
 
-    if (index_a == index_b) {
-        return ANV_ARR_RESULT_INDEX_COLLISION;
+    // the header is padded with zeroes up to the first item.
+    unsigned char header_buff[ANV_ARR__FILE_DATA_OFFSET] = { 0 };
+    anv_arr_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ANV_ARR__FILE_MAGIC, sizeof(header.magic));
+    header.version = ANV_ARR_FILE_VERSION;
+    header.byte_order = ANV_ARR_FILE_BYTE_ORDER;
+    header.item_sz = metadata->item_sz;
+    header.length = metadata->arr_sz;
+    header.capacity = metadata->arr_capacity;
+    header.data_offset = ANV_ARR__FILE_DATA_OFFSET;
+    memcpy(header_buff, &header, sizeof(header));
+
+    FILE *file = fopen(filename, "wb");
+    if (ANV_ARR__UNLIKELY(!file)) {
+        return ANV_ARR_RESULT_IO_ERROR;
     }
-    if (index_a >= metadata->arr_sz || index_b >= metadata->arr_sz) {
-        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    size_t data_sz = metadata->arr_sz * metadata->item_sz;
+    int ok = fwrite(header_buff, 1, sizeof(header_buff), file)
+        == sizeof(header_buff);
+    if (ok && data_sz > 0) {
+        ok = fwrite(arr, 1, data_sz, file) == data_sz;
     }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok ? ANV_ARR_RESULT_OK : ANV_ARR_RESULT_IO_ERROR;
+}
 
-    anv_arr__swap_internal(arr, metadata, index_a, index_b);
+/*
+ * Turn a file written by anv_arr_save into an array in place.
+ */
+static anv_arr_result
+anv_arr__init_view(unsigned char *base, size_t file_sz, anv_arr_t *out_arr)
+{
+    anv_arr_file_header header;
+    if (ANV_ARR__UNLIKELY(file_sz < sizeof(header))) {
+        return ANV_ARR_RESULT_BAD_FORMAT;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (ANV_ARR__UNLIKELY(
+            memcmp(header.magic, ANV_ARR__FILE_MAGIC, sizeof(header.magic))
+                != 0
+            || header.version != ANV_ARR_FILE_VERSION
+            || header.byte_order != ANV_ARR_FILE_BYTE_ORDER
+            || header.item_sz == 0 || header.data_offset > file_sz
+            || header.data_offset % ANV_ARR__VIEW_ALIGNMENT != 0
+        )) {
+        return ANV_ARR_RESULT_BAD_FORMAT;
+    }
+    // also rejects sizes not fitting in size_t.
+    if (ANV_ARR__UNLIKELY(
+            header.length > (file_sz - header.data_offset) / header.item_sz
+        )) {
+        return ANV_ARR_RESULT_BAD_FORMAT;
+    }
+
+    // Grow the metadata so that it starts aligned like the items.
+    anv_meta_size_t meta_sz = sizeof(anv_arr__metadata);
+    while (ANV_META_BUFFER_SIZE(meta_sz, 0) % ANV_ARR__VIEW_ALIGNMENT != 0) {
+        ++meta_sz;
+    }
+    size_t header_sz = ANV_META_BUFFER_SIZE(meta_sz, 0);
+    if (ANV_ARR__UNLIKELY(
+            header.data_offset
+            < sizeof(header) + sizeof(anv_arr__mapping) + header_sz
+        )) {
+        return ANV_ARR_RESULT_BAD_FORMAT;
+    }
+
+    size_t data_offset = (size_t)header.data_offset;
+    size_t data_sz = (size_t)header.length * (size_t)header.item_sz;
+    unsigned char *buffer = base + data_offset - header_sz;
+    // metalloc wants room for at least 1 byte of data, never accessed.
+    void *arr = anv_meta_init_buffer(
+        buffer, header_sz + data_sz + (data_sz == 0), NULL, meta_sz
+    );
+    if (ANV_ARR__UNLIKELY(!arr)) {
+        return ANV_ARR_RESULT_BAD_FORMAT;
+    }
+    anv_arr__metadata metadata = {
+        .arr_sz = (size_t)header.length,
+        .arr_capacity = (size_t)header.length,
+        .item_sz = (size_t)header.item_sz,
+        .grow_count = 0,
+        .growth_fn = NULL,
+        .growth_ctx = NULL,
+        .is_inline = 0,
+        .is_mapped = 1,
+        .is_readonly = 1,
+    };
+    memcpy(anv_meta_get_unchecked(arr), &metadata, sizeof(metadata));
+    anv_arr__mapping mapping = { .base = base, .sz = file_sz };
+    memcpy(buffer - sizeof(mapping), &mapping, sizeof(mapping));
+
+    // Only the pages written above have been copied.
+    if (ANV_ARR__UNLIKELY(!anv_arr__protect_file(base, file_sz))) {
+        return ANV_ARR_RESULT_IO_ERROR;
+    }
+#ifdef ANV_ARR_ENABLE_STATS
+    anv_arr__stats_created((anv_arr__metadata *)anv_meta_get_unchecked(arr));
+#endif
+    *out_arr = arr;
     return ANV_ARR_RESULT_OK;
 }
 
+anv_arr_result
+anv_arr_map_readonly(const char *filename, anv_arr_t *out_arr)
+{
+    if (ANV_ARR__UNLIKELY(!filename || !out_arr)) {
+        anv_arr__assert(0, "invalid null filename or out array");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
+    *out_arr = NULL;
+
+    size_t file_sz = 0;
+    unsigned char *base = anv_arr__map_file(filename, &file_sz);
+    if (ANV_ARR__UNLIKELY(!base)) {
+        return ANV_ARR_RESULT_IO_ERROR;
+    }
+    anv_arr_result result = anv_arr__init_view(base, file_sz, out_arr);
+    if (ANV_ARR__UNLIKELY(result != ANV_ARR_RESULT_OK)) {
+        anv_arr__unmap_file(base, file_sz);
+    }
+    return result;
+}
+
+#ifdef ANV_ARR_ENABLE_THREADS
+
+#include <pthread.h>
+
+#define ANV_ARR__MAX_SORT_THREADS 64
+
+typedef struct anv_arr__sort_job {
+    anv_arr__sort_ctx ctx;
+    // Merge destination buffer, unused when sorting.
+    unsigned char *dst;
+    size_t lo;
+    size_t mid;
+    size_t hi;
+} anv_arr__sort_job;
+
+static void *
+anv_arr__sort_job_run(void *arg)
+{
+    anv_arr__sort_job *job = (anv_arr__sort_job *)arg;
+    anv_arr__sort_range(&job->ctx, job->lo, job->hi);
+    return NULL;
+}
+
+static void *
+anv_arr__merge_job_run(void *arg)
+{
+    anv_arr__sort_job *job = (anv_arr__sort_job *)arg;
+    anv_arr__sort_ctx *ctx = &job->ctx;
+    size_t item_sz = ctx->item_sz;
+    size_t i = job->lo;
+    size_t j = job->mid;
+    unsigned char *out = job->dst + item_sz * job->lo;
+
+    while (i < job->mid && j < job->hi) {
+        if (anv_arr__sort_cmp(ctx, j, i) < 0) {
+            memcpy(out, ANV_ARR__SORT_AT(ctx, j++), item_sz);
+        } else {
+            memcpy(out, ANV_ARR__SORT_AT(ctx, i++), item_sz);
+        }
+        out += item_sz;
+    }
+    memcpy(out, ANV_ARR__SORT_AT(ctx, i), item_sz * (job->mid - i));
+    out += item_sz * (job->mid - i);
+    memcpy(out, ANV_ARR__SORT_AT(ctx, j), item_sz * (job->hi - j));
+    return NULL;
+}
+
+/**
+ * Run all jobs concurrently and wait for them. Jobs whose thread cannot be
+ * spawned are run on the calling thread instead.
+ */
 static void
-anv_arr__copy_internal(
-    anv_arr_t arr, anv_arr__metadata *metadata, size_t from_idx, size_t to_idx
+anv_arr__sort_run_jobs(
+    anv_arr__sort_job *jobs, size_t n_jobs, void *(*job_fn)(void *)
 )
 {
-    void *from_item = anv_arr__get_internal(arr, from_idx, metadata);
-    void *to_item = anv_arr__get_internal(arr, to_idx, metadata);
-    memcpy(to_item, from_item, metadata->item_sz);
+    pthread_t threads[ANV_ARR__MAX_SORT_THREADS];
+    int spawned[ANV_ARR__MAX_SORT_THREADS];
+
+    for (size_t i = 0; i < n_jobs; ++i) {
+        spawned[i] = pthread_create(&threads[i], NULL, job_fn, &jobs[i]) == 0;
+        if (!spawned[i]) {
+            job_fn(&jobs[i]);
+        }
+    }
+    for (size_t i = 0; i < n_jobs; ++i) {
+        if (spawned[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
 }
 
 anv_arr_result
-anv_arr_remove(anv_arr_t arr, size_t index)
+anv_arr_sort_parallel(anv_arr_t arr, anv_arr_compare_fn cmp, size_t n_threads)
 {
     if (ANV_ARR__UNLIKELY(!arr)) {
         anv_arr__assert(0, "invalid null array");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
+    if (ANV_ARR__UNLIKELY(!cmp)) {
+        anv_arr__assert(0, "invalid null compare fn");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
+    }
 
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(arr);
+    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_arr__meta_get(arr);
     if (ANV_ARR__UNLIKELY(!metadata)) {
         anv_arr__assert(0, "cannot find metadata, is arr a valid meta obj?");
         return ANV_ARR_RESULT_INVALID_PARAMS;
     }
 
-    if (index >= metadata->arr_sz) {
-        return ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS;
+    if (ANV_ARR__UNLIKELY(ANV_ARR__IS_READONLY(metadata))) {
+        anv_arr__assert(0, "read-only arrays cannot be modified");
+        return ANV_ARR_RESULT_INVALID_PARAMS;
     }
 
-    anv_arr__copy_internal(arr, metadata, metadata->arr_sz - 1, index);
-    metadata->arr_sz--;
-    return ANV_ARR_RESULT_OK;
-}
+    size_t n = metadata->arr_sz;
+    if (n_threads <= 1 || n < ANV_ARR_PARALLEL_SORT_THRESHOLD) {
+        return anv_arr_sort(arr, cmp);
+    }
+    if (n_threads > ANV_ARR__MAX_SORT_THREADS) {
+        n_threads = ANV_ARR__MAX_SORT_THREADS;
+    }
 
-anv_arr_result
-anv_arr__shrink_to_fit(anv_arr_t *refarr)
-{
-    if (ANV_ARR__UNLIKELY(!refarr || !*refarr)) {
-        anv_arr__assert(0, "invalid null array");
-        return ANV_ARR_RESULT_INVALID_PARAMS;
+    size_t item_sz = metadata->item_sz;
+    // Merge buffer + one swap scratch item for each thread.
+    unsigned char *buffer
+        = (unsigned char *)malloc(item_sz * (n + n_threads));
+    if (ANV_ARR__UNLIKELY(!buffer)) {
+        return ANV_ARR_RESULT_ALLOC_ERROR;
     }
 
-    anv_arr__metadata *metadata = (anv_arr__metadata *)anv_meta_get(*refarr);
-    if (ANV_ARR__UNLIKELY(!metadata)) {
-        anv_arr__assert(0, "cannot find metadata, is refarr a valid meta obj?");
-        return ANV_ARR_RESULT_INVALID_PARAMS;
+    size_t bounds[ANV_ARR__MAX_SORT_THREADS + 1];
+    for (size_t t = 0; t <= n_threads; ++t) {
+        bounds[t] = n / n_threads * t + (n % n_threads) * t / n_threads;
     }
 
-    return anv_arr__reallocate(refarr, &metadata, metadata->arr_sz);
+    anv_arr__sort_job jobs[ANV_ARR__MAX_SORT_THREADS];
+    for (size_t t = 0; t < n_threads; ++t) {
+        anv_arr__sort_job job = {
+            .ctx = {
+                .base = (unsigned char *)arr,
+                .item_sz = item_sz,
+                .cmp = cmp,
+                .tmp_item = buffer + item_sz * (n + t),
+            },
+            .dst = NULL,
+            .lo = bounds[t],
+            .mid = bounds[t],
+            .hi = bounds[t + 1],
+        };
+        jobs[t] = job;
+    }
+    anv_arr__sort_run_jobs(jobs, n_threads, anv_arr__sort_job_run);
+
+    // Merge sorted chunks pairwise, ping-ponging between array and buffer.
+    unsigned char *src = (unsigned char *)arr;
+    unsigned char *dst = buffer;
+    for (size_t width = 1; width < n_threads; width *= 2) {
+        size_t n_jobs = 0;
+        for (size_t r = 0; r < n_threads; r += 2 * width) {
+            size_t mid = r + width < n_threads ? r + width : n_threads;
+            size_t hi = r + 2 * width < n_threads ? r + 2 * width : n_threads;
+            anv_arr__sort_job job = {
+                .ctx = {
+                    .base = src,
+                    .item_sz = item_sz,
+                    .cmp = cmp,
+                    .tmp_item = NULL,
+                },
+                .dst = dst,
+                .lo = bounds[r],
+                .mid = bounds[mid],
+                .hi = bounds[hi],
+            };
+            jobs[n_jobs++] = job;
+        }
+        anv_arr__sort_run_jobs(jobs, n_jobs, anv_arr__merge_job_run);
+
+        unsigned char *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != (unsigned char *)arr) {
+        memcpy(arr, src, item_sz * n);
+    }
+    free(buffer);
+    return ANV_ARR_RESULT_OK;
 }
 
+#endif /* ANV_ARR_ENABLE_THREADS */
+
 #endif /* ANV_ARR_IMPLEMENTATION */
 
 #endif /* ANV_ARR_H */
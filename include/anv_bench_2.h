@@ -0,0 +1,896 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_bench_2 (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_bench_2
+
+Simple C micro benchmarking library, replacement for the deprecated
+anv_bench.h.
+
+Main goals:
+- same look and feel of anv_testsuite_2
+- portable (x86, ARM, Windows and POSIX)
+- statistically sound results: warmup, automatic iterations calibration and
+  min/median/mean/p99/stddev over many samples
+- machine readable output (CSV, JSON) to track regressions
+
+## Dependencies
+
+None
+
+## Include usage
+
+```c
+#include "anv_bench_2.h"
+```
+
+## Clocks
+
+Time is measured with a monotonic clock:
+- QueryPerformanceCounter on Windows
+- mach_absolute_time on macOS
+- clock_gettime(CLOCK_MONOTONIC) elsewhere. With strict ISO modes (e.g.
+  -std=c99) it is only declared when _POSIX_C_SOURCE >= 199309L is defined
+  before including any system header, otherwise the much coarser clock() is
+  used. The clock in use is printed with the results and returned by
+  anv_bench_clock_name.
+
+Define ANV_BENCH_USE_TSC to read the CPU timestamp counter instead (fenced
+rdtsc on x86, cntvct_el0 on ARM64): reading it is cheaper than a clock call.
+Ticks are converted to nanoseconds against the monotonic clock once at
+startup, so results are always reported in nanoseconds.
+
+## Measuring
+
+Each benchmark is a function receiving an anv_bench_state. Only the code inside
+ANV_BENCH_LOOP is timed, anything before and after it can be used for setup and
+cleanup. The function is called many times:
+
+1. calibration: the iterations count is increased until a single call lasts at
+   least sample_time_s.
+2. warmup: the function runs for warmup_time_s without recording anything, to
+   populate caches and let the CPU reach a steady frequency.
+3. measure: the function is called samples times, each call gives the time of
+   one iteration.
+
+Use anv_bench_do_not_optimize on results and anv_bench_clobber_memory after
+writes so that the compiler cannot delete the benchmarked work.
+
+Iterations which must reset their data (e.g. refill an array before popping
+from it) can exclude that part with anv_bench_pause/anv_bench_resume.
+
+The same benchmark can be run with different params by registering it with
+ANV_BENCH_REGISTER_ARG (available as state->arg), suites built at runtime are
+run with ANV_BENCH_RUN_CASES.
+
+## Examples
+
+```c
+#include "anv_bench_2.h"
+
+ANV_BENCH_CASE(bench_sum)
+{
+    int values[256];
+    for (int i = 0; i < 256; ++i) {
+        values[i] = i;
+    }
+    // 256 items and 1KB processed for each iteration.
+    state->items_per_iteration = 256;
+    state->bytes_per_iteration = sizeof(values);
+
+    ANV_BENCH_LOOP(state)
+    {
+        int sum = 0;
+        for (int i = 0; i < 256; ++i) {
+            sum += values[i];
+        }
+        anv_bench_do_not_optimize(&sum);
+    }
+}
+
+ANV_BENCH_SUITE(
+    my_benchmarks,
+    ANV_BENCH_REGISTER(bench_sum),
+);
+
+int
+main(int argc, char **argv)
+{
+    anv_bench_config config = { 0 };
+    // --csv, --json, --filter=name, --samples=N, --sample-time=S, --warmup=S
+    anv_bench_config_from_args(&config, argc, argv);
+    return ANV_BENCH_RUN(my_benchmarks, stdout, &config);
+}
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_BENCH_2_H
+#define ANV_BENCH_2_H
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for uint64_t */
+#include <stdio.h> /* for FILE, fprintf() */
+#include <stdlib.h> /* for qsort(), strtod(), strtoul() */
+#include <string.h> /* for memset(), strcmp(), strncmp(), strstr() */
+#include <time.h> /* for clock_gettime(), clock() */
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h> /* for QueryPerformanceCounter() */
+#elif defined(__APPLE__)
+#include <mach/mach_time.h> /* for mach_absolute_time() */
+#endif
+
+#ifdef ANV_BENCH_USE_TSC
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h> /* for __rdtsc(), _mm_lfence() */
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> /* for __rdtsc(), _mm_lfence() */
+#elif !defined(__aarch64__)
+#error "anv_bench_2: ANV_BENCH_USE_TSC is only supported on x86 and ARM64"
+#endif
+#endif
+
+/**
+ * Default min duration in seconds of each sample.
+ */
+#ifndef ANV_BENCH_DEFAULT_SAMPLE_TIME
+#define ANV_BENCH_DEFAULT_SAMPLE_TIME 0.01
+#endif
+
+/**
+ * Default number of samples of each benchmark.
+ */
+#ifndef ANV_BENCH_DEFAULT_SAMPLES
+#define ANV_BENCH_DEFAULT_SAMPLES 30
+#endif
+
+/**
+ * Default warmup duration in seconds of each benchmark.
+ */
+#ifndef ANV_BENCH_DEFAULT_WARMUP_TIME
+#define ANV_BENCH_DEFAULT_WARMUP_TIME 0.05
+#endif
+
+/**
+ * Max number of samples of each benchmark.
+ */
+#ifndef ANV_BENCH_MAX_SAMPLES
+#define ANV_BENCH_MAX_SAMPLES 1000
+#endif
+
+/**
+ * Change dotted padding length for benchmark names in text output.
+ */
+#ifndef ANV_BENCH_PADDING
+#define ANV_BENCH_PADDING 50
+#endif
+
+#define ANV_BENCH__LEN(x) (sizeof(x) / sizeof((x)[0]))
+
+#define ANV_BENCH__MAX_ITERATIONS ((size_t)1 << 30)
+
+typedef enum anv_bench_format {
+    /** Human readable table. */
+    ANV_BENCH_FORMAT_TEXT = 0,
+    /** One line per benchmark, with a header line. */
+    ANV_BENCH_FORMAT_CSV = 1,
+    /** A single JSON object with a "benchmarks" array. */
+    ANV_BENCH_FORMAT_JSON = 2,
+} anv_bench_format;
+
+/**
+ * Runtime config of a benchmarks run, a zeroed struct means all defaults.
+ */
+typedef struct anv_bench_config {
+    /** Min duration in seconds of each sample, 0 for the default. */
+    double sample_time_s;
+    /** Warmup duration in seconds, 0 for the default, < 0 to disable. */
+    double warmup_time_s;
+    /** Number of samples, 0 for the default (max ANV_BENCH_MAX_SAMPLES). */
+    size_t samples;
+    /** Output format. */
+    anv_bench_format format;
+    /** Optional, only run benchmarks whose name contains this string. */
+    const char *filter;
+} anv_bench_config;
+
+/**
+ * State of the running benchmark.
+ */
+typedef struct anv_bench_state {
+    /** Number of iterations ANV_BENCH_LOOP runs in this call. */
+    size_t iterations;
+    /** Optional, number of items processed by a single iteration. */
+    double items_per_iteration;
+    /** Optional, number of bytes processed by a single iteration. */
+    double bytes_per_iteration;
+    /** Set with anv_bench_skip to abort the benchmark. */
+    const char *error;
+    /** User argument of the benchmark, see anv_bench_case. */
+    const void *arg;
+    /* private */
+    uint64_t start;
+    uint64_t elapsed;
+    int looped;
+    int paused;
+} anv_bench_state;
+
+/**
+ * Benchmark interface.
+ */
+typedef void (*anv_bench_callback)(anv_bench_state *state);
+
+/**
+ * Identifies a benchmark run by a benchmarks suite.
+ */
+typedef struct anv_bench_case {
+    /** Display name for benchmark. */
+    const char *name;
+    /** Benchmark to run. */
+    anv_bench_callback bench;
+    /** Optional, passed as state->arg to run the same benchmark with
+     * different params. */
+    const void *arg;
+} anv_bench_case;
+
+/**
+ * Results of a single benchmark, times are per iteration.
+ */
+typedef struct anv_bench_result {
+    const char *name;
+    size_t iterations;
+    size_t samples;
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+    double p99_ns;
+    double max_ns;
+    double stddev_ns;
+    /** 0 when items_per_iteration was not set. */
+    double items_per_s;
+    /** 0 when bytes_per_iteration was not set. */
+    double bytes_per_s;
+} anv_bench_result;
+
+/**
+ * Define a benchmark scoped to current file only, its state is available as
+ * state. Name must be unique for current file.
+ */
+#define ANV_BENCH_CASE(bench_name)                                             \
+    static void bench_name(anv_bench_state *state)
+
+/**
+ * Define a benchmarks suite with a list of benchmarks to run scoped to current
+ * file only. Name must be unique for current file.
+ */
+#define ANV_BENCH_SUITE(suitename, ...)                                        \
+    static const anv_bench_case suitename[] = { __VA_ARGS__ }
+
+/**
+ * Register benchmark for benchmarks suite.
+ */
+#define ANV_BENCH_REGISTER(bench_name)                                         \
+    {                                                                          \
+        #bench_name, bench_name, NULL                                          \
+    }
+
+/**
+ * Register benchmark with a custom name and argument for benchmarks suite.
+ */
+#define ANV_BENCH_REGISTER_ARG(name, bench_name, arg)                          \
+    {                                                                          \
+        name, bench_name, arg                                                  \
+    }
+
+/**
+ * Timed loop, runs state->iterations times.
+ * Must be used exactly once in each benchmark.
+ */
+#define ANV_BENCH_LOOP(state)                                                  \
+    for (size_t anv_bench__i = anv_bench__loop_begin(state);                   \
+         anv_bench__i < (state)->iterations || anv_bench__loop_end(state);     \
+         ++anv_bench__i)
+
+/**
+ * Prevent the compiler from optimizing away the computation of the value
+ * pointed by ptr, e.g. anv_bench_do_not_optimize(&result).
+ */
+static inline void
+anv_bench_do_not_optimize(const void *ptr)
+{
+#if defined(__GNUC__)
+    __asm__ __volatile__("" : : "g"(ptr) : "memory");
+#else
+    static const void *volatile anv_bench__sink;
+    anv_bench__sink = ptr;
+#endif
+}
+
+/**
+ * Force the compiler to consider all memory as read and written, so that
+ * stores done by the benchmarked code cannot be removed.
+ */
+static inline void
+anv_bench_clobber_memory(void)
+{
+#if defined(__GNUC__)
+    __asm__ __volatile__("" : : : "memory");
+#elif defined(_MSC_VER)
+    _ReadWriteBarrier();
+#endif
+}
+
+/**
+ * Abort the current benchmark, reporting msg instead of its results.
+ */
+static inline void
+anv_bench_skip(anv_bench_state *state, const char *msg)
+{
+    state->error = msg ? msg : "skipped";
+}
+
+/**
+ * @return Name of the clock used to measure time.
+ */
+static inline const char *
+anv_bench_clock_name(void)
+{
+#if defined(ANV_BENCH_USE_TSC) && defined(__aarch64__)
+    return "cntvct_el0";
+#elif defined(ANV_BENCH_USE_TSC)
+    return "rdtsc";
+#elif defined(_WIN32)
+    return "QueryPerformanceCounter";
+#elif defined(__APPLE__)
+    return "mach_absolute_time";
+#elif defined(CLOCK_MONOTONIC)
+    return "clock_gettime(CLOCK_MONOTONIC)";
+#else
+    return "clock()";
+#endif
+}
+
+/**
+ * @return Monotonic time in nanoseconds, from an unspecified starting point.
+ */
+static inline uint64_t
+anv_bench_now_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9
+                      / (double)frequency.QuadPart);
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+ * Raw timestamp in clock specific ticks, see anv_bench__ticks_to_ns.
+ */
+static inline uint64_t
+anv_bench__ticks(void)
+{
+#if defined(ANV_BENCH_USE_TSC) && defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0"
+                         : "=r"(ticks)
+                         :
+                         : "memory");
+    return ticks;
+#elif defined(ANV_BENCH_USE_TSC)
+    // fences keep the benchmarked code from being reordered around rdtsc.
+    _mm_lfence();
+    uint64_t ticks = (uint64_t)__rdtsc();
+    _mm_lfence();
+    return ticks;
+#else
+    return anv_bench_now_ns();
+#endif
+}
+
+static double
+anv_bench__ticks_to_ns(uint64_t ticks)
+{
+#ifdef ANV_BENCH_USE_TSC
+    static double ns_per_tick = 0;
+    if (ns_per_tick == 0) {
+        uint64_t start_ns = anv_bench_now_ns();
+        uint64_t start_ticks = anv_bench__ticks();
+        while (anv_bench_now_ns() - start_ns < 20000000u) {
+        }
+        uint64_t end_ticks = anv_bench__ticks();
+        uint64_t end_ns = anv_bench_now_ns();
+        ns_per_tick
+            = (double)(end_ns - start_ns) / (double)(end_ticks - start_ticks);
+    }
+    return (double)ticks * ns_per_tick;
+#else
+    return (double)ticks;
+#endif
+}
+
+static inline size_t
+anv_bench__loop_begin(anv_bench_state *state)
+{
+    state->looped = 1;
+    state->paused = 0;
+    state->start = anv_bench__ticks();
+    return 0;
+}
+
+static inline int
+anv_bench__loop_end(anv_bench_state *state)
+{
+    if (!state->paused) {
+        state->elapsed += anv_bench__ticks() - state->start;
+    }
+    return 0;
+}
+
+/**
+ * Stop timing inside ANV_BENCH_LOOP, e.g. to reset the data used by each
+ * iteration. Each pause costs 2 clock reads: only use it when iterations are
+ * much longer than that.
+ */
+static inline void
+anv_bench_pause(anv_bench_state *state)
+{
+    if (!state->paused) {
+        state->elapsed += anv_bench__ticks() - state->start;
+        state->paused = 1;
+    }
+}
+
+/**
+ * Resume timing after anv_bench_pause.
+ */
+static inline void
+anv_bench_resume(anv_bench_state *state)
+{
+    if (state->paused) {
+        state->paused = 0;
+        state->start = anv_bench__ticks();
+    }
+}
+
+/*
+ * Call bench with iterations, return the elapsed time in ns or a negative
+ * value on errors.
+ */
+static double
+anv_bench__call(
+    anv_bench_callback bench, anv_bench_state *state, size_t iterations
+)
+{
+    state->iterations = iterations;
+    state->elapsed = 0;
+    state->looped = 0;
+    bench(state);
+    // a benchmark may leave the loop paused.
+    state->paused = 0;
+    if (state->error) {
+        return -1;
+    }
+    if (!state->looped) {
+        state->error = "ANV_BENCH_LOOP not found";
+        return -1;
+    }
+    return anv_bench__ticks_to_ns(state->elapsed);
+}
+
+/*
+ * Newton's method square root, to avoid linking libm.
+ */
+static double
+anv_bench__sqrt(double x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    double root = x > 1 ? x : 1;
+    for (int i = 0; i < 64; ++i) {
+        double next = (root + x / root) / 2;
+        if (next >= root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+static int
+anv_bench__compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Run a single benchmark and compute its stats, return 0 on success.
+ */
+static int
+anv_bench__measure(
+    const anv_bench_case *bench_case,
+    const anv_bench_config *config,
+    double *samples_buff,
+    anv_bench_result *out_result,
+    const char **out_error
+)
+{
+    double sample_time_ns = (config->sample_time_s > 0
+                                 ? config->sample_time_s
+                                 : ANV_BENCH_DEFAULT_SAMPLE_TIME)
+                          * 1e9;
+    double warmup_time_ns = (config->warmup_time_s != 0
+                                 ? config->warmup_time_s
+                                 : ANV_BENCH_DEFAULT_WARMUP_TIME)
+                          * 1e9;
+    size_t samples = config->samples ? config->samples
+                                     : ANV_BENCH_DEFAULT_SAMPLES;
+    if (samples > ANV_BENCH_MAX_SAMPLES) {
+        samples = ANV_BENCH_MAX_SAMPLES;
+    }
+
+    anv_bench_state state;
+    memset(&state, 0, sizeof(state));
+    state.arg = bench_case->arg;
+
+    // calibration: grow iterations until a call lasts sample_time_ns.
+    size_t iterations = 1;
+    for (;;) {
+        double elapsed = anv_bench__call(bench_case->bench, &state, iterations);
+        if (elapsed < 0) {
+            *out_error = state.error;
+            return 1;
+        }
+        if (elapsed >= sample_time_ns
+            || iterations >= ANV_BENCH__MAX_ITERATIONS) {
+            break;
+        }
+        // aim slightly past the target, never more than 10x at once.
+        double factor = elapsed > 0 ? sample_time_ns * 1.2 / elapsed : 10;
+        if (factor > 10) {
+            factor = 10;
+        }
+        size_t next = (size_t)((double)iterations * factor);
+        iterations = next > iterations ? next : iterations + 1;
+        if (iterations > ANV_BENCH__MAX_ITERATIONS) {
+            iterations = ANV_BENCH__MAX_ITERATIONS;
+        }
+    }
+
+    // warmup
+    if (warmup_time_ns > 0) {
+        uint64_t warmup_start = anv_bench_now_ns();
+        while ((double)(anv_bench_now_ns() - warmup_start) < warmup_time_ns) {
+            if (anv_bench__call(bench_case->bench, &state, iterations) < 0) {
+                *out_error = state.error;
+                return 1;
+            }
+        }
+    }
+
+    // measure
+    for (size_t i = 0; i < samples; ++i) {
+        double elapsed = anv_bench__call(bench_case->bench, &state, iterations);
+        if (elapsed < 0) {
+            *out_error = state.error;
+            return 1;
+        }
+        samples_buff[i] = elapsed / (double)iterations;
+    }
+    qsort(samples_buff, samples, sizeof(double), anv_bench__compare_doubles);
+
+    double sum = 0;
+    for (size_t i = 0; i < samples; ++i) {
+        sum += samples_buff[i];
+    }
+    double mean = sum / (double)samples;
+    double variance = 0;
+    for (size_t i = 0; i < samples; ++i) {
+        variance += (samples_buff[i] - mean) * (samples_buff[i] - mean);
+    }
+    variance = samples > 1 ? variance / (double)(samples - 1) : 0;
+
+    out_result->name = bench_case->name;
+    out_result->iterations = iterations;
+    out_result->samples = samples;
+    out_result->min_ns = samples_buff[0];
+    out_result->max_ns = samples_buff[samples - 1];
+    out_result->mean_ns = mean;
+    out_result->median_ns = samples % 2
+        ? samples_buff[samples / 2]
+        : (samples_buff[samples / 2 - 1] + samples_buff[samples / 2]) / 2;
+    // nearest rank: ceil(0.99 * samples).
+    size_t p99_rank = (samples * 99 + 99) / 100;
+    out_result->p99_ns = samples_buff[p99_rank - 1];
+    out_result->stddev_ns = anv_bench__sqrt(variance);
+    out_result->items_per_s = out_result->median_ns > 0
+        ? state.items_per_iteration * 1e9 / out_result->median_ns
+        : 0;
+    out_result->bytes_per_s = out_result->median_ns > 0
+        ? state.bytes_per_iteration * 1e9 / out_result->median_ns
+        : 0;
+    return 0;
+}
+
+/*
+ * Print n with a metric suffix (k, M, G) in a 9 chars wide column.
+ */
+static void
+anv_bench__print_rate(FILE *out_file, double n, const char *unit)
+{
+    const char *suffixes[] = { "", "k", "M", "G", "T" };
+    size_t i = 0;
+    while (n >= 1000 && i < ANV_BENCH__LEN(suffixes) - 1) {
+        n /= 1000;
+        ++i;
+    }
+    fprintf(out_file, " %7.2f%s%s", n, suffixes[i], unit);
+}
+
+static void
+anv_bench__print_header(FILE *out_file, const anv_bench_config *config)
+{
+    switch (config->format) {
+        case ANV_BENCH_FORMAT_CSV:
+            fprintf(
+                out_file,
+                "name,iterations,samples,min_ns,median_ns,mean_ns,p99_ns,"
+                "max_ns,stddev_ns,items_per_s,bytes_per_s,error\n"
+            );
+            break;
+        case ANV_BENCH_FORMAT_JSON:
+            fprintf(
+                out_file,
+                "{\n  \"clock\": \"%s\",\n  \"benchmarks\": [",
+                anv_bench_clock_name()
+            );
+            break;
+        default:
+            fprintf(
+                out_file,
+                "%-*s %11s %11s %11s %9s %11s\n",
+                ANV_BENCH_PADDING,
+                "",
+                "min",
+                "median",
+                "p99",
+                "stddev",
+                "iterations"
+            );
+            break;
+    }
+}
+
+static void
+anv_bench__print_result(
+    FILE *out_file,
+    const anv_bench_config *config,
+    const char *name,
+    const anv_bench_result *result,
+    const char *error,
+    int is_first
+)
+{
+    switch (config->format) {
+        case ANV_BENCH_FORMAT_CSV:
+            if (error) {
+                fprintf(out_file, "%s,,,,,,,,,,,\"%s\"\n", name, error);
+                return;
+            }
+            fprintf(
+                out_file,
+                "%s,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,\n",
+                name,
+                (unsigned long)result->iterations,
+                (unsigned long)result->samples,
+                result->min_ns,
+                result->median_ns,
+                result->mean_ns,
+                result->p99_ns,
+                result->max_ns,
+                result->stddev_ns,
+                result->items_per_s,
+                result->bytes_per_s
+            );
+            return;
+        case ANV_BENCH_FORMAT_JSON:
+            fprintf(
+                out_file,
+                "%s\n    {\"name\": \"%s\", ",
+                is_first ? "" : ",",
+                name
+            );
+            if (error) {
+                fprintf(out_file, "\"error\": \"%s\"}", error);
+                return;
+            }
+            fprintf(
+                out_file,
+                "\"iterations\": %lu, \"samples\": %lu, \"min_ns\": %.3f, "
+                "\"median_ns\": %.3f, \"mean_ns\": %.3f, \"p99_ns\": %.3f, "
+                "\"max_ns\": %.3f, \"stddev_ns\": %.3f, \"items_per_s\": %.3f, "
+                "\"bytes_per_s\": %.3f}",
+                (unsigned long)result->iterations,
+                (unsigned long)result->samples,
+                result->min_ns,
+                result->median_ns,
+                result->mean_ns,
+                result->p99_ns,
+                result->max_ns,
+                result->stddev_ns,
+                result->items_per_s,
+                result->bytes_per_s
+            );
+            return;
+        default:
+            fprintf(out_file, "%-*s", ANV_BENCH_PADDING, name);
+            if (error) {
+                fprintf(out_file, " ERROR: %s\n", error);
+                return;
+            }
+            fprintf(
+                out_file,
+                " %9.1fns %9.1fns %9.1fns %8.1f%% %11lu",
+                result->min_ns,
+                result->median_ns,
+                result->p99_ns,
+                result->mean_ns > 0
+                    ? result->stddev_ns * 100 / result->mean_ns
+                    : 0,
+                (unsigned long)result->iterations
+            );
+            if (result->items_per_s > 0) {
+                anv_bench__print_rate(out_file, result->items_per_s, "items/s");
+            }
+            if (result->bytes_per_s > 0) {
+                anv_bench__print_rate(out_file, result->bytes_per_s, "B/s");
+            }
+            fprintf(out_file, "\n");
+            return;
+    }
+}
+
+static int
+anv_bench__run(
+    const char *suitename,
+    const anv_bench_case *suite,
+    size_t suite_sz,
+    FILE *out_file,
+    const anv_bench_config *config
+)
+{
+    static const anv_bench_config default_config = { 0 };
+    static double samples_buff[ANV_BENCH_MAX_SAMPLES];
+    if (!config) {
+        config = &default_config;
+    }
+
+    if (config->format == ANV_BENCH_FORMAT_TEXT) {
+        fprintf(
+            out_file,
+            "Benchmarks: %s (clock: %s)\n",
+            suitename,
+            anv_bench_clock_name()
+        );
+    }
+    anv_bench__print_header(out_file, config);
+
+    int total_errors = 0;
+    int printed = 0;
+    for (size_t i = 0; i < suite_sz; ++i) {
+        if (config->filter && !strstr(suite[i].name, config->filter)) {
+            continue;
+        }
+        anv_bench_result result;
+        const char *error = NULL;
+        memset(&result, 0, sizeof(result));
+        if (anv_bench__measure(&suite[i], config, samples_buff, &result, &error)
+            != 0) {
+            ++total_errors;
+        }
+        anv_bench__print_result(
+            out_file, config, suite[i].name, &result, error, printed == 0
+        );
+        ++printed;
+        fflush(out_file);
+    }
+
+    if (config->format == ANV_BENCH_FORMAT_JSON) {
+        fprintf(out_file, "\n  ]\n}\n");
+    }
+    return total_errors;
+}
+
+/**
+ * Fill config from command line arguments, unknown ones are ignored:
+ * --csv, --json, --filter=substring, --samples=N, --sample-time=seconds and
+ * --warmup=seconds.
+ */
+static inline void
+anv_bench_config_from_args(anv_bench_config *config, int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--csv") == 0) {
+            config->format = ANV_BENCH_FORMAT_CSV;
+        } else if (strcmp(arg, "--json") == 0) {
+            config->format = ANV_BENCH_FORMAT_JSON;
+        } else if (strncmp(arg, "--filter=", 9) == 0) {
+            config->filter = arg + 9;
+        } else if (strncmp(arg, "--samples=", 10) == 0) {
+            config->samples = (size_t)strtoul(arg + 10, NULL, 10);
+        } else if (strncmp(arg, "--sample-time=", 14) == 0) {
+            config->sample_time_s = strtod(arg + 14, NULL);
+        } else if (strncmp(arg, "--warmup=", 9) == 0) {
+            config->warmup_time_s = strtod(arg + 9, NULL);
+        }
+    }
+}
+
+/**
+ * Run all registered benchmarks of this suite and print results to file.
+ * @param config Optional run config, NULL for defaults.
+ * @return Number of benchmarks which failed or were skipped.
+ */
+#define ANV_BENCH_RUN(suitename, out_file, config)                             \
+    anv_bench__run(                                                            \
+        #suitename, suitename, ANV_BENCH__LEN(suitename), out_file, config     \
+    )
+
+/**
+ * Same as ANV_BENCH_RUN for an array of cases built at runtime, e.g. to run a
+ * benchmark over a matrix of params with ANV_BENCH_REGISTER_ARG.
+ * @param name Display name of the suite.
+ * @param cases Array of cases_count cases.
+ */
+#define ANV_BENCH_RUN_CASES(name, cases, cases_count, out_file, config)        \
+    anv_bench__run(name, cases, cases_count, out_file, config)
+
+#endif /* ANV_BENCH_2_H */
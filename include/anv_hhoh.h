@@ -23,11 +23,12 @@
  */
 
 /*------------------------------------------------------------------------------
-    anv_hhoh (windows only)
+    anv_hhoh
 --------------------------------------------------------------------------------
 
   open, close and interchange between C file descriptors, windows's HANDLEs and
-  C FILEs.
+  C FILEs. Read files through any of them with positioned reads, batches of
+  overlapped reads and read only mapped views.
 
   Handy Handler Of Handles (aka hhoh) has 2 main purposes:
     1. hide boilerplate code
@@ -71,24 +72,110 @@
         anv_hhoh_close_auto(&file_handle); // error checking (?)
     }
 
+  reads example:
+
+    ANV_HANDLE hd;
+    if (!anv_hhoh_open_read(
+            &hd,
+            ANV_HHOH_TEXT("data.bin"),
+            ANV_HHOH_OPEN_UNBUFFERED | ANV_HHOH_OPEN_OVERLAPPED
+        )) {
+        // could not open the file
+    }
+
+    // unbuffered reads want sector aligned buffers, sizes and offsets.
+    anv_hhoh_read_req reqs[8] = { 0 };
+    for (int i = 0; i < 8; ++i) {
+        reqs[i].buff = anv_hhoh_alloc_aligned(65536);
+        reqs[i].sz = 65536;
+        reqs[i].offset = (uint64_t)i * 65536;
+    }
+
+    // at most 4 reads in flight, each reqs[i].read_sz is filled.
+    if (!anv_hhoh_read_batch(&hd, reqs, 8, 4)) {
+        // some request failed, check reqs[i].success
+    }
+
+    // zero-copy access to bytes [100, 1100).
+    anv_hhoh_view view;
+    if (anv_hhoh_map_view(&hd, 100, 1000, &view)) {
+        const unsigned char *bytes = view.data;
+        // ...
+        anv_hhoh_unmap_view(&view);
+    }
+
+    anv_hhoh_close_auto(&hd);
+
+  the reads api is available everywhere. On POSIX systems only C file
+  descriptors and C FILEs are supported and the win32 types used by the
+  interface (ANV_HHOH_BOOL, ANV_HHOH_TCHAR, ANV_HHOH_TEXT) are plain C types,
+  on Windows they are BOOL, TCHAR and TEXT. fileno and fdopen are POSIX: with
+  strict ISO modes (e.g. -std=c99) define _POSIX_C_SOURCE before including any
+  system header.
+    - ANV_HHOH_OPEN_UNBUFFERED uses O_DIRECT (or F_NOCACHE) when the system
+      headers expose it and the filesystem supports it, otherwise it is
+      ignored.
+    - anv_hhoh_read_at uses pread when exposed (_POSIX_C_SOURCE >= 200809L
+      or _XOPEN_SOURCE >= 500), lseek and read otherwise.
+    - anv_hhoh_read_batch serves requests one after another on the calling
+      thread by default, queue_depth is ignored. Define
+      ANV_HHOH_ENABLE_THREADS before the implementation to spread them over
+      up to queue_depth threads with pread instead (link with -pthread,
+      without pread batches stay serial).
+    - views are mmap-ed.
+
+  anv_hhoh_read_batch on windows associates the handle with an io completion
+  port, closed together with the handle. Handles must come from the open
+  functions (or be zero initialized) and must not be used for batches from
+  more threads at once.
+
 ------------------------------------------------------------------------------*/
 
 #ifndef ANV_HHOH_H
 #define ANV_HHOH_H
 
-#ifndef _WIN32
-#error Only available on Windows!
+#if defined(_WIN32)
+#define ANV_HHOH__HAS_WIN32
+#elif defined(__unix__) || defined(__APPLE__)
+#define ANV_HHOH__HAS_POSIX
+#else
+#error Only available on Windows and POSIX systems!
 #endif
 
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
+
+/*
+ * Win32 types used by the interface, plain C types elsewhere so that they do
+ * not clash with other definitions of BOOL and the like (e.g. objc on Apple).
+ */
+#ifdef ANV_HHOH__HAS_WIN32
 #include <windows.h>
+typedef BOOL ANV_HHOH_BOOL;
+typedef TCHAR ANV_HHOH_TCHAR;
+#define ANV_HHOH_TRUE    TRUE
+#define ANV_HHOH_FALSE   FALSE
+#define ANV_HHOH_TEXT(x) TEXT(x)
+#else
+typedef int ANV_HHOH_BOOL;
+typedef char ANV_HHOH_TCHAR;
+#define ANV_HHOH_TRUE    1
+#define ANV_HHOH_FALSE   0
+#define ANV_HHOH_TEXT(x) x
+#endif
 
 #ifndef ANV_HHOH_EXP
 #define ANV_HHOH_EXP extern
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define ANV_HHOH__EXTENSION __extension__
+#else
+#define ANV_HHOH__EXTENSION
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -98,42 +185,117 @@ extern "C" {
 #define ANV_HHOH_HANDLE_WIN32   2
 #define ANV_HHOH_HANDLE_FILE    3
 
+// anv_hhoh_open_read flags.
+#define ANV_HHOH_OPEN_UNBUFFERED 0x01
+#define ANV_HHOH_OPEN_OVERLAPPED 0x02
+
+// Alignment of anv_hhoh_alloc_aligned buffers. Unbuffered reads want buffers,
+// sizes and offsets multiple of the volume sector size.
+#ifndef ANV_HHOH_SECTOR_SIZE
+#define ANV_HHOH_SECTOR_SIZE 4096
+#endif
+
 typedef struct ANV_HANDLE {
-    union {
+    ANV_HHOH__EXTENSION union {
         int fd;
+#ifdef ANV_HHOH__HAS_WIN32
         HANDLE handle;
+#endif
         FILE *file;
     };
     int current;
+    int flags;
+#ifdef ANV_HHOH__HAS_WIN32
+    HANDLE iocp;
+#endif
 } ANV_HANDLE;
 
+typedef struct anv_hhoh_read_req {
+    void *buff;
+    size_t sz;
+    uint64_t offset;
+    // filled once the request is done, reads past the end of file succeed
+    // with less bytes.
+    size_t read_sz;
+    ANV_HHOH_BOOL success;
+#ifdef ANV_HHOH__HAS_WIN32
+    OVERLAPPED overlapped;
+#endif
+} anv_hhoh_read_req;
+
+typedef struct anv_hhoh_view {
+    const void *data;
+    size_t sz;
+    // whole mapping, starts at an allocation granularity boundary.
+    void *base;
+    size_t base_sz;
+} anv_hhoh_view;
+
 /*------------------------------------------------------------------------------
     open - close
 ------------------------------------------------------------------------------*/
 
-ANV_HHOH_EXP BOOL
-anv_hhoh_open_cfd(ANV_HANDLE *hd, const TCHAR *filename, int mode);
-ANV_HHOH_EXP BOOL anv_hhoh_open_win32(
-    ANV_HANDLE *hd, const TCHAR *filename, DWORD mode, BOOL shared
+ANV_HHOH_EXP ANV_HHOH_BOOL
+anv_hhoh_open_cfd(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, int mode);
+#ifdef ANV_HHOH__HAS_WIN32
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_open_win32(
+    ANV_HANDLE *hd,
+    const ANV_HHOH_TCHAR *filename,
+    DWORD mode,
+    ANV_HHOH_BOOL shared
 );
-ANV_HHOH_EXP BOOL
-anv_hhoh_open_file(ANV_HANDLE *hd, const TCHAR *filename, const TCHAR *mode);
+#endif
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_open_file(
+    ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, const ANV_HHOH_TCHAR *mode
+);
+ANV_HHOH_EXP ANV_HHOH_BOOL
+anv_hhoh_open_read(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, int flags);
 
-ANV_HHOH_EXP BOOL anv_hhoh_close_cfd(ANV_HANDLE *hd);
-ANV_HHOH_EXP BOOL anv_hhoh_close_win32(ANV_HANDLE *hd);
-ANV_HHOH_EXP BOOL anv_hhoh_close_file(ANV_HANDLE *hd);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_close_cfd(ANV_HANDLE *hd);
+#ifdef ANV_HHOH__HAS_WIN32
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_close_win32(ANV_HANDLE *hd);
+#endif
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_close_file(ANV_HANDLE *hd);
 
-ANV_HHOH_EXP BOOL anv_hhoh_close_auto(ANV_HANDLE *hd);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_close_auto(ANV_HANDLE *hd);
 
 /*------------------------------------------------------------------------------
     conversions
 ------------------------------------------------------------------------------*/
 
-ANV_HHOH_EXP BOOL anv_hhoh_file_to_cfd(ANV_HANDLE *hd);
-ANV_HHOH_EXP BOOL anv_hhoh_cfd_to_file(ANV_HANDLE *hd, const TCHAR *mode);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_file_to_cfd(ANV_HANDLE *hd);
+ANV_HHOH_EXP ANV_HHOH_BOOL
+anv_hhoh_cfd_to_file(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *mode);
+
+#ifdef ANV_HHOH__HAS_WIN32
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_win32_to_cfd(ANV_HANDLE *hd, int flags);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_cfd_to_win32(ANV_HANDLE *hd);
+#endif
+
+/*------------------------------------------------------------------------------
+    reads
+------------------------------------------------------------------------------*/
+
+ANV_HHOH_EXP void *anv_hhoh_alloc_aligned(size_t sz);
+ANV_HHOH_EXP void anv_hhoh_free_aligned(void *mem);
+
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_get_size(ANV_HANDLE *hd, uint64_t *out_sz);
 
-ANV_HHOH_EXP BOOL anv_hhoh_win32_to_cfd(ANV_HANDLE *hd, int flags);
-ANV_HHOH_EXP BOOL anv_hhoh_cfd_to_win32(ANV_HANDLE *hd);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_read_at(
+    ANV_HANDLE *hd, void *buff, size_t sz, uint64_t offset, size_t *out_read
+);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_read_batch(
+    ANV_HANDLE *hd, anv_hhoh_read_req *reqs, size_t count, size_t queue_depth
+);
+
+/*------------------------------------------------------------------------------
+    mapped views
+------------------------------------------------------------------------------*/
+
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_map_view(
+    ANV_HANDLE *hd, uint64_t offset, size_t sz, anv_hhoh_view *out_view
+);
+ANV_HHOH_EXP ANV_HHOH_BOOL anv_hhoh_unmap_view(anv_hhoh_view *view);
 
 #ifdef __cplusplus
 }
@@ -141,41 +303,96 @@ ANV_HHOH_EXP BOOL anv_hhoh_cfd_to_win32(ANV_HANDLE *hd);
 
 #ifdef ANV_HHOH_IMPLEMENTATION
 
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ANV_HHOH__HAS_WIN32
 #include <fcntl.h>
 #include <io.h>
+#include <stddef.h>
 #include <sys/stat.h>
 #include <tchar.h>
+#else
+#include <errno.h>
+#include <fcntl.h> /* for open() */
+#include <sys/mman.h> /* for mmap(), munmap() */
+#include <sys/stat.h> /* for fstat() */
+#include <unistd.h> /* for read(), lseek(), close() */
+
+#if _XOPEN_VERSION >= 500 || _POSIX_VERSION >= 200809L
+#define ANV_HHOH__HAS_PREAD
+#endif
+
+// positioned reads do not share a file offset, threads can run a batch.
+#if defined(ANV_HHOH_ENABLE_THREADS) && defined(ANV_HHOH__HAS_PREAD)
+#include <pthread.h>
+#define ANV_HHOH__HAS_THREADS
+#define ANV_HHOH__MAX_WORKERS 64
+#endif
+#endif
 
 #ifndef anv_hhoh__assert
 #include <assert.h>
 #define anv_hhoh__assert(x) assert(x)
 #endif
 
+static void
+anv_hhoh__reset(ANV_HANDLE *hd)
+{
+    hd->flags = 0;
+#ifdef ANV_HHOH__HAS_WIN32
+    hd->iocp = NULL;
+#endif
+}
+
+static void
+anv_hhoh__release(ANV_HANDLE *hd)
+{
+    hd->current = ANV_HHOH_HANDLE_INVALID;
+#ifdef ANV_HHOH__HAS_WIN32
+    if (hd->iocp) {
+        CloseHandle(hd->iocp);
+        hd->iocp = NULL;
+    }
+#endif
+}
+
 /*------------------------------------------------------------------------------
     open functions
 ------------------------------------------------------------------------------*/
 
 // _O_CREAT, _O_TEXT, ...
-BOOL
-anv_hhoh_open_cfd(ANV_HANDLE *hd, const TCHAR *filename, int mode)
+ANV_HHOH_BOOL
+anv_hhoh_open_cfd(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, int mode)
 {
+    anv_hhoh__reset(hd);
+#ifdef ANV_HHOH__HAS_WIN32
     // https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/sopen-s-wsopen-s
     errno_t err
         = _tsopen_s(&hd->fd, filename, mode, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#else
+    hd->fd = open(filename, mode, 0666);
+    int err = hd->fd < 0;
+#endif
     if (err != 0) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->current = ANV_HHOH_HANDLE_C_FD;
-    return TRUE;
+    return ANV_HHOH_TRUE;
 }
 
+#ifdef ANV_HHOH__HAS_WIN32
 // CREATE_NEW, OPEN_EXISTING, ...
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_open_win32(
-    ANV_HANDLE *hd, const TCHAR *filename, DWORD mode, BOOL shared
+    ANV_HANDLE *hd,
+    const ANV_HHOH_TCHAR *filename,
+    DWORD mode,
+    ANV_HHOH_BOOL shared
 )
 {
+    anv_hhoh__reset(hd);
     // https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-createfilea
     HANDLE hfile = CreateFile(
         filename,
@@ -188,69 +405,143 @@ anv_hhoh_open_win32(
     );
     if (hfile == INVALID_HANDLE_VALUE) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->handle = hfile;
     hd->current = ANV_HHOH_HANDLE_WIN32;
-    return TRUE;
+    return ANV_HHOH_TRUE;
 }
+#endif
 
 // "r", "w", ...
-BOOL
-anv_hhoh_open_file(ANV_HANDLE *hd, const TCHAR *filename, const TCHAR *mode)
+ANV_HHOH_BOOL
+anv_hhoh_open_file(
+    ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, const ANV_HHOH_TCHAR *mode
+)
 {
+    anv_hhoh__reset(hd);
+#ifdef ANV_HHOH__HAS_WIN32
     // https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/fopen-wfopen?f1url=https%3A%2F%2Fmsdn.microsoft.com%2Fquery%2Fdev15.query%3FappId%3DDev15IDEF1%26l%3DEN-US%26k%3Dk(TCHAR%2F_tfopen)%3Bk(_tfopen)%3Bk(DevLang-C%2B%2B)%3Bk(TargetOS-Windows)%26rd%3Dtrue%26f%3D255%26MSPPError%3D-2147217396
     FILE *file = _tfopen(filename, mode);
+#else
+    FILE *file = fopen(filename, mode);
+#endif
     if (!file) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->file = file;
     hd->current = ANV_HHOH_HANDLE_FILE;
-    return TRUE;
+    return ANV_HHOH_TRUE;
+}
+
+// ANV_HHOH_OPEN_UNBUFFERED, ANV_HHOH_OPEN_OVERLAPPED
+ANV_HHOH_BOOL
+anv_hhoh_open_read(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *filename, int flags)
+{
+    anv_hhoh__reset(hd);
+#ifdef ANV_HHOH__HAS_WIN32
+    // https://learn.microsoft.com/en-us/windows/win32/fileio/file-buffering
+    DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+    if (flags & ANV_HHOH_OPEN_UNBUFFERED) {
+        attributes |= FILE_FLAG_NO_BUFFERING;
+    }
+    if (flags & ANV_HHOH_OPEN_OVERLAPPED) {
+        attributes |= FILE_FLAG_OVERLAPPED;
+    }
+    HANDLE hfile = CreateFile(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        attributes,
+        NULL
+    );
+    if (hfile == INVALID_HANDLE_VALUE) {
+        hd->current = ANV_HHOH_HANDLE_INVALID;
+        return ANV_HHOH_FALSE;
+    }
+    hd->handle = hfile;
+    hd->current = ANV_HHOH_HANDLE_WIN32;
+#else
+    int oflags = O_RDONLY;
+#ifdef O_DIRECT
+    if (flags & ANV_HHOH_OPEN_UNBUFFERED) {
+        oflags |= O_DIRECT;
+    }
+#endif
+    hd->fd = open(filename, oflags);
+#ifdef O_DIRECT
+    // not every filesystem supports direct I/O.
+    if (hd->fd < 0 && errno == EINVAL && (oflags & O_DIRECT)) {
+        hd->fd = open(filename, O_RDONLY);
+    }
+#endif
+    if (hd->fd < 0) {
+        hd->current = ANV_HHOH_HANDLE_INVALID;
+        return ANV_HHOH_FALSE;
+    }
+#ifdef F_NOCACHE
+    if (flags & ANV_HHOH_OPEN_UNBUFFERED) {
+        fcntl(hd->fd, F_NOCACHE, 1);
+    }
+#endif
+    hd->current = ANV_HHOH_HANDLE_C_FD;
+#endif
+    hd->flags = flags;
+    return ANV_HHOH_TRUE;
 }
 
 /*------------------------------------------------------------------------------
     close Functions
 ------------------------------------------------------------------------------*/
 
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_close_cfd(ANV_HANDLE *hd)
 {
     anv_hhoh__assert(hd->current == ANV_HHOH_HANDLE_C_FD);
-    hd->current = ANV_HHOH_HANDLE_INVALID;
+    anv_hhoh__release(hd);
+#ifdef ANV_HHOH__HAS_WIN32
     return _close(hd->fd) == 0;
+#else
+    return close(hd->fd) == 0;
+#endif
 }
 
-BOOL
+#ifdef ANV_HHOH__HAS_WIN32
+ANV_HHOH_BOOL
 anv_hhoh_close_win32(ANV_HANDLE *hd)
 {
     anv_hhoh__assert(hd->current == ANV_HHOH_HANDLE_WIN32);
-    hd->current = ANV_HHOH_HANDLE_INVALID;
+    anv_hhoh__release(hd);
     return CloseHandle(hd->handle);
 }
+#endif
 
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_close_file(ANV_HANDLE *hd)
 {
     anv_hhoh__assert(hd->current == ANV_HHOH_HANDLE_FILE);
-    hd->current = ANV_HHOH_HANDLE_INVALID;
+    anv_hhoh__release(hd);
     return fclose(hd->file) == 0;
 }
 
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_close_auto(ANV_HANDLE *hd)
 {
     switch (hd->current) {
         case ANV_HHOH_HANDLE_C_FD:
             return anv_hhoh_close_cfd(hd);
+#ifdef ANV_HHOH__HAS_WIN32
         case ANV_HHOH_HANDLE_WIN32:
             return anv_hhoh_close_win32(hd);
+#endif
         case ANV_HHOH_HANDLE_FILE:
             return anv_hhoh_close_file(hd);
         default:
             anv_hhoh__assert(0);
-            return FALSE;
+            return ANV_HHOH_FALSE;
     }
 }
 
@@ -258,56 +549,584 @@ anv_hhoh_close_auto(ANV_HANDLE *hd)
     conversions
 ------------------------------------------------------------------------------*/
 
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_file_to_cfd(ANV_HANDLE *hd)
 {
+#ifdef ANV_HHOH__HAS_WIN32
     hd->fd = _fileno(hd->file);
+#else
+    hd->fd = fileno(hd->file);
+#endif
     if (hd->fd == -1) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->current = ANV_HHOH_HANDLE_C_FD;
-    return TRUE;
+    return ANV_HHOH_TRUE;
 }
 
 // "r", "w", ...
-BOOL
-anv_hhoh_cfd_to_file(ANV_HANDLE *hd, const TCHAR *mode)
+ANV_HHOH_BOOL
+anv_hhoh_cfd_to_file(ANV_HANDLE *hd, const ANV_HHOH_TCHAR *mode)
 {
+#ifdef ANV_HHOH__HAS_WIN32
     // https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/fdopen-wfdopen?f1url=https%3A%2F%2Fmsdn.microsoft.com%2Fquery%2Fdev15.query%3FappId%3DDev15IDEF1%26l%3DEN-US%26k%3Dk(TCHAR%2F_tfdopen)%3Bk(_tfdopen)%3Bk(DevLang-C%2B%2B)%3Bk(TargetOS-Windows)%26rd%3Dtrue%26f%3D255%26MSPPError%3D-2147217396
     hd->file = _tfdopen(hd->fd, mode);
+#else
+    hd->file = fdopen(hd->fd, mode);
+#endif
     if (!hd->file) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->current = ANV_HHOH_HANDLE_FILE;
-    return TRUE;
+    return ANV_HHOH_TRUE;
 }
 
+#ifdef ANV_HHOH__HAS_WIN32
 // _O_APPEND, _O_RDONLY, _O_TEXT, _O_WTEXT
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_win32_to_cfd(ANV_HANDLE *hd, int flags)
 {
     // https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/open-osfhandle?f1url=https%3A%2F%2Fmsdn.microsoft.com%2Fquery%2Fdev15.query%3FappId%3DDev15IDEF1%26l%3DEN-US%26k%3Dk(CORECRT_IO%2F_open_osfhandle)%3Bk(_open_osfhandle)%3Bk(DevLang-C%2B%2B)%3Bk(TargetOS-Windows)%26rd%3Dtrue
     hd->fd = _open_osfhandle((intptr_t)hd->handle, flags);
     if (hd->fd == -1) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->current = ANV_HHOH_HANDLE_C_FD;
-    return TRUE;
+    return ANV_HHOH_TRUE;
 }
 
-BOOL
+ANV_HHOH_BOOL
 anv_hhoh_cfd_to_win32(ANV_HANDLE *hd)
 {
     hd->handle = (HANDLE)_get_osfhandle(hd->fd);
     if (hd->handle == INVALID_HANDLE_VALUE) {
         hd->current = ANV_HHOH_HANDLE_INVALID;
-        return FALSE;
+        return ANV_HHOH_FALSE;
     }
     hd->current = ANV_HHOH_HANDLE_WIN32;
-    return TRUE;
+    return ANV_HHOH_TRUE;
+}
+#endif
+
+/*------------------------------------------------------------------------------
+    reads
+------------------------------------------------------------------------------*/
+
+/*
+ * Underlying OS handle, C FILEs buffers are bypassed.
+ */
+#ifdef ANV_HHOH__HAS_WIN32
+static HANDLE
+anv_hhoh__os_handle(const ANV_HANDLE *hd)
+{
+    switch (hd->current) {
+        case ANV_HHOH_HANDLE_C_FD:
+            return (HANDLE)_get_osfhandle(hd->fd);
+        case ANV_HHOH_HANDLE_WIN32:
+            return hd->handle;
+        case ANV_HHOH_HANDLE_FILE:
+            return (HANDLE)_get_osfhandle(_fileno(hd->file));
+        default:
+            anv_hhoh__assert(0);
+            return INVALID_HANDLE_VALUE;
+    }
+}
+#else
+static int
+anv_hhoh__os_fd(const ANV_HANDLE *hd)
+{
+    switch (hd->current) {
+        case ANV_HHOH_HANDLE_C_FD:
+            return hd->fd;
+        case ANV_HHOH_HANDLE_FILE:
+            return fileno(hd->file);
+        default:
+            anv_hhoh__assert(0);
+            return -1;
+    }
+}
+
+static ANV_HHOH_BOOL
+anv_hhoh__fits_off(uint64_t value)
+{
+    return (off_t)value >= 0 && (uint64_t)(off_t)value == value;
+}
+#endif
+
+void *
+anv_hhoh_alloc_aligned(size_t sz)
+{
+    size_t extra = ANV_HHOH_SECTOR_SIZE + sizeof(void *);
+    if (sz > (size_t)-1 - extra) {
+        return NULL;
+    }
+    unsigned char *raw = malloc(sz + extra);
+    if (!raw) {
+        return NULL;
+    }
+    // the original pointer is stored right before the aligned block.
+    uintptr_t addr = (uintptr_t)(raw + sizeof(void *));
+    unsigned char *mem = raw + sizeof(void *)
+                       + (ANV_HHOH_SECTOR_SIZE - addr % ANV_HHOH_SECTOR_SIZE)
+                             % ANV_HHOH_SECTOR_SIZE;
+    memcpy(mem - sizeof(void *), &raw, sizeof(void *));
+    return mem;
+}
+
+void
+anv_hhoh_free_aligned(void *mem)
+{
+    if (!mem) {
+        return;
+    }
+    void *raw;
+    memcpy(&raw, (unsigned char *)mem - sizeof(void *), sizeof(void *));
+    free(raw);
+}
+
+ANV_HHOH_BOOL
+anv_hhoh_get_size(ANV_HANDLE *hd, uint64_t *out_sz)
+{
+#ifdef ANV_HHOH__HAS_WIN32
+    LARGE_INTEGER file_sz;
+    if (!GetFileSizeEx(anv_hhoh__os_handle(hd), &file_sz)
+        || file_sz.QuadPart < 0) {
+        return ANV_HHOH_FALSE;
+    }
+    *out_sz = (uint64_t)file_sz.QuadPart;
+#else
+    struct stat st;
+    if (fstat(anv_hhoh__os_fd(hd), &st) != 0 || st.st_size < 0) {
+        return ANV_HHOH_FALSE;
+    }
+    *out_sz = (uint64_t)st.st_size;
+#endif
+    return ANV_HHOH_TRUE;
+}
+
+#ifdef ANV_HHOH__HAS_WIN32
+// ReadFile takes DWORD sizes, keeps chunks sector aligned.
+#define ANV_HHOH__MAX_CHUNK 0x40000000u
+
+static ANV_HHOH_BOOL
+anv_hhoh__read_chunk(
+    const ANV_HANDLE *hd,
+    HANDLE handle,
+    void *buff,
+    DWORD sz,
+    uint64_t offset,
+    DWORD *out_read
+)
+{
+    // https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-readfile
+    OVERLAPPED ov;
+    ZeroMemory(&ov, sizeof(ov));
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    *out_read = 0;
+    if (!(hd->flags & ANV_HHOH_OPEN_OVERLAPPED)) {
+        if (!ReadFile(handle, buff, sz, out_read, &ov)) {
+            return GetLastError() == ERROR_HANDLE_EOF;
+        }
+        return ANV_HHOH_TRUE;
+    }
+    HANDLE event = CreateEvent(NULL, ANV_HHOH_TRUE, ANV_HHOH_FALSE, NULL);
+    if (!event) {
+        return ANV_HHOH_FALSE;
+    }
+    // the low bit keeps the completion off the handle completion port.
+    ov.hEvent = (HANDLE)((uintptr_t)event | 1);
+    ANV_HHOH_BOOL ok = ReadFile(handle, buff, sz, NULL, &ov);
+    if (ok || GetLastError() == ERROR_IO_PENDING) {
+        ok = GetOverlappedResult(handle, &ov, out_read, ANV_HHOH_TRUE);
+    }
+    if (!ok && GetLastError() == ERROR_HANDLE_EOF) {
+        ok = ANV_HHOH_TRUE;
+    }
+    CloseHandle(event);
+    return ok;
+}
+#endif
+
+/*
+ * Read up to sz bytes at offset. The file position is left untouched when
+ * pread is available and for ANV_HHOH_OPEN_OVERLAPPED handles on windows:
+ * synchronous windows handles end up positioned after the last byte read,
+ * ReadFile moves them even when given an offset. Elsewhere the position is
+ * moved too (lseek). Stops early at the end of file only.
+ */
+ANV_HHOH_BOOL
+anv_hhoh_read_at(
+    ANV_HANDLE *hd, void *buff, size_t sz, uint64_t offset, size_t *out_read
+)
+{
+    anv_hhoh__assert(hd);
+    anv_hhoh__assert(buff || sz == 0);
+    anv_hhoh__assert(out_read);
+    *out_read = 0;
+    if (offset + sz < offset) {
+        return ANV_HHOH_FALSE;
+    }
+    size_t total = 0;
+#ifdef ANV_HHOH__HAS_WIN32
+    HANDLE handle = anv_hhoh__os_handle(hd);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return ANV_HHOH_FALSE;
+    }
+    while (total < sz) {
+        size_t left = sz - total;
+        DWORD chunk = left > ANV_HHOH__MAX_CHUNK ? ANV_HHOH__MAX_CHUNK
+                                                 : (DWORD)left;
+        DWORD read_sz;
+        if (!anv_hhoh__read_chunk(
+                hd,
+                handle,
+                (unsigned char *)buff + total,
+                chunk,
+                offset + total,
+                &read_sz
+            )) {
+            return ANV_HHOH_FALSE;
+        }
+        total += read_sz;
+        if (read_sz < chunk) {
+            break;
+        }
+    }
+#else
+    int fd = anv_hhoh__os_fd(hd);
+    if (fd < 0 || !anv_hhoh__fits_off(offset + sz)) {
+        return ANV_HHOH_FALSE;
+    }
+#ifndef ANV_HHOH__HAS_PREAD
+    if (lseek(fd, (off_t)offset, SEEK_SET) < 0) {
+        return ANV_HHOH_FALSE;
+    }
+#endif
+    while (total < sz) {
+#ifdef ANV_HHOH__HAS_PREAD
+        ssize_t res = pread(
+            fd, (unsigned char *)buff + total, sz - total,
+            (off_t)(offset + total)
+        );
+#else
+        ssize_t res = read(fd, (unsigned char *)buff + total, sz - total);
+#endif
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ANV_HHOH_FALSE;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += (size_t)res;
+    }
+#endif
+    *out_read = total;
+    return ANV_HHOH_TRUE;
+}
+
+#ifdef ANV_HHOH__HAS_WIN32
+/*
+ * Cancel the first count requests still in flight and wait for all of them,
+ * so that no read touches the caller's buffers or overlapped structs once the
+ * batch returns.
+ */
+static void
+anv_hhoh__cancel_batch(
+    ANV_HANDLE *hd,
+    HANDLE handle,
+    anv_hhoh_read_req *reqs,
+    size_t count,
+    size_t in_flight
+)
+{
+    CancelIo(handle);
+    // consume the completion packets, later batches would find them.
+    while (in_flight > 0) {
+        DWORD transferred;
+        ULONG_PTR key;
+        LPOVERLAPPED ov = NULL;
+        GetQueuedCompletionStatus(hd->iocp, &transferred, &key, &ov, INFINITE);
+        if (!ov) {
+            break;
+        }
+        --in_flight;
+    }
+    if (in_flight == 0) {
+        return;
+    }
+    // the port is unusable: wait on each request instead.
+    for (size_t i = 0; i < count; ++i) {
+        if (!HasOverlappedIoCompleted(&reqs[i].overlapped)) {
+            DWORD transferred;
+            GetOverlappedResult(
+                handle, &reqs[i].overlapped, &transferred, ANV_HHOH_TRUE
+            );
+        }
+    }
+}
+#endif
+
+#ifdef ANV_HHOH__HAS_THREADS
+typedef struct anv_hhoh__batch {
+    pthread_mutex_t lock;
+    ANV_HANDLE *hd;
+    anv_hhoh_read_req *reqs;
+    size_t count;
+    size_t next;
+} anv_hhoh__batch;
+
+static void *
+anv_hhoh__batch_worker(void *arg)
+{
+    anv_hhoh__batch *batch = (anv_hhoh__batch *)arg;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->count) {
+            return NULL;
+        }
+        anv_hhoh_read_req *req = &batch->reqs[i];
+        req->success = anv_hhoh_read_at(
+            batch->hd, req->buff, req->sz, req->offset, &req->read_sz
+        );
+    }
+}
+
+/*
+ * Serve the requests from queue_depth threads, the calling one included.
+ */
+static void
+anv_hhoh__read_batch_threads(
+    ANV_HANDLE *hd, anv_hhoh_read_req *reqs, size_t count, size_t queue_depth
+)
+{
+    anv_hhoh__batch batch;
+    batch.hd = hd;
+    batch.reqs = reqs;
+    batch.count = count;
+    batch.next = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+    size_t workers = queue_depth < count ? queue_depth : count;
+    if (workers > ANV_HHOH__MAX_WORKERS) {
+        workers = ANV_HHOH__MAX_WORKERS;
+    }
+    pthread_t threads[ANV_HHOH__MAX_WORKERS];
+    size_t started = 0;
+    // fewer threads still serve the whole batch.
+    while (started + 1 < workers
+           && pthread_create(
+                  &threads[started], NULL, anv_hhoh__batch_worker, &batch
+              ) == 0) {
+        ++started;
+    }
+    anv_hhoh__batch_worker(&batch);
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&batch.lock);
+}
+#endif
+
+/*
+ * Run every request keeping up to queue_depth of them in flight. Returns
+ * ANV_HHOH_TRUE when all succeeded.
+ */
+ANV_HHOH_BOOL
+anv_hhoh_read_batch(
+    ANV_HANDLE *hd, anv_hhoh_read_req *reqs, size_t count, size_t queue_depth
+)
+{
+    anv_hhoh__assert(hd);
+    anv_hhoh__assert(reqs || count == 0);
+    anv_hhoh__assert(queue_depth > 0);
+    ANV_HHOH_BOOL all_ok = ANV_HHOH_TRUE;
+#ifdef ANV_HHOH__HAS_WIN32
+    if ((hd->flags & ANV_HHOH_OPEN_OVERLAPPED) && queue_depth > 1) {
+        HANDLE handle = anv_hhoh__os_handle(hd);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return ANV_HHOH_FALSE;
+        }
+        // https://learn.microsoft.com/en-us/windows/win32/fileio/i-o-completion-ports
+        if (!hd->iocp) {
+            hd->iocp = CreateIoCompletionPort(handle, NULL, 0, 1);
+            if (!hd->iocp) {
+                return ANV_HHOH_FALSE;
+            }
+        }
+        size_t next = 0;
+        size_t in_flight = 0;
+        while (next < count || in_flight > 0) {
+            while (next < count && in_flight < queue_depth) {
+                anv_hhoh_read_req *req = &reqs[next++];
+                req->read_sz = 0;
+                req->success = ANV_HHOH_FALSE;
+                // never submitted requests must look completed.
+                ZeroMemory(&req->overlapped, sizeof(OVERLAPPED));
+                if (req->sz > MAXDWORD || req->offset + req->sz < req->offset) {
+                    all_ok = ANV_HHOH_FALSE;
+                    continue;
+                }
+                req->overlapped.Offset = (DWORD)req->offset;
+                req->overlapped.OffsetHigh = (DWORD)(req->offset >> 32);
+                // completions reach the port even when ReadFile succeeds
+                // right away.
+                if (ReadFile(
+                        handle, req->buff, (DWORD)req->sz, NULL,
+                        &req->overlapped
+                    )
+                    || GetLastError() == ERROR_IO_PENDING) {
+                    ++in_flight;
+                } else if (GetLastError() == ERROR_HANDLE_EOF) {
+                    req->success = ANV_HHOH_TRUE;
+                } else {
+                    all_ok = ANV_HHOH_FALSE;
+                }
+            }
+            if (in_flight == 0) {
+                break;
+            }
+            DWORD transferred = 0;
+            ULONG_PTR key;
+            LPOVERLAPPED ov = NULL;
+            ANV_HHOH_BOOL ok = GetQueuedCompletionStatus(
+                hd->iocp, &transferred, &key, &ov, INFINITE
+            );
+            if (!ov) {
+                // the port itself failed, requests after next never started.
+                anv_hhoh__cancel_batch(hd, handle, reqs, next, in_flight);
+                return ANV_HHOH_FALSE;
+            }
+            anv_hhoh_read_req *req
+                = (anv_hhoh_read_req *)((unsigned char *)ov
+                                        - offsetof(
+                                            anv_hhoh_read_req, overlapped
+                                        ));
+            --in_flight;
+            req->read_sz = transferred;
+            req->success = ok || GetLastError() == ERROR_HANDLE_EOF;
+            if (!req->success) {
+                all_ok = ANV_HHOH_FALSE;
+            }
+        }
+        return all_ok;
+    }
+#elif defined(ANV_HHOH__HAS_THREADS)
+    if (queue_depth > 1 && count > 1) {
+        anv_hhoh__read_batch_threads(hd, reqs, count, queue_depth);
+        for (size_t i = 0; i < count; ++i) {
+            if (!reqs[i].success) {
+                all_ok = ANV_HHOH_FALSE;
+            }
+        }
+        return all_ok;
+    }
+#else
+    (void)queue_depth;
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        reqs[i].success = anv_hhoh_read_at(
+            hd, reqs[i].buff, reqs[i].sz, reqs[i].offset, &reqs[i].read_sz
+        );
+        if (!reqs[i].success) {
+            all_ok = ANV_HHOH_FALSE;
+        }
+    }
+    return all_ok;
+}
+
+/*------------------------------------------------------------------------------
+    mapped views
+------------------------------------------------------------------------------*/
+
+/*
+ * Map sz bytes at offset read only, sz 0 maps up to the end of file. The view
+ * stays valid after the handle is closed.
+ */
+ANV_HHOH_BOOL
+anv_hhoh_map_view(
+    ANV_HANDLE *hd, uint64_t offset, size_t sz, anv_hhoh_view *out_view
+)
+{
+    anv_hhoh__assert(hd);
+    anv_hhoh__assert(out_view);
+    uint64_t file_sz;
+    if (!anv_hhoh_get_size(hd, &file_sz) || offset >= file_sz) {
+        return ANV_HHOH_FALSE;
+    }
+    uint64_t view_sz = sz ? (uint64_t)sz : file_sz - offset;
+    if (view_sz > file_sz - offset) {
+        return ANV_HHOH_FALSE;
+    }
+#ifdef ANV_HHOH__HAS_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uint64_t granularity = info.dwAllocationGranularity;
+#else
+    uint64_t granularity = (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+    uint64_t aligned = offset - offset % granularity;
+    size_t delta = (size_t)(offset - aligned);
+    if (view_sz > (uint64_t)((size_t)-1 - delta)) {
+        return ANV_HHOH_FALSE;
+    }
+    size_t base_sz = (size_t)view_sz + delta;
+#ifdef ANV_HHOH__HAS_WIN32
+    // https://learn.microsoft.com/en-us/windows/win32/memory/creating-a-view-within-a-file
+    HANDLE mapping = CreateFileMapping(
+        anv_hhoh__os_handle(hd), NULL, PAGE_READONLY, 0, 0, NULL
+    );
+    if (!mapping) {
+        return ANV_HHOH_FALSE;
+    }
+    void *base = MapViewOfFile(
+        mapping, FILE_MAP_READ, (DWORD)(aligned >> 32), (DWORD)aligned, base_sz
+    );
+    // the view keeps the mapping alive.
+    CloseHandle(mapping);
+    if (!base) {
+        return ANV_HHOH_FALSE;
+    }
+#else
+    if (!anv_hhoh__fits_off(aligned)) {
+        return ANV_HHOH_FALSE;
+    }
+    void *base = mmap(
+        NULL, base_sz, PROT_READ, MAP_SHARED, anv_hhoh__os_fd(hd),
+        (off_t)aligned
+    );
+    if (base == MAP_FAILED) {
+        return ANV_HHOH_FALSE;
+    }
+#endif
+    out_view->base = base;
+    out_view->base_sz = base_sz;
+    out_view->data = (const unsigned char *)base + delta;
+    out_view->sz = (size_t)view_sz;
+    return ANV_HHOH_TRUE;
+}
+
+ANV_HHOH_BOOL
+anv_hhoh_unmap_view(anv_hhoh_view *view)
+{
+    anv_hhoh__assert(view);
+    if (!view->base) {
+        return ANV_HHOH_FALSE;
+    }
+#ifdef ANV_HHOH__HAS_WIN32
+    ANV_HHOH_BOOL ok = UnmapViewOfFile(view->base);
+#else
+    ANV_HHOH_BOOL ok = munmap(view->base, view->base_sz) == 0;
+#endif
+    memset(view, 0, sizeof(*view));
+    return ok;
 }
 
 #endif
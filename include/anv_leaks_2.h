@@ -0,0 +1,1149 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_leaks_2 (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_leaks_2
+
+Memory leaks spotter and heap profiler, cheap enough to be left on under load.
+
+malloc(), calloc(), realloc() and free() are replaced by macros recording
+every live block with the file:line which allocated it. Blocks live in open
+addressing hash tables keyed by address, so tracking and untracking are O(1).
+Records come from slabs: tracking a block does not call malloc.
+
+```
+== brief overview ==
+
+ address --hash--> |shard 0|shard 1|...|shard N|    <- one lock each
+                       |
+         |records table|sites table|slabs|stats|
+               |              ^
+               \--> record ---/  (address, size, file:line site)
+```
+
+Each allocation site (file:line) aggregates the count and bytes of its live
+and total allocations, see anv_leaks_get_sites.
+
+## Sampling
+
+With anv_leaks_options.sample_rate set to N > 1 only 1 in N allocations is
+tracked, all calls are still counted. Multiply sites numbers by N for an
+estimate of the real ones. Blocks which were not tracked can not be told apart
+from never allocated ones, so freeing unknown blocks only asserts when all
+allocations are tracked.
+
+## Threads
+
+By default only a single thread may allocate. Define ANV_LEAKS_ENABLE_THREADS
+before including the implementation to lock each of the ANV_LEAKS_SHARDS
+shards with its own mutex (requires POSIX threads, link with -pthread).
+anv_leaks_init and anv_leaks_shutdown must not run while other threads
+allocate.
+
+## Dependencies
+
+None
+
+## Include usage
+
+```c
+// once in the whole project.
+#define ANV_LEAKS_ENABLE_THREADS // optional
+#define ANV_LEAKS_IMPLEMENTATION
+#include "anv_leaks_2.h"
+```
+
+Include this header after any other header in each file where allocations must
+be tracked. Define ANV_LEAKS_DISABLE to keep the API without replacing
+malloc() and co.
+
+## Examples
+
+```c
+int
+main(void)
+{
+    anv_leaks_options options = { .sample_rate = 1, .log_file = NULL };
+    anv_leaks_init(&options);
+
+    void *mem = malloc(10);
+    anv_leaks_report(stdout, 10); // 1 live block
+
+    free(mem);
+    anv_leaks_shutdown();
+}
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_LEAKS_2_H
+#define ANV_LEAKS_2_H
+
+#include <stdio.h> /* for FILE */
+#include <stdlib.h> /* before overriding malloc() and co. */
+
+/**
+ * Number of independently locked tables, must be a power of 2.
+ */
+#ifndef ANV_LEAKS_SHARDS
+#ifdef ANV_LEAKS_ENABLE_THREADS
+#define ANV_LEAKS_SHARDS 16
+#else
+#define ANV_LEAKS_SHARDS 1
+#endif
+#endif
+
+/**
+ * Number of records allocated at once by each slab.
+ */
+#ifndef ANV_LEAKS_SLAB_ITEMS
+#define ANV_LEAKS_SLAB_ITEMS 1024
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum anv_leaks_result {
+    ANV_LEAKS_OK = 0,
+    ANV_LEAKS_INVALID_PARAMS = 1,
+    ANV_LEAKS_ALLOC_ERROR = 2,
+} anv_leaks_result;
+
+typedef struct anv_leaks_options {
+    /** Track 1 in sample_rate allocations, 0 or 1 to track all of them. */
+    size_t sample_rate;
+    /** Log every call here, NULL to disable. */
+    FILE *log_file;
+} anv_leaks_options;
+
+typedef struct anv_leaks_stats {
+    size_t malloc_count;
+    size_t calloc_count;
+    size_t realloc_count;
+    size_t free_count;
+    /** Tracked blocks currently allocated. */
+    size_t live_count;
+    /** Bytes of tracked blocks currently allocated. */
+    size_t live_bytes;
+    /** Bytes of all tracked allocations, reallocations included. */
+    size_t total_allocated;
+    /** Bytes of all tracked releases, reallocations included. */
+    size_t total_freed;
+    /** Allocations not tracked because of sampling or out of memory. */
+    size_t untracked_count;
+} anv_leaks_stats;
+
+/**
+ * A tracked block still allocated.
+ */
+typedef struct anv_leak_info {
+    const char *filename;
+    int line;
+    size_t bytes;
+    void *address;
+} anv_leak_info;
+
+/**
+ * Tracked allocations of a single file:line.
+ */
+typedef struct anv_leaks_site {
+    const char *filename;
+    int line;
+    /** Blocks allocated here and not yet freed. */
+    size_t live_count;
+    size_t live_bytes;
+    /** All blocks allocated here. */
+    size_t total_count;
+    size_t total_bytes;
+} anv_leaks_site;
+
+/**
+ * Start tracking allocations, calls made before are not tracked.
+ * @param options NULL to track everything without logging.
+ */
+anv_leaks_result anv_leaks_init(const anv_leaks_options *options);
+
+/**
+ * Stop tracking and release all records. Blocks still allocated are not
+ * touched.
+ */
+void anv_leaks_shutdown(void);
+
+void anv_leaks_get_stats(anv_leaks_stats *out_stats);
+
+/**
+ * Get all tracked blocks still allocated.
+ * @param out_leaks Array to be released with anv_leaks_free_leaks, NULL if
+ *        there are no leaks.
+ * @param out_count Items count of out_leaks.
+ */
+anv_leaks_result
+anv_leaks_get_leaks(anv_leak_info **out_leaks, size_t *out_count);
+
+void anv_leaks_free_leaks(anv_leak_info *leaks);
+
+/**
+ * Get allocation sites sorted by live bytes, then total bytes.
+ * @param out_sites Array to be released with anv_leaks_free_sites, NULL if
+ *        nothing was tracked.
+ * @param out_count Items count of out_sites.
+ */
+anv_leaks_result
+anv_leaks_get_sites(anv_leaks_site **out_sites, size_t *out_count);
+
+void anv_leaks_free_sites(anv_leaks_site *sites);
+
+/**
+ * Print stats and the top max_sites allocation sites to file.
+ */
+void anv_leaks_report(FILE *out_file, size_t max_sites);
+
+void *anv_leaks_malloc_(size_t size, const char *filename, int line);
+void *
+anv_leaks_calloc_(size_t num, size_t size, const char *filename, int line);
+void *
+anv_leaks_realloc_(void *mem, size_t size, const char *filename, int line);
+void anv_leaks_free_(void *mem, const char *filename, int line);
+
+#define anv_leaks_malloc(size) anv_leaks_malloc_(size, __FILE__, __LINE__)
+#define anv_leaks_calloc(num, size)                                            \
+    anv_leaks_calloc_(num, size, __FILE__, __LINE__)
+#define anv_leaks_realloc(mem, size)                                           \
+    anv_leaks_realloc_(mem, size, __FILE__, __LINE__)
+#define anv_leaks_free(mem) anv_leaks_free_(mem, __FILE__, __LINE__)
+
+// function-like, so that (malloc)(size) still calls the real one.
+#ifndef ANV_LEAKS_DISABLE
+#define malloc(size)       anv_leaks_malloc(size)
+#define calloc(num, size)  anv_leaks_calloc(num, size)
+#define realloc(mem, size) anv_leaks_realloc(mem, size)
+#define free(mem)          anv_leaks_free(mem)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ANV_LEAKS_2_H */
+
+#ifdef ANV_LEAKS_IMPLEMENTATION
+
+// The implementation always calls the real malloc() and co. as (malloc)(...)
+// to skip the function-like macros above.
+
+#include <stdint.h> /* for uint64_t, uintptr_t */
+#include <string.h> /* for memset(), strcmp() */
+
+#ifdef ANV_LEAKS_ENABLE_THREADS
+#include <pthread.h>
+#endif
+
+#ifndef anv_leaks__assert
+#include <assert.h>
+#define anv_leaks__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_LEAKS__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_LEAKS__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_LEAKS__LIKELY(x)   (x)
+#define ANV_LEAKS__UNLIKELY(x) (x)
+#endif
+
+#ifdef ANV_LEAKS_ENABLE_THREADS
+#define ANV_LEAKS__MUTEX                pthread_mutex_t
+#define ANV_LEAKS__MUTEX_INIT(mutex)    pthread_mutex_init((mutex), NULL)
+#define ANV_LEAKS__MUTEX_DESTROY(mutex) pthread_mutex_destroy((mutex))
+#define ANV_LEAKS__LOCK(mutex)          pthread_mutex_lock((mutex))
+#define ANV_LEAKS__UNLOCK(mutex)        pthread_mutex_unlock((mutex))
+#else
+#define ANV_LEAKS__MUTEX                char
+#define ANV_LEAKS__MUTEX_INIT(mutex)    ((void)(mutex))
+#define ANV_LEAKS__MUTEX_DESTROY(mutex) ((void)(mutex))
+#define ANV_LEAKS__LOCK(mutex)          ((void)(mutex))
+#define ANV_LEAKS__UNLOCK(mutex)        ((void)(mutex))
+#endif
+
+#define ANV_LEAKS__MIN_TABLE_CAPACITY 64
+
+typedef enum anv_leaks__op {
+    ANV_LEAKS__OP_MALLOC,
+    ANV_LEAKS__OP_CALLOC,
+    ANV_LEAKS__OP_REALLOC,
+} anv_leaks__op;
+
+typedef struct anv_leaks__record {
+    void *address;
+    size_t size;
+    anv_leaks_site *site;
+} anv_leaks__record;
+
+/*
+ * Fixed size items carved out of ANV_LEAKS_SLAB_ITEMS sized chunks. Chunks are
+ * only released all at once.
+ */
+typedef struct anv_leaks__slab {
+    size_t item_sz;
+    /** Free items, linked through their first pointer. */
+    void *free_list;
+    /** Allocated chunks, linked through their first pointer. */
+    void *chunks;
+} anv_leaks__slab;
+
+typedef struct anv_leaks__slot {
+    uint64_t hash;
+    /** NULL for empty slots. */
+    void *item;
+} anv_leaks__slot;
+
+/*
+ * Linear probing hash table of pointers to items, with backward shift
+ * deletion so that there are no tombstones.
+ */
+typedef struct anv_leaks__table {
+    anv_leaks__slot *slots;
+    size_t capacity;
+    size_t length;
+} anv_leaks__table;
+
+typedef int (*anv_leaks__equals_fn)(const void *item, const void *key);
+
+typedef struct anv_leaks__shard {
+    ANV_LEAKS__MUTEX mutex;
+    /** anv_leaks__record by address. */
+    anv_leaks__table records;
+    /** anv_leaks_site by file:line. */
+    anv_leaks__table sites;
+    anv_leaks__slab record_slab;
+    anv_leaks__slab site_slab;
+    anv_leaks_stats stats;
+} anv_leaks__shard;
+
+static struct {
+    int initialized;
+    size_t sample_rate;
+    FILE *log_file;
+    size_t sample_counter;
+#if defined(ANV_LEAKS_ENABLE_THREADS) && !defined(__GNUC__)
+    pthread_mutex_t sample_mutex;
+#endif
+    anv_leaks__shard shards[ANV_LEAKS_SHARDS];
+} anv_leaks__state;
+
+static uint64_t
+anv_leaks__mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= (uint64_t)0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= (uint64_t)0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t
+anv_leaks__hash_address(const void *address)
+{
+    return anv_leaks__mix((uint64_t)(uintptr_t)address);
+}
+
+static anv_leaks__shard *
+anv_leaks__shard_of(uint64_t hash)
+{
+    // high bits for the shard, low bits for the slot.
+    return &anv_leaks__state.shards[(hash >> 48) & (ANV_LEAKS_SHARDS - 1)];
+}
+
+static void *
+anv_leaks__slab_alloc(anv_leaks__slab *slab)
+{
+    if (ANV_LEAKS__UNLIKELY(!slab->free_list)) {
+        // first item holds the chunks list.
+        char *chunk
+            = (char *)(malloc)((ANV_LEAKS_SLAB_ITEMS + 1) * slab->item_sz);
+        if (ANV_LEAKS__UNLIKELY(!chunk)) {
+            return NULL;
+        }
+        *(void **)chunk = slab->chunks;
+        slab->chunks = chunk;
+        for (size_t i = ANV_LEAKS_SLAB_ITEMS; i > 0; --i) {
+            void *item = chunk + i * slab->item_sz;
+            *(void **)item = slab->free_list;
+            slab->free_list = item;
+        }
+    }
+    void *item = slab->free_list;
+    slab->free_list = *(void **)item;
+    return item;
+}
+
+static void
+anv_leaks__slab_release(anv_leaks__slab *slab, void *item)
+{
+    *(void **)item = slab->free_list;
+    slab->free_list = item;
+}
+
+static void
+anv_leaks__slab_destroy(anv_leaks__slab *slab)
+{
+    while (slab->chunks) {
+        void *next = *(void **)slab->chunks;
+        (free)(slab->chunks);
+        slab->chunks = next;
+    }
+    slab->free_list = NULL;
+}
+
+/*
+ * Index of the slot holding key, or of the empty slot where it belongs.
+ */
+static size_t
+anv_leaks__table_find(
+    const anv_leaks__table *table,
+    uint64_t hash,
+    anv_leaks__equals_fn equals_fn,
+    const void *key
+)
+{
+    size_t mask = table->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (table->slots[i].item) {
+        if (table->slots[i].hash == hash
+            && equals_fn(table->slots[i].item, key)) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int
+anv_leaks__table_grow(anv_leaks__table *table)
+{
+    size_t capacity = table->capacity ? table->capacity * 2
+                                      : ANV_LEAKS__MIN_TABLE_CAPACITY;
+    anv_leaks__slot *slots
+        = (anv_leaks__slot *)(calloc)(capacity, sizeof(anv_leaks__slot));
+    if (ANV_LEAKS__UNLIKELY(!slots)) {
+        return 1;
+    }
+    for (size_t i = 0; i < table->capacity; ++i) {
+        if (table->slots[i].item) {
+            size_t j = (size_t)table->slots[i].hash & (capacity - 1);
+            while (slots[j].item) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = table->slots[i];
+        }
+    }
+    (free)(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
+/*
+ * Insert item, which must not be in table yet. Return 0 on success.
+ */
+static int
+anv_leaks__table_insert(
+    anv_leaks__table *table,
+    uint64_t hash,
+    anv_leaks__equals_fn equals_fn,
+    const void *key,
+    void *item
+)
+{
+    // keep at most 3/4 of the slots full.
+    if (ANV_LEAKS__UNLIKELY((table->length + 1) * 4 > table->capacity * 3)) {
+        if (anv_leaks__table_grow(table) != 0) {
+            return 1;
+        }
+    }
+    size_t i = anv_leaks__table_find(table, hash, equals_fn, key);
+    table->slots[i].hash = hash;
+    table->slots[i].item = item;
+    ++table->length;
+    return 0;
+}
+
+static void *
+anv_leaks__table_get(
+    const anv_leaks__table *table,
+    uint64_t hash,
+    anv_leaks__equals_fn equals_fn,
+    const void *key
+)
+{
+    if (ANV_LEAKS__UNLIKELY(table->capacity == 0)) {
+        return NULL;
+    }
+    return table->slots[anv_leaks__table_find(table, hash, equals_fn, key)]
+        .item;
+}
+
+/*
+ * Remove and return the item matching key, NULL if not found.
+ */
+static void *
+anv_leaks__table_remove(
+    anv_leaks__table *table,
+    uint64_t hash,
+    anv_leaks__equals_fn equals_fn,
+    const void *key
+)
+{
+    if (ANV_LEAKS__UNLIKELY(table->capacity == 0)) {
+        return NULL;
+    }
+    size_t mask = table->capacity - 1;
+    size_t i = anv_leaks__table_find(table, hash, equals_fn, key);
+    void *item = table->slots[i].item;
+    if (!item) {
+        return NULL;
+    }
+
+    // move back following items which would not be found past the hole.
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!table->slots[j].item) {
+            break;
+        }
+        size_t home = (size_t)table->slots[j].hash & mask;
+        // distance from home to j, wrapping around.
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+    table->slots[i].item = NULL;
+    --table->length;
+    return item;
+}
+
+static int
+anv_leaks__record_equals(const void *item, const void *key)
+{
+    return ((const anv_leaks__record *)item)->address == key;
+}
+
+static int
+anv_leaks__site_equals(const void *item, const void *key)
+{
+    const anv_leaks_site *a = (const anv_leaks_site *)item;
+    const anv_leaks_site *b = (const anv_leaks_site *)key;
+    return a->filename == b->filename && a->line == b->line;
+}
+
+static uint64_t
+anv_leaks__hash_site(const char *filename, int line)
+{
+    return anv_leaks__mix(
+        (uint64_t)(uintptr_t)filename ^ ((uint64_t)(unsigned)line << 32)
+    );
+}
+
+/*
+ * Decide whether the next allocation is tracked.
+ */
+static int
+anv_leaks__sample(void)
+{
+    size_t rate = anv_leaks__state.sample_rate;
+    if (ANV_LEAKS__LIKELY(rate <= 1)) {
+        return 1;
+    }
+    size_t n;
+#if defined(ANV_LEAKS_ENABLE_THREADS) && defined(__GNUC__)
+    n = __atomic_fetch_add(
+        &anv_leaks__state.sample_counter, 1, __ATOMIC_RELAXED
+    );
+#elif defined(ANV_LEAKS_ENABLE_THREADS)
+    pthread_mutex_lock(&anv_leaks__state.sample_mutex);
+    n = anv_leaks__state.sample_counter++;
+    pthread_mutex_unlock(&anv_leaks__state.sample_mutex);
+#else
+    n = anv_leaks__state.sample_counter++;
+#endif
+    return n % rate == 0;
+}
+
+static void
+anv_leaks__count_op(anv_leaks_stats *stats, anv_leaks__op op)
+{
+    switch (op) {
+        case ANV_LEAKS__OP_MALLOC:
+            ++stats->malloc_count;
+            break;
+        case ANV_LEAKS__OP_CALLOC:
+            ++stats->calloc_count;
+            break;
+        case ANV_LEAKS__OP_REALLOC:
+            ++stats->realloc_count;
+            break;
+    }
+}
+
+/*
+ * Add record for a new block, caller must hold the shard lock. Return 0 on
+ * success.
+ */
+static int
+anv_leaks__track_locked(
+    anv_leaks__shard *shard,
+    uint64_t hash,
+    void *mem,
+    size_t size,
+    const char *filename,
+    int line
+)
+{
+    anv_leaks_site key;
+    key.filename = filename;
+    key.line = line;
+    uint64_t site_hash = anv_leaks__hash_site(filename, line);
+    anv_leaks_site *site = (anv_leaks_site *)anv_leaks__table_get(
+        &shard->sites, site_hash, anv_leaks__site_equals, &key
+    );
+    if (ANV_LEAKS__UNLIKELY(!site)) {
+        site = (anv_leaks_site *)anv_leaks__slab_alloc(&shard->site_slab);
+        if (ANV_LEAKS__UNLIKELY(!site)) {
+            return 1;
+        }
+        memset(site, 0, sizeof(*site));
+        site->filename = filename;
+        site->line = line;
+        if (anv_leaks__table_insert(
+                &shard->sites, site_hash, anv_leaks__site_equals, &key, site
+            )
+            != 0) {
+            anv_leaks__slab_release(&shard->site_slab, site);
+            return 1;
+        }
+    }
+
+    anv_leaks__record *record
+        = (anv_leaks__record *)anv_leaks__slab_alloc(&shard->record_slab);
+    if (ANV_LEAKS__UNLIKELY(!record)) {
+        return 1;
+    }
+    record->address = mem;
+    record->size = size;
+    record->site = site;
+    if (ANV_LEAKS__UNLIKELY(
+            anv_leaks__table_insert(
+                &shard->records, hash, anv_leaks__record_equals, mem, record
+            )
+            != 0
+        )) {
+        anv_leaks__slab_release(&shard->record_slab, record);
+        return 1;
+    }
+
+    ++site->live_count;
+    site->live_bytes += size;
+    ++site->total_count;
+    site->total_bytes += size;
+    ++shard->stats.live_count;
+    shard->stats.live_bytes += size;
+    shard->stats.total_allocated += size;
+    return 0;
+}
+
+/*
+ * Count a new block and track it if sampled.
+ */
+static void
+anv_leaks__track(
+    void *mem,
+    size_t size,
+    const char *filename,
+    int line,
+    anv_leaks__op op,
+    int sampled
+)
+{
+    uint64_t hash = anv_leaks__hash_address(mem);
+    anv_leaks__shard *shard = anv_leaks__shard_of(hash);
+    ANV_LEAKS__LOCK(&shard->mutex);
+    anv_leaks__count_op(&shard->stats, op);
+    if (!sampled
+        || anv_leaks__track_locked(shard, hash, mem, size, filename, line)
+               != 0) {
+        ++shard->stats.untracked_count;
+    }
+    ANV_LEAKS__UNLOCK(&shard->mutex);
+}
+
+/*
+ * Remove the record of mem if tracked, return whether it was.
+ */
+static int
+anv_leaks__untrack(void *mem, size_t *out_size)
+{
+    uint64_t hash = anv_leaks__hash_address(mem);
+    anv_leaks__shard *shard = anv_leaks__shard_of(hash);
+    ANV_LEAKS__LOCK(&shard->mutex);
+    anv_leaks__record *record = (anv_leaks__record *)anv_leaks__table_remove(
+        &shard->records, hash, anv_leaks__record_equals, mem
+    );
+    if (record) {
+        anv_leaks_site *site = record->site;
+        --site->live_count;
+        site->live_bytes -= record->size;
+        --shard->stats.live_count;
+        shard->stats.live_bytes -= record->size;
+        shard->stats.total_freed += record->size;
+        *out_size = record->size;
+        anv_leaks__slab_release(&shard->record_slab, record);
+    }
+    ANV_LEAKS__UNLOCK(&shard->mutex);
+    return record != NULL;
+}
+
+static void
+anv_leaks__count_free(void *mem)
+{
+    anv_leaks__shard *shard = anv_leaks__shard_of(anv_leaks__hash_address(mem));
+    ANV_LEAKS__LOCK(&shard->mutex);
+    ++shard->stats.free_count;
+    ANV_LEAKS__UNLOCK(&shard->mutex);
+}
+
+static void
+anv_leaks__lock_all(void)
+{
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        ANV_LEAKS__LOCK(&anv_leaks__state.shards[i].mutex);
+    }
+}
+
+static void
+anv_leaks__unlock_all(void)
+{
+    for (size_t i = ANV_LEAKS_SHARDS; i > 0; --i) {
+        ANV_LEAKS__UNLOCK(&anv_leaks__state.shards[i - 1].mutex);
+    }
+}
+
+anv_leaks_result
+anv_leaks_init(const anv_leaks_options *options)
+{
+    if (ANV_LEAKS__UNLIKELY(anv_leaks__state.initialized)) {
+        anv_leaks__assert(0, "anv_leaks already initialized");
+        return ANV_LEAKS_INVALID_PARAMS;
+    }
+
+    memset(&anv_leaks__state, 0, sizeof(anv_leaks__state));
+    if (options) {
+        anv_leaks__state.sample_rate = options->sample_rate;
+        anv_leaks__state.log_file = options->log_file;
+    }
+#if defined(ANV_LEAKS_ENABLE_THREADS) && !defined(__GNUC__)
+    pthread_mutex_init(&anv_leaks__state.sample_mutex, NULL);
+#endif
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        anv_leaks__shard *shard = &anv_leaks__state.shards[i];
+        ANV_LEAKS__MUTEX_INIT(&shard->mutex);
+        // slab links need pointer sized items at least.
+        shard->record_slab.item_sz = sizeof(anv_leaks__record);
+        shard->site_slab.item_sz = sizeof(anv_leaks_site);
+    }
+    anv_leaks__state.initialized = 1;
+    return ANV_LEAKS_OK;
+}
+
+void
+anv_leaks_shutdown(void)
+{
+    if (!anv_leaks__state.initialized) {
+        return;
+    }
+    anv_leaks__state.initialized = 0;
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        anv_leaks__shard *shard = &anv_leaks__state.shards[i];
+        (free)(shard->records.slots);
+        (free)(shard->sites.slots);
+        anv_leaks__slab_destroy(&shard->record_slab);
+        anv_leaks__slab_destroy(&shard->site_slab);
+        ANV_LEAKS__MUTEX_DESTROY(&shard->mutex);
+    }
+#if defined(ANV_LEAKS_ENABLE_THREADS) && !defined(__GNUC__)
+    pthread_mutex_destroy(&anv_leaks__state.sample_mutex);
+#endif
+    memset(&anv_leaks__state, 0, sizeof(anv_leaks__state));
+}
+
+void
+anv_leaks_get_stats(anv_leaks_stats *out_stats)
+{
+    if (ANV_LEAKS__UNLIKELY(!out_stats)) {
+        anv_leaks__assert(0, "invalid params");
+        return;
+    }
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (!anv_leaks__state.initialized) {
+        return;
+    }
+    anv_leaks__lock_all();
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        const anv_leaks_stats *stats = &anv_leaks__state.shards[i].stats;
+        out_stats->malloc_count += stats->malloc_count;
+        out_stats->calloc_count += stats->calloc_count;
+        out_stats->realloc_count += stats->realloc_count;
+        out_stats->free_count += stats->free_count;
+        out_stats->live_count += stats->live_count;
+        out_stats->live_bytes += stats->live_bytes;
+        out_stats->total_allocated += stats->total_allocated;
+        out_stats->total_freed += stats->total_freed;
+        out_stats->untracked_count += stats->untracked_count;
+    }
+    anv_leaks__unlock_all();
+}
+
+anv_leaks_result
+anv_leaks_get_leaks(anv_leak_info **out_leaks, size_t *out_count)
+{
+    if (ANV_LEAKS__UNLIKELY(!out_leaks || !out_count)) {
+        anv_leaks__assert(0, "invalid params");
+        return ANV_LEAKS_INVALID_PARAMS;
+    }
+    *out_leaks = NULL;
+    *out_count = 0;
+    if (!anv_leaks__state.initialized) {
+        return ANV_LEAKS_OK;
+    }
+
+    anv_leaks__lock_all();
+    size_t count = 0;
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        count += anv_leaks__state.shards[i].records.length;
+    }
+    if (count == 0) {
+        anv_leaks__unlock_all();
+        return ANV_LEAKS_OK;
+    }
+    anv_leak_info *leaks
+        = (anv_leak_info *)(malloc)(count * sizeof(anv_leak_info));
+    if (ANV_LEAKS__UNLIKELY(!leaks)) {
+        anv_leaks__unlock_all();
+        return ANV_LEAKS_ALLOC_ERROR;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        const anv_leaks__table *records = &anv_leaks__state.shards[i].records;
+        for (size_t j = 0; j < records->capacity; ++j) {
+            const anv_leaks__record *record
+                = (const anv_leaks__record *)records->slots[j].item;
+            if (record) {
+                leaks[n].filename = record->site->filename;
+                leaks[n].line = record->site->line;
+                leaks[n].bytes = record->size;
+                leaks[n].address = record->address;
+                ++n;
+            }
+        }
+    }
+    anv_leaks__unlock_all();
+
+    *out_leaks = leaks;
+    *out_count = n;
+    return ANV_LEAKS_OK;
+}
+
+void
+anv_leaks_free_leaks(anv_leak_info *leaks)
+{
+    (free)(leaks);
+}
+
+static int
+anv_leaks__compare_sites(const void *a, const void *b)
+{
+    const anv_leaks_site *sa = (const anv_leaks_site *)a;
+    const anv_leaks_site *sb = (const anv_leaks_site *)b;
+    if (sa->live_bytes != sb->live_bytes) {
+        return sa->live_bytes < sb->live_bytes ? 1 : -1;
+    }
+    if (sa->total_bytes != sb->total_bytes) {
+        return sa->total_bytes < sb->total_bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+anv_leaks_result
+anv_leaks_get_sites(anv_leaks_site **out_sites, size_t *out_count)
+{
+    if (ANV_LEAKS__UNLIKELY(!out_sites || !out_count)) {
+        anv_leaks__assert(0, "invalid params");
+        return ANV_LEAKS_INVALID_PARAMS;
+    }
+    *out_sites = NULL;
+    *out_count = 0;
+    if (!anv_leaks__state.initialized) {
+        return ANV_LEAKS_OK;
+    }
+
+    anv_leaks__lock_all();
+    size_t count = 0;
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        count += anv_leaks__state.shards[i].sites.length;
+    }
+    if (count == 0) {
+        anv_leaks__unlock_all();
+        return ANV_LEAKS_OK;
+    }
+    anv_leaks_site *sites
+        = (anv_leaks_site *)(malloc)(count * sizeof(anv_leaks_site));
+    if (ANV_LEAKS__UNLIKELY(!sites)) {
+        anv_leaks__unlock_all();
+        return ANV_LEAKS_ALLOC_ERROR;
+    }
+    // each shard has its own copy of a site, merge them.
+    size_t n = 0;
+    for (size_t i = 0; i < ANV_LEAKS_SHARDS; ++i) {
+        const anv_leaks__table *table = &anv_leaks__state.shards[i].sites;
+        for (size_t j = 0; j < table->capacity; ++j) {
+            const anv_leaks_site *site
+                = (const anv_leaks_site *)table->slots[j].item;
+            if (!site) {
+                continue;
+            }
+            size_t k = 0;
+            while (k < n
+                   && (sites[k].line != site->line
+                       || strcmp(sites[k].filename, site->filename) != 0)) {
+                ++k;
+            }
+            if (k == n) {
+                sites[n++] = *site;
+            } else {
+                sites[k].live_count += site->live_count;
+                sites[k].live_bytes += site->live_bytes;
+                sites[k].total_count += site->total_count;
+                sites[k].total_bytes += site->total_bytes;
+            }
+        }
+    }
+    anv_leaks__unlock_all();
+
+    qsort(sites, n, sizeof(anv_leaks_site), anv_leaks__compare_sites);
+    *out_sites = sites;
+    *out_count = n;
+    return ANV_LEAKS_OK;
+}
+
+void
+anv_leaks_free_sites(anv_leaks_site *sites)
+{
+    (free)(sites);
+}
+
+void
+anv_leaks_report(FILE *out_file, size_t max_sites)
+{
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    fprintf(
+        out_file,
+        "anv_leaks: %zu live blocks, %zu bytes (sample rate: %zu)\n",
+        stats.live_count,
+        stats.live_bytes,
+        anv_leaks__state.sample_rate > 1 ? anv_leaks__state.sample_rate : 1
+    );
+    fprintf(
+        out_file,
+        "  malloc: %zu, calloc: %zu, realloc: %zu, free: %zu, untracked: %zu\n",
+        stats.malloc_count,
+        stats.calloc_count,
+        stats.realloc_count,
+        stats.free_count,
+        stats.untracked_count
+    );
+
+    anv_leaks_site *sites = NULL;
+    size_t count = 0;
+    if (max_sites == 0 || anv_leaks_get_sites(&sites, &count) != ANV_LEAKS_OK) {
+        return;
+    }
+    for (size_t i = 0; i < count && i < max_sites; ++i) {
+        fprintf(
+            out_file,
+            "  [%s:%d] live: %zu blocks, %zu bytes | total: %zu blocks, %zu "
+            "bytes\n",
+            sites[i].filename,
+            sites[i].line,
+            sites[i].live_count,
+            sites[i].live_bytes,
+            sites[i].total_count,
+            sites[i].total_bytes
+        );
+    }
+    anv_leaks_free_sites(sites);
+}
+
+void *
+anv_leaks_malloc_(size_t size, const char *filename, int line)
+{
+    void *mem = (malloc)(size);
+    if (mem && anv_leaks__state.initialized) {
+        anv_leaks__track(
+            mem, size, filename, line, ANV_LEAKS__OP_MALLOC, anv_leaks__sample()
+        );
+        if (anv_leaks__state.log_file) {
+            fprintf(
+                anv_leaks__state.log_file,
+                "[%s:%d] <%p> malloc(%zu)\n",
+                filename,
+                line,
+                mem,
+                size
+            );
+        }
+    }
+    return mem;
+}
+
+void *
+anv_leaks_calloc_(size_t num, size_t size, const char *filename, int line)
+{
+    void *mem = (calloc)(num, size);
+    if (mem && anv_leaks__state.initialized) {
+        anv_leaks__track(
+            mem,
+            num * size,
+            filename,
+            line,
+            ANV_LEAKS__OP_CALLOC,
+            anv_leaks__sample()
+        );
+        if (anv_leaks__state.log_file) {
+            fprintf(
+                anv_leaks__state.log_file,
+                "[%s:%d] <%p> calloc(%zu, %zu)\n",
+                filename,
+                line,
+                mem,
+                num,
+                size
+            );
+        }
+    }
+    return mem;
+}
+
+void *
+anv_leaks_realloc_(void *mem, size_t size, const char *filename, int line)
+{
+    if (!anv_leaks__state.initialized) {
+        return (realloc)(mem, size);
+    }
+    if (!mem) {
+        void *new_mem = (malloc)(size);
+        if (new_mem) {
+            anv_leaks__track(
+                new_mem,
+                size,
+                filename,
+                line,
+                ANV_LEAKS__OP_REALLOC,
+                anv_leaks__sample()
+            );
+        }
+        return new_mem;
+    }
+    if (size == 0) {
+        anv_leaks_free_(mem, filename, line);
+        return NULL;
+    }
+
+    // untrack first: once released the address may be reused by other threads.
+    size_t old_size = 0;
+    int tracked = anv_leaks__untrack(mem, &old_size);
+    if (!tracked && anv_leaks__state.sample_rate <= 1) {
+        anv_leaks__assert(0, "reallocated unknown memory block");
+    }
+    void *new_mem = (realloc)(mem, size);
+    if (!new_mem) {
+        // mem is still valid.
+        if (tracked) {
+            anv_leaks__track(
+                mem, old_size, filename, line, ANV_LEAKS__OP_REALLOC, 1
+            );
+        }
+        return NULL;
+    }
+    // a tracked block keeps being tracked, whatever the sampling.
+    anv_leaks__track(
+        new_mem, size, filename, line, ANV_LEAKS__OP_REALLOC, tracked
+    );
+    if (anv_leaks__state.log_file) {
+        fprintf(
+            anv_leaks__state.log_file,
+            "[%s:%d] <%p> realloc(from: %zu, to: %zu)\n",
+            filename,
+            line,
+            new_mem,
+            old_size,
+            size
+        );
+    }
+    return new_mem;
+}
+
+void
+anv_leaks_free_(void *mem, const char *filename, int line)
+{
+    if (!mem) {
+        return;
+    }
+    if (anv_leaks__state.initialized) {
+        size_t size = 0;
+        int tracked = anv_leaks__untrack(mem, &size);
+        anv_leaks__count_free(mem);
+        if (!tracked && anv_leaks__state.sample_rate <= 1) {
+            anv_leaks__assert(0, "attempt to free an unknown memory block");
+        }
+        if (anv_leaks__state.log_file) {
+            fprintf(
+                anv_leaks__state.log_file,
+                "[%s:%d] <%p> free(%zu)\n",
+                filename,
+                line,
+                mem,
+                size
+            );
+        }
+    }
+    (free)(mem);
+}
+
+#endif /* ANV_LEAKS_IMPLEMENTATION */
@@ -0,0 +1,960 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_map (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_map
+
+Open addressing hash map with fixed size keys and values.
+
+Like anv_arr, keys and values are plain bytes of key_sz and value_sz size
+copied in and out with memcpy. The whole map (control bytes + slots + extra
+info) lives inside a single metalloc allocation, so inserting may move the map
+in memory just like pushing to an anv_arr.
+
+The table is laid out Swiss table style: every slot has a control byte holding
+7 bits of its key's hash (or the empty/deleted markers), and lookups compare a
+whole group of control bytes at once before touching any key. Groups are 16
+bytes wide with SSE2 and 8 bytes wide on other targets (SWAR on a 64 bit word,
+also forced by defining ANV_MAP_NO_SIMD). Most lookups end within the first
+group.
+
+```
+== brief overview ==
+
+|-metadata-|-ctrl0-|-ctrl1-|...|-ctrlN-|-mirror-|-key0-|-val0-|-key1-|-val1-|...
+```
+
+The map keeps at most 7/8 of its slots full, growing 2x when needed. Removed
+keys leave a tombstone only when a probe sequence may run through their slot.
+
+## Keys
+
+By default keys are hashed with anv_map_hash_bytes and compared with memcmp,
+which is fine for integers and packed structs. Structs with padding bytes
+must be zeroed before being used as keys, or use custom callbacks (see
+anv_map_options), e.g. to store pointers to strings as keys.
+
+## Trusted mode
+
+Same as anv_arr: defining ANV_MAP_TRUSTED before including the implementation
+skips map validation on every call (see anv_meta_get_unchecked).
+
+## Dependencies
+
+- anv_metalloc.h
+
+## Include usage
+
+```c
+// only if metalloc define is not already present somewhere else.
+#define ANV_METALLOC_IMPLEMENTATION
+
+#define ANV_MAP_IMPLEMENTATION
+#include "anv_map.h"
+```
+
+## Examples
+
+```c
+anv_map_t routes = anv_map_new(64, sizeof(uint32_t), sizeof(route_t));
+
+uint32_t id = 42;
+route_t route = { .port = 8080 };
+if (anv_map_put(routes, &id, &route) != ANV_MAP_RESULT_OK) {
+    fprintf(stderr, "failed inserting route\n");
+}
+
+route_t *found = anv_map_get(routes, &id);
+if (found) {
+    printf("route port: %d\n", found->port);
+}
+
+size_t cursor = 0;
+void *key;
+void *value;
+while (anv_map_next(routes, &cursor, &key, &value)) {
+    printf("%u -> %d\n", *(uint32_t *)key, ((route_t *)value)->port);
+}
+
+anv_map_destroy(routes);
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_MAP_H
+#define ANV_MAP_H
+
+#include <stddef.h> /* for size_t */
+
+#include "anv_metalloc.h"
+
+/**
+ * Alignment of the map's control bytes and first slot.
+ */
+#ifndef ANV_MAP_ALIGNMENT
+#define ANV_MAP_ALIGNMENT 16
+#endif
+
+typedef enum anv_map_result {
+    /**
+     * Operation succeeded.
+     */
+    ANV_MAP_RESULT_OK = 0,
+    /**
+     * Invalid params have been passed to method.
+     * @note With debug asserts enabled, these errors always trigger an assert.
+     */
+    ANV_MAP_RESULT_INVALID_PARAMS = 1,
+    /**
+     * Memory allocation related error.
+     */
+    ANV_MAP_RESULT_ALLOC_ERROR = 2,
+    /**
+     * The key is not in the map.
+     */
+    ANV_MAP_RESULT_KEY_NOT_FOUND = 10,
+} anv_map_result;
+
+/**
+ * Convenience alias to better recognize an anv map from a regular void *ptr;
+ */
+typedef void *anv_map_t;
+
+/**
+ * Hash callback.
+ * @param key Pointer to key_sz bytes.
+ * @return Hash of key, all bits should be well mixed.
+ */
+typedef size_t (*anv_map_hash_fn)(const void *key, size_t key_sz);
+
+/**
+ * Key equality callback.
+ * @return Non zero if keys a and b are equal.
+ */
+typedef int (*anv_map_equals_fn)(const void *a, const void *b, size_t key_sz);
+
+typedef struct anv_map_options {
+    /** Number of items the map can hold before growing. */
+    size_t capacity;
+    /** Size in bytes of a key, always > 0. */
+    size_t key_sz;
+    /** Size in bytes of a value, can be 0 to use the map as a set. */
+    size_t value_sz;
+    /** Optional hash callback, NULL for anv_map_hash_bytes. */
+    anv_map_hash_fn hash_fn;
+    /** Optional equality callback, NULL for memcmp. */
+    anv_map_equals_fn equals_fn;
+    /**
+     * Optional allocator for the map's memory, NULL for the metalloc default
+     * one (see anv_meta_set_default_allocator).
+     */
+    const anv_meta_allocator *allocator;
+} anv_map_options;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Default hash callback, hashes key_sz bytes of key.
+ */
+size_t anv_map_hash_bytes(const void *key, size_t key_sz);
+
+/**
+ * Allocate a new map.
+ * @param capacity Number of items the map can hold before growing.
+ * @param key_sz Size in bytes of a key, always > 0.
+ * @param value_sz Size in bytes of a value, can be 0.
+ * @return New map, NULL on invalid params or internal alloc errors.
+ */
+anv_map_t anv_map_new(size_t capacity, size_t key_sz, size_t value_sz);
+
+/**
+ * Allocate a new map.
+ * @return New map, NULL on invalid params or internal alloc errors.
+ */
+anv_map_t anv_map_new_with_options(const anv_map_options *options);
+
+/**
+ * Destroy a map.
+ * @param map Map to destroy, NULL is a no-op.
+ */
+void anv_map_destroy(anv_map_t map);
+
+/**
+ * @return Number of items in the map, 0 on invalid params.
+ */
+size_t anv_map_length(anv_map_t map);
+
+/**
+ * @return Number of items the map can hold before growing, 0 on invalid
+ *         params.
+ */
+size_t anv_map_capacity(anv_map_t map);
+
+anv_map_result anv_map__reserve(anv_map_t *refmap, size_t capacity);
+
+/**
+ * Make room for at least capacity items without further growing.
+ * @note May move the map in memory.
+ * @return Status code.
+ */
+#define anv_map_reserve(map, capacity)                                         \
+    anv_map__reserve((void *)&(map), capacity)
+
+anv_map_result
+anv_map__put(anv_map_t *refmap, const void *key, const void *value);
+
+/**
+ * Insert a new item or overwrite the value of an existing key.
+ * @note May move the map in memory, invalidating pointers to its items.
+ * @param key Pointer to key_sz bytes.
+ * @param value Pointer to value_sz bytes, NULL to zero the value.
+ * @return Status code.
+ */
+#define anv_map_put(map, key, value) anv_map__put((void *)&(map), key, value)
+
+/**
+ * Find the value of key.
+ * @return Pointer to the value inside the map, NULL if key is not found or on
+ *         invalid params. Valid until the map is modified.
+ */
+void *anv_map_get(anv_map_t map, const void *key);
+
+/**
+ * @return Non zero if key is in the map.
+ */
+int anv_map_contains(anv_map_t map, const void *key);
+
+/**
+ * Remove key and its value from the map.
+ * @return ANV_MAP_RESULT_OK, ANV_MAP_RESULT_KEY_NOT_FOUND or invalid params.
+ */
+anv_map_result anv_map_remove(anv_map_t map, const void *key);
+
+/**
+ * Remove all items, capacity is kept.
+ */
+void anv_map_clear(anv_map_t map);
+
+/**
+ * Iterate over all the map's items, in unspecified order.
+ * The map must not be modified while iterating, except through out_value.
+ * @param cursor Iteration state, set it to 0 before the first call.
+ * @param out_key Optional, set to the item's key.
+ * @param out_value Optional, set to the item's value.
+ * @return Non zero while an item has been found.
+ */
+int anv_map_next(
+    anv_map_t map, size_t *cursor, void **out_key, void **out_value
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_MAP_IMPLEMENTATION
+
+#include <stdint.h> /* for uint64_t */
+#include <string.h> /* for memcpy(), memset(), memcmp() */
+
+#ifndef anv_map__assert
+#include <assert.h>
+#define anv_map__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_MAP__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_MAP__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_MAP__LIKELY(x)   (x)
+#define ANV_MAP__UNLIKELY(x) (x)
+#endif
+
+#define ANV_MAP__SIZE_MAX ((size_t)-1)
+
+#ifdef ANV_MAP_TRUSTED
+#define anv_map__meta_get(map) anv_meta_get_unchecked(map)
+#else
+#define anv_map__meta_get(map) anv_meta_get(map)
+#endif
+
+/*
+ * Control bytes: full slots store the low 7 bits of their hash (>= 0), free
+ * ones are negative.
+ */
+#define ANV_MAP__CTRL_EMPTY   ((signed char)-128)
+#define ANV_MAP__CTRL_DELETED ((signed char)-2)
+
+#define ANV_MAP__H1(hash) ((hash) >> 7)
+#define ANV_MAP__H2(hash) ((signed char)((hash) & 0x7F))
+
+#if !defined(ANV_MAP_NO_SIMD)                                                  \
+    && (defined(__SSE2__) || defined(_M_X64)                                   \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+
+#include <emmintrin.h>
+
+#define ANV_MAP__GROUP_WIDTH 16
+
+/* One bit per control byte. */
+typedef unsigned int anv_map__bitmask;
+#define ANV_MAP__BITMASK_SHIFT 0
+
+static anv_map__bitmask
+anv_map__match(const signed char *ctrl, signed char h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (anv_map__bitmask)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(h2))
+    );
+}
+
+static anv_map__bitmask
+anv_map__match_empty(const signed char *ctrl)
+{
+    return anv_map__match(ctrl, ANV_MAP__CTRL_EMPTY);
+}
+
+static anv_map__bitmask
+anv_map__match_free(const signed char *ctrl)
+{
+    /* empty and deleted are the only negative control bytes. */
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (anv_map__bitmask)_mm_movemask_epi8(group);
+}
+
+#else
+
+#define ANV_MAP__GROUP_WIDTH 8
+
+/* High bit of each byte of a 64 bit word. */
+typedef uint64_t anv_map__bitmask;
+#define ANV_MAP__BITMASK_SHIFT 3
+
+#define ANV_MAP__LSBS ((uint64_t)0x0101010101010101)
+#define ANV_MAP__MSBS ((uint64_t)0x8080808080808080)
+
+static uint64_t
+anv_map__load_group(const signed char *ctrl)
+{
+    /* byte i always ends up at bits 8i..8i+7, whatever the endianness. */
+    uint64_t group = 0;
+    for (int i = 0; i < 8; ++i) {
+        group |= (uint64_t)(unsigned char)ctrl[i] << (8 * i);
+    }
+    return group;
+}
+
+static anv_map__bitmask
+anv_map__match(const signed char *ctrl, signed char h2)
+{
+    /* may report false positives, keys are always compared afterwards. */
+    uint64_t group
+        = anv_map__load_group(ctrl) ^ (ANV_MAP__LSBS * (unsigned char)h2);
+    return (group - ANV_MAP__LSBS) & ~group & ANV_MAP__MSBS;
+}
+
+static anv_map__bitmask
+anv_map__match_empty(const signed char *ctrl)
+{
+    /* empty is 0x80, deleted is 0xFE: only empty has bit 1 clear. */
+    uint64_t group = anv_map__load_group(ctrl);
+    return group & ~(group << 6) & ANV_MAP__MSBS;
+}
+
+static anv_map__bitmask
+anv_map__match_free(const signed char *ctrl)
+{
+    return anv_map__load_group(ctrl) & ANV_MAP__MSBS;
+}
+
+#endif
+
+/*
+ * Index of the lowest set bit, mask != 0.
+ */
+static size_t
+anv_map__lowest_bit(anv_map__bitmask mask)
+{
+#if defined(__GNUC__)
+    if (sizeof(mask) > sizeof(unsigned int)) {
+        return (size_t)__builtin_ctzll((unsigned long long)mask)
+            >> ANV_MAP__BITMASK_SHIFT;
+    }
+    return (size_t)__builtin_ctz((unsigned int)mask) >> ANV_MAP__BITMASK_SHIFT;
+#else
+    size_t index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index >> ANV_MAP__BITMASK_SHIFT;
+#endif
+}
+
+typedef struct anv_map__metadata {
+    size_t key_sz;
+    size_t value_sz;
+    /* offset of the value inside a slot. */
+    size_t value_offset;
+    size_t slot_sz;
+    /* number of slots, power of 2 >= ANV_MAP__GROUP_WIDTH. */
+    size_t slots_count;
+    size_t length;
+    /* items which can still be inserted in empty slots before growing. */
+    size_t growth_left;
+    anv_map_hash_fn hash_fn;
+    anv_map_equals_fn equals_fn;
+} anv_map__metadata;
+
+#define ANV_MAP__ROUND_UP(n, align) (((n) + (align) - 1) / (align) * (align))
+
+/* max number of full slots, 7/8 of them. */
+#define ANV_MAP__MAX_LOAD(slots_count) ((slots_count) - (slots_count) / 8)
+
+#define ANV_MAP__CTRL(map) ((signed char *)(map))
+#define ANV_MAP__CTRL_SZ(slots_count)                                          \
+    ANV_MAP__ROUND_UP((slots_count) + ANV_MAP__GROUP_WIDTH, ANV_MAP_ALIGNMENT)
+#define ANV_MAP__SLOT(map, metadata, index)                                    \
+    ((unsigned char *)(map) + ANV_MAP__CTRL_SZ((metadata)->slots_count)        \
+     + (index) * (metadata)->slot_sz)
+
+/*
+ * Biggest power of 2 dividing sz (up to 16): the strictest alignment a type of
+ * sz bytes can require. 1 for sz == 0.
+ */
+static size_t
+anv_map__size_alignment(size_t sz)
+{
+    size_t align = sz & (~sz + 1);
+    if (align == 0) {
+        return 1;
+    }
+    return align > 16 ? 16 : align;
+}
+
+/*
+ * Smallest slots count able to hold capacity items, 0 on overflow.
+ */
+static size_t
+anv_map__slots_for(size_t capacity)
+{
+    size_t slots_count = ANV_MAP__GROUP_WIDTH;
+    while (ANV_MAP__MAX_LOAD(slots_count) < capacity) {
+        if (slots_count > ANV_MAP__SIZE_MAX / 4) {
+            return 0;
+        }
+        slots_count <<= 1;
+    }
+    return slots_count;
+}
+
+static void
+anv_map__set_ctrl(
+    anv_map_t map,
+    const anv_map__metadata *metadata,
+    size_t index,
+    signed char h
+)
+{
+    signed char *ctrl = ANV_MAP__CTRL(map);
+    ctrl[index] = h;
+    /* the first group is mirrored past the end, so that groups starting near
+     * the end can be loaded at once. */
+    if (index < ANV_MAP__GROUP_WIDTH) {
+        ctrl[metadata->slots_count + index] = h;
+    }
+}
+
+static void
+anv_map__reset_ctrl(anv_map_t map, anv_map__metadata *metadata)
+{
+    memset(
+        ANV_MAP__CTRL(map),
+        (unsigned char)ANV_MAP__CTRL_EMPTY,
+        metadata->slots_count + ANV_MAP__GROUP_WIDTH
+    );
+    metadata->length = 0;
+    metadata->growth_left = ANV_MAP__MAX_LOAD(metadata->slots_count);
+}
+
+/*
+ * Allocate an empty map with the same key and value params of proto and
+ * slots_count slots.
+ */
+static anv_map_t
+anv_map__alloc(
+    const anv_map__metadata *proto,
+    const anv_meta_allocator *allocator,
+    size_t slots_count
+)
+{
+    anv_map__metadata metadata = *proto;
+    metadata.slots_count = slots_count;
+
+    size_t ctrl_sz = ANV_MAP__CTRL_SZ(slots_count);
+    if (ANV_MAP__UNLIKELY(
+            metadata.slot_sz != 0
+            && slots_count > (ANV_MAP__SIZE_MAX - ctrl_sz) / metadata.slot_sz
+        )) {
+        return NULL;
+    }
+    anv_map_t map = anv_meta_malloc_aligned_with(
+        allocator,
+        &metadata,
+        sizeof(anv_map__metadata),
+        ctrl_sz + slots_count * metadata.slot_sz,
+        ANV_MAP_ALIGNMENT
+    );
+    if (ANV_MAP__UNLIKELY(!map)) {
+        return NULL;
+    }
+    anv_map__reset_ctrl(map, anv_meta_get_unchecked(map));
+    return map;
+}
+
+static int
+anv_map__key_equals(
+    const anv_map__metadata *metadata, const void *a, const void *b
+)
+{
+    if (metadata->equals_fn) {
+        return metadata->equals_fn(a, b, metadata->key_sz);
+    }
+    return memcmp(a, b, metadata->key_sz) == 0;
+}
+
+static size_t
+anv_map__hash(const anv_map__metadata *metadata, const void *key)
+{
+    if (metadata->hash_fn) {
+        return metadata->hash_fn(key, metadata->key_sz);
+    }
+    return anv_map_hash_bytes(key, metadata->key_sz);
+}
+
+/*
+ * Index of the slot holding key, ANV_MAP__SIZE_MAX if not found.
+ */
+static size_t
+anv_map__find(
+    anv_map_t map,
+    const anv_map__metadata *metadata,
+    const void *key,
+    size_t hash
+)
+{
+    const signed char *ctrl = ANV_MAP__CTRL(map);
+    size_t mask = metadata->slots_count - 1;
+    size_t pos = ANV_MAP__H1(hash) & mask;
+    signed char h2 = ANV_MAP__H2(hash);
+    /* triangular probing over groups visits every group exactly once. */
+    for (size_t step = ANV_MAP__GROUP_WIDTH;; step += ANV_MAP__GROUP_WIDTH) {
+        anv_map__bitmask match = anv_map__match(ctrl + pos, h2);
+        while (match) {
+            size_t index = (pos + anv_map__lowest_bit(match)) & mask;
+            if (ANV_MAP__LIKELY(anv_map__key_equals(
+                    metadata, ANV_MAP__SLOT(map, metadata, index), key
+                ))) {
+                return index;
+            }
+            match &= match - 1;
+        }
+        /* an empty slot ends every probe sequence: key is not in the map. */
+        if (ANV_MAP__LIKELY(anv_map__match_empty(ctrl + pos))) {
+            return ANV_MAP__SIZE_MAX;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+/*
+ * Index of the first empty or deleted slot in hash's probe sequence.
+ */
+static size_t
+anv_map__find_free(
+    anv_map_t map, const anv_map__metadata *metadata, size_t hash
+)
+{
+    const signed char *ctrl = ANV_MAP__CTRL(map);
+    size_t mask = metadata->slots_count - 1;
+    size_t pos = ANV_MAP__H1(hash) & mask;
+    for (size_t step = ANV_MAP__GROUP_WIDTH;; step += ANV_MAP__GROUP_WIDTH) {
+        anv_map__bitmask match = anv_map__match_free(ctrl + pos);
+        if (ANV_MAP__LIKELY(match)) {
+            return (pos + anv_map__lowest_bit(match)) & mask;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+/*
+ * Move all items of *refmap to a new map with slots_count slots.
+ */
+static anv_map_result
+anv_map__rehash(
+    anv_map_t *refmap, anv_map__metadata **refmetadata, size_t slots_count
+)
+{
+    anv_map_t map = *refmap;
+    anv_map__metadata *metadata = *refmetadata;
+    anv_map_t new_map
+        = anv_map__alloc(metadata, anv_meta_get_allocator(map), slots_count);
+    if (ANV_MAP__UNLIKELY(!new_map)) {
+        return ANV_MAP_RESULT_ALLOC_ERROR;
+    }
+    anv_map__metadata *new_metadata = anv_meta_get_unchecked(new_map);
+
+    const signed char *ctrl = ANV_MAP__CTRL(map);
+    for (size_t i = 0; i < metadata->slots_count; ++i) {
+        if (ctrl[i] < 0) {
+            continue;
+        }
+        unsigned char *slot = ANV_MAP__SLOT(map, metadata, i);
+        size_t hash = anv_map__hash(metadata, slot);
+        size_t index = anv_map__find_free(new_map, new_metadata, hash);
+        anv_map__set_ctrl(new_map, new_metadata, index, ANV_MAP__H2(hash));
+        memcpy(
+            ANV_MAP__SLOT(new_map, new_metadata, index), slot, metadata->slot_sz
+        );
+    }
+    new_metadata->length = metadata->length;
+    new_metadata->growth_left -= metadata->length;
+
+    anv_meta_free(map);
+    *refmap = new_map;
+    *refmetadata = new_metadata;
+    return ANV_MAP_RESULT_OK;
+}
+
+static anv_map__metadata *
+anv_map__get_metadata(anv_map_t map)
+{
+    if (ANV_MAP__UNLIKELY(!map)) {
+        anv_map__assert(0, "invalid null map");
+        return NULL;
+    }
+    anv_map__metadata *metadata = anv_map__meta_get(map);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        anv_map__assert(0, "cannot find metadata, is map a valid meta obj?");
+        return NULL;
+    }
+    return metadata;
+}
+
+size_t
+anv_map_hash_bytes(const void *key, size_t key_sz)
+{
+    /* murmur3 style mixing of 8 bytes words. */
+    const unsigned char *bytes = key;
+    uint64_t hash = (uint64_t)0x9E3779B97F4A7C15 ^ (uint64_t)key_sz;
+    while (key_sz >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        word *= (uint64_t)0x87C37B91114253D5;
+        word = (word << 31) | (word >> 33);
+        word *= (uint64_t)0x4CF5AD432745937F;
+        hash ^= word;
+        hash = ((hash << 27) | (hash >> 37)) * 5 + 0x52DCE729;
+        bytes += 8;
+        key_sz -= 8;
+    }
+    if (key_sz > 0) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, key_sz);
+        word *= (uint64_t)0x87C37B91114253D5;
+        word = (word << 31) | (word >> 33);
+        word *= (uint64_t)0x4CF5AD432745937F;
+        hash ^= word;
+    }
+    hash ^= hash >> 33;
+    hash *= (uint64_t)0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    hash *= (uint64_t)0xC4CEB9FE1A85EC53;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
+
+anv_map_t
+anv_map_new(size_t capacity, size_t key_sz, size_t value_sz)
+{
+    anv_map_options options = {
+        .capacity = capacity,
+        .key_sz = key_sz,
+        .value_sz = value_sz,
+    };
+    return anv_map_new_with_options(&options);
+}
+
+anv_map_t
+anv_map_new_with_options(const anv_map_options *options)
+{
+    if (ANV_MAP__UNLIKELY(!options)) {
+        anv_map__assert(0, "invalid null options");
+        return NULL;
+    }
+    if (ANV_MAP__UNLIKELY(options->key_sz == 0)) {
+        anv_map__assert(0, "key size cannot be 0");
+        return NULL;
+    }
+    if (ANV_MAP__UNLIKELY(
+            options->key_sz > ANV_MAP__SIZE_MAX / 4
+            || options->value_sz > ANV_MAP__SIZE_MAX / 4
+        )) {
+        anv_map__assert(0, "key or value size too big");
+        return NULL;
+    }
+    size_t slots_count = anv_map__slots_for(options->capacity);
+    if (ANV_MAP__UNLIKELY(slots_count == 0)) {
+        anv_map__assert(0, "capacity too big");
+        return NULL;
+    }
+
+    anv_map__metadata metadata;
+    size_t key_align = anv_map__size_alignment(options->key_sz);
+    size_t value_align = anv_map__size_alignment(options->value_sz);
+    metadata.key_sz = options->key_sz;
+    metadata.value_sz = options->value_sz;
+    metadata.value_offset = ANV_MAP__ROUND_UP(options->key_sz, value_align);
+    metadata.slot_sz = ANV_MAP__ROUND_UP(
+        metadata.value_offset + options->value_sz,
+        key_align > value_align ? key_align : value_align
+    );
+    metadata.hash_fn = options->hash_fn;
+    metadata.equals_fn = options->equals_fn;
+    return anv_map__alloc(&metadata, options->allocator, slots_count);
+}
+
+void
+anv_map_destroy(anv_map_t map)
+{
+    if (map) {
+        anv_meta_free(map);
+    }
+}
+
+size_t
+anv_map_length(anv_map_t map)
+{
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    return metadata ? metadata->length : 0;
+}
+
+size_t
+anv_map_capacity(anv_map_t map)
+{
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    return metadata ? ANV_MAP__MAX_LOAD(metadata->slots_count) : 0;
+}
+
+anv_map_result
+anv_map__reserve(anv_map_t *refmap, size_t capacity)
+{
+    if (ANV_MAP__UNLIKELY(!refmap)) {
+        anv_map__assert(0, "invalid null map");
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+    anv_map__metadata *metadata = anv_map__get_metadata(*refmap);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+    if (capacity <= ANV_MAP__MAX_LOAD(metadata->slots_count)) {
+        return ANV_MAP_RESULT_OK;
+    }
+    size_t slots_count = anv_map__slots_for(capacity);
+    if (ANV_MAP__UNLIKELY(slots_count == 0)) {
+        return ANV_MAP_RESULT_ALLOC_ERROR;
+    }
+    return anv_map__rehash(refmap, &metadata, slots_count);
+}
+
+anv_map_result
+anv_map__put(anv_map_t *refmap, const void *key, const void *value)
+{
+    if (ANV_MAP__UNLIKELY(!refmap || !key)) {
+        anv_map__assert(0, "invalid null params");
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+    anv_map__metadata *metadata = anv_map__get_metadata(*refmap);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+
+    size_t hash = anv_map__hash(metadata, key);
+    size_t index = anv_map__find(*refmap, metadata, key, hash);
+    if (index == ANV_MAP__SIZE_MAX) {
+        index = anv_map__find_free(*refmap, metadata, hash);
+        signed char *ctrl = ANV_MAP__CTRL(*refmap);
+        /* deleted slots can always be reused, empty ones only while the max
+         * load is not reached. */
+        if (ANV_MAP__UNLIKELY(
+                metadata->growth_left == 0 && ctrl[index] == ANV_MAP__CTRL_EMPTY
+            )) {
+            /* plenty of tombstones: rehashing at the same size is enough. */
+            size_t slots_count = metadata->slots_count;
+            if (metadata->length >= ANV_MAP__MAX_LOAD(slots_count) / 2) {
+                if (ANV_MAP__UNLIKELY(slots_count > ANV_MAP__SIZE_MAX / 4)) {
+                    return ANV_MAP_RESULT_ALLOC_ERROR;
+                }
+                slots_count <<= 1;
+            }
+            anv_map_result res
+                = anv_map__rehash(refmap, &metadata, slots_count);
+            if (ANV_MAP__UNLIKELY(res != ANV_MAP_RESULT_OK)) {
+                return res;
+            }
+            index = anv_map__find_free(*refmap, metadata, hash);
+            ctrl = ANV_MAP__CTRL(*refmap);
+        }
+        if (ctrl[index] == ANV_MAP__CTRL_EMPTY) {
+            --metadata->growth_left;
+        }
+        anv_map__set_ctrl(*refmap, metadata, index, ANV_MAP__H2(hash));
+        ++metadata->length;
+        memcpy(ANV_MAP__SLOT(*refmap, metadata, index), key, metadata->key_sz);
+    }
+
+    unsigned char *slot_value
+        = ANV_MAP__SLOT(*refmap, metadata, index) + metadata->value_offset;
+    if (value) {
+        memcpy(slot_value, value, metadata->value_sz);
+    } else {
+        memset(slot_value, 0, metadata->value_sz);
+    }
+    return ANV_MAP_RESULT_OK;
+}
+
+void *
+anv_map_get(anv_map_t map, const void *key)
+{
+    if (ANV_MAP__UNLIKELY(!key)) {
+        anv_map__assert(0, "invalid null key");
+        return NULL;
+    }
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return NULL;
+    }
+    size_t index
+        = anv_map__find(map, metadata, key, anv_map__hash(metadata, key));
+    if (index == ANV_MAP__SIZE_MAX) {
+        return NULL;
+    }
+    return ANV_MAP__SLOT(map, metadata, index) + metadata->value_offset;
+}
+
+int
+anv_map_contains(anv_map_t map, const void *key)
+{
+    return anv_map_get(map, key) != NULL;
+}
+
+anv_map_result
+anv_map_remove(anv_map_t map, const void *key)
+{
+    if (ANV_MAP__UNLIKELY(!key)) {
+        anv_map__assert(0, "invalid null key");
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return ANV_MAP_RESULT_INVALID_PARAMS;
+    }
+    size_t index
+        = anv_map__find(map, metadata, key, anv_map__hash(metadata, key));
+    if (index == ANV_MAP__SIZE_MAX) {
+        return ANV_MAP_RESULT_KEY_NOT_FOUND;
+    }
+
+    /* the slot can go back to empty only if no group without empty slots ever
+     * covered it, i.e. no probe sequence ever went past it. */
+    const signed char *ctrl = ANV_MAP__CTRL(map);
+    size_t mask = metadata->slots_count - 1;
+    size_t full_before = 0;
+    while (full_before < ANV_MAP__GROUP_WIDTH
+           && ctrl[(index - full_before - 1) & mask] != ANV_MAP__CTRL_EMPTY) {
+        ++full_before;
+    }
+    size_t full_after = 0;
+    while (full_before + full_after < ANV_MAP__GROUP_WIDTH
+           && ctrl[(index + full_after + 1) & mask] != ANV_MAP__CTRL_EMPTY) {
+        ++full_after;
+    }
+    if (full_before + full_after + 1 < ANV_MAP__GROUP_WIDTH) {
+        anv_map__set_ctrl(map, metadata, index, ANV_MAP__CTRL_EMPTY);
+        ++metadata->growth_left;
+    } else {
+        anv_map__set_ctrl(map, metadata, index, ANV_MAP__CTRL_DELETED);
+    }
+    --metadata->length;
+    return ANV_MAP_RESULT_OK;
+}
+
+void
+anv_map_clear(anv_map_t map)
+{
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return;
+    }
+    anv_map__reset_ctrl(map, metadata);
+}
+
+int
+anv_map_next(anv_map_t map, size_t *cursor, void **out_key, void **out_value)
+{
+    if (ANV_MAP__UNLIKELY(!cursor)) {
+        anv_map__assert(0, "invalid null cursor");
+        return 0;
+    }
+    anv_map__metadata *metadata = anv_map__get_metadata(map);
+    if (ANV_MAP__UNLIKELY(!metadata)) {
+        return 0;
+    }
+    const signed char *ctrl = ANV_MAP__CTRL(map);
+    for (size_t i = *cursor; i < metadata->slots_count; ++i) {
+        if (ctrl[i] < 0) {
+            continue;
+        }
+        unsigned char *slot = ANV_MAP__SLOT(map, metadata, i);
+        if (out_key) {
+            *out_key = slot;
+        }
+        if (out_value) {
+            *out_value = slot + metadata->value_offset;
+        }
+        *cursor = i + 1;
+        return 1;
+    }
+    *cursor = metadata->slots_count;
+    return 0;
+}
+
+#endif /* ANV_MAP_IMPLEMENTATION */
+
+#endif /* ANV_MAP_H */
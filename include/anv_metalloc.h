@@ -36,18 +36,23 @@ Advantages:
 - minimal overhead during allocations
 
 Drawbacks:
-- allocation size is larger (default min is at least 5+ bytes)
+- allocation size is larger: 14 bytes of header plus the metadata by default
+  on 64 bits systems, 22 with stats or large blocks (see ANV_META_OVERHEAD)
 
 ```
 == brief overview ==
 
 allocated memory block looks like this:
 
-|-----metadata---sc|-------------------data------------------|   ... ->
+|-----metadata-afsc|-------------------data------------------|   ... ->
                  ^ptr points here
 
 where:
-s = stores metadata size (s and c excluded. default max is 256).
+a = allocator the block was allocated with (see anv_meta_allocator).
+  followed by the block data size with ANV_METALLOC_ENABLE_STATS or
+  ANV_METALLOC_ENABLE_LARGE_BLOCKS only.
+f = block flags (e.g. whether the block was allocated aligned).
+s = stores metadata size (a, f, s and c excluded. default max is 256).
   retrieve with anv_meta_getsz()
   see ANV_METALLOC_METASIZE).
 c = check byte (default is 4 bytes).
@@ -55,12 +60,83 @@ c = check byte (default is 4 bytes).
   see CHKB.
 
 to sum it up the default total allocation size is:
-metadata size + metadata size num size + check byte size + memory allocated
-which translates to:
-metadata size + METASZ_SZ + CHKB_SZ + memory allocated   bytes
-...           + 1         + 4       + ...                bytes
+metadata size + allocator + flags + metadata size num size + check byte size +
+memory allocated, which translates to:
+metadata size + ALLOC_SZ + FLAGS_SZ + METASZ_SZ + CHKB_SZ + memory allocated
+...           + 8        + 1        + 1         + 4       + ...     bytes
+
+that is 14 bytes of header on 64 bits systems, 22 with the data size stored
+(stats or large blocks). The compact layout uses 2 bytes for both FLAGS_SZ and
+METASZ_SZ (16 or 24 bytes), then pads the metadata so that data is aligned.
+
+aligned blocks (see anv_meta_malloc_aligned) are shifted forward inside their
+allocation so that data starts on the requested boundary, and their metadata
+is padded as in the compact layout so that it starts on a 16 bytes boundary:
+
+|--pad--|i|-----metadata-p-afsc|-------------------data---------|   ... ->
+
+i = pad and alignment of the block, used to find the real allocation.
+p = metadata padding, up to 15 bytes.
 ```
 
+## Custom allocators
+
+By default memory comes from libc malloc/realloc/free. A custom allocator can be
+set globally with anv_meta_set_default_allocator or used for a single block with
+anv_meta_malloc_with. Each block remembers the allocator it was created with, so
+anv_meta_realloc and anv_meta_free always go through the right one, even after
+the default allocator has been changed.
+
+## Header size options
+
+The metadata size is stored as ANV_METALLOC_METASIZE (unsigned char by default,
+so at most 255 bytes of metadata). Define it to a wider unsigned type before
+including this header to store larger metadata.
+
+Defining ANV_METALLOC_COMPACT switches to a 2 bytes metadata size and 2 bytes
+flags, and pads the header so that data always starts on a
+ANV_METALLOC_COMPACT_ALIGNMENT boundary (16 by default) for blocks coming from
+an allocator with that alignment. Size and flags are always read via memcpy, so
+no header field needs to be naturally aligned.
+
+Despite its name the compact layout does not save space: flags, metadata size
+and check bytes fill the 8 bytes word right before data, aligned with data,
+but stay separate fields and the check bytes keep their full 4 bytes. Its
+header is 16 bytes (24 with the data size), 2 more than the default one, plus
+up to ANV_METALLOC_COMPACT_ALIGNMENT - 1 bytes of padding after the metadata.
+What it buys is aligned data and metadata, and metadata up to 65535 bytes.
+
+The header layout is read inline, so every translation unit must be built
+with the same ANV_METALLOC_COMPACT, ANV_METALLOC_ENABLE_STATS and
+ANV_METALLOC_ENABLE_LARGE_BLOCKS defines: mismatches fail to link.
+
+## Heap statistics
+
+Define ANV_METALLOC_ENABLE_STATS to count every allocation, reallocation and
+release made through metalloc (see anv_meta_stats_snapshot). Blocks then also
+store their data size in the header (one more size_t, see ANV_META_OVERHEAD) so
+that freed bytes can be accounted for. Counters are updated with relaxed
+atomics on GCC/Clang and are only meant to be read as a whole through
+anv_meta_stats_snapshot. Without the define, none of this is compiled in.
+
+## Large blocks
+
+Define ANV_METALLOC_ENABLE_LARGE_BLOCKS to serve blocks of at least
+ANV_METALLOC_LARGE_THRESHOLD bytes of data (16 MiB by default) straight from
+the OS instead of malloc, for blocks using the libc allocator and no alignment.
+Such blocks reserve ANV_METALLOC_LARGE_RESERVE_FACTOR times (16 by default)
+their size of virtual address space, at most ANV_METALLOC_LARGE_RESERVE_MAX
+bytes (64 GiB by default) unless the block itself is bigger, and only commit
+the pages they use, so that anv_meta_realloc grows them in place without
+copying their data, until the reservation is exhausted. Reserving up front
+replaces mremap, which only exists on Linux. Shrinking them gives the unused
+pages back to the OS. Smaller blocks growing past the threshold are moved to a
+reservation once. Blocks also store their data size in the header, as with
+stats. All three knobs can be defined before including the implementation.
+
+Only available on 64 bits POSIX and Windows systems, elsewhere the define does
+nothing.
+
 ## Dependencies
 
 None
@@ -114,6 +190,20 @@ done:
 #define ANV_METALLOC_H
 
 #include <stddef.h> /* for size_t, ptrdiff_t */
+#include <string.h> /* for memcpy() */
+
+#ifdef ANV_METALLOC_COMPACT
+#ifdef ANV_METALLOC_METASIZE
+#error "ANV_METALLOC_COMPACT cannot be used with a custom ANV_METALLOC_METASIZE"
+#endif
+#define ANV_METALLOC_METASIZE unsigned short
+#define ANV_META__FLAGS_T     unsigned short
+#ifndef ANV_METALLOC_COMPACT_ALIGNMENT
+#define ANV_METALLOC_COMPACT_ALIGNMENT 16
+#endif
+#else
+#define ANV_META__FLAGS_T unsigned char
+#endif
 
 #ifndef ANV_METALLOC_METASIZE
 #define ANV_METALLOC_METASIZE unsigned char
@@ -121,6 +211,95 @@ done:
 
 typedef ANV_METALLOC_METASIZE anv_meta_size_t;
 
+/**
+ * Custom memory allocator. Callbacks follow libc malloc/realloc/free semantics
+ * and receive ctx as first param.
+ * @note The allocator object must outlive all the blocks allocated with it.
+ */
+typedef struct anv_meta_allocator {
+    void *(*malloc_fn)(void *ctx, size_t sz);
+    void *(*realloc_fn)(void *ctx, void *mem, size_t new_sz);
+    void (*free_fn)(void *ctx, void *mem);
+    /** User context passed as is to all callbacks. */
+    void *ctx;
+} anv_meta_allocator;
+
+/*
+ * Data size stored in the header of each block, only with stats or large
+ * blocks enabled.
+ */
+#if defined(ANV_METALLOC_ENABLE_STATS)                                         \
+    || defined(ANV_METALLOC_ENABLE_LARGE_BLOCKS)
+#define ANV_META__HAS_DATASZ
+#define ANV_META__DATASZ_SZ sizeof(size_t)
+#else
+#define ANV_META__DATASZ_SZ ((size_t)0)
+#endif
+
+/**
+ * Bytes stored between the metadata and the data: allocator + (data size) +
+ * flags + metadata size + check bytes.
+ */
+#define ANV_META_OVERHEAD                                                      \
+    (sizeof(const anv_meta_allocator *) + ANV_META__DATASZ_SZ                  \
+     + sizeof(ANV_META__FLAGS_T) + sizeof(anv_meta_size_t) + 4)
+
+/*
+ * Padding added after meta_sz bytes of metadata so that data starts aligned,
+ * only used by the compact layout.
+ */
+#ifdef ANV_METALLOC_COMPACT
+#define ANV_META__PADDING(meta_sz)                                             \
+    ((ANV_METALLOC_COMPACT_ALIGNMENT                                           \
+      - ((size_t)(meta_sz) + ANV_META_OVERHEAD)                                \
+            % ANV_METALLOC_COMPACT_ALIGNMENT)                                  \
+     % ANV_METALLOC_COMPACT_ALIGNMENT)
+#else
+#define ANV_META__PADDING(meta_sz) ((size_t)0)
+#endif
+
+/*
+ * Aligned blocks (see anv_meta_malloc_aligned) are aligned on at least
+ * ANV_META__MAX_ALIGN bytes and pad their metadata like the compact layout,
+ * whatever the layout: both data and metadata start aligned.
+ */
+#define ANV_META__MAX_ALIGN    ((size_t)16)
+#define ANV_META__FLAG_ALIGNED 0x01
+#define ANV_META__ALIGNED_PADDING(meta_sz)                                     \
+    ((ANV_META__MAX_ALIGN                                                      \
+      - ((size_t)(meta_sz) + ANV_META_OVERHEAD) % ANV_META__MAX_ALIGN)         \
+     % ANV_META__MAX_ALIGN)
+#define ANV_META__BLOCK_PADDING(meta_sz, flags)                                \
+    (((flags) & ANV_META__FLAG_ALIGNED) ? ANV_META__ALIGNED_PADDING(meta_sz)   \
+                                        : ANV_META__PADDING(meta_sz))
+
+/**
+ * Size of a buffer needed to hold a metallocated object, see
+ * anv_meta_init_buffer.
+ */
+#define ANV_META_BUFFER_SIZE(meta_sz, data_sz)                                 \
+    ((size_t)(meta_sz) + ANV_META__PADDING(meta_sz) + ANV_META_OVERHEAD        \
+     + (size_t)(data_sz))
+
+/*
+ * Relaxed counter updates for the stats of this and the other anv libs, plain
+ * operations without GCC builtins.
+ */
+#ifdef __GNUC__
+#define ANV_META__COUNTER_ADD(var, n)                                          \
+    __atomic_fetch_add(&(var), (n), __ATOMIC_RELAXED)
+#define ANV_META__COUNTER_SUB(var, n)                                          \
+    __atomic_fetch_sub(&(var), (n), __ATOMIC_RELAXED)
+#define ANV_META__COUNTER_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define ANV_META__COUNTER_STORE(var, n)                                        \
+    __atomic_store_n(&(var), (n), __ATOMIC_RELAXED)
+#else
+#define ANV_META__COUNTER_ADD(var, n)   ((var) += (n))
+#define ANV_META__COUNTER_SUB(var, n)   ((var) -= (n))
+#define ANV_META__COUNTER_LOAD(var)     (var)
+#define ANV_META__COUNTER_STORE(var, n) ((var) = (n))
+#endif
+
 /**
  * Metalloc status codes for operations.
  */
@@ -161,6 +340,28 @@ anv_meta_size_t anv_meta_getsz(void *mem);
  */
 void *anv_meta_get(void *mem);
 
+/**
+ * Get metadata for passed memory object without checking its validity.
+ * Meant for hot paths where mem is already known to be a valid metallocated
+ * object: this only reads the metadata size.
+ * @warning Passing NULL or a non metallocated object is undefined behavior.
+ * @param mem Metallocated memory block.
+ * @return Pointer to the metadata.
+ */
+static inline void *
+anv_meta_get_unchecked(void *mem)
+{
+    // Metadata size is stored right before the 4 check bytes, flags right
+    // before it.
+    anv_meta_size_t meta_sz;
+    ANV_META__FLAGS_T flags;
+    unsigned char *meta_sz_at = (unsigned char *)mem - 4 - sizeof(meta_sz);
+    memcpy(&meta_sz, meta_sz_at, sizeof(meta_sz));
+    memcpy(&flags, meta_sz_at - sizeof(flags), sizeof(flags));
+    return (void *)((unsigned char *)mem - ANV_META_OVERHEAD
+                    - ANV_META__BLOCK_PADDING(meta_sz, flags) - meta_sz);
+}
+
 /**
  * Change metadata for passed memory object.
  * @param mem Metallocated memory block.
@@ -174,7 +375,10 @@ anv_meta_result anv_meta_set(void *mem, void *metadata);
  * Get offset between real memory allocated on heap and first data byte after
  * the metadata.
  * @note subtracting this size from mem you get the pointer to the heap object
- *       passed to regular malloc and thus freeable with regular free.
+ *       passed to regular malloc and thus freeable with regular free. Blocks
+ *       from a custom allocator go back to its free_fn instead, and large
+ *       blocks (see ANV_METALLOC_ENABLE_LARGE_BLOCKS) are OS reservations
+ *       which only anv_meta_free can release.
  * @param mem Metallocated memory block.
  */
 ptrdiff_t anv_meta_get_offset(void *mem);
@@ -197,6 +401,62 @@ ptrdiff_t anv_meta_get_offset(void *mem);
  */
 void *anv_meta_malloc(void *metadata, anv_meta_size_t meta_sz, size_t data_sz);
 
+/**
+ * Allocate on the heap a new metallocated object using a specific allocator.
+ * Same as anv_meta_malloc otherwise.
+ * @param allocator Allocator to use, NULL for the default one.
+ */
+void *anv_meta_malloc_with(
+    const anv_meta_allocator *allocator,
+    void *metadata,
+    anv_meta_size_t meta_sz,
+    size_t data_sz
+);
+
+/**
+ * Allocate on the heap a new metallocated object whose data portion starts at
+ * a multiple of alignment bytes (e.g. 32 for AVX loads or 64 for cache lines).
+ * The block keeps its alignment through anv_meta_realloc, all other methods
+ * work as usual. Both data and metadata are aligned on at least 16 bytes.
+ * @note Up to alignment - 1 + 2 * sizeof(size_t) extra bytes are allocated
+ *       (15 if alignment is lower), plus up to 15 bytes of metadata padding.
+ * @param alignment Required data alignment, must be a power of 2.
+ */
+void *anv_meta_malloc_aligned(
+    void *metadata, anv_meta_size_t meta_sz, size_t data_sz, size_t alignment
+);
+
+/**
+ * Same as anv_meta_malloc_aligned using a specific allocator.
+ * @param allocator Allocator to use, NULL for the default one.
+ */
+void *anv_meta_malloc_aligned_with(
+    const anv_meta_allocator *allocator,
+    void *metadata,
+    anv_meta_size_t meta_sz,
+    size_t data_sz,
+    size_t alignment
+);
+
+/**
+ * Create a metallocated object inside a caller owned buffer (e.g. on the
+ * stack) instead of allocating it on the heap.
+ *
+ * The object can be used with all the methods of this lib except for
+ * anv_meta_free and anv_meta_realloc: its memory belongs to the caller.
+ *
+ * @param buffer Memory where to store the object, aligned at least as the
+ *               metadata type.
+ * @param buffer_sz Size of buffer, see ANV_META_BUFFER_SIZE.
+ * @param metadata Optional metadata value to store.
+ * @param meta_sz Size of the metadata value to store. Can not be zero.
+ * @return A pointer to the data portion of the object, NULL if buffer is too
+ *         small to fit the metadata and at least 1 byte of data.
+ */
+void *anv_meta_init_buffer(
+    void *buffer, size_t buffer_sz, void *metadata, anv_meta_size_t meta_sz
+);
+
 /**
  * Free metallocated object memory.
  * @param mem Metallocated memory block, passing NULL is safe and does nothing.
@@ -208,10 +468,116 @@ void anv_meta_free(void *mem);
  * @note This method does not change size of the metadata portion.
  * @param mem Metallocated memory block.
  * @param new_sz New size of the data portion.
- * @return Pointer to data portion if succeeded.
+ * @return Pointer to data portion if succeeded. On failure NULL is returned
+ *         and mem is left untouched: it is still valid and must still be
+ *         freed.
  */
 void *anv_meta_realloc(void *mem, size_t new_sz);
 
+/**
+ * Get the data alignment requested for the passed memory object.
+ * @return 0 if not allocated with anv_meta_malloc_aligned.
+ */
+size_t anv_meta_get_alignment(void *mem);
+
+/**
+ * Get the allocator which allocated the passed memory object.
+ * @return NULL if allocated with libc or stored in a caller owned buffer.
+ */
+const anv_meta_allocator *anv_meta_get_allocator(void *mem);
+
+/**
+ * Change the allocator used by anv_meta_malloc from now on. Blocks already
+ * allocated keep using the allocator they were allocated with.
+ * @warning Not thread-safe, set it once at startup.
+ * @param allocator New default allocator, NULL to restore libc.
+ */
+void anv_meta_set_default_allocator(const anv_meta_allocator *allocator);
+
+/**
+ * Get the allocator currently used by anv_meta_malloc.
+ * @return NULL when using libc.
+ */
+const anv_meta_allocator *anv_meta_get_default_allocator(void);
+
+#ifdef ANV_METALLOC_ENABLE_STATS
+/**
+ * Process wide metalloc counters (see ANV_METALLOC_ENABLE_STATS).
+ * Blocks created with anv_meta_init_buffer are never counted.
+ */
+typedef struct anv_meta_stats {
+    /** Successful anv_meta_malloc* calls. */
+    size_t alloc_count;
+    /** Blocks released by anv_meta_free. */
+    size_t free_count;
+    /** Successful anv_meta_realloc calls. */
+    size_t realloc_count;
+    /** Reallocations which moved the block to a new address. */
+    size_t realloc_moves;
+    /** Failed allocations and reallocations. */
+    size_t failed_count;
+    /** Blocks currently allocated. */
+    size_t live_count;
+    /** Data bytes of the blocks currently allocated, as asked by callers. */
+    size_t live_requested_bytes;
+    /**
+     * Bytes currently allocated from the allocators: data + metadata + header
+     * + alignment padding.
+     */
+    size_t live_allocated_bytes;
+    /** Highest live_allocated_bytes since the last anv_meta_stats_reset. */
+    size_t peak_allocated_bytes;
+    /** Data bytes of all allocations, reallocations count their new size. */
+    size_t total_requested_bytes;
+    /** Allocator bytes of all allocations and reallocations. */
+    size_t total_allocated_bytes;
+} anv_meta_stats;
+
+/**
+ * Copy current counters to out_stats. Counters are read one by one, while
+ * other threads allocate they might not be consistent with each other.
+ */
+void anv_meta_stats_snapshot(anv_meta_stats *out_stats);
+
+/**
+ * Zero all counters but live ones, peak restarts from current live bytes.
+ */
+void anv_meta_stats_reset(void);
+#endif
+
+/*
+ * The block header layout depends on ANV_METALLOC_COMPACT,
+ * ANV_METALLOC_ENABLE_STATS and ANV_METALLOC_ENABLE_LARGE_BLOCKS, read inline
+ * by ANV_META_OVERHEAD and anv_meta_get_unchecked. Every layout has its own
+ * tag symbol, defined by the implementation and referenced by each translation
+ * unit, so that objects built with different defines fail to link instead of
+ * disagreeing on the layout. A custom ANV_METALLOC_METASIZE is not checked.
+ */
+#if defined(ANV_METALLOC_COMPACT) && defined(ANV_META__HAS_DATASZ)
+#define ANV_META__LAYOUT_TAG anv_meta__layout_compact_datasz
+#elif defined(ANV_METALLOC_COMPACT)
+#define ANV_META__LAYOUT_TAG anv_meta__layout_compact
+#elif defined(ANV_META__HAS_DATASZ)
+#define ANV_META__LAYOUT_TAG anv_meta__layout_default_datasz
+#else
+#define ANV_META__LAYOUT_TAG anv_meta__layout_default
+#endif
+
+extern const char ANV_META__LAYOUT_TAG;
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((used)) static const char *const anv_meta__layout_ref
+    = &ANV_META__LAYOUT_TAG;
+#elif defined(_MSC_VER)
+#define ANV_META__STR_(x) #x
+#define ANV_META__STR(x)  ANV_META__STR_(x)
+#ifdef _M_IX86
+#pragma comment(linker, "/include:_" ANV_META__STR(ANV_META__LAYOUT_TAG))
+#else
+#pragma comment(linker, "/include:" ANV_META__STR(ANV_META__LAYOUT_TAG))
+#endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -227,6 +593,33 @@ void *anv_meta_realloc(void *mem, size_t new_sz);
 #define anv_meta__assert(cond, errmsg) assert((cond) && (errmsg))
 #endif
 
+/*
+ * Large blocks need a 64 bits address space to reserve in.
+ */
+#if defined(ANV_METALLOC_ENABLE_LARGE_BLOCKS) && UINTPTR_MAX > 0xffffffffu
+#if defined(_WIN32)
+#define ANV_META__HAS_LARGE
+#include <windows.h> /* for VirtualAlloc(), VirtualFree() */
+#elif defined(__unix__) || defined(__APPLE__)
+#define ANV_META__HAS_LARGE
+#include <fcntl.h> /* for open() */
+#include <sys/mman.h> /* for mmap(), mprotect(), munmap() */
+#include <unistd.h> /* for sysconf(), close() */
+#endif
+#endif
+
+#ifdef ANV_META__HAS_LARGE
+#ifndef ANV_METALLOC_LARGE_THRESHOLD
+#define ANV_METALLOC_LARGE_THRESHOLD ((size_t)16 * 1024 * 1024)
+#endif
+#ifndef ANV_METALLOC_LARGE_RESERVE_FACTOR
+#define ANV_METALLOC_LARGE_RESERVE_FACTOR 16
+#endif
+#ifndef ANV_METALLOC_LARGE_RESERVE_MAX
+#define ANV_METALLOC_LARGE_RESERVE_MAX ((size_t)64 * 1024 * 1024 * 1024)
+#endif
+#endif
+
 #ifdef __GNUC__
 #define ANV_META__LIKELY(x)   __builtin_expect((x), 1)
 #define ANV_META__UNLIKELY(x) __builtin_expect((x), 0)
@@ -239,22 +632,142 @@ typedef uint32_t chkb_t;
 
 #define CHKB ((chkb_t)0x696941469)
 
+typedef ANV_META__FLAGS_T flags_t;
+
+#define ALLOC_SZ  sizeof(const anv_meta_allocator *)
+#define DATASZ_SZ ANV_META__DATASZ_SZ
+#define FLAGS_SZ  sizeof(flags_t)
 #define METASZ_SZ sizeof(anv_meta_size_t)
 #define CHKB_SZ   sizeof(chkb_t)
 
+/* everything between metadata and data */
+#define HEADER_SZ ANV_META_OVERHEAD
+
+/* metadata + its padding, which depends on the block flags */
+#define META_TOTAL_SZ(meta_sz, flags)                                          \
+    ((size_t)(meta_sz) + ANV_META__BLOCK_PADDING(meta_sz, flags))
+
+/* block allocated with anv_meta_malloc_aligned */
+#define FLAG_ALIGNED ((flags_t)ANV_META__FLAG_ALIGNED)
+
+/* alignment actually used for the blocks aligned on alignment bytes */
+#define BLOCK_ALIGNMENT(alignment)                                             \
+    ((alignment) < ANV_META__MAX_ALIGN ? ANV_META__MAX_ALIGN : (alignment))
+
+/* bytes allocated on top of the block to align it, 0 for unaligned blocks */
+#define ALIGN_EXTRA_SZ(alignment)                                              \
+    ((alignment) ? BLOCK_ALIGNMENT(alignment) - 1 + ALIGN_INFO_SZ : 0)
+
+/*
+ * Aligned blocks are shifted forward inside the real allocation by pad bytes.
+ * This info is stored right before the metadata of such blocks.
+ */
+typedef struct anv_meta__align_info {
+    size_t pad;
+    size_t alignment;
+} anv_meta__align_info;
+
+#define ALIGN_INFO_SZ sizeof(anv_meta__align_info)
+
+/* block reserved from the OS, see ANV_METALLOC_ENABLE_LARGE_BLOCKS */
+#define FLAG_LARGE ((flags_t)0x02)
+
+/*
+ * Large blocks start at the beginning of their reservation with this info,
+ * right before the metadata. They are never aligned blocks.
+ */
+typedef struct anv_meta__large_info {
+    size_t reserved_sz;
+    size_t committed_sz;
+} anv_meta__large_info;
+
+#define LARGE_INFO_SZ sizeof(anv_meta__large_info)
+
+const char ANV_META__LAYOUT_TAG = 0;
+
+static const anv_meta_allocator *anv_meta__default_allocator = NULL;
+
+#ifdef ANV_METALLOC_ENABLE_STATS
+static anv_meta_stats anv_meta__stats;
+
+#define ANV_META__STAT_ADD(field, n)                                           \
+    ANV_META__COUNTER_ADD(anv_meta__stats.field, n)
+#define ANV_META__STAT_SUB(field, n)                                           \
+    ANV_META__COUNTER_SUB(anv_meta__stats.field, n)
+#define ANV_META__STAT_LOAD(field) ANV_META__COUNTER_LOAD(anv_meta__stats.field)
+#define ANV_META__STAT_STORE(field, n)                                         \
+    ANV_META__COUNTER_STORE(anv_meta__stats.field, n)
+
+static void
+anv_meta__stats_update_peak(void)
+{
+    size_t live = ANV_META__STAT_LOAD(live_allocated_bytes);
+#ifdef __GNUC__
+    size_t peak = ANV_META__STAT_LOAD(peak_allocated_bytes);
+    while (live > peak
+           && !__atomic_compare_exchange_n(
+               &anv_meta__stats.peak_allocated_bytes,
+               &peak,
+               live,
+               1,
+               __ATOMIC_RELAXED,
+               __ATOMIC_RELAXED
+           )) {
+    }
+#else
+    if (live > anv_meta__stats.peak_allocated_bytes) {
+        anv_meta__stats.peak_allocated_bytes = live;
+    }
+#endif
+}
+
+static void
+anv_meta__stats_add_block(size_t data_sz, size_t full_sz)
+{
+    ANV_META__STAT_ADD(live_count, 1);
+    ANV_META__STAT_ADD(live_requested_bytes, data_sz);
+    ANV_META__STAT_ADD(live_allocated_bytes, full_sz);
+    ANV_META__STAT_ADD(total_requested_bytes, data_sz);
+    ANV_META__STAT_ADD(total_allocated_bytes, full_sz);
+    anv_meta__stats_update_peak();
+}
+
+static void
+anv_meta__stats_remove_block(size_t data_sz, size_t full_sz)
+{
+    ANV_META__STAT_SUB(live_count, 1);
+    ANV_META__STAT_SUB(live_requested_bytes, data_sz);
+    ANV_META__STAT_SUB(live_allocated_bytes, full_sz);
+}
+#endif
+
 int
 anv_meta_isvalid(void *mem)
 {
     if (!mem) {
         return 0;
     }
-    return *(chkb_t *)((size_t)mem - CHKB_SZ) == CHKB ? 1 : 0;
+    chkb_t chkb;
+    memcpy(&chkb, (void *)((size_t)mem - CHKB_SZ), CHKB_SZ);
+    return chkb == CHKB ? 1 : 0;
 }
 
 static anv_meta_size_t
 anv_meta__getsz(void *mem)
 {
-    return *(anv_meta_size_t *)((size_t)mem - METASZ_SZ - CHKB_SZ);
+    anv_meta_size_t meta_sz;
+    memcpy(&meta_sz, (void *)((size_t)mem - METASZ_SZ - CHKB_SZ), METASZ_SZ);
+    return meta_sz;
+}
+
+static flags_t
+anv_meta__getflags(void *mem)
+{
+    flags_t flags;
+    memcpy(
+        &flags, (void *)((size_t)mem - FLAGS_SZ - METASZ_SZ - CHKB_SZ), FLAGS_SZ
+    );
+    return flags;
 }
 
 anv_meta_size_t
@@ -267,6 +780,14 @@ anv_meta_getsz(void *mem)
     return anv_meta__getsz(mem);
 }
 
+static void *
+anv_meta__get(void *mem)
+{
+    size_t meta_total_sz
+        = META_TOTAL_SZ(anv_meta__getsz(mem), anv_meta__getflags(mem));
+    return (void *)((size_t)mem - meta_total_sz - HEADER_SZ);
+}
+
 void *
 anv_meta_get(void *mem)
 {
@@ -274,7 +795,7 @@ anv_meta_get(void *mem)
         anv_meta__assert(0, "not a valid metallocated object");
         return NULL;
     }
-    return (void *)((size_t)mem - anv_meta__getsz(mem) - METASZ_SZ - CHKB_SZ);
+    return anv_meta__get(mem);
 }
 
 static void
@@ -295,17 +816,34 @@ anv_meta_set(void *mem, void *metadata)
         return ANV_META_RESULT_INVALID_PARAMS;
     }
 
-    anv_meta_size_t meta_sz = anv_meta__getsz(mem);
-    void *full_mem = (void *)((size_t)mem - meta_sz - METASZ_SZ - CHKB_SZ);
-
-    anv_meta__set(full_mem, metadata, meta_sz);
+    anv_meta__set(anv_meta__get(mem), metadata, anv_meta__getsz(mem));
     return ANV_META_RESULT_OK;
 }
 
+static anv_meta__align_info
+anv_meta__get_align_info(void *mem)
+{
+    anv_meta__align_info info = { 0, 0 };
+    if (anv_meta__getflags(mem) & FLAG_ALIGNED) {
+        memcpy(
+            &info,
+            (void *)((size_t)anv_meta__get(mem) - ALIGN_INFO_SZ),
+            ALIGN_INFO_SZ
+        );
+    }
+    return info;
+}
+
 static ptrdiff_t
 anv_meta_get__offset(void *mem)
 {
-    return (ptrdiff_t)(anv_meta__getsz(mem) + METASZ_SZ + CHKB_SZ);
+    flags_t flags = anv_meta__getflags(mem);
+    size_t meta_total_sz = META_TOTAL_SZ(anv_meta__getsz(mem), flags);
+    if (flags & FLAG_LARGE) {
+        return (ptrdiff_t)(LARGE_INFO_SZ + meta_total_sz + HEADER_SZ);
+    }
+    return (ptrdiff_t)(anv_meta__get_align_info(mem).pad + meta_total_sz
+                       + HEADER_SZ);
 }
 
 ptrdiff_t
@@ -318,8 +856,296 @@ anv_meta_get_offset(void *mem)
     return anv_meta_get__offset(mem);
 }
 
-void *
-anv_meta_malloc(void *metadata, anv_meta_size_t meta_sz, size_t data_sz)
+static const anv_meta_allocator *
+anv_meta__get_allocator(void *mem)
+{
+    const anv_meta_allocator *allocator;
+    memcpy(&allocator, (void *)((size_t)mem - HEADER_SZ), ALLOC_SZ);
+    return allocator;
+}
+
+#ifdef ANV_META__HAS_DATASZ
+static size_t
+anv_meta__getdatasz(void *mem)
+{
+    size_t data_sz;
+    memcpy(&data_sz, (void *)((size_t)mem - HEADER_SZ + ALLOC_SZ), DATASZ_SZ);
+    return data_sz;
+}
+
+static void
+anv_meta__setdatasz(void *mem, size_t data_sz)
+{
+    memcpy((void *)((size_t)mem - HEADER_SZ + ALLOC_SZ), &data_sz, DATASZ_SZ);
+}
+#endif
+
+static void *
+anv_meta__init(
+    void *meta_mem,
+    const anv_meta_allocator *allocator,
+    flags_t flags,
+    void *metadata,
+    anv_meta_size_t meta_sz
+)
+{
+    anv_meta__set(meta_mem, metadata, meta_sz);
+
+    // Header fields are not aligned (but in compact mode), always access them
+    // through memcpy. The data size (stats only) is set by the callers.
+    size_t header = (size_t)meta_mem + META_TOTAL_SZ(meta_sz, flags);
+    memcpy((void *)header, &allocator, ALLOC_SZ);
+    size_t flags_at = header + ALLOC_SZ + DATASZ_SZ;
+    memcpy((void *)flags_at, &flags, FLAGS_SZ);
+    memcpy((void *)(flags_at + FLAGS_SZ), &meta_sz, METASZ_SZ);
+    chkb_t chkb = CHKB;
+    memcpy((void *)(flags_at + FLAGS_SZ + METASZ_SZ), &chkb, CHKB_SZ);
+    return (void *)(header + HEADER_SZ);
+}
+
+/*
+ * Bytes to skip from full_mem so that data is aligned, always leaves room for
+ * the align info. The metadata padding keeps the metadata aligned as well.
+ */
+static size_t
+anv_meta__align_pad(void *full_mem, size_t meta_sz, size_t alignment)
+{
+    alignment = BLOCK_ALIGNMENT(alignment);
+    size_t data = (size_t)full_mem + ALIGN_INFO_SZ
+        + META_TOTAL_SZ(meta_sz, FLAG_ALIGNED) + HEADER_SZ;
+    return ALIGN_INFO_SZ + (alignment - data % alignment) % alignment;
+}
+
+static void
+anv_meta__set_align_info(void *meta_mem, size_t pad, size_t alignment)
+{
+    anv_meta__align_info info = { pad, alignment };
+    memcpy((void *)((size_t)meta_mem - ALIGN_INFO_SZ), &info, ALIGN_INFO_SZ);
+}
+
+#ifdef ANV_METALLOC_ENABLE_STATS
+/*
+ * Bytes asked to the allocator (or reserved from the OS) for mem.
+ */
+static size_t
+anv_meta__get_full_sz(void *mem)
+{
+    flags_t flags = anv_meta__getflags(mem);
+    size_t extra_sz = ALIGN_EXTRA_SZ(anv_meta__get_align_info(mem).alignment);
+    if (flags & FLAG_LARGE) {
+        extra_sz = LARGE_INFO_SZ;
+    }
+    return anv_meta__getdatasz(mem) + META_TOTAL_SZ(anv_meta__getsz(mem), flags)
+        + HEADER_SZ + extra_sz;
+}
+#endif
+
+#ifdef ANV_META__HAS_LARGE
+static size_t
+anv_meta__page_sz(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    long page_sz = sysconf(_SC_PAGESIZE);
+    return page_sz > 0 ? (size_t)page_sz : 4096;
+#endif
+}
+
+#ifndef _WIN32
+/*
+ * Map sz bytes of inaccessible memory, replacing the pages at addr if not NULL.
+ */
+static void *
+anv_meta__vm_map(void *addr, size_t sz)
+{
+#if defined(MAP_ANONYMOUS)
+    int fd = -1;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#elif defined(MAP_ANON)
+    int fd = -1;
+    int flags = MAP_PRIVATE | MAP_ANON;
+#else
+    // strict ISO C modes hide anonymous mappings.
+    int fd = open("/dev/zero", O_RDWR);
+    if (ANV_META__UNLIKELY(fd < 0)) {
+        return NULL;
+    }
+    int flags = MAP_PRIVATE;
+#endif
+    if (addr) {
+        flags |= MAP_FIXED;
+    }
+    void *mem = mmap(addr, sz, PROT_NONE, flags, fd, 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return mem == MAP_FAILED ? NULL : mem;
+}
+#endif
+
+/*
+ * Reserve sz bytes of address space, no memory is used until committed.
+ */
+static void *
+anv_meta__vm_reserve(size_t sz)
+{
+#ifdef _WIN32
+    return VirtualAlloc(NULL, sz, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    return anv_meta__vm_map(NULL, sz);
+#endif
+}
+
+static int
+anv_meta__vm_commit(void *addr, size_t sz)
+{
+#ifdef _WIN32
+    return VirtualAlloc(addr, sz, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(addr, sz, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+/*
+ * Give pages back to the OS, they stay reserved.
+ */
+static void
+anv_meta__vm_decommit(void *addr, size_t sz)
+{
+#ifdef _WIN32
+    VirtualFree(addr, sz, MEM_DECOMMIT);
+#else
+    anv_meta__vm_map(addr, sz);
+#endif
+}
+
+static void
+anv_meta__vm_release(void *addr, size_t sz)
+{
+#ifdef _WIN32
+    (void)sz;
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munmap(addr, sz);
+#endif
+}
+
+/*
+ * Whole pages needed by a large block, 0 on overflow.
+ */
+static size_t
+anv_meta__large_committed_sz(anv_meta_size_t meta_sz, size_t data_sz)
+{
+    size_t page_sz = anv_meta__page_sz();
+    size_t full_sz
+        = LARGE_INFO_SZ + META_TOTAL_SZ(meta_sz, FLAG_LARGE) + HEADER_SZ;
+    if (ANV_META__UNLIKELY(data_sz > (size_t)-1 - full_sz - page_sz)) {
+        return 0;
+    }
+    full_sz += data_sz;
+    return (full_sz + page_sz - 1) / page_sz * page_sz;
+}
+
+static anv_meta__large_info
+anv_meta__get_large_info(void *mem)
+{
+    anv_meta__large_info info;
+    memcpy(
+        &info,
+        (void *)((size_t)anv_meta__get(mem) - LARGE_INFO_SZ),
+        LARGE_INFO_SZ
+    );
+    return info;
+}
+
+static void *
+anv_meta__large_alloc(void *metadata, anv_meta_size_t meta_sz, size_t data_sz)
+{
+    size_t committed_sz = anv_meta__large_committed_sz(meta_sz, data_sz);
+    if (ANV_META__UNLIKELY(!committed_sz)) {
+        return NULL;
+    }
+    size_t reserved_sz = ANV_METALLOC_LARGE_RESERVE_MAX;
+    if (committed_sz <= (size_t)-1 / ANV_METALLOC_LARGE_RESERVE_FACTOR
+        && committed_sz * ANV_METALLOC_LARGE_RESERVE_FACTOR < reserved_sz) {
+        reserved_sz = committed_sz * ANV_METALLOC_LARGE_RESERVE_FACTOR;
+    }
+    if (reserved_sz < committed_sz) {
+        reserved_sz = committed_sz;
+    }
+    void *full_mem = anv_meta__vm_reserve(reserved_sz);
+    if (!full_mem && reserved_sz != committed_sz) {
+        // out of address space, the block will move on growth.
+        reserved_sz = committed_sz;
+        full_mem = anv_meta__vm_reserve(reserved_sz);
+    }
+    if (ANV_META__UNLIKELY(!full_mem)) {
+        return NULL;
+    }
+    if (ANV_META__UNLIKELY(!anv_meta__vm_commit(full_mem, committed_sz))) {
+        anv_meta__vm_release(full_mem, reserved_sz);
+        return NULL;
+    }
+
+    anv_meta__large_info info = { reserved_sz, committed_sz };
+    memcpy(full_mem, &info, LARGE_INFO_SZ);
+    void *mem = anv_meta__init(
+        (void *)((size_t)full_mem + LARGE_INFO_SZ),
+        NULL,
+        FLAG_LARGE,
+        metadata,
+        meta_sz
+    );
+    anv_meta__setdatasz(mem, data_sz);
+    return mem;
+}
+
+/*
+ * Commit or decommit pages so that a large block fits new_sz bytes of data.
+ * @return 0 if the block does not fit its reservation or pages could not be
+ *         committed, the block is left untouched.
+ */
+static int
+anv_meta__large_resize(void *mem, size_t new_sz)
+{
+    size_t committed_sz
+        = anv_meta__large_committed_sz(anv_meta__getsz(mem), new_sz);
+    anv_meta__large_info info = anv_meta__get_large_info(mem);
+    if (!committed_sz || committed_sz > info.reserved_sz) {
+        return 0;
+    }
+    void *full_mem = (void *)((size_t)anv_meta__get(mem) - LARGE_INFO_SZ);
+    if (committed_sz > info.committed_sz) {
+        if (ANV_META__UNLIKELY(!anv_meta__vm_commit(
+                (void *)((size_t)full_mem + info.committed_sz),
+                committed_sz - info.committed_sz
+            ))) {
+            return 0;
+        }
+    } else if (committed_sz < info.committed_sz) {
+        anv_meta__vm_decommit(
+            (void *)((size_t)full_mem + committed_sz),
+            info.committed_sz - committed_sz
+        );
+    }
+    info.committed_sz = committed_sz;
+    memcpy(full_mem, &info, LARGE_INFO_SZ);
+    anv_meta__setdatasz(mem, new_sz);
+    return 1;
+}
+#endif
+
+static void *
+anv_meta__alloc(
+    const anv_meta_allocator *allocator,
+    void *metadata,
+    anv_meta_size_t meta_sz,
+    size_t data_sz,
+    size_t alignment
+)
 {
     if (ANV_META__UNLIKELY(data_sz <= 0)) {
         anv_meta__assert(0, "trying to allocate 0 bytes is not supported");
@@ -330,16 +1156,148 @@ anv_meta_malloc(void *metadata, anv_meta_size_t meta_sz, size_t data_sz)
         return NULL;
     }
 
-    void *full_mem = malloc(data_sz + meta_sz + METASZ_SZ + CHKB_SZ);
-    if (ANV_META__UNLIKELY(!full_mem)) {
+    if (!allocator) {
+        allocator = anv_meta__default_allocator;
+    }
+
+    flags_t flags = alignment ? FLAG_ALIGNED : 0;
+    size_t extra_sz = ALIGN_EXTRA_SZ(alignment);
+    size_t full_sz
+        = data_sz + META_TOTAL_SZ(meta_sz, flags) + HEADER_SZ + extra_sz;
+    if (ANV_META__UNLIKELY(full_sz < data_sz)) {
         return NULL;
     }
+    void *mem = NULL;
+#ifdef ANV_META__HAS_LARGE
+    // falls back to malloc if the OS refuses the reservation.
+    if (!allocator && !alignment && data_sz >= ANV_METALLOC_LARGE_THRESHOLD) {
+        mem = anv_meta__large_alloc(metadata, meta_sz, data_sz);
+    }
+#endif
+    if (!mem) {
+        void *full_mem = allocator
+            ? allocator->malloc_fn(allocator->ctx, full_sz)
+            : malloc(full_sz);
+        if (ANV_META__UNLIKELY(!full_mem)) {
+#ifdef ANV_METALLOC_ENABLE_STATS
+            ANV_META__STAT_ADD(failed_count, 1);
+#endif
+            return NULL;
+        }
+
+        if (!alignment) {
+            mem = anv_meta__init(full_mem, allocator, 0, metadata, meta_sz);
+        } else {
+            size_t pad = anv_meta__align_pad(full_mem, meta_sz, alignment);
+            void *meta_mem = (void *)((size_t)full_mem + pad);
+            anv_meta__set_align_info(meta_mem, pad, alignment);
+            mem = anv_meta__init(
+                meta_mem, allocator, FLAG_ALIGNED, metadata, meta_sz
+            );
+        }
+#ifdef ANV_META__HAS_DATASZ
+        anv_meta__setdatasz(mem, data_sz);
+#endif
+    }
+#ifdef ANV_METALLOC_ENABLE_STATS
+    ANV_META__STAT_ADD(alloc_count, 1);
+    anv_meta__stats_add_block(data_sz, anv_meta__get_full_sz(mem));
+#endif
+    return mem;
+}
 
-    anv_meta__set(full_mem, metadata, meta_sz);
+void *
+anv_meta_malloc(void *metadata, anv_meta_size_t meta_sz, size_t data_sz)
+{
+    return anv_meta__alloc(NULL, metadata, meta_sz, data_sz, 0);
+}
 
-    *(anv_meta_size_t *)((size_t)full_mem + meta_sz) = meta_sz;
-    *(chkb_t *)((size_t)full_mem + meta_sz + METASZ_SZ) = CHKB;
-    return (void *)((size_t)full_mem + meta_sz + METASZ_SZ + CHKB_SZ);
+void *
+anv_meta_malloc_with(
+    const anv_meta_allocator *allocator,
+    void *metadata,
+    anv_meta_size_t meta_sz,
+    size_t data_sz
+)
+{
+    return anv_meta__alloc(allocator, metadata, meta_sz, data_sz, 0);
+}
+
+void *
+anv_meta_malloc_aligned(
+    void *metadata, anv_meta_size_t meta_sz, size_t data_sz, size_t alignment
+)
+{
+    return anv_meta_malloc_aligned_with(
+        NULL, metadata, meta_sz, data_sz, alignment
+    );
+}
+
+void *
+anv_meta_malloc_aligned_with(
+    const anv_meta_allocator *allocator,
+    void *metadata,
+    anv_meta_size_t meta_sz,
+    size_t data_sz,
+    size_t alignment
+)
+{
+    if (ANV_META__UNLIKELY(alignment == 0 || (alignment & (alignment - 1)))) {
+        anv_meta__assert(0, "alignment must be a power of 2");
+        return NULL;
+    }
+    return anv_meta__alloc(allocator, metadata, meta_sz, data_sz, alignment);
+}
+
+void *
+anv_meta_init_buffer(
+    void *buffer, size_t buffer_sz, void *metadata, anv_meta_size_t meta_sz
+)
+{
+    if (ANV_META__UNLIKELY(!buffer)) {
+        anv_meta__assert(0, "invalid null buffer");
+        return NULL;
+    }
+    if (ANV_META__UNLIKELY(meta_sz <= 0)) {
+        anv_meta__assert(0, "metadata allocation size cannot be 0");
+        return NULL;
+    }
+    if (ANV_META__UNLIKELY(buffer_sz <= ANV_META_BUFFER_SIZE(meta_sz, 0))) {
+        anv_meta__assert(0, "buffer too small for metadata and data");
+        return NULL;
+    }
+
+    void *mem = anv_meta__init(buffer, NULL, 0, metadata, meta_sz);
+#ifdef ANV_META__HAS_DATASZ
+    anv_meta__setdatasz(mem, buffer_sz - ANV_META_BUFFER_SIZE(meta_sz, 0));
+#endif
+    return mem;
+}
+
+static void
+anv_meta__release(const anv_meta_allocator *allocator, void *full_mem)
+{
+    if (allocator) {
+        allocator->free_fn(allocator->ctx, full_mem);
+    } else {
+        free(full_mem);
+    }
+}
+
+static void
+anv_meta__free_block(void *mem)
+{
+#ifdef ANV_META__HAS_LARGE
+    if (anv_meta__getflags(mem) & FLAG_LARGE) {
+        anv_meta__vm_release(
+            (void *)((size_t)anv_meta__get(mem) - LARGE_INFO_SZ),
+            anv_meta__get_large_info(mem).reserved_sz
+        );
+        return;
+    }
+#endif
+    void *full_mem = (void *)((size_t)mem - anv_meta_get__offset(mem));
+    anv_meta__release(anv_meta__get_allocator(mem), full_mem);
 }
 
 void
@@ -349,9 +1307,52 @@ anv_meta_free(void *mem)
         anv_meta__assert(0, "not a valid metallocated object");
         return;
     }
-    free((void *)((size_t)mem - (anv_meta__getsz(mem) + METASZ_SZ + CHKB_SZ)));
+#ifdef ANV_METALLOC_ENABLE_STATS
+    ANV_META__STAT_ADD(free_count, 1);
+    anv_meta__stats_remove_block(
+        anv_meta__getdatasz(mem), anv_meta__get_full_sz(mem)
+    );
+#endif
+    anv_meta__free_block(mem);
 }
 
+#ifdef ANV_META__HAS_LARGE
+/*
+ * Grow or shrink a large block in place, or move mem to a new large block
+ * when it does not fit its reservation (or is not a large block yet).
+ */
+static void *
+anv_meta__large_realloc(void *mem, size_t new_sz)
+{
+#ifdef ANV_METALLOC_ENABLE_STATS
+    size_t old_data_sz = anv_meta__getdatasz(mem);
+    size_t old_full_sz = anv_meta__get_full_sz(mem);
+#endif
+    void *new_mem = mem;
+    if (!(anv_meta__getflags(mem) & FLAG_LARGE)
+        || !anv_meta__large_resize(mem, new_sz)) {
+        new_mem = anv_meta__large_alloc(
+            anv_meta__get(mem), anv_meta__getsz(mem), new_sz
+        );
+        if (ANV_META__UNLIKELY(!new_mem)) {
+            return NULL;
+        }
+        size_t data_sz = anv_meta__getdatasz(mem);
+        memcpy(new_mem, mem, data_sz < new_sz ? data_sz : new_sz);
+        anv_meta__free_block(mem);
+    }
+#ifdef ANV_METALLOC_ENABLE_STATS
+    ANV_META__STAT_ADD(realloc_count, 1);
+    if (new_mem != mem) {
+        ANV_META__STAT_ADD(realloc_moves, 1);
+    }
+    anv_meta__stats_remove_block(old_data_sz, old_full_sz);
+    anv_meta__stats_add_block(new_sz, anv_meta__get_full_sz(new_mem));
+#endif
+    return new_mem;
+}
+#endif
+
 void *
 anv_meta_realloc(void *mem, size_t new_sz)
 {
@@ -364,17 +1365,155 @@ anv_meta_realloc(void *mem, size_t new_sz)
     void *full_mem = (void *)((size_t)mem - padd);
 
     anv_meta_size_t meta_sz = anv_meta__getsz(mem);
+    anv_meta__align_info info = anv_meta__get_align_info(mem);
+    const anv_meta_allocator *allocator = anv_meta__get_allocator(mem);
+
+#ifdef ANV_META__HAS_LARGE
+    flags_t flags = anv_meta__getflags(mem);
+    if ((flags & FLAG_LARGE)
+        || (!allocator && !info.alignment
+            && new_sz >= ANV_METALLOC_LARGE_THRESHOLD)) {
+        void *large_mem = anv_meta__large_realloc(mem, new_sz);
+        // libc blocks can still be grown by realloc.
+        if (large_mem || (flags & FLAG_LARGE)) {
+#ifdef ANV_METALLOC_ENABLE_STATS
+            if (!large_mem) {
+                ANV_META__STAT_ADD(failed_count, 1);
+            }
+#endif
+            return large_mem;
+        }
+    }
+#endif
 
-    void *reallocated_mem
-        = realloc(full_mem, new_sz + meta_sz + METASZ_SZ + CHKB_SZ);
+    flags_t block_flags = info.alignment ? FLAG_ALIGNED : 0;
+    size_t meta_total_sz = META_TOTAL_SZ(meta_sz, block_flags);
+    size_t extra_sz = ALIGN_EXTRA_SZ(info.alignment);
+    size_t full_sz = new_sz + meta_total_sz + HEADER_SZ + extra_sz;
+    if (ANV_META__UNLIKELY(full_sz < new_sz)) {
+        return NULL;
+    }
+#ifdef ANV_METALLOC_ENABLE_STATS
+    size_t old_data_sz = anv_meta__getdatasz(mem);
+    size_t old_full_sz = anv_meta__get_full_sz(mem);
+#endif
+    void *reallocated_mem = allocator
+        ? allocator->realloc_fn(allocator->ctx, full_mem, full_sz)
+        : realloc(full_mem, full_sz);
+    // the original block is still valid, leave it to the caller.
     if (ANV_META__UNLIKELY(!reallocated_mem)) {
-        free(full_mem);
+#ifdef ANV_METALLOC_ENABLE_STATS
+        ANV_META__STAT_ADD(failed_count, 1);
+#endif
         return NULL;
     }
+#ifdef ANV_METALLOC_ENABLE_STATS
+    ANV_META__STAT_ADD(realloc_count, 1);
+    if (reallocated_mem != full_mem) {
+        ANV_META__STAT_ADD(realloc_moves, 1);
+    }
+    anv_meta__stats_remove_block(old_data_sz, old_full_sz);
+    anv_meta__stats_add_block(new_sz, full_sz);
+#endif
+
+    if (!info.alignment) {
+        void *new_mem = (void *)((size_t)reallocated_mem + padd);
+#ifdef ANV_META__HAS_DATASZ
+        anv_meta__setdatasz(new_mem, new_sz);
+#endif
+        return new_mem;
+    }
 
-    return (void *)((size_t)reallocated_mem + padd);
+    // The new block may start at a different alignment: move metadata and
+    // data to the right spot. Both ranges always fit inside the new block.
+    size_t pad = anv_meta__align_pad(reallocated_mem, meta_sz, info.alignment);
+    void *meta_mem = (void *)((size_t)reallocated_mem + pad);
+    if (pad != info.pad) {
+        memmove(
+            meta_mem,
+            (void *)((size_t)reallocated_mem + info.pad),
+            meta_total_sz + HEADER_SZ + new_sz
+        );
+    }
+    anv_meta__set_align_info(meta_mem, pad, info.alignment);
+    void *new_mem = (void *)((size_t)meta_mem + meta_total_sz + HEADER_SZ);
+#ifdef ANV_META__HAS_DATASZ
+    anv_meta__setdatasz(new_mem, new_sz);
+#endif
+    return new_mem;
+}
+
+size_t
+anv_meta_get_alignment(void *mem)
+{
+    if (ANV_META__UNLIKELY(!anv_meta_isvalid(mem))) {
+        anv_meta__assert(0, "not a valid metallocated object");
+        return 0;
+    }
+    return anv_meta__get_align_info(mem).alignment;
 }
 
+const anv_meta_allocator *
+anv_meta_get_allocator(void *mem)
+{
+    if (ANV_META__UNLIKELY(!anv_meta_isvalid(mem))) {
+        anv_meta__assert(0, "not a valid metallocated object");
+        return NULL;
+    }
+    return anv_meta__get_allocator(mem);
+}
+
+void
+anv_meta_set_default_allocator(const anv_meta_allocator *allocator)
+{
+    anv_meta__default_allocator = allocator;
+}
+
+const anv_meta_allocator *
+anv_meta_get_default_allocator(void)
+{
+    return anv_meta__default_allocator;
+}
+
+#ifdef ANV_METALLOC_ENABLE_STATS
+void
+anv_meta_stats_snapshot(anv_meta_stats *out_stats)
+{
+    if (ANV_META__UNLIKELY(!out_stats)) {
+        anv_meta__assert(0, "invalid null stats");
+        return;
+    }
+    out_stats->alloc_count = ANV_META__STAT_LOAD(alloc_count);
+    out_stats->free_count = ANV_META__STAT_LOAD(free_count);
+    out_stats->realloc_count = ANV_META__STAT_LOAD(realloc_count);
+    out_stats->realloc_moves = ANV_META__STAT_LOAD(realloc_moves);
+    out_stats->failed_count = ANV_META__STAT_LOAD(failed_count);
+    out_stats->live_count = ANV_META__STAT_LOAD(live_count);
+    out_stats->live_requested_bytes = ANV_META__STAT_LOAD(live_requested_bytes);
+    out_stats->live_allocated_bytes = ANV_META__STAT_LOAD(live_allocated_bytes);
+    out_stats->peak_allocated_bytes = ANV_META__STAT_LOAD(peak_allocated_bytes);
+    out_stats->total_requested_bytes
+        = ANV_META__STAT_LOAD(total_requested_bytes);
+    out_stats->total_allocated_bytes
+        = ANV_META__STAT_LOAD(total_allocated_bytes);
+}
+
+void
+anv_meta_stats_reset(void)
+{
+    ANV_META__STAT_STORE(alloc_count, 0);
+    ANV_META__STAT_STORE(free_count, 0);
+    ANV_META__STAT_STORE(realloc_count, 0);
+    ANV_META__STAT_STORE(realloc_moves, 0);
+    ANV_META__STAT_STORE(failed_count, 0);
+    ANV_META__STAT_STORE(total_requested_bytes, 0);
+    ANV_META__STAT_STORE(total_allocated_bytes, 0);
+    ANV_META__STAT_STORE(
+        peak_allocated_bytes, ANV_META__STAT_LOAD(live_allocated_bytes)
+    );
+}
+#endif
+
 #endif /* ANV_METALLOC_IMPLEMENTATION */
 
 #endif /* ANV_METALLOC_H */
@@ -0,0 +1,1051 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_pool (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_pool
+
+Slab allocator for lots of small, same sized objects.
+
+Requested sizes are rounded up to a size class (16 bytes up to
+ANV_POOL_MAX_SIZE). Objects of the same class are carved out of the same
+ANV_POOL_SLAB_SIZE aligned slabs, so alloc and free are O(1) and objects
+allocated together stay close in memory.
+
+```
+== brief overview ==
+
+ thread 1              thread 2
+|loaded|previous|     |loaded|previous|     <- per thread magazines, no locks
+     \     /               \     /
+      \   /                 \   /
+   |full mags|empty mags|free list|slab|    <- per class depot, locked
+```
+
+Each thread caches freed objects in two magazines (small stacks of pointers)
+per size class, most allocs and frees only touch these. When both are
+empty/full a whole magazine is exchanged with the shared depot of the class in
+a single locked operation. New objects are carved from the current slab of the
+class once the depot runs dry.
+
+Sizes above ANV_POOL_MAX_SIZE are forwarded to malloc/realloc with a small
+header in front of the block (about 48 bytes), so growing them is a plain
+realloc which may happen in place.
+
+## Threads
+
+By default a pool is meant to be used by a single thread. Define
+ANV_POOL_ENABLE_THREADS before including the implementation to make pools
+thread safe (requires POSIX threads, link with -pthread). Threads get their
+magazines lazily on first use and give them back to the depot on exit, or
+earlier with anv_pool_thread_release.
+
+## Allocator hooks
+
+- anv_pool_allocator: anv_meta_allocator backed by the pool, use with
+  anv_meta_malloc_with or as anv_arr_options.allocator.
+- anv_pool_halloc_realloc: matches halloc's h_realloc_t, set it as
+  halloc_allocator after anv_pool_set_halloc_pool and before the first halloc
+  allocation.
+
+## Dependencies
+
+- anv_metalloc.h (only for anv_meta_allocator)
+
+## Include usage
+
+```c
+// only if metalloc define is not already present somewhere else.
+#define ANV_METALLOC_IMPLEMENTATION
+
+#define ANV_POOL_ENABLE_THREADS // optional
+#define ANV_POOL_IMPLEMENTATION
+#include "anv_pool.h"
+```
+
+## Examples
+
+### halloc nodes from a pool
+
+```c
+anv_pool *pool = anv_pool_new();
+anv_pool_set_halloc_pool(pool);
+halloc_allocator = anv_pool_halloc_realloc;
+
+char *root = h_malloc(32);
+hattach(h_strdup("child"), root);
+h_free(root);
+
+anv_pool_destroy(pool);
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_POOL_H
+#define ANV_POOL_H
+
+#include <stddef.h> /* for size_t */
+
+#include "anv_metalloc.h"
+
+/**
+ * Size in bytes of each slab, must be a power of 2.
+ */
+#ifndef ANV_POOL_SLAB_SIZE
+#define ANV_POOL_SLAB_SIZE (64 * 1024)
+#endif
+
+/**
+ * Number of objects cached by each magazine.
+ */
+#ifndef ANV_POOL_MAGAZINE_SIZE
+#define ANV_POOL_MAGAZINE_SIZE 32
+#endif
+
+/**
+ * Biggest size served from slabs, bigger allocations use malloc with a small
+ * header.
+ */
+#define ANV_POOL_MAX_SIZE 1024
+
+/**
+ * Opaque pool object.
+ */
+typedef struct anv_pool anv_pool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a new empty pool.
+ * @return New pool, NULL on internal alloc errors.
+ */
+anv_pool *anv_pool_new(void);
+
+/**
+ * Free the pool and all memory allocated from it.
+ * @warning No other thread must be using the pool anymore.
+ * @param pool Pool to destroy, NULL is a no-op.
+ */
+void anv_pool_destroy(anv_pool *pool);
+
+/**
+ * Allocate sz bytes aligned to 16 bytes.
+ * @param pool Pool to allocate from.
+ * @param sz Size in bytes, always > 0.
+ * @return New memory, NULL on invalid params or internal alloc errors.
+ */
+void *anv_pool_alloc(anv_pool *pool, size_t sz);
+
+/**
+ * Give memory back to the pool.
+ * @param pool Pool mem was allocated from.
+ * @param mem Memory to free, NULL is a no-op.
+ */
+void anv_pool_free(anv_pool *pool, void *mem);
+
+/**
+ * Resize memory allocated from the pool, libc realloc semantics.
+ * @param pool Pool mem was allocated from.
+ * @param mem Memory to resize, NULL behaves like anv_pool_alloc.
+ * @param new_sz New size in bytes, always > 0.
+ * @return Resized memory, NULL on invalid params or internal alloc errors. On
+ *         errors mem is left untouched.
+ */
+void *anv_pool_realloc(anv_pool *pool, void *mem, size_t new_sz);
+
+/**
+ * Get the number of usable bytes of a block, i.e. its size class.
+ * @param mem Memory allocated from a pool.
+ */
+size_t anv_pool_usable_size(void *mem);
+
+/**
+ * Give the magazines cached by the calling thread back to the pool's depot.
+ * Threads do this automatically on exit, call it before destroying a pool
+ * still known to long lived threads. No-op without ANV_POOL_ENABLE_THREADS.
+ * @param pool Pool to release.
+ */
+void anv_pool_thread_release(anv_pool *pool);
+
+/**
+ * Get a metalloc allocator backed by the pool, valid as long as the pool.
+ * @param pool Pool to allocate from.
+ */
+const anv_meta_allocator *anv_pool_allocator(anv_pool *pool);
+
+/**
+ * Set the pool used by anv_pool_halloc_realloc.
+ * @param pool Pool to use.
+ */
+void anv_pool_set_halloc_pool(anv_pool *pool);
+
+/**
+ * halloc_allocator compatible callback allocating from the pool set with
+ * anv_pool_set_halloc_pool. A 0 len frees ptr.
+ */
+void *anv_pool_halloc_realloc(void *ptr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_POOL_IMPLEMENTATION
+
+#include <stdlib.h> /* for malloc(), free() */
+#include <string.h> /* for memcpy() */
+
+#ifdef ANV_POOL_ENABLE_THREADS
+#include <pthread.h>
+#endif
+
+#ifndef anv_pool__assert
+#include <assert.h>
+#define anv_pool__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_POOL__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_POOL__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_POOL__LIKELY(x)   (x)
+#define ANV_POOL__UNLIKELY(x) (x)
+#endif
+
+#ifdef ANV_POOL_ENABLE_THREADS
+#define ANV_POOL__MUTEX                pthread_mutex_t
+#define ANV_POOL__MUTEX_INIT(mutex)    pthread_mutex_init((mutex), NULL)
+#define ANV_POOL__MUTEX_DESTROY(mutex) pthread_mutex_destroy((mutex))
+#define ANV_POOL__LOCK(mutex)          pthread_mutex_lock((mutex))
+#define ANV_POOL__UNLOCK(mutex)        pthread_mutex_unlock((mutex))
+#else
+#define ANV_POOL__MUTEX                char
+#define ANV_POOL__MUTEX_INIT(mutex)    ((void)(mutex))
+#define ANV_POOL__MUTEX_DESTROY(mutex) ((void)(mutex))
+#define ANV_POOL__LOCK(mutex)          ((void)(mutex))
+#define ANV_POOL__UNLOCK(mutex)        ((void)(mutex))
+#endif
+
+#define ANV_POOL__SIZE_MAX      ((size_t)-1)
+#define ANV_POOL__ALIGNMENT     16
+#define ANV_POOL__REGION_SLABS  8
+#define ANV_POOL__CLASSES_COUNT 20
+
+#define ANV_POOL__ALIGN_UP(x, alignment)                                       \
+    (((x) + (alignment) - 1) & ~((size_t)(alignment) - 1))
+
+static const size_t anv_pool__class_sizes[ANV_POOL__CLASSES_COUNT] = {
+    16,  32,  48,  64,  80,  96,  112, 128, 160, 192,
+    224, 256, 320, 384, 448, 512, 640, 768, 896, 1024,
+};
+
+/*
+ * Header at the start of every slab, found by masking the address of any of
+ * its objects.
+ */
+typedef struct anv_pool__slab {
+    anv_pool *pool;
+    size_t class_idx;
+    size_t block_sz;
+    /* Right before the first object, never a valid large block tag. */
+    size_t guard;
+} anv_pool__slab;
+
+/*
+ * Header right before every big allocation.
+ */
+typedef struct anv_pool__large {
+    struct anv_pool__large *prev;
+    struct anv_pool__large *next;
+    anv_pool *pool;
+    size_t block_sz;
+    /* Real malloc'd pointer, the block is aligned past the header. */
+    void *raw;
+    /* Header address ^ ANV_POOL__LARGE_MAGIC, last so it touches the block. */
+    size_t tag;
+} anv_pool__large;
+
+#define ANV_POOL__LARGE_MAGIC ((size_t)0x5a3c96a5e1d2b487ull)
+
+#define ANV_POOL__LARGE_EXTRA                                                  \
+    (sizeof(anv_pool__large) + ANV_POOL__ALIGNMENT - 1)
+
+#define ANV_POOL__SLAB_HEADER_SZ                                               \
+    ANV_POOL__ALIGN_UP(sizeof(anv_pool__slab), ANV_POOL__ALIGNMENT)
+
+#define ANV_POOL__CLASS_OF(pool, sz)                                           \
+    ((size_t)(pool)->class_of[((sz) + ANV_POOL__ALIGNMENT - 1)                 \
+                              / ANV_POOL__ALIGNMENT])
+
+#define ANV_POOL__SLAB_OF(mem)                                                 \
+    ((anv_pool__slab *)((size_t)(mem) & ~((size_t)ANV_POOL_SLAB_SIZE - 1)))
+
+#define ANV_POOL__LARGE_OF(mem) ((anv_pool__large *)(mem) - 1)
+
+/*
+ * The word before a slab object is either the slab guard or the end of the
+ * previous object, which would have to hold this exact tag to be mistaken for
+ * a big block.
+ */
+#define ANV_POOL__IS_LARGE(mem)                                                \
+    (ANV_POOL__LARGE_OF(mem)->tag                                              \
+     == ((size_t)ANV_POOL__LARGE_OF(mem) ^ ANV_POOL__LARGE_MAGIC))
+
+typedef struct anv_pool__magazine {
+    /* Depot stack link. */
+    struct anv_pool__magazine *next;
+    /* All magazines of a pool, freed on destroy. */
+    struct anv_pool__magazine *all_next;
+    size_t count;
+    void *items[ANV_POOL_MAGAZINE_SIZE];
+} anv_pool__magazine;
+
+typedef struct anv_pool__depot {
+    ANV_POOL__MUTEX lock;
+    anv_pool__magazine *full;
+    anv_pool__magazine *empty;
+    /* Objects freed when no magazine could be allocated. */
+    void *free_list;
+    /* Slab objects are currently carved from. */
+    anv_pool__slab *slab;
+    size_t slab_offset;
+} anv_pool__depot;
+
+typedef struct anv_pool__cache {
+    anv_pool *pool;
+    struct anv_pool__cache *next;
+    anv_pool__magazine *loaded[ANV_POOL__CLASSES_COUNT];
+    anv_pool__magazine *previous[ANV_POOL__CLASSES_COUNT];
+} anv_pool__cache;
+
+typedef struct anv_pool__region {
+    struct anv_pool__region *next;
+    void *raw;
+} anv_pool__region;
+
+struct anv_pool {
+    anv_pool__depot depots[ANV_POOL__CLASSES_COUNT];
+    unsigned char class_of[ANV_POOL_MAX_SIZE / ANV_POOL__ALIGNMENT + 1];
+    /* Everything below is protected by lock. */
+    ANV_POOL__MUTEX lock;
+    anv_pool__region *regions;
+    unsigned char *next_slab;
+    size_t slabs_left;
+    anv_pool__magazine *magazines;
+    anv_pool__large *large;
+    anv_meta_allocator allocator;
+#ifdef ANV_POOL_ENABLE_THREADS
+    pthread_key_t cache_key;
+    anv_pool__cache *caches;
+#else
+    anv_pool__cache cache;
+#endif
+};
+
+static anv_pool *anv_pool__halloc_pool = NULL;
+
+static void *
+anv_pool__meta_malloc(void *ctx, size_t sz)
+{
+    return anv_pool_alloc((anv_pool *)ctx, sz);
+}
+
+static void *
+anv_pool__meta_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    return anv_pool_realloc((anv_pool *)ctx, mem, new_sz);
+}
+
+static void
+anv_pool__meta_free(void *ctx, void *mem)
+{
+    anv_pool_free((anv_pool *)ctx, mem);
+}
+
+/*
+ * Take a new slab from the current region, allocating a new region when
+ * needed.
+ */
+static anv_pool__slab *
+anv_pool__new_slab(anv_pool *pool)
+{
+    ANV_POOL__LOCK(&pool->lock);
+    if (!pool->slabs_left) {
+        anv_pool__region *region
+            = (anv_pool__region *)malloc(sizeof(anv_pool__region));
+        void *raw = malloc(
+            ANV_POOL__REGION_SLABS * ANV_POOL_SLAB_SIZE + ANV_POOL_SLAB_SIZE - 1
+        );
+        if (ANV_POOL__UNLIKELY(!region || !raw)) {
+            ANV_POOL__UNLOCK(&pool->lock);
+            free(region);
+            free(raw);
+            return NULL;
+        }
+        region->raw = raw;
+        region->next = pool->regions;
+        pool->regions = region;
+        pool->next_slab = (unsigned char *)ANV_POOL__ALIGN_UP(
+            (size_t)raw, ANV_POOL_SLAB_SIZE
+        );
+        pool->slabs_left = ANV_POOL__REGION_SLABS;
+    }
+    anv_pool__slab *slab = (anv_pool__slab *)pool->next_slab;
+    pool->next_slab += ANV_POOL_SLAB_SIZE;
+    --pool->slabs_left;
+    ANV_POOL__UNLOCK(&pool->lock);
+    return slab;
+}
+
+static anv_pool__magazine *
+anv_pool__new_magazine(anv_pool *pool)
+{
+    anv_pool__magazine *mag
+        = (anv_pool__magazine *)malloc(sizeof(anv_pool__magazine));
+    if (ANV_POOL__UNLIKELY(!mag)) {
+        return NULL;
+    }
+    mag->next = NULL;
+    mag->count = 0;
+    ANV_POOL__LOCK(&pool->lock);
+    mag->all_next = pool->magazines;
+    pool->magazines = mag;
+    ANV_POOL__UNLOCK(&pool->lock);
+    return mag;
+}
+
+/*
+ * Get an empty magazine from depot or allocate a new one.
+ * @note depot must be locked.
+ */
+static anv_pool__magazine *
+anv_pool__empty_magazine(anv_pool *pool, anv_pool__depot *depot)
+{
+    anv_pool__magazine *mag = depot->empty;
+    if (mag) {
+        depot->empty = mag->next;
+        return mag;
+    }
+    return anv_pool__new_magazine(pool);
+}
+
+/*
+ * Carve a new object of class class_idx.
+ * @note depot must be locked.
+ */
+static void *
+anv_pool__carve(anv_pool *pool, anv_pool__depot *depot, size_t class_idx)
+{
+    size_t block_sz = anv_pool__class_sizes[class_idx];
+    if (!depot->slab || depot->slab_offset + block_sz > ANV_POOL_SLAB_SIZE) {
+        anv_pool__slab *slab = anv_pool__new_slab(pool);
+        if (ANV_POOL__UNLIKELY(!slab)) {
+            return NULL;
+        }
+        slab->pool = pool;
+        slab->class_idx = class_idx;
+        slab->block_sz = block_sz;
+        slab->guard = 0;
+        depot->slab = slab;
+        depot->slab_offset = ANV_POOL__SLAB_HEADER_SZ;
+    }
+    void *mem = (unsigned char *)depot->slab + depot->slab_offset;
+    depot->slab_offset += block_sz;
+    return mem;
+}
+
+/*
+ * Fill mag with free objects, first from the depot free list and then from
+ * slabs.
+ * @note depot must be locked.
+ */
+static void
+anv_pool__refill(
+    anv_pool *pool,
+    anv_pool__depot *depot,
+    anv_pool__magazine *mag,
+    size_t class_idx
+)
+{
+    while (mag->count < ANV_POOL_MAGAZINE_SIZE && depot->free_list) {
+        void *mem = depot->free_list;
+        depot->free_list = *(void **)mem;
+        mag->items[mag->count++] = mem;
+    }
+    while (mag->count < ANV_POOL_MAGAZINE_SIZE) {
+        void *mem = anv_pool__carve(pool, depot, class_idx);
+        if (ANV_POOL__UNLIKELY(!mem)) {
+            return;
+        }
+        mag->items[mag->count++] = mem;
+    }
+}
+
+#ifdef ANV_POOL_ENABLE_THREADS
+
+/*
+ * Give a thread's magazines back to the depots.
+ */
+static void
+anv_pool__cache_drain(anv_pool__cache *cache)
+{
+    anv_pool *pool = cache->pool;
+    for (size_t i = 0; i < ANV_POOL__CLASSES_COUNT; ++i) {
+        anv_pool__depot *depot = &pool->depots[i];
+        anv_pool__magazine *mags[2] = { cache->loaded[i], cache->previous[i] };
+        ANV_POOL__LOCK(&depot->lock);
+        for (size_t j = 0; j < 2; ++j) {
+            if (!mags[j]) {
+                continue;
+            }
+            // partially filled magazines go with the full ones: allocs use
+            // their count anyway.
+            anv_pool__magazine **stack
+                = mags[j]->count ? &depot->full : &depot->empty;
+            mags[j]->next = *stack;
+            *stack = mags[j];
+        }
+        ANV_POOL__UNLOCK(&depot->lock);
+        cache->loaded[i] = NULL;
+        cache->previous[i] = NULL;
+    }
+}
+
+static void
+anv_pool__cache_release(void *ctx)
+{
+    anv_pool__cache *cache = (anv_pool__cache *)ctx;
+    anv_pool *pool = cache->pool;
+    anv_pool__cache_drain(cache);
+    ANV_POOL__LOCK(&pool->lock);
+    anv_pool__cache **it = &pool->caches;
+    while (*it != cache) {
+        it = &(*it)->next;
+    }
+    *it = cache->next;
+    ANV_POOL__UNLOCK(&pool->lock);
+    free(cache);
+}
+
+static anv_pool__cache *
+anv_pool__new_cache(anv_pool *pool)
+{
+    anv_pool__cache *cache
+        = (anv_pool__cache *)calloc(1, sizeof(anv_pool__cache));
+    if (ANV_POOL__UNLIKELY(!cache)) {
+        return NULL;
+    }
+    cache->pool = pool;
+    if (ANV_POOL__UNLIKELY(pthread_setspecific(pool->cache_key, cache) != 0)) {
+        free(cache);
+        return NULL;
+    }
+    ANV_POOL__LOCK(&pool->lock);
+    cache->next = pool->caches;
+    pool->caches = cache;
+    ANV_POOL__UNLOCK(&pool->lock);
+    return cache;
+}
+
+static anv_pool__cache *
+anv_pool__get_cache(anv_pool *pool)
+{
+    anv_pool__cache *cache
+        = (anv_pool__cache *)pthread_getspecific(pool->cache_key);
+    if (ANV_POOL__LIKELY(cache != NULL)) {
+        return cache;
+    }
+    return anv_pool__new_cache(pool);
+}
+
+#else
+
+#define anv_pool__get_cache(pool) (&(pool)->cache)
+
+#endif /* ANV_POOL_ENABLE_THREADS */
+
+/*
+ * Make sure cache has both magazines for class_idx.
+ */
+static int
+anv_pool__cache_ready(
+    anv_pool *pool, anv_pool__cache *cache, size_t class_idx
+)
+{
+    if (ANV_POOL__LIKELY(cache->loaded[class_idx] != NULL)) {
+        return 1;
+    }
+    anv_pool__depot *depot = &pool->depots[class_idx];
+    ANV_POOL__LOCK(&depot->lock);
+    anv_pool__magazine *loaded = anv_pool__empty_magazine(pool, depot);
+    anv_pool__magazine *previous = anv_pool__empty_magazine(pool, depot);
+    if (ANV_POOL__UNLIKELY(!loaded || !previous)) {
+        // keep whatever we got for later.
+        for (size_t i = 0; i < 2; ++i) {
+            anv_pool__magazine *mag = i ? previous : loaded;
+            if (mag) {
+                mag->next = depot->empty;
+                depot->empty = mag;
+            }
+        }
+        ANV_POOL__UNLOCK(&depot->lock);
+        return 0;
+    }
+    ANV_POOL__UNLOCK(&depot->lock);
+    cache->loaded[class_idx] = loaded;
+    cache->previous[class_idx] = previous;
+    return 1;
+}
+
+static void *
+anv_pool__alloc_slow(anv_pool *pool, anv_pool__cache *cache, size_t class_idx)
+{
+    if (ANV_POOL__UNLIKELY(!anv_pool__cache_ready(pool, cache, class_idx))) {
+        return NULL;
+    }
+    anv_pool__magazine *loaded = cache->loaded[class_idx];
+    anv_pool__magazine *previous = cache->previous[class_idx];
+    if (loaded->count) {
+        return loaded->items[--loaded->count];
+    }
+    if (previous->count) {
+        cache->loaded[class_idx] = previous;
+        cache->previous[class_idx] = loaded;
+        return previous->items[--previous->count];
+    }
+
+    // both empty: trade one for a full magazine or refill it.
+    anv_pool__depot *depot = &pool->depots[class_idx];
+    ANV_POOL__LOCK(&depot->lock);
+    if (depot->full) {
+        anv_pool__magazine *full = depot->full;
+        depot->full = full->next;
+        previous->next = depot->empty;
+        depot->empty = previous;
+        cache->previous[class_idx] = loaded;
+        cache->loaded[class_idx] = loaded = full;
+    } else {
+        anv_pool__refill(pool, depot, loaded, class_idx);
+    }
+    ANV_POOL__UNLOCK(&depot->lock);
+    if (ANV_POOL__UNLIKELY(!loaded->count)) {
+        return NULL;
+    }
+    return loaded->items[--loaded->count];
+}
+
+static void
+anv_pool__free_slow(
+    anv_pool *pool, anv_pool__cache *cache, size_t class_idx, void *mem
+)
+{
+    anv_pool__depot *depot = &pool->depots[class_idx];
+    if (ANV_POOL__LIKELY(
+            cache && anv_pool__cache_ready(pool, cache, class_idx)
+        )) {
+        anv_pool__magazine *loaded = cache->loaded[class_idx];
+        anv_pool__magazine *previous = cache->previous[class_idx];
+        if (loaded->count < ANV_POOL_MAGAZINE_SIZE) {
+            loaded->items[loaded->count++] = mem;
+            return;
+        }
+        if (previous->count == 0) {
+            cache->loaded[class_idx] = previous;
+            cache->previous[class_idx] = loaded;
+            previous->items[previous->count++] = mem;
+            return;
+        }
+
+        // both full: trade one for an empty magazine.
+        ANV_POOL__LOCK(&depot->lock);
+        anv_pool__magazine *empty = anv_pool__empty_magazine(pool, depot);
+        if (ANV_POOL__LIKELY(empty != NULL)) {
+            previous->next = depot->full;
+            depot->full = previous;
+            cache->previous[class_idx] = loaded;
+            cache->loaded[class_idx] = empty;
+            empty->items[empty->count++] = mem;
+            ANV_POOL__UNLOCK(&depot->lock);
+            return;
+        }
+        ANV_POOL__UNLOCK(&depot->lock);
+    }
+
+    // out of memory for magazines, the depot free list always works.
+    ANV_POOL__LOCK(&depot->lock);
+    *(void **)mem = depot->free_list;
+    depot->free_list = mem;
+    ANV_POOL__UNLOCK(&depot->lock);
+}
+
+static void
+anv_pool__push_large(anv_pool *pool, anv_pool__large *large)
+{
+    large->tag = (size_t)large ^ ANV_POOL__LARGE_MAGIC;
+    large->prev = NULL;
+    ANV_POOL__LOCK(&pool->lock);
+    large->next = pool->large;
+    if (pool->large) {
+        pool->large->prev = large;
+    }
+    pool->large = large;
+    ANV_POOL__UNLOCK(&pool->lock);
+}
+
+/*
+ * Write the header of a big block allocated at raw and link it to the pool.
+ */
+static void *
+anv_pool__link_large(anv_pool *pool, void *raw, size_t sz)
+{
+    unsigned char *mem = (unsigned char *)ANV_POOL__ALIGN_UP(
+        (size_t)raw + sizeof(anv_pool__large), ANV_POOL__ALIGNMENT
+    );
+    anv_pool__large *large = ANV_POOL__LARGE_OF(mem);
+    large->pool = pool;
+    large->block_sz = sz;
+    large->raw = raw;
+    anv_pool__push_large(pool, large);
+    return mem;
+}
+
+static void
+anv_pool__unlink_large(anv_pool *pool, anv_pool__large *large)
+{
+    ANV_POOL__LOCK(&pool->lock);
+    if (large->prev) {
+        large->prev->next = large->next;
+    } else {
+        pool->large = large->next;
+    }
+    if (large->next) {
+        large->next->prev = large->prev;
+    }
+    ANV_POOL__UNLOCK(&pool->lock);
+    // stale pointers must not look like big blocks.
+    large->tag = 0;
+}
+
+static void *
+anv_pool__alloc_large(anv_pool *pool, size_t sz)
+{
+    if (ANV_POOL__UNLIKELY(sz > ANV_POOL__SIZE_MAX - ANV_POOL__LARGE_EXTRA)) {
+        return NULL;
+    }
+    void *raw = malloc(sz + ANV_POOL__LARGE_EXTRA);
+    if (ANV_POOL__UNLIKELY(!raw)) {
+        return NULL;
+    }
+    return anv_pool__link_large(pool, raw, sz);
+}
+
+static void
+anv_pool__free_large(anv_pool *pool, anv_pool__large *large)
+{
+    anv_pool__unlink_large(pool, large);
+    free(large->raw);
+}
+
+/*
+ * Grow or shrink a big block with realloc, the block is moved only when
+ * realloc moves it or changes its alignment.
+ */
+static void *
+anv_pool__realloc_large(anv_pool *pool, void *mem, size_t new_sz)
+{
+    if (ANV_POOL__UNLIKELY(new_sz > ANV_POOL__SIZE_MAX - ANV_POOL__LARGE_EXTRA)
+    ) {
+        return NULL;
+    }
+    anv_pool__large *large = ANV_POOL__LARGE_OF(mem);
+    size_t old_sz = large->block_sz;
+    size_t offset = (size_t)mem - (size_t)large->raw;
+    anv_pool__unlink_large(pool, large);
+    void *new_raw = realloc(large->raw, new_sz + ANV_POOL__LARGE_EXTRA);
+    if (ANV_POOL__UNLIKELY(!new_raw)) {
+        // the old block is still valid.
+        anv_pool__push_large(pool, large);
+        return NULL;
+    }
+    size_t new_offset = ANV_POOL__ALIGN_UP(
+                            (size_t)new_raw + sizeof(anv_pool__large),
+                            ANV_POOL__ALIGNMENT
+                        )
+                      - (size_t)new_raw;
+    if (new_offset != offset) {
+        // before linking, the new header may overlap the old data.
+        memmove(
+            (unsigned char *)new_raw + new_offset,
+            (unsigned char *)new_raw + offset,
+            new_sz < old_sz ? new_sz : old_sz
+        );
+    }
+    unsigned char *new_mem = anv_pool__link_large(pool, new_raw, new_sz);
+    return new_mem;
+}
+
+anv_pool *
+anv_pool_new(void)
+{
+    anv_pool *pool = (anv_pool *)calloc(1, sizeof(anv_pool));
+    if (ANV_POOL__UNLIKELY(!pool)) {
+        return NULL;
+    }
+#ifdef ANV_POOL_ENABLE_THREADS
+    if (ANV_POOL__UNLIKELY(
+            pthread_key_create(&pool->cache_key, anv_pool__cache_release) != 0
+        )) {
+        free(pool);
+        return NULL;
+    }
+#else
+    pool->cache.pool = pool;
+#endif
+    ANV_POOL__MUTEX_INIT(&pool->lock);
+    for (size_t i = 0; i < ANV_POOL__CLASSES_COUNT; ++i) {
+        ANV_POOL__MUTEX_INIT(&pool->depots[i].lock);
+    }
+    size_t class_idx = 0;
+    for (size_t i = 0; i < sizeof(pool->class_of); ++i) {
+        while (anv_pool__class_sizes[class_idx] < i * ANV_POOL__ALIGNMENT) {
+            ++class_idx;
+        }
+        pool->class_of[i] = (unsigned char)class_idx;
+    }
+    pool->allocator.malloc_fn = anv_pool__meta_malloc;
+    pool->allocator.realloc_fn = anv_pool__meta_realloc;
+    pool->allocator.free_fn = anv_pool__meta_free;
+    pool->allocator.ctx = pool;
+    return pool;
+}
+
+void
+anv_pool_destroy(anv_pool *pool)
+{
+    if (!pool) {
+        return;
+    }
+#ifdef ANV_POOL_ENABLE_THREADS
+    pthread_key_delete(pool->cache_key);
+    anv_pool__cache *cache = pool->caches;
+    while (cache) {
+        anv_pool__cache *next = cache->next;
+        free(cache);
+        cache = next;
+    }
+#endif
+    anv_pool__magazine *mag = pool->magazines;
+    while (mag) {
+        anv_pool__magazine *next = mag->all_next;
+        free(mag);
+        mag = next;
+    }
+    anv_pool__region *region = pool->regions;
+    while (region) {
+        anv_pool__region *next = region->next;
+        free(region->raw);
+        free(region);
+        region = next;
+    }
+    anv_pool__large *large = pool->large;
+    while (large) {
+        anv_pool__large *next = large->next;
+        free(large->raw);
+        large = next;
+    }
+    for (size_t i = 0; i < ANV_POOL__CLASSES_COUNT; ++i) {
+        ANV_POOL__MUTEX_DESTROY(&pool->depots[i].lock);
+    }
+    ANV_POOL__MUTEX_DESTROY(&pool->lock);
+    if (anv_pool__halloc_pool == pool) {
+        anv_pool__halloc_pool = NULL;
+    }
+    free(pool);
+}
+
+void *
+anv_pool_alloc(anv_pool *pool, size_t sz)
+{
+    if (ANV_POOL__UNLIKELY(!pool)) {
+        anv_pool__assert(0, "invalid null pool");
+        return NULL;
+    }
+    if (ANV_POOL__UNLIKELY(sz == 0)) {
+        anv_pool__assert(0, "trying to allocate 0 bytes is not supported");
+        return NULL;
+    }
+    if (ANV_POOL__UNLIKELY(sz > ANV_POOL_MAX_SIZE)) {
+        return anv_pool__alloc_large(pool, sz);
+    }
+
+    size_t class_idx = ANV_POOL__CLASS_OF(pool, sz);
+    anv_pool__cache *cache = anv_pool__get_cache(pool);
+    if (ANV_POOL__UNLIKELY(!cache)) {
+        return NULL;
+    }
+    anv_pool__magazine *mag = cache->loaded[class_idx];
+    if (ANV_POOL__LIKELY(mag && mag->count)) {
+        return mag->items[--mag->count];
+    }
+    return anv_pool__alloc_slow(pool, cache, class_idx);
+}
+
+void
+anv_pool_free(anv_pool *pool, void *mem)
+{
+    if (!mem) {
+        return;
+    }
+    if (ANV_POOL__UNLIKELY(ANV_POOL__IS_LARGE(mem))) {
+        anv_pool__large *large = ANV_POOL__LARGE_OF(mem);
+        if (ANV_POOL__UNLIKELY(!pool || large->pool != pool)) {
+            anv_pool__assert(0, "memory not allocated from this pool");
+            return;
+        }
+        anv_pool__free_large(pool, large);
+        return;
+    }
+    anv_pool__slab *slab = ANV_POOL__SLAB_OF(mem);
+    if (ANV_POOL__UNLIKELY(!pool || slab->pool != pool)) {
+        anv_pool__assert(0, "memory not allocated from this pool");
+        return;
+    }
+
+    size_t class_idx = slab->class_idx;
+    anv_pool__cache *cache = anv_pool__get_cache(pool);
+    anv_pool__magazine *mag = cache ? cache->loaded[class_idx] : NULL;
+    if (ANV_POOL__LIKELY(mag && mag->count < ANV_POOL_MAGAZINE_SIZE)) {
+        mag->items[mag->count++] = mem;
+        return;
+    }
+    anv_pool__free_slow(pool, cache, class_idx, mem);
+}
+
+void *
+anv_pool_realloc(anv_pool *pool, void *mem, size_t new_sz)
+{
+    if (!mem) {
+        return anv_pool_alloc(pool, new_sz);
+    }
+    if (ANV_POOL__UNLIKELY(new_sz == 0)) {
+        anv_pool__assert(0, "trying to allocate 0 bytes is not supported");
+        return NULL;
+    }
+    size_t old_sz;
+    if (ANV_POOL__IS_LARGE(mem)) {
+        anv_pool__large *large = ANV_POOL__LARGE_OF(mem);
+        if (ANV_POOL__UNLIKELY(!pool || large->pool != pool)) {
+            anv_pool__assert(0, "memory not allocated from this pool");
+            return NULL;
+        }
+        old_sz = large->block_sz;
+        if (new_sz > ANV_POOL_MAX_SIZE) {
+            if (new_sz <= old_sz) {
+                return mem;
+            }
+            return anv_pool__realloc_large(pool, mem, new_sz);
+        }
+    } else {
+        anv_pool__slab *slab = ANV_POOL__SLAB_OF(mem);
+        if (ANV_POOL__UNLIKELY(!pool || slab->pool != pool)) {
+            anv_pool__assert(0, "memory not allocated from this pool");
+            return NULL;
+        }
+        old_sz = slab->block_sz;
+        if (new_sz <= ANV_POOL_MAX_SIZE
+            && ANV_POOL__CLASS_OF(pool, new_sz) == slab->class_idx) {
+            return mem;
+        }
+    }
+    void *new_mem = anv_pool_alloc(pool, new_sz);
+    if (ANV_POOL__UNLIKELY(!new_mem)) {
+        return NULL;
+    }
+    memcpy(new_mem, mem, new_sz < old_sz ? new_sz : old_sz);
+    anv_pool_free(pool, mem);
+    return new_mem;
+}
+
+size_t
+anv_pool_usable_size(void *mem)
+{
+    if (ANV_POOL__UNLIKELY(!mem)) {
+        anv_pool__assert(0, "invalid null mem");
+        return 0;
+    }
+    if (ANV_POOL__IS_LARGE(mem)) {
+        return ANV_POOL__LARGE_OF(mem)->block_sz;
+    }
+    return ANV_POOL__SLAB_OF(mem)->block_sz;
+}
+
+void
+anv_pool_thread_release(anv_pool *pool)
+{
+    if (ANV_POOL__UNLIKELY(!pool)) {
+        anv_pool__assert(0, "invalid null pool");
+        return;
+    }
+#ifdef ANV_POOL_ENABLE_THREADS
+    anv_pool__cache *cache
+        = (anv_pool__cache *)pthread_getspecific(pool->cache_key);
+    if (cache) {
+        pthread_setspecific(pool->cache_key, NULL);
+        anv_pool__cache_release(cache);
+    }
+#endif
+}
+
+const anv_meta_allocator *
+anv_pool_allocator(anv_pool *pool)
+{
+    if (ANV_POOL__UNLIKELY(!pool)) {
+        anv_pool__assert(0, "invalid null pool");
+        return NULL;
+    }
+    return &pool->allocator;
+}
+
+void
+anv_pool_set_halloc_pool(anv_pool *pool)
+{
+    anv_pool__halloc_pool = pool;
+}
+
+void *
+anv_pool_halloc_realloc(void *ptr, size_t len)
+{
+    if (!len) {
+        anv_pool_free(anv_pool__halloc_pool, ptr);
+        return NULL;
+    }
+    return anv_pool_realloc(anv_pool__halloc_pool, ptr, len);
+}
+
+#endif /* ANV_POOL_IMPLEMENTATION */
+
+#endif /* ANV_POOL_H */
@@ -0,0 +1,711 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_ring (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_ring
+
+Bounded lock-free ring buffer queues of fixed size items.
+
+Like anv_arr, items are plain bytes of item_sz size copied in and out with
+memcpy. Capacity is fixed at creation and always rounded up to a power of 2.
+
+Two variants are available, chosen with anv_ring_new:
+
+- ANV_RING_SPSC: exactly one producer thread and one consumer thread. Pushing
+  and popping are a couple of loads and one release store, no atomic
+  read-modify-write is ever performed.
+- ANV_RING_MPMC: any number of producers and consumers. Each slot carries a
+  sequence number (D. Vyukov's bounded queue) so threads only contend on a
+  single compare-and-swap of the head or tail index.
+
+```
+== brief overview ==
+
+|-metadata-|--producer line--|--consumer line--|-slot0-|-slot1-|...|-slotN-|
+                 ^tail              ^head
+```
+
+Producer and consumer indexes live on separate cache lines (see
+ANV_RING_CACHE_LINE_SIZE) so the two sides never invalidate each other's line
+unless they actually need to know about the other side's progress.
+
+anv_ring_push_n and anv_ring_pop_n move as many items as possible with a single
+index update, which is much cheaper than repeated single item calls under
+contention.
+
+## Requirements
+
+GCC/clang atomic builtins or MSVC on x86/x64.
+
+## Dependencies
+
+- anv_metalloc.h
+
+## Include usage
+
+```c
+// only if metalloc define is not already present somewhere else.
+#define ANV_METALLOC_IMPLEMENTATION
+
+#define ANV_RING_IMPLEMENTATION
+#include "anv_ring.h"
+```
+
+## Examples
+
+### Producer/consumer
+
+```c
+anv_ring_t ring = anv_ring_new(ANV_RING_SPSC, 1024, sizeof(job_t));
+
+// producer thread
+while (anv_ring_push(ring, &job) == ANV_RING_RESULT_FULL) {
+    // wait or do something else.
+}
+
+// consumer thread
+job_t jobs[32];
+size_t count = anv_ring_pop_n(ring, jobs, 32);
+for (size_t i = 0; i < count; ++i) {
+    run_job(&jobs[i]);
+}
+
+anv_ring_destroy(ring);
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_RING_H
+#define ANV_RING_H
+
+#include <stddef.h> /* for size_t */
+
+#include "anv_metalloc.h"
+
+/**
+ * Size in bytes of a cache line, producer and consumer indexes are kept this
+ * far apart.
+ */
+#ifndef ANV_RING_CACHE_LINE_SIZE
+#define ANV_RING_CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * Queue variant.
+ */
+typedef enum anv_ring_kind {
+    /**
+     * Single producer, single consumer.
+     */
+    ANV_RING_SPSC = 0,
+    /**
+     * Multiple producers, multiple consumers.
+     */
+    ANV_RING_MPMC = 1,
+} anv_ring_kind;
+
+typedef enum anv_ring_result {
+    /**
+     * Operation succeeded.
+     */
+    ANV_RING_RESULT_OK = 0,
+    /**
+     * Invalid params have been passed to method.
+     * @note With debug asserts enabled, these errors always trigger an assert.
+     */
+    ANV_RING_RESULT_INVALID_PARAMS = 1,
+    /**
+     * The ring has no free slot left.
+     */
+    ANV_RING_RESULT_FULL = 10,
+    /**
+     * The ring has no item to pop.
+     */
+    ANV_RING_RESULT_EMPTY = 11,
+} anv_ring_result;
+
+/**
+ * Convenience alias to better recognize an anv ring from a regular void *ptr;
+ */
+typedef void *anv_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a new ring.
+ * @param kind Queue variant, see anv_ring_kind.
+ * @param capacity Min number of items the ring can hold, rounded up to a power
+ *                 of 2 (at least 2).
+ * @param item_sz Size in bytes of a single item.
+ * @return New ring, NULL on invalid params or internal alloc errors.
+ */
+anv_ring_t anv_ring_new(anv_ring_kind kind, size_t capacity, size_t item_sz);
+
+/**
+ * Destroy a ring. No thread must be using it anymore.
+ * @param ring Ring to destroy, NULL is a no-op.
+ */
+void anv_ring_destroy(anv_ring_t ring);
+
+/**
+ * @return Ring variant.
+ */
+anv_ring_kind anv_ring_kind_of(anv_ring_t ring);
+
+/**
+ * @return Max number of items the ring can hold, 0 on invalid params.
+ */
+size_t anv_ring_capacity(anv_ring_t ring);
+
+/**
+ * @return Size in bytes of a single item, 0 on invalid params.
+ */
+size_t anv_ring_item_sz(anv_ring_t ring);
+
+/**
+ * Number of items currently in the ring.
+ * @note Only a snapshot when other threads are pushing or popping.
+ */
+size_t anv_ring_length(anv_ring_t ring);
+
+/**
+ * Copy item at the end of the ring.
+ * @param item Pointer to item_sz bytes.
+ * @return ANV_RING_RESULT_OK, ANV_RING_RESULT_FULL or invalid params.
+ */
+anv_ring_result anv_ring_push(anv_ring_t ring, const void *item);
+
+/**
+ * Copy the first item of the ring to out_item and remove it.
+ * @param out_item Pointer to item_sz writable bytes.
+ * @return ANV_RING_RESULT_OK, ANV_RING_RESULT_EMPTY or invalid params.
+ */
+anv_ring_result anv_ring_pop(anv_ring_t ring, void *out_item);
+
+/**
+ * Copy up to count contiguous items at the end of the ring, in order.
+ * @param items Array of count items.
+ * @return Number of items pushed, 0 when full or on invalid params.
+ */
+size_t anv_ring_push_n(anv_ring_t ring, const void *items, size_t count);
+
+/**
+ * Move up to count items from the start of the ring to out_items, in order.
+ * @param out_items Array with room for count items.
+ * @return Number of items popped, 0 when empty or on invalid params.
+ */
+size_t anv_ring_pop_n(anv_ring_t ring, void *out_items, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_RING_IMPLEMENTATION
+
+#include <string.h> /* for memcpy() */
+
+#ifndef anv_ring__assert
+#include <assert.h>
+#define anv_ring__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_RING__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_RING__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_RING__LIKELY(x)   (x)
+#define ANV_RING__UNLIKELY(x) (x)
+#endif
+
+#define ANV_RING__SIZE_MAX ((size_t)-1)
+
+/*
+ * Atomic operations on size_t indexes.
+ */
+#if defined(__GNUC__)
+#define ANV_RING__LOAD_RELAXED(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define ANV_RING__LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ANV_RING__STORE_RELEASE(ptr, val)                                      \
+    __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define ANV_RING__CAS(ptr, expected, desired)                                  \
+    __atomic_compare_exchange_n(                                               \
+        (ptr), (expected), (desired), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED    \
+    )
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+/* x86 is TSO: plain volatile accesses plus compiler barriers are enough. */
+static __forceinline size_t
+anv_ring__load(size_t *ptr)
+{
+    size_t val = *(volatile size_t *)ptr;
+    _ReadWriteBarrier();
+    return val;
+}
+
+static __forceinline void
+anv_ring__store(size_t *ptr, size_t val)
+{
+    _ReadWriteBarrier();
+    *(volatile size_t *)ptr = val;
+}
+
+static __forceinline int
+anv_ring__cas(size_t *ptr, size_t *expected, size_t desired)
+{
+#ifdef _M_X64
+    size_t prev = (size_t)_InterlockedCompareExchange64(
+        (volatile __int64 *)ptr, (__int64)desired, (__int64)*expected
+    );
+#else
+    size_t prev = (size_t)_InterlockedCompareExchange(
+        (volatile long *)ptr, (long)desired, (long)*expected
+    );
+#endif
+    if (prev == *expected) {
+        return 1;
+    }
+    *expected = prev;
+    return 0;
+}
+#define ANV_RING__LOAD_RELAXED(ptr)       anv_ring__load(ptr)
+#define ANV_RING__LOAD_ACQUIRE(ptr)       anv_ring__load(ptr)
+#define ANV_RING__STORE_RELEASE(ptr, val) anv_ring__store((ptr), (val))
+#define ANV_RING__CAS(ptr, expected, desired)                                  \
+    anv_ring__cas((ptr), (expected), (desired))
+#else
+#error "anv_ring: atomic operations not available for this compiler"
+#endif
+
+typedef struct anv_ring__metadata {
+    anv_ring_kind kind;
+    size_t item_sz;
+    size_t capacity;
+    /* capacity - 1 */
+    size_t mask;
+    /* item_sz for SPSC, sequence number + item_sz (padded) for MPMC. */
+    size_t slot_sz;
+} anv_ring__metadata;
+
+/*
+ * Indexes owned by one side of the ring. For SPSC cached holds the last seen
+ * index of the other side, so it is only reloaded when the ring looks full
+ * (or empty).
+ */
+typedef struct anv_ring__line {
+    size_t index;
+    size_t cached;
+    char padding[ANV_RING_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+} anv_ring__line;
+
+#define ANV_RING__PRODUCER(ring) ((anv_ring__line *)(ring))
+#define ANV_RING__CONSUMER(ring) ((anv_ring__line *)(ring) + 1)
+#define ANV_RING__SLOTS(ring)                                                  \
+    ((unsigned char *)(ring) + 2 * sizeof(anv_ring__line))
+
+/* MPMC slots: sequence number followed by the item bytes. */
+#define ANV_RING__SLOT(ring, metadata, pos)                                    \
+    (ANV_RING__SLOTS(ring) + ((pos) & (metadata)->mask) * (metadata)->slot_sz)
+#define ANV_RING__SLOT_SEQ(slot)  ((size_t *)(slot))
+#define ANV_RING__SLOT_ITEM(slot) ((slot) + sizeof(size_t))
+
+anv_ring_t
+anv_ring_new(anv_ring_kind kind, size_t capacity, size_t item_sz)
+{
+    if (ANV_RING__UNLIKELY(kind != ANV_RING_SPSC && kind != ANV_RING_MPMC)) {
+        anv_ring__assert(0, "invalid ring kind");
+        return NULL;
+    }
+    if (ANV_RING__UNLIKELY(item_sz == 0)) {
+        anv_ring__assert(0, "invalid item_sz == 0");
+        return NULL;
+    }
+    if (ANV_RING__UNLIKELY(capacity > (ANV_RING__SIZE_MAX >> 1) + 1)) {
+        anv_ring__assert(0, "invalid capacity too big");
+        return NULL;
+    }
+
+    anv_ring__metadata metadata;
+    metadata.kind = kind;
+    metadata.item_sz = item_sz;
+    metadata.capacity = 2;
+    while (metadata.capacity < capacity) {
+        metadata.capacity <<= 1;
+    }
+    metadata.mask = metadata.capacity - 1;
+    if (kind == ANV_RING_SPSC) {
+        metadata.slot_sz = item_sz;
+    } else {
+        if (ANV_RING__UNLIKELY(
+                item_sz > ANV_RING__SIZE_MAX - 2 * sizeof(size_t)
+            )) {
+            return NULL;
+        }
+        metadata.slot_sz = (sizeof(size_t) + item_sz + sizeof(size_t) - 1)
+                         / sizeof(size_t) * sizeof(size_t);
+    }
+    if (ANV_RING__UNLIKELY(
+            metadata.slot_sz
+            > (ANV_RING__SIZE_MAX - 2 * sizeof(anv_ring__line))
+                  / metadata.capacity
+        )) {
+        return NULL;
+    }
+
+    anv_ring_t ring = anv_meta_malloc_aligned(
+        &metadata,
+        sizeof(anv_ring__metadata),
+        2 * sizeof(anv_ring__line) + metadata.capacity * metadata.slot_sz,
+        ANV_RING_CACHE_LINE_SIZE
+    );
+    if (ANV_RING__UNLIKELY(!ring)) {
+        return NULL;
+    }
+
+    memset(ring, 0, 2 * sizeof(anv_ring__line));
+    if (kind == ANV_RING_MPMC) {
+        for (size_t i = 0; i < metadata.capacity; ++i) {
+            *ANV_RING__SLOT_SEQ(ANV_RING__SLOT(ring, &metadata, i)) = i;
+        }
+    }
+    return ring;
+}
+
+void
+anv_ring_destroy(anv_ring_t ring)
+{
+    if (ring) {
+        anv_meta_free(ring);
+    }
+}
+
+static anv_ring__metadata *
+anv_ring__get_metadata(anv_ring_t ring)
+{
+    if (ANV_RING__UNLIKELY(!ring)) {
+        anv_ring__assert(0, "invalid null ring");
+        return NULL;
+    }
+    anv_ring__metadata *metadata = anv_meta_get(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        anv_ring__assert(0, "invalid ring");
+        return NULL;
+    }
+    return metadata;
+}
+
+anv_ring_kind
+anv_ring_kind_of(anv_ring_t ring)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    return metadata ? metadata->kind : ANV_RING_SPSC;
+}
+
+size_t
+anv_ring_capacity(anv_ring_t ring)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    return metadata ? metadata->capacity : 0;
+}
+
+size_t
+anv_ring_item_sz(anv_ring_t ring)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    return metadata ? metadata->item_sz : 0;
+}
+
+size_t
+anv_ring_length(anv_ring_t ring)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        return 0;
+    }
+    size_t head = ANV_RING__LOAD_ACQUIRE(&ANV_RING__CONSUMER(ring)->index);
+    size_t tail = ANV_RING__LOAD_ACQUIRE(&ANV_RING__PRODUCER(ring)->index);
+    /* head is loaded first and never overtakes tail, but more items may have
+     * been pushed and popped in between. */
+    size_t length = tail - head;
+    return length > metadata->capacity ? metadata->capacity : length;
+}
+
+/*
+ * Copy count items between the contiguous array items and the ring slots
+ * starting at pos, handling the wrap around.
+ */
+static void
+anv_ring__spsc_copy(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    size_t pos,
+    unsigned char *items,
+    size_t count,
+    int to_ring
+)
+{
+    size_t start = pos & metadata->mask;
+    size_t first = metadata->capacity - start;
+    if (first > count) {
+        first = count;
+    }
+    unsigned char *slots = ANV_RING__SLOTS(ring);
+    if (to_ring) {
+        memcpy(slots + start * metadata->item_sz, items,
+               first * metadata->item_sz);
+        memcpy(slots, items + first * metadata->item_sz,
+               (count - first) * metadata->item_sz);
+    } else {
+        memcpy(items, slots + start * metadata->item_sz,
+               first * metadata->item_sz);
+        memcpy(items + first * metadata->item_sz, slots,
+               (count - first) * metadata->item_sz);
+    }
+}
+
+static size_t
+anv_ring__spsc_push_n(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    const void *items,
+    size_t count
+)
+{
+    anv_ring__line *producer = ANV_RING__PRODUCER(ring);
+    size_t tail = ANV_RING__LOAD_RELAXED(&producer->index);
+    size_t free_slots = metadata->capacity - (tail - producer->cached);
+    if (free_slots < count) {
+        producer->cached
+            = ANV_RING__LOAD_ACQUIRE(&ANV_RING__CONSUMER(ring)->index);
+        free_slots = metadata->capacity - (tail - producer->cached);
+        if (free_slots < count) {
+            count = free_slots;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    anv_ring__spsc_copy(ring, metadata, tail, (unsigned char *)items, count, 1);
+    ANV_RING__STORE_RELEASE(&producer->index, tail + count);
+    return count;
+}
+
+static size_t
+anv_ring__spsc_pop_n(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    void *out_items,
+    size_t count
+)
+{
+    anv_ring__line *consumer = ANV_RING__CONSUMER(ring);
+    size_t head = ANV_RING__LOAD_RELAXED(&consumer->index);
+    size_t available = consumer->cached - head;
+    if (available < count) {
+        consumer->cached
+            = ANV_RING__LOAD_ACQUIRE(&ANV_RING__PRODUCER(ring)->index);
+        available = consumer->cached - head;
+        if (available < count) {
+            count = available;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    anv_ring__spsc_copy(ring, metadata, head, out_items, count, 0);
+    ANV_RING__STORE_RELEASE(&consumer->index, head + count);
+    return count;
+}
+
+/*
+ * Claim up to count (> 0) contiguous slots from line. A slot at pos is ready when its
+ * sequence number equals pos + ready_offset: 0 means free for producers, 1
+ * means full for consumers. Stores the first claimed position in out_pos.
+ */
+static size_t
+anv_ring__mpmc_claim(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    anv_ring__line *line,
+    size_t ready_offset,
+    size_t count,
+    size_t *out_pos
+)
+{
+    size_t pos = ANV_RING__LOAD_RELAXED(&line->index);
+    for (;;) {
+        size_t ready = 0;
+        while (ready < count) {
+            unsigned char *slot = ANV_RING__SLOT(ring, metadata, pos + ready);
+            size_t seq = ANV_RING__LOAD_ACQUIRE(ANV_RING__SLOT_SEQ(slot));
+            if (seq != pos + ready + ready_offset) {
+                break;
+            }
+            ++ready;
+        }
+        if (ready == 0) {
+            unsigned char *slot = ANV_RING__SLOT(ring, metadata, pos);
+            size_t seq = ANV_RING__LOAD_ACQUIRE(ANV_RING__SLOT_SEQ(slot));
+            /* slot still belongs to the previous lap: full (or empty). */
+            if ((ptrdiff_t)(seq - (pos + ready_offset)) < 0) {
+                return 0;
+            }
+            /* another thread already claimed it, retry with the new index. */
+            pos = ANV_RING__LOAD_RELAXED(&line->index);
+            continue;
+        }
+        if (ANV_RING__CAS(&line->index, &pos, pos + ready)) {
+            *out_pos = pos;
+            return ready;
+        }
+    }
+}
+
+static size_t
+anv_ring__mpmc_push_n(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    const void *items,
+    size_t count
+)
+{
+    size_t pos;
+    count = anv_ring__mpmc_claim(
+        ring, metadata, ANV_RING__PRODUCER(ring), 0, count, &pos
+    );
+    const unsigned char *item = items;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char *slot = ANV_RING__SLOT(ring, metadata, pos + i);
+        memcpy(ANV_RING__SLOT_ITEM(slot), item, metadata->item_sz);
+        ANV_RING__STORE_RELEASE(ANV_RING__SLOT_SEQ(slot), pos + i + 1);
+        item += metadata->item_sz;
+    }
+    return count;
+}
+
+static size_t
+anv_ring__mpmc_pop_n(
+    anv_ring_t ring,
+    const anv_ring__metadata *metadata,
+    void *out_items,
+    size_t count
+)
+{
+    size_t pos;
+    count = anv_ring__mpmc_claim(
+        ring, metadata, ANV_RING__CONSUMER(ring), 1, count, &pos
+    );
+    unsigned char *item = out_items;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char *slot = ANV_RING__SLOT(ring, metadata, pos + i);
+        memcpy(item, ANV_RING__SLOT_ITEM(slot), metadata->item_sz);
+        ANV_RING__STORE_RELEASE(
+            ANV_RING__SLOT_SEQ(slot), pos + i + metadata->capacity
+        );
+        item += metadata->item_sz;
+    }
+    return count;
+}
+
+size_t
+anv_ring_push_n(anv_ring_t ring, const void *items, size_t count)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        return 0;
+    }
+    if (ANV_RING__UNLIKELY(!items)) {
+        anv_ring__assert(0, "invalid null items");
+        return 0;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (metadata->kind == ANV_RING_SPSC) {
+        return anv_ring__spsc_push_n(ring, metadata, items, count);
+    }
+    return anv_ring__mpmc_push_n(ring, metadata, items, count);
+}
+
+size_t
+anv_ring_pop_n(anv_ring_t ring, void *out_items, size_t count)
+{
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        return 0;
+    }
+    if (ANV_RING__UNLIKELY(!out_items)) {
+        anv_ring__assert(0, "invalid null out_items");
+        return 0;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (metadata->kind == ANV_RING_SPSC) {
+        return anv_ring__spsc_pop_n(ring, metadata, out_items, count);
+    }
+    return anv_ring__mpmc_pop_n(ring, metadata, out_items, count);
+}
+
+anv_ring_result
+anv_ring_push(anv_ring_t ring, const void *item)
+{
+    if (ANV_RING__UNLIKELY(!item)) {
+        anv_ring__assert(0, "invalid null item");
+        return ANV_RING_RESULT_INVALID_PARAMS;
+    }
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        return ANV_RING_RESULT_INVALID_PARAMS;
+    }
+    size_t pushed = metadata->kind == ANV_RING_SPSC
+        ? anv_ring__spsc_push_n(ring, metadata, item, 1)
+        : anv_ring__mpmc_push_n(ring, metadata, item, 1);
+    return pushed ? ANV_RING_RESULT_OK : ANV_RING_RESULT_FULL;
+}
+
+anv_ring_result
+anv_ring_pop(anv_ring_t ring, void *out_item)
+{
+    if (ANV_RING__UNLIKELY(!out_item)) {
+        anv_ring__assert(0, "invalid null out_item");
+        return ANV_RING_RESULT_INVALID_PARAMS;
+    }
+    anv_ring__metadata *metadata = anv_ring__get_metadata(ring);
+    if (ANV_RING__UNLIKELY(!metadata)) {
+        return ANV_RING_RESULT_INVALID_PARAMS;
+    }
+    size_t popped = metadata->kind == ANV_RING_SPSC
+        ? anv_ring__spsc_pop_n(ring, metadata, out_item, 1)
+        : anv_ring__mpmc_pop_n(ring, metadata, out_item, 1);
+    return popped ? ANV_RING_RESULT_OK : ANV_RING_RESULT_EMPTY;
+}
+
+#endif /* ANV_RING_IMPLEMENTATION */
+
+#endif /* ANV_RING_H */
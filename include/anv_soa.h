@@ -0,0 +1,636 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_soa (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_soa
+
+Struct of arrays dynamic container: each field of a record is stored in its
+own contiguous column.
+
+anv_arr stores whole records next to each other (array of structs), so a loop
+reading a single field still drags all the other fields through the cache. An
+anv_soa stores the same records one column per field instead: scanning a field
+only reads that field's bytes and the loop is trivially vectorizable.
+
+```
+== brief overview ==
+
+|-metadata-|-columns info-|---column0 (a a a a a ...)---|---column1 (b b b ...)
+                          ^ANV_SOA_ALIGNMENT            ^ANV_SOA_ALIGNMENT
+```
+
+All columns live inside a single metalloc allocation and always hold the same
+number of items: anv_soa_push appends one item to every column, anv_soa_remove
+removes the same index from every column. Like anv_arr_remove, removing moves
+the last record in place of the removed one, so records order is not kept.
+
+Each column starts at a multiple of ANV_SOA_ALIGNMENT bytes (64 by default, a
+cache line and enough for any SIMD load).
+
+## Dependencies
+
+- anv_metalloc.h
+
+## Include usage
+
+```c
+// only if metalloc define is not already present somewhere else.
+#define ANV_METALLOC_IMPLEMENTATION
+
+#define ANV_SOA_IMPLEMENTATION
+#include "anv_soa.h"
+```
+
+## Examples
+
+```c
+enum { COL_ID, COL_PRICE, COL_QTY, COLS_COUNT };
+const size_t sizes[COLS_COUNT] = { sizeof(int), sizeof(double), sizeof(int) };
+
+anv_soa_t orders = anv_soa_new(1024, COLS_COUNT, sizes);
+
+int id = 1;
+double price = 9.99;
+int qty = 3;
+const void *fields[COLS_COUNT] = { &id, &price, &qty };
+if (anv_soa_push(orders, fields) != ANV_SOA_RESULT_OK) {
+    fprintf(stderr, "failed inserting order\n");
+}
+
+// only the price column is read.
+double total = 0;
+double *prices = anv_soa_column(orders, double, COL_PRICE);
+for (size_t i = 0; i < anv_soa_length(orders); ++i) {
+    total += prices[i];
+}
+
+anv_soa_destroy(orders);
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_SOA_H
+#define ANV_SOA_H
+
+#include <stddef.h> /* for size_t */
+
+#include "anv_metalloc.h"
+
+/**
+ * Alignment in bytes of every column's first item, must be a power of 2.
+ */
+#ifndef ANV_SOA_ALIGNMENT
+#define ANV_SOA_ALIGNMENT 64
+#endif
+
+typedef enum anv_soa_result {
+    /**
+     * Operation succeeded.
+     */
+    ANV_SOA_RESULT_OK = 0,
+    /**
+     * Invalid params have been passed to method.
+     * @note With debug asserts enabled, these errors always trigger an assert.
+     */
+    ANV_SOA_RESULT_INVALID_PARAMS = 1,
+    /**
+     * Memory allocation related error.
+     */
+    ANV_SOA_RESULT_ALLOC_ERROR = 2,
+    /**
+     * Index is >= the container's current length.
+     */
+    ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS = 10,
+} anv_soa_result;
+
+/**
+ * Convenience alias to better recognize an anv soa from a regular void *ptr;
+ */
+typedef void *anv_soa_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocate a new container with initial max capacity.
+ * @param capacity Initial max number of records, always > 0.
+ * @param columns_count Number of columns, always > 0.
+ * @param item_sizes Array of columns_count sizes, the size in bytes of an item
+ *                   of each column (always > 0).
+ * @return New container, NULL on invalid params or internal alloc errors.
+ */
+anv_soa_t
+anv_soa_new(size_t capacity, size_t columns_count, const size_t *item_sizes);
+
+/**
+ * Destroy a container.
+ * @param soa Container to destroy, NULL is a no-op.
+ */
+void anv_soa_destroy(anv_soa_t soa);
+
+/**
+ * @return Number of records, 0 on invalid params.
+ */
+size_t anv_soa_length(anv_soa_t soa);
+
+/**
+ * @return Max number of records before growing, 0 on invalid params.
+ */
+size_t anv_soa_capacity(anv_soa_t soa);
+
+/**
+ * @return Number of columns, 0 on invalid params.
+ */
+size_t anv_soa_columns_count(anv_soa_t soa);
+
+/**
+ * @return Size in bytes of an item of column, 0 on invalid params.
+ */
+size_t anv_soa_item_sz(anv_soa_t soa, size_t column);
+
+void *anv_soa__column(anv_soa_t soa, size_t column);
+
+/**
+ * Get a typed pointer to the first item of a column, aligned to
+ * ANV_SOA_ALIGNMENT. Valid until the container grows.
+ * @return Column's data, NULL on invalid params.
+ */
+#define anv_soa_column(soa, type, column) ((type *)anv_soa__column(soa, column))
+
+void *anv_soa__get(anv_soa_t soa, size_t column, size_t index);
+
+/**
+ * Get a typed pointer to the item at index of a column.
+ * @return Item's pointer, NULL on invalid params or if index is out of bounds.
+ */
+#define anv_soa_get(soa, type, column, index)                                  \
+    ((type *)anv_soa__get(soa, column, index))
+
+anv_soa_result anv_soa__reserve(anv_soa_t *refsoa, size_t capacity);
+
+/**
+ * Make room for at least capacity records.
+ * @note May move the container in memory.
+ * @return Status code.
+ */
+#define anv_soa_reserve(soa, capacity)                                         \
+    anv_soa__reserve((void *)&(soa), capacity)
+
+anv_soa_result anv_soa__push(anv_soa_t *refsoa, const void *const *fields);
+
+/**
+ * Push a new record to the end of every column.
+ * @note May move the container in memory.
+ * @param fields Array of columns_count pointers to each column's new item. A
+ *               NULL array or NULL items are zeroed.
+ * @return Status code.
+ */
+#define anv_soa_push(soa, fields) anv_soa__push((void *)&(soa), fields)
+
+/**
+ * Replace the item at index of a single column.
+ * @param item New item, NULL to zero it.
+ * @return Status code.
+ */
+anv_soa_result
+anv_soa_set(anv_soa_t soa, size_t column, size_t index, const void *item);
+
+/**
+ * Delete the record at index from all columns.
+ * This method does not guarantee records order: the last record is moved in
+ * place of the removed one (see anv_arr_remove).
+ * @return Status code.
+ */
+anv_soa_result anv_soa_remove(anv_soa_t soa, size_t index);
+
+/**
+ * Delete the last record from all columns.
+ * @return Status code.
+ */
+anv_soa_result anv_soa_pop(anv_soa_t soa);
+
+/**
+ * Delete all records, capacity is kept.
+ */
+void anv_soa_clear(anv_soa_t soa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ANV_SOA_IMPLEMENTATION
+
+#include <string.h> /* for memcpy(), memmove(), memset() */
+
+#ifndef anv_soa__assert
+#include <assert.h>
+#define anv_soa__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_SOA__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_SOA__UNLIKELY(x) __builtin_expect((x), 0)
+#else
+#define ANV_SOA__LIKELY(x)   (x)
+#define ANV_SOA__UNLIKELY(x) (x)
+#endif
+
+#define ANV_SOA__SIZE_MAX ((size_t)-1)
+
+typedef struct anv_soa__metadata {
+    size_t length;
+    size_t capacity;
+    size_t columns_count;
+} anv_soa__metadata;
+
+/* stored at the start of the data portion, one for each column. */
+typedef struct anv_soa__column_info {
+    size_t item_sz;
+    /* from the start of the data portion. */
+    size_t offset;
+} anv_soa__column_info;
+
+#define ANV_SOA__ROUND_UP(n)                                                   \
+    (((n) + ANV_SOA_ALIGNMENT - 1) / ANV_SOA_ALIGNMENT * ANV_SOA_ALIGNMENT)
+
+#define ANV_SOA__COLUMNS(soa) ((anv_soa__column_info *)(soa))
+#define ANV_SOA__COLUMN_DATA(soa, info)                                        \
+    ((unsigned char *)(soa) + (info)->offset)
+
+/*
+ * Total data size needed to store capacity records, 0 on overflow. When
+ * columns_out is not NULL, the columns offsets are written to it as well.
+ */
+static size_t
+anv_soa__layout(
+    const anv_soa__column_info *columns,
+    size_t columns_count,
+    size_t capacity,
+    anv_soa__column_info *columns_out
+)
+{
+    size_t offset
+        = ANV_SOA__ROUND_UP(columns_count * sizeof(anv_soa__column_info));
+    for (size_t i = 0; i < columns_count; ++i) {
+        size_t item_sz = columns[i].item_sz;
+        if (ANV_SOA__UNLIKELY(
+                capacity > (ANV_SOA__SIZE_MAX / 2 - offset) / item_sz
+            )) {
+            return 0;
+        }
+        if (columns_out) {
+            columns_out[i].item_sz = item_sz;
+            columns_out[i].offset = offset;
+        }
+        offset += ANV_SOA__ROUND_UP(capacity * item_sz);
+    }
+    return offset;
+}
+
+static anv_soa__metadata *
+anv_soa__get_metadata(anv_soa_t soa)
+{
+    if (ANV_SOA__UNLIKELY(!soa)) {
+        anv_soa__assert(0, "invalid null soa");
+        return NULL;
+    }
+    anv_soa__metadata *metadata = anv_meta_get(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        anv_soa__assert(0, "cannot find metadata, is soa a valid meta obj?");
+        return NULL;
+    }
+    return metadata;
+}
+
+static anv_soa_result
+anv_soa__grow(
+    anv_soa_t *refsoa, anv_soa__metadata **refmetadata, size_t min_capacity
+)
+{
+    anv_soa__metadata *metadata = *refmetadata;
+    size_t new_capacity = metadata->capacity;
+    if (new_capacity >= min_capacity) {
+        return ANV_SOA_RESULT_OK;
+    }
+    while (new_capacity < min_capacity) {
+        if (ANV_SOA__UNLIKELY(new_capacity > ANV_SOA__SIZE_MAX / 2)) {
+            return ANV_SOA_RESULT_ALLOC_ERROR;
+        }
+        new_capacity *= 2;
+    }
+
+    size_t columns_count = metadata->columns_count;
+    size_t data_sz = anv_soa__layout(
+        ANV_SOA__COLUMNS(*refsoa), columns_count, new_capacity, NULL
+    );
+    if (ANV_SOA__UNLIKELY(data_sz == 0)) {
+        return ANV_SOA_RESULT_ALLOC_ERROR;
+    }
+    anv_soa_t soa = anv_meta_realloc(*refsoa, data_sz);
+    if (ANV_SOA__UNLIKELY(!soa)) {
+        return ANV_SOA_RESULT_ALLOC_ERROR;
+    }
+
+    /* columns only move forward: moving them starting from the last one never
+     * overwrites items not moved yet. */
+    metadata = anv_meta_get_unchecked(soa);
+    anv_soa__column_info *columns = ANV_SOA__COLUMNS(soa);
+    size_t end = data_sz;
+    for (size_t i = columns_count; i-- > 0;) {
+        size_t offset
+            = end - ANV_SOA__ROUND_UP(new_capacity * columns[i].item_sz);
+        memmove(
+            (unsigned char *)soa + offset,
+            ANV_SOA__COLUMN_DATA(soa, &columns[i]),
+            metadata->length * columns[i].item_sz
+        );
+        columns[i].offset = offset;
+        end = offset;
+    }
+    metadata->capacity = new_capacity;
+
+    *refsoa = soa;
+    *refmetadata = metadata;
+    return ANV_SOA_RESULT_OK;
+}
+
+anv_soa_t
+anv_soa_new(size_t capacity, size_t columns_count, const size_t *item_sizes)
+{
+    if (ANV_SOA__UNLIKELY(capacity == 0)) {
+        anv_soa__assert(0, "capacity cannot be 0");
+        return NULL;
+    }
+    if (ANV_SOA__UNLIKELY(columns_count == 0 || !item_sizes)) {
+        anv_soa__assert(0, "container needs at least a column");
+        return NULL;
+    }
+    if (ANV_SOA__UNLIKELY(
+            columns_count
+            > ANV_SOA__SIZE_MAX / 4 / sizeof(anv_soa__column_info)
+        )) {
+        anv_soa__assert(0, "too many columns");
+        return NULL;
+    }
+
+    /* compute the layout on the item sizes alone, offsets are filled later. */
+    size_t data_sz = ANV_SOA__ROUND_UP(
+        columns_count * sizeof(anv_soa__column_info)
+    );
+    for (size_t i = 0; i < columns_count; ++i) {
+        if (ANV_SOA__UNLIKELY(item_sizes[i] == 0)) {
+            anv_soa__assert(0, "item size cannot be 0");
+            return NULL;
+        }
+        if (ANV_SOA__UNLIKELY(
+                capacity > (ANV_SOA__SIZE_MAX / 2 - data_sz) / item_sizes[i]
+            )) {
+            anv_soa__assert(0, "capacity too big");
+            return NULL;
+        }
+        data_sz += ANV_SOA__ROUND_UP(capacity * item_sizes[i]);
+    }
+
+    anv_soa__metadata metadata = {
+        .length = 0,
+        .capacity = capacity,
+        .columns_count = columns_count,
+    };
+    anv_soa_t soa = anv_meta_malloc_aligned(
+        &metadata, sizeof(anv_soa__metadata), data_sz, ANV_SOA_ALIGNMENT
+    );
+    if (ANV_SOA__UNLIKELY(!soa)) {
+        return NULL;
+    }
+    anv_soa__column_info *columns = ANV_SOA__COLUMNS(soa);
+    for (size_t i = 0; i < columns_count; ++i) {
+        columns[i].item_sz = item_sizes[i];
+    }
+    anv_soa__layout(columns, columns_count, capacity, columns);
+    return soa;
+}
+
+void
+anv_soa_destroy(anv_soa_t soa)
+{
+    if (soa) {
+        anv_meta_free(soa);
+    }
+}
+
+size_t
+anv_soa_length(anv_soa_t soa)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    return metadata ? metadata->length : 0;
+}
+
+size_t
+anv_soa_capacity(anv_soa_t soa)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    return metadata ? metadata->capacity : 0;
+}
+
+size_t
+anv_soa_columns_count(anv_soa_t soa)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    return metadata ? metadata->columns_count : 0;
+}
+
+size_t
+anv_soa_item_sz(anv_soa_t soa, size_t column)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return 0;
+    }
+    if (ANV_SOA__UNLIKELY(column >= metadata->columns_count)) {
+        anv_soa__assert(0, "invalid column");
+        return 0;
+    }
+    return ANV_SOA__COLUMNS(soa)[column].item_sz;
+}
+
+void *
+anv_soa__column(anv_soa_t soa, size_t column)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return NULL;
+    }
+    if (ANV_SOA__UNLIKELY(column >= metadata->columns_count)) {
+        anv_soa__assert(0, "invalid column");
+        return NULL;
+    }
+    return ANV_SOA__COLUMN_DATA(soa, &ANV_SOA__COLUMNS(soa)[column]);
+}
+
+void *
+anv_soa__get(anv_soa_t soa, size_t column, size_t index)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return NULL;
+    }
+    if (ANV_SOA__UNLIKELY(column >= metadata->columns_count)) {
+        anv_soa__assert(0, "invalid column");
+        return NULL;
+    }
+    if (index >= metadata->length) {
+        return NULL;
+    }
+    anv_soa__column_info *info = &ANV_SOA__COLUMNS(soa)[column];
+    return ANV_SOA__COLUMN_DATA(soa, info) + index * info->item_sz;
+}
+
+anv_soa_result
+anv_soa__reserve(anv_soa_t *refsoa, size_t capacity)
+{
+    if (ANV_SOA__UNLIKELY(!refsoa)) {
+        anv_soa__assert(0, "invalid null soa");
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    anv_soa__metadata *metadata = anv_soa__get_metadata(*refsoa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    return anv_soa__grow(refsoa, &metadata, capacity);
+}
+
+anv_soa_result
+anv_soa__push(anv_soa_t *refsoa, const void *const *fields)
+{
+    if (ANV_SOA__UNLIKELY(!refsoa)) {
+        anv_soa__assert(0, "invalid null soa");
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    anv_soa__metadata *metadata = anv_soa__get_metadata(*refsoa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_SOA__UNLIKELY(metadata->length == metadata->capacity)) {
+        anv_soa_result res
+            = anv_soa__grow(refsoa, &metadata, metadata->length + 1);
+        if (ANV_SOA__UNLIKELY(res != ANV_SOA_RESULT_OK)) {
+            return res;
+        }
+    }
+
+    anv_soa_t soa = *refsoa;
+    anv_soa__column_info *columns = ANV_SOA__COLUMNS(soa);
+    for (size_t i = 0; i < metadata->columns_count; ++i) {
+        unsigned char *dst = ANV_SOA__COLUMN_DATA(soa, &columns[i])
+                           + metadata->length * columns[i].item_sz;
+        if (fields && fields[i]) {
+            memcpy(dst, fields[i], columns[i].item_sz);
+        } else {
+            memset(dst, 0, columns[i].item_sz);
+        }
+    }
+    metadata->length++;
+    return ANV_SOA_RESULT_OK;
+}
+
+anv_soa_result
+anv_soa_set(anv_soa_t soa, size_t column, size_t index, const void *item)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    if (ANV_SOA__UNLIKELY(column >= metadata->columns_count)) {
+        anv_soa__assert(0, "invalid column");
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    if (index >= metadata->length) {
+        return ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+    anv_soa__column_info *info = &ANV_SOA__COLUMNS(soa)[column];
+    unsigned char *dst
+        = ANV_SOA__COLUMN_DATA(soa, info) + index * info->item_sz;
+    if (item) {
+        memcpy(dst, item, info->item_sz);
+    } else {
+        memset(dst, 0, info->item_sz);
+    }
+    return ANV_SOA_RESULT_OK;
+}
+
+anv_soa_result
+anv_soa_remove(anv_soa_t soa, size_t index)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    if (index >= metadata->length) {
+        return ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+
+    size_t last = metadata->length - 1;
+    if (index != last) {
+        anv_soa__column_info *columns = ANV_SOA__COLUMNS(soa);
+        for (size_t i = 0; i < metadata->columns_count; ++i) {
+            unsigned char *data = ANV_SOA__COLUMN_DATA(soa, &columns[i]);
+            size_t item_sz = columns[i].item_sz;
+            memcpy(data + index * item_sz, data + last * item_sz, item_sz);
+        }
+    }
+    metadata->length--;
+    return ANV_SOA_RESULT_OK;
+}
+
+anv_soa_result
+anv_soa_pop(anv_soa_t soa)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return ANV_SOA_RESULT_INVALID_PARAMS;
+    }
+    if (metadata->length == 0) {
+        return ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS;
+    }
+    metadata->length--;
+    return ANV_SOA_RESULT_OK;
+}
+
+void
+anv_soa_clear(anv_soa_t soa)
+{
+    anv_soa__metadata *metadata = anv_soa__get_metadata(soa);
+    if (ANV_SOA__UNLIKELY(!metadata)) {
+        return;
+    }
+    metadata->length = 0;
+}
+
+#endif /* ANV_SOA_IMPLEMENTATION */
+
+#endif /* ANV_SOA_H */
@@ -60,6 +60,34 @@ much OS-specific.
 The current implementation involves basic C signal() callbacks and logs to
 stderr.
 
+## Parallel and isolated fixtures
+
+On POSIX systems fixtures can be run each one in its own forked process, with
+`jobs` of them running at the same time (see anv_testsuite_config.jobs, or set
+the ANV_TESTSUITE_JOBS environment variable to override it for all suites,
+e.g. `ANV_TESTSUITE_JOBS=-1 make` to use all CPUs).
+
+A crashing fixture is then reported as such without stopping the suite, and
+the fixtures output is buffered and printed in registration order, same as a
+sequential run. setup and teardown still run once in the main process while
+before_each and after_each run in the fixture process: changes made to global
+state by fixtures are not visible to other fixtures.
+
+ANV_TESTSUITE_RUN returns the number of failed fixtures, capped at 255 so
+that it can be used as exit code.
+
+## Timings, budgets and reports
+
+The wall time of each fixture is printed next to its result. Fixtures taking
+longer than their budget (ANV_TESTSUITE_REGISTER_WITH_BUDGET, or
+anv_testsuite_config.budget_s for all of them) are flagged as over budget.
+Hung fixtures can be killed with anv_testsuite_config.timeout_s (POSIX only).
+
+ANV_TESTSUITE_RUN_WITH_REPORT also writes a JUnit XML or JSON report with the
+wall and CPU time of each fixture. Without changing the code, setting
+ANV_TESTSUITE_REPORT_DIR writes a <suitename>.xml report (or .json with
+ANV_TESTSUITE_REPORT_FORMAT=json) inside that directory for every suite.
+
 ## Examples
 
 ### Simple example
@@ -86,7 +114,7 @@ ANV_TESTSUITE(
 int
 main(void)
 {
-    ANV_TESTSUITE_RUN(my_testsuite, stdout);
+    return ANV_TESTSUITE_RUN(my_testsuite, stdout);
 }
 ```
 
@@ -123,7 +151,7 @@ ANV_TESTSUITE_WITH_CONFIG(
 int
 main(void)
 {
-    ANV_TESTSUITE_RUN(tests_config, stdout);
+    return ANV_TESTSUITE_RUN(tests_config, stdout);
 }
 ```
 
@@ -164,7 +192,44 @@ ANV_TESTSUITE_WITH_CONFIG(
 int
 main(void)
 {
-    ANV_TESTSUITE_RUN(tests_callbacks, stdout);
+    return ANV_TESTSUITE_RUN(tests_callbacks, stdout);
+}
+```
+
+### Example with forked fixtures
+
+```c
+ANV_TESTSUITE_FIXTURE(tests_forked_crash)
+{
+    int *p = NULL;
+    *p = 1;
+    expect(1);
+}
+
+ANV_TESTSUITE_FIXTURE(tests_forked_success)
+{
+    expect(1);
+}
+
+ANV_TESTSUITE_WITH_CONFIG(
+    tests_forked,
+    ANV_TESTSUITE_REGISTER(tests_forked_crash),
+    ANV_TESTSUITE_REGISTER_WITH_BUDGET(tests_forked_success, 0.5),
+) {
+    .jobs = -1, // one worker per CPU
+    .timeout_s = 10,
+};
+
+int
+main(void)
+{
+    FILE *report = fopen("tests_forked.xml", "w");
+    // 1 fixture failed
+    int fails = ANV_TESTSUITE_RUN_WITH_REPORT(
+        tests_forked, stdout, ANV_TESTSUITE_REPORT_JUNIT, report
+    );
+    fclose(report);
+    return fails;
 }
 ```
 
@@ -192,7 +257,7 @@ main(void)
     // enable listeners for abnormal errors
     anv_testsuite_catch_crashes();
 
-    ANV_TESTSUITE_RUN(tests_crash, stdout);
+    return ANV_TESTSUITE_RUN(tests_crash, stdout);
 }
 ```
 
@@ -205,6 +270,21 @@ main(void)
 #include <stdio.h> /* for FILE, fprintf(), snprintf() */
 #include <stdlib.h> /* for exit() */
 #include <string.h> /* for strlen() */
+#include <time.h> /* for clock() */
+
+/**
+ * Forked fixtures (see anv_testsuite_config.jobs) are only available on
+ * POSIX systems.
+ */
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+#define ANV_TESTSUITE__HAS_FORK
+#include <errno.h> /* for errno */
+#include <sys/resource.h> /* for getrusage() */
+#include <sys/time.h> /* for gettimeofday() */
+#include <sys/types.h> /* for pid_t */
+#include <sys/wait.h> /* for waitpid() */
+#include <unistd.h> /* for fork(), _exit(), sysconf(), alarm() */
+#endif
 
 /**
  * Toggle UNIX console colors.
@@ -261,8 +341,37 @@ typedef struct anv_testsuite_config {
     anv_testsuite_teardown_callback teardown;
     anv_testsuite_each_callback before_each;
     anv_testsuite_each_callback after_each;
+    /**
+     * Number of fixtures run at the same time, each one in its own forked
+     * process. 0 (default) runs all fixtures in-process one after the other,
+     * -1 uses one worker per online CPU.
+     * Overridden at runtime by the ANV_TESTSUITE_JOBS environment variable.
+     * Ignored where fork() is not available.
+     */
+    int jobs;
+    /**
+     * Default time budget in seconds of each fixture, 0 for none.
+     * Fixtures taking longer are flagged as over budget, but do not fail.
+     */
+    double budget_s;
+    /**
+     * Kill fixtures running longer than this many seconds (rounded up to
+     * whole seconds), 0 for none. Forked fixtures are reported as timed out,
+     * in-process ones abort the whole suite as a crash would.
+     * Ignored where alarm() is not available.
+     */
+    double timeout_s;
 } anv_testsuite_config;
 
+/**
+ * Format of machine readable reports, see ANV_TESTSUITE_RUN_WITH_REPORT.
+ */
+typedef enum anv_testsuite_report_format {
+    ANV_TESTSUITE_REPORT_NONE = 0,
+    ANV_TESTSUITE_REPORT_JUNIT = 1,
+    ANV_TESTSUITE_REPORT_JSON = 2,
+} anv_testsuite_report_format;
+
 /**
  * Test fixture interface.
  * @param out_res Must be set to non-zero values to signal errors.
@@ -278,6 +387,8 @@ typedef struct anv_testsuite_fixture {
     const char *fixture_name;
     /** Fixture to run. */
     anv_testsuite_fixture_callback fixture;
+    /** Time budget in seconds, 0 to use anv_testsuite_config.budget_s. */
+    double budget_s;
 } anv_testsuite_fixture;
 
 /**
@@ -310,9 +421,57 @@ typedef struct anv_testsuite_fixture {
  */
 #define ANV_TESTSUITE_REGISTER(fixture_name)                                   \
     {                                                                          \
-        #fixture_name, fixture_name                                            \
+        #fixture_name, fixture_name, 0                                         \
+    }
+
+/**
+ * Register test fixture for test suite with its own time budget in seconds.
+ */
+#define ANV_TESTSUITE_REGISTER_WITH_BUDGET(fixture_name, budget_s)             \
+    {                                                                          \
+        #fixture_name, fixture_name, budget_s                                  \
     }
 
+static const char *
+anv_testsuite__signal_name(int sig)
+{
+    switch (sig) {
+        case SIGABRT:
+            return "SIGABRT";
+        case SIGFPE:
+            return "SIGFPE";
+        case SIGILL:
+            return "SIGILL";
+        case SIGSEGV:
+            return "SIGSEGV";
+#ifdef ANV_TESTSUITE__HAS_FORK
+        case SIGALRM:
+            return "SIGALRM";
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static void
+anv_testsuite__print_crash_reason(FILE *out_file, int sig)
+{
+    const char *name = anv_testsuite__signal_name(sig);
+    if (name) {
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED("           REASON:        '%s'\n"),
+            name
+        );
+    } else {
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED("           REASON:        '%d'\n"),
+            sig
+        );
+    }
+}
+
 static void
 anv_testsuite__handle_crash(int sig)
 {
@@ -322,39 +481,7 @@ anv_testsuite__handle_crash(int sig)
             "\n******************** CRASH ********************\n"
         )
     );
-    switch (sig) {
-        case SIGABRT:
-            fprintf(
-                stderr,
-                ANV_TESTSUITE__STR_RED("           REASON:        'SIGABRT'\n")
-            );
-            break;
-        case SIGFPE:
-            fprintf(
-                stderr,
-                ANV_TESTSUITE__STR_RED("           REASON:        'SIGFPE'\n")
-            );
-            break;
-        case SIGILL:
-            fprintf(
-                stderr,
-                ANV_TESTSUITE__STR_RED("           REASON:        'SIGILL'\n")
-            );
-            break;
-        case SIGSEGV:
-            fprintf(
-                stderr,
-                ANV_TESTSUITE__STR_RED("           REASON:        'SIGSEGV'\n")
-            );
-            break;
-        default:
-            fprintf(
-                stderr,
-                ANV_TESTSUITE__STR_RED("           REASON:        '%d'\n"),
-                sig
-            );
-            break;
-    }
+    anv_testsuite__print_crash_reason(stderr, sig);
     fprintf(
         stderr,
         ANV_TESTSUITE__STR_RED(
@@ -381,9 +508,678 @@ anv_testsuite_catch_crashes(void)
     signal(SIGFPE, anv_testsuite__handle_crash);
     signal(SIGILL, anv_testsuite__handle_crash);
     signal(SIGSEGV, anv_testsuite__handle_crash);
+#ifdef ANV_TESTSUITE__HAS_FORK
+    // in-process fixtures timeouts.
+    signal(SIGALRM, anv_testsuite__handle_crash);
+#endif
+}
+
+/*
+ * Wall clock time in seconds since an unspecified point.
+ */
+static double
+anv_testsuite__wall_time(void)
+{
+#if defined(ANV_TESTSUITE__HAS_FORK) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#elif defined(ANV_TESTSUITE__HAS_FORK)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+#else
+    // the Microsoft CRT clock() measures wall time.
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*
+ * CPU time in seconds used by this process.
+ */
+static double
+anv_testsuite__cpu_time(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/*
+ * Fixture outcome, for timings and reports.
+ */
+typedef struct anv_testsuite__result {
+    double wall_s;
+    double cpu_s;
+    double budget_s;
+    int failed;
+    int over_budget;
+    /** Why the fixture failed, e.g. "expect failed". */
+    char reason[48];
+} anv_testsuite__result;
+
+static void
+anv_testsuite__print_fixture_name(FILE *out_file, size_t i, const char *name)
+{
+    char buff[128] = { 0 };
+    char padd_buff[128] = { 0 };
+
+    // pretty print info
+    snprintf(buff, 128, "  [%03ld]  %s", (long)i, name);
+    int padd_sz = ANV_TESTSUITE_PADDING - strlen(buff);
+    if (padd_sz > 0) {
+        snprintf(padd_buff, (size_t)padd_sz, "%s", ANV_TESTSUITE__PADDING);
+    } else {
+        padd_buff[0] = '\0';
+    }
+    fprintf(out_file, "%s %s ", buff, padd_buff);
+}
+
+/*
+ * Set fixture budget and check whether it was exceeded.
+ */
+static void
+anv_testsuite__check_budget(
+    anv_testsuite__result *result,
+    const anv_testsuite_fixture *fixture,
+    const anv_testsuite_config *config
+)
+{
+    result->budget_s = fixture->budget_s > 0 ? fixture->budget_s
+                                             : config->budget_s;
+    result->over_budget = result->budget_s > 0
+                       && result->wall_s > result->budget_s;
+}
+
+static void
+anv_testsuite__print_success(
+    FILE *out_file, const anv_testsuite__result *result
+)
+{
+    fprintf(
+        out_file,
+        ANV_TESTSUITE__STR_GREEN("SUCCESS") " (%.3f ms)",
+        result->wall_s * 1e3
+    );
+    if (result->over_budget) {
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED(" OVER BUDGET (%.3f ms)"),
+            result->budget_s * 1e3
+        );
+    }
+    fprintf(out_file, "\n");
+}
+
+/*
+ * Run fixture with before/after each callbacks, return non-zero on failure.
+ */
+static int
+anv_testsuite__run_fixture(
+    const anv_testsuite_fixture *fixture,
+    FILE *out_file,
+    const anv_testsuite_config *config
+)
+{
+#ifdef ANV_TESTSUITE__HAS_FORK
+    if (config->timeout_s > 0) {
+        // alarm() only takes whole seconds.
+        unsigned int secs = (unsigned int)config->timeout_s;
+        alarm(secs < config->timeout_s ? secs + 1 : secs);
+    }
+#endif
+
+    if (config->before_each) {
+        config->before_each();
+    }
+
+    // run test
+    int result = 0;
+    fixture->fixture(&result, out_file);
+
+    if (config->after_each) {
+        config->after_each();
+    }
+
+#ifdef ANV_TESTSUITE__HAS_FORK
+    if (config->timeout_s > 0) {
+        alarm(0);
+    }
+#endif
+    return result;
+}
+
+static int
+anv_testsuite__run_sequential(
+    const anv_testsuite_fixture *suite,
+    size_t suite_sz,
+    FILE *out_file,
+    const anv_testsuite_config *config,
+    anv_testsuite__result *results
+)
+{
+    int total_fails = 0;
+    for (size_t i = 0; i < suite_sz; ++i) {
+        anv_testsuite__print_fixture_name(out_file, i, suite[i].fixture_name);
+
+        // force flush here because if test fixture crashes we may not be able
+        // to get the line log.
+        fflush(out_file);
+
+        anv_testsuite__result *result = &results[i];
+        double wall_start = anv_testsuite__wall_time();
+        double cpu_start = anv_testsuite__cpu_time();
+        result->failed
+            = anv_testsuite__run_fixture(&suite[i], out_file, config) != 0;
+        result->wall_s = anv_testsuite__wall_time() - wall_start;
+        result->cpu_s = anv_testsuite__cpu_time() - cpu_start;
+        anv_testsuite__check_budget(result, &suite[i], config);
+
+        if (!result->failed) {
+            anv_testsuite__print_success(out_file, result);
+        } else {
+            snprintf(result->reason, sizeof(result->reason), "expect failed");
+            ++total_fails;
+        }
+    }
+    return total_fails;
+}
+
+#ifdef ANV_TESTSUITE__HAS_FORK
+
+/* Exit code of forked fixtures failing an expect. */
+#define ANV_TESTSUITE__EXIT_FAILED 101
+
+typedef struct anv_testsuite__forked {
+    pid_t pid;
+    /** Fixture output, written by the child. */
+    FILE *file;
+    /** Output read back by the parent once the child is done. */
+    char *output;
+    size_t output_sz;
+    double start_s;
+    int status;
+    int done;
+    /** Set if the child could not be waited for (e.g. SIGCHLD ignored). */
+    int lost;
+} anv_testsuite__forked;
+
+static int
+anv_testsuite__jobs(const anv_testsuite_config *config)
+{
+    int jobs = config->jobs;
+    const char *env = getenv("ANV_TESTSUITE_JOBS");
+    if (env && *env) {
+        jobs = atoi(env);
+    }
+    if (jobs < 0) {
+        jobs = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus > 1) {
+            jobs = (int)cpus;
+        }
+#endif
+    }
+    return jobs;
+}
+
+/*
+ * CPU time in seconds used by all terminated and waited for children.
+ */
+static double
+anv_testsuite__children_cpu_time(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_CHILDREN, &usage) != 0) {
+        return 0;
+    }
+    return (double)usage.ru_utime.tv_sec + (double)usage.ru_stime.tv_sec
+         + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+/*
+ * Start fixture in a child process, return 0 on success.
+ */
+static int
+anv_testsuite__fork_fixture(
+    const anv_testsuite_fixture *fixture,
+    anv_testsuite__forked *forked,
+    const anv_testsuite_config *config
+)
+{
+    forked->file = tmpfile();
+    if (!forked->file) {
+        return 1;
+    }
+    // buffered streams would be written twice, by parent and child.
+    fflush(NULL);
+    forked->start_s = anv_testsuite__wall_time();
+    forked->pid = fork();
+    if (forked->pid < 0) {
+        fclose(forked->file);
+        forked->file = NULL;
+        return 1;
+    }
+    if (forked->pid == 0) {
+        // crashes are reported by the parent, keep the default handlers.
+        signal(SIGABRT, SIG_DFL);
+        signal(SIGFPE, SIG_DFL);
+        signal(SIGILL, SIG_DFL);
+        signal(SIGSEGV, SIG_DFL);
+        signal(SIGALRM, SIG_DFL);
+        // keep the output written right before a crash.
+        setvbuf(forked->file, NULL, _IONBF, 0);
+        int result = anv_testsuite__run_fixture(fixture, forked->file, config);
+        fflush(NULL);
+        _exit(result == 0 ? 0 : ANV_TESTSUITE__EXIT_FAILED);
+    }
+    return 0;
 }
 
 static void
+anv_testsuite__collect_fixture(
+    anv_testsuite__forked *forked,
+    int status,
+    double cpu_s,
+    anv_testsuite__result *result
+)
+{
+    result->wall_s = anv_testsuite__wall_time() - forked->start_s;
+    result->cpu_s = cpu_s;
+    forked->status = status;
+    forked->done = 1;
+
+    long sz = -1;
+    if (fseek(forked->file, 0, SEEK_END) == 0) {
+        sz = ftell(forked->file);
+    }
+    if (sz > 0) {
+        forked->output = (char *)malloc((size_t)sz);
+    }
+    if (forked->output) {
+        rewind(forked->file);
+        forked->output_sz = fread(forked->output, 1, (size_t)sz, forked->file);
+    }
+    fclose(forked->file);
+    forked->file = NULL;
+}
+
+/*
+ * Print fixture output and result, return non-zero on failure.
+ */
+static int
+anv_testsuite__report_fixture(
+    FILE *out_file,
+    size_t i,
+    const anv_testsuite_fixture *fixture,
+    anv_testsuite__forked *forked,
+    const anv_testsuite_config *config,
+    anv_testsuite__result *result
+)
+{
+    anv_testsuite__print_fixture_name(out_file, i, fixture->fixture_name);
+    if (forked->output) {
+        fwrite(forked->output, 1, forked->output_sz, out_file);
+        free(forked->output);
+        forked->output = NULL;
+    }
+    anv_testsuite__check_budget(result, fixture, config);
+
+    int status = forked->status;
+    result->failed = 1;
+    if (forked->lost) {
+        snprintf(result->reason, sizeof(result->reason), "waitpid failed");
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("FAILURE\n"));
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED(
+                "           REASON:        'waitpid failed'\n"
+            )
+        );
+        return 1;
+    }
+    if (!forked->done) {
+        snprintf(result->reason, sizeof(result->reason), "fork failed");
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("FAILURE\n"));
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED("           REASON:        'fork failed'\n")
+        );
+        return 1;
+    }
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM
+        && config->timeout_s > 0) {
+        snprintf(result->reason, sizeof(result->reason), "timeout");
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("TIMEOUT\n"));
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED("           LIMIT:         '%.3f s'\n"),
+            config->timeout_s
+        );
+        return 1;
+    }
+    if (WIFSIGNALED(status)) {
+        const char *name = anv_testsuite__signal_name(WTERMSIG(status));
+        snprintf(
+            result->reason,
+            sizeof(result->reason),
+            "crash (%s)",
+            name ? name : "signal"
+        );
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("CRASH\n"));
+        anv_testsuite__print_crash_reason(out_file, WTERMSIG(status));
+        return 1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        // expect already reported what failed.
+        if (WIFEXITED(status)
+            && WEXITSTATUS(status) == ANV_TESTSUITE__EXIT_FAILED) {
+            snprintf(result->reason, sizeof(result->reason), "expect failed");
+            return 1;
+        }
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        snprintf(result->reason, sizeof(result->reason), "exit(%d)", code);
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("FAILURE\n"));
+        fprintf(
+            out_file,
+            ANV_TESTSUITE__STR_RED("           REASON:        'exit(%d)'\n"),
+            code
+        );
+        return 1;
+    }
+    result->failed = 0;
+    anv_testsuite__print_success(out_file, result);
+    return 0;
+}
+
+/*
+ * Run each fixture in its own process, at most jobs at a time. Output is
+ * buffered and printed in registration order.
+ * Return the number of failed fixtures or -1 if no fixture could be run.
+ */
+static int
+anv_testsuite__run_forked(
+    const anv_testsuite_fixture *suite,
+    size_t suite_sz,
+    FILE *out_file,
+    const anv_testsuite_config *config,
+    int jobs,
+    anv_testsuite__result *results
+)
+{
+    anv_testsuite__forked *forked = (anv_testsuite__forked *)calloc(
+        suite_sz ? suite_sz : 1, sizeof(anv_testsuite__forked)
+    );
+    if (!forked) {
+        return -1;
+    }
+
+    int total_fails = 0;
+    int running = 0;
+    size_t started = 0;
+    size_t printed = 0;
+    double children_cpu_s = anv_testsuite__children_cpu_time();
+    while (printed < suite_sz) {
+        while (running < jobs && started < suite_sz) {
+            if (anv_testsuite__fork_fixture(
+                    &suite[started], &forked[started], config
+                )
+                == 0) {
+                ++running;
+            }
+            ++started;
+        }
+
+        if (running > 0) {
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, 0);
+            if (pid < 0 && errno != EINTR) {
+                for (size_t i = printed; i < started; ++i) {
+                    if (forked[i].file) {
+                        anv_testsuite__collect_fixture(
+                            &forked[i], 0, 0, &results[i]
+                        );
+                        forked[i].lost = 1;
+                    }
+                }
+                running = 0;
+            }
+            // only one child is waited for at a time: the CPU time
+            // difference is all its own.
+            double cpu_s = anv_testsuite__children_cpu_time();
+            for (size_t i = printed; pid > 0 && i < started; ++i) {
+                if (forked[i].file && forked[i].pid == pid) {
+                    anv_testsuite__collect_fixture(
+                        &forked[i], status, cpu_s - children_cpu_s, &results[i]
+                    );
+                    --running;
+                    break;
+                }
+            }
+            children_cpu_s = cpu_s;
+        }
+
+        // fixtures which could not be forked are reported as failures.
+        while (printed < started
+               && (forked[printed].done || !forked[printed].file)) {
+            total_fails += anv_testsuite__report_fixture(
+                out_file,
+                printed,
+                &suite[printed],
+                &forked[printed],
+                config,
+                &results[printed]
+            );
+            ++printed;
+        }
+    }
+
+    free(forked);
+    return total_fails;
+}
+
+#endif /* ANV_TESTSUITE__HAS_FORK */
+
+static void
+anv_testsuite__write_junit(
+    FILE *report_file,
+    const char *suitename,
+    const anv_testsuite_fixture *suite,
+    size_t suite_sz,
+    const anv_testsuite__result *results,
+    int total_fails,
+    double wall_s
+)
+{
+    fprintf(report_file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(report_file, "<testsuites>\n");
+    fprintf(
+        report_file,
+        "  <testsuite name=\"%s\" tests=\"%d\" failures=\"%d\" errors=\"0\" "
+        "time=\"%.6f\">\n",
+        suitename,
+        (int)suite_sz,
+        total_fails,
+        wall_s
+    );
+    for (size_t i = 0; i < suite_sz; ++i) {
+        const anv_testsuite__result *result = &results[i];
+        fprintf(
+            report_file,
+            "    <testcase name=\"%s\" classname=\"%s\" time=\"%.6f\">\n",
+            suite[i].fixture_name,
+            suitename,
+            result->wall_s
+        );
+        fprintf(report_file, "      <properties>\n");
+        fprintf(
+            report_file,
+            "        <property name=\"cpu_time\" value=\"%.6f\"/>\n",
+            result->cpu_s
+        );
+        if (result->budget_s > 0) {
+            fprintf(
+                report_file,
+                "        <property name=\"budget\" value=\"%.6f\"/>\n"
+                "        <property name=\"over_budget\" value=\"%s\"/>\n",
+                result->budget_s,
+                result->over_budget ? "true" : "false"
+            );
+        }
+        fprintf(report_file, "      </properties>\n");
+        if (result->failed) {
+            fprintf(
+                report_file,
+                "      <failure message=\"%s\"/>\n",
+                result->reason
+            );
+        }
+        fprintf(report_file, "    </testcase>\n");
+    }
+    fprintf(report_file, "  </testsuite>\n");
+    fprintf(report_file, "</testsuites>\n");
+}
+
+static void
+anv_testsuite__write_json(
+    FILE *report_file,
+    const char *suitename,
+    const anv_testsuite_fixture *suite,
+    size_t suite_sz,
+    const anv_testsuite__result *results,
+    int total_fails,
+    double wall_s
+)
+{
+    int over_budget = 0;
+    for (size_t i = 0; i < suite_sz; ++i) {
+        over_budget += results[i].over_budget;
+    }
+    fprintf(report_file, "{\n");
+    fprintf(report_file, "  \"suite\": \"%s\",\n", suitename);
+    fprintf(
+        report_file,
+        "  \"tests\": %d,\n  \"failures\": %d,\n  \"over_budget\": %d,\n",
+        (int)suite_sz,
+        total_fails,
+        over_budget
+    );
+    fprintf(report_file, "  \"wall_s\": %.6f,\n", wall_s);
+    fprintf(report_file, "  \"fixtures\": [");
+    for (size_t i = 0; i < suite_sz; ++i) {
+        const anv_testsuite__result *result = &results[i];
+        fprintf(
+            report_file,
+            "%s\n    {\"name\": \"%s\", \"success\": %s, \"reason\": \"%s\", "
+            "\"wall_s\": %.6f, \"cpu_s\": %.6f, \"budget_s\": %.6f, "
+            "\"over_budget\": %s}",
+            i == 0 ? "" : ",",
+            suite[i].fixture_name,
+            result->failed ? "false" : "true",
+            result->reason,
+            result->wall_s,
+            result->cpu_s,
+            result->budget_s,
+            result->over_budget ? "true" : "false"
+        );
+    }
+    fprintf(report_file, "\n  ]\n}\n");
+}
+
+/*
+ * Open report file named after suitename inside ANV_TESTSUITE_REPORT_DIR if
+ * set, NULL otherwise.
+ */
+static FILE *
+anv_testsuite__open_env_report(
+    const char *suitename, anv_testsuite_report_format *out_format
+)
+{
+    const char *dir = getenv("ANV_TESTSUITE_REPORT_DIR");
+    if (!dir || !*dir) {
+        return NULL;
+    }
+    const char *format = getenv("ANV_TESTSUITE_REPORT_FORMAT");
+    *out_format = format && strcmp(format, "json") == 0
+                    ? ANV_TESTSUITE_REPORT_JSON
+                    : ANV_TESTSUITE_REPORT_JUNIT;
+
+    char path[512];
+    snprintf(
+        path,
+        sizeof(path),
+        "%s/%s.%s",
+        dir,
+        suitename,
+        *out_format == ANV_TESTSUITE_REPORT_JSON ? "json" : "xml"
+    );
+    return fopen(path, "w");
+}
+
+static void
+anv_testsuite__write_report(
+    FILE *report_file,
+    anv_testsuite_report_format report_format,
+    const char *suitename,
+    const anv_testsuite_fixture *suite,
+    size_t suite_sz,
+    const anv_testsuite__result *results,
+    int total_fails,
+    double wall_s
+)
+{
+    FILE *env_file = NULL;
+    if (!report_file || report_format == ANV_TESTSUITE_REPORT_NONE) {
+        env_file = anv_testsuite__open_env_report(suitename, &report_format);
+        report_file = env_file;
+    }
+    if (!report_file) {
+        return;
+    }
+
+    switch (report_format) {
+        case ANV_TESTSUITE_REPORT_JUNIT:
+            anv_testsuite__write_junit(
+                report_file,
+                suitename,
+                suite,
+                suite_sz,
+                results,
+                total_fails,
+                wall_s
+            );
+            break;
+        case ANV_TESTSUITE_REPORT_JSON:
+            anv_testsuite__write_json(
+                report_file,
+                suitename,
+                suite,
+                suite_sz,
+                results,
+                total_fails,
+                wall_s
+            );
+            break;
+        default:
+            break;
+    }
+
+    if (env_file) {
+        fclose(env_file);
+    } else {
+        fflush(report_file);
+    }
+}
+
+/*
+ * Exit statuses are 8 bits: 256 failures must not look like a success.
+ */
+static int
+anv_testsuite__exit_code(int fails)
+{
+    return fails > 255 ? 255 : fails;
+}
+
+static int
 anv_testsuite__run(
     const char *filename,
     int line,
@@ -391,12 +1187,23 @@ anv_testsuite__run(
     size_t suite_sz,
     const char *suitename,
     FILE *out_file,
-    const anv_testsuite_config *config
+    const anv_testsuite_config *config,
+    anv_testsuite_report_format report_format,
+    FILE *report_file
 )
 {
-    int total_fails = 0;
+    int total_fails = -1;
     fprintf(out_file, "Suite(%s:%d): %s\n", filename, line, suitename);
 
+    anv_testsuite__result *results = (anv_testsuite__result *)calloc(
+        suite_sz ? suite_sz : 1, sizeof(anv_testsuite__result)
+    );
+    if (!results) {
+        fprintf(out_file, ANV_TESTSUITE__STR_RED("Out of memory\n"));
+        return anv_testsuite__exit_code((int)suite_sz);
+    }
+    double wall_start = anv_testsuite__wall_time();
+
     // run setup if present
     if (config->setup) {
         fprintf(out_file, "\nRunning setup ...\n");
@@ -410,45 +1217,42 @@ anv_testsuite__run(
                 out_file,
                 "Running setup ... " ANV_TESTSUITE__STR_RED("FAILURE\n\n")
             );
-            return;
+            // no fixture was run.
+            for (size_t i = 0; i < suite_sz; ++i) {
+                results[i].failed = 1;
+                snprintf(
+                    results[i].reason,
+                    sizeof(results[i].reason),
+                    "setup failed"
+                );
+            }
+            anv_testsuite__write_report(
+                report_file,
+                report_format,
+                suitename,
+                suite,
+                suite_sz,
+                results,
+                (int)suite_sz,
+                anv_testsuite__wall_time() - wall_start
+            );
+            free(results);
+            return anv_testsuite__exit_code((int)suite_sz);
         }
     }
 
-    char buff[128] = { 0 };
-    char padd_buff[128] = { 0 };
-
-    for (size_t i = 0; i < suite_sz; ++i) {
-        // pretty print info
-        snprintf(buff, 128, "  [%03ld]  %s", i, suite[i].fixture_name);
-        int padd_sz = ANV_TESTSUITE_PADDING - strlen(buff);
-        if (padd_sz > 0) {
-            snprintf(padd_buff, (size_t)padd_sz, "%s", ANV_TESTSUITE__PADDING);
-        } else {
-            padd_buff[0] = '\0';
-        }
-        fprintf(out_file, "%s %s ", buff, padd_buff);
-
-        // force flush here because if test fixture crashes we may not be able
-        // to get the line log.
-        fflush(out_file);
-
-        if (config->before_each) {
-            config->before_each();
-        }
-
-        // run test
-        int result = 0;
-        suite[i].fixture(&result, out_file);
-
-        if (config->after_each) {
-            config->after_each();
-        }
-
-        if (result == 0) {
-            fprintf(out_file, ANV_TESTSUITE__STR_GREEN("SUCCESS\n"));
-        } else {
-            ++total_fails;
-        }
+#ifdef ANV_TESTSUITE__HAS_FORK
+    int jobs = anv_testsuite__jobs(config);
+    if (jobs > 0) {
+        total_fails = anv_testsuite__run_forked(
+            suite, suite_sz, out_file, config, jobs, results
+        );
+    }
+#endif
+    if (total_fails < 0) {
+        total_fails = anv_testsuite__run_sequential(
+            suite, suite_sz, out_file, config, results
+        );
     }
 
     // run teardown cleanup if present
@@ -483,10 +1287,37 @@ anv_testsuite__run(
             (int)suite_sz
         );
     }
+    int over_budget = 0;
+    for (size_t i = 0; i < suite_sz; ++i) {
+        over_budget += results[i].over_budget;
+    }
+    if (over_budget > 0) {
+        fprintf(
+            out_file,
+            "Over budget: " ANV_TESTSUITE__STR_RED("%d\n"),
+            over_budget
+        );
+    }
+
+    anv_testsuite__write_report(
+        report_file,
+        report_format,
+        suitename,
+        suite,
+        suite_sz,
+        results,
+        total_fails,
+        anv_testsuite__wall_time() - wall_start
+    );
+    free(results);
+    return anv_testsuite__exit_code(total_fails);
 }
 
 /**
  * Run all registered tests fot this testsuite and print results to file.
+ * A report is also written if ANV_TESTSUITE_REPORT_DIR is set.
+ * @return Number of failed fixtures capped at 255, e.g. to be returned by
+ *         main().
  */
 #define ANV_TESTSUITE_RUN(suitename, out_file)                                 \
     anv_testsuite__run(                                                        \
@@ -496,7 +1327,29 @@ anv_testsuite__run(
         ANV_TESTSUITE__LEN(suitename),                                         \
         #suitename,                                                            \
         out_file,                                                              \
-        &suitename##_config                                                    \
+        &suitename##_config,                                                   \
+        ANV_TESTSUITE_REPORT_NONE,                                             \
+        NULL                                                                   \
+    )
+
+/**
+ * Same as ANV_TESTSUITE_RUN and write a machine readable report with the
+ * fixtures timings to report_file.
+ * @param report_format One of anv_testsuite_report_format.
+ */
+#define ANV_TESTSUITE_RUN_WITH_REPORT(                                         \
+    suitename, out_file, report_format, report_file                            \
+)                                                                              \
+    anv_testsuite__run(                                                        \
+        __FILE__,                                                              \
+        __LINE__,                                                              \
+        suitename,                                                             \
+        ANV_TESTSUITE__LEN(suitename),                                         \
+        #suitename,                                                            \
+        out_file,                                                              \
+        &suitename##_config,                                                   \
+        report_format,                                                         \
+        report_file                                                            \
     )
 
 static void
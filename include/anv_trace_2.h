@@ -0,0 +1,1411 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2023 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*------------------------------------------------------------------------------
+    anv_trace_2 (https://github.com/anvouk/anv)
+--------------------------------------------------------------------------------
+
+# anv_trace_2
+
+Leveled logging with an optional asynchronous backend.
+
+Each message is written as a single line:
+
+```
+-- [Info   ] [    0.001234] [    main.c:   12 | main                ] Hi 7
+```
+
+where the second field is the time in seconds since anv_trace_init.
+
+By default messages are formatted and written right away by the calling
+thread, with a single fwrite per line, so lines from different threads never
+interleave.
+
+## Asynchronous mode
+
+Define ANV_TRACE_ENABLE_ASYNC before including the implementation to move
+formatting and I/O to a background writer thread (requires POSIX threads, link
+with -pthread):
+
+```
+== brief overview ==
+
+ thread A --record--> |SPSC ring A|--\
+ thread B --record--> |SPSC ring B|---+--> writer thread --batch--> out_file
+ thread C --record--> |SPSC ring C|--/     (sort, format, fwrite)
+```
+
+A trace call only stores a binary record (format pointer, level, timestamp,
+call site and a copy of the args) in a lock-free ring owned by the calling
+thread, see anv_ring.h. The writer drains all rings in batches, sorts each
+batch by timestamp and formats it. A thread gets its ring on its first trace
+call and the ring is released once the thread has exited and the writer has
+drained it.
+
+Args are copied according to the format string, which must thus be a string
+literal (or live until anv_trace_quit). Strings (%s) are copied into the
+record: once its ANV_TRACE_PAYLOAD_SZ bytes are full, the rest of the message
+is replaced by "[truncated]". Wide chars and strings (%lc, %ls) are not
+supported, long doubles (%Lf) are printed as doubles.
+
+When a ring is full the record is dropped and counted (see anv_trace_stats),
+unless ANV_TRACE_OVERFLOW_BLOCK is set in anv_trace_options.
+
+Fatal messages are always written synchronously, after anything queued by the
+calling thread, so that they are not lost in case of a crash.
+
+## Compile-time level
+
+Define ANV_TRACE_MIN_LEVEL (ANV_TRACE_DEBUG by default) to remove all trace
+calls of lower levels. Their args are not evaluated.
+
+## Dependencies
+
+- anv_ring.h (asynchronous mode only)
+
+## Include usage
+
+```c
+// asynchronous mode only.
+#define ANV_METALLOC_IMPLEMENTATION
+#define ANV_RING_IMPLEMENTATION
+#define ANV_TRACE_ENABLE_ASYNC
+
+#define ANV_TRACE_IMPLEMENTATION
+#include "anv_trace_2.h"
+```
+
+## Examples
+
+```c
+int
+main(void)
+{
+    anv_trace_init(stdout);
+
+    anv_trace_enter();
+    anv_traced("Hello %s!", "Debug");
+    anv_tracei("Hello %s!", "Info");
+    anv_tracew("Hello %s!", "Warning");
+    anv_tracee("Hello %s!", "Error");
+    anv_tracef("Hello %s!", "Fatal");
+    anv_trace_leave();
+
+    anv_trace_quit();
+}
+```
+
+------------------------------------------------------------------------------*/
+
+#ifndef ANV_TRACE_2_H
+#define ANV_TRACE_2_H
+
+#include <stddef.h> /* for size_t */
+#include <stdio.h> /* for FILE */
+
+/** verbose. */
+#define ANV_TRACE_DEBUG   0
+/** common log message. */
+#define ANV_TRACE_INFO    1
+/** warning log message. */
+#define ANV_TRACE_WARNING 2
+/** current operation aborted. the program will not crash. */
+#define ANV_TRACE_ERROR   3
+/** critical failure. program crash imminent. */
+#define ANV_TRACE_FATAL   4
+
+#ifndef ANV_TRACE_MIN_LEVEL
+#define ANV_TRACE_MIN_LEVEL ANV_TRACE_DEBUG
+#endif
+
+/**
+ * Max length of a single line, longer lines are cut.
+ */
+#ifndef ANV_TRACE_MAX_LINE_LEN
+#define ANV_TRACE_MAX_LINE_LEN 1024
+#endif
+
+/**
+ * Bytes available in each record for args (asynchronous mode only).
+ */
+#ifndef ANV_TRACE_PAYLOAD_SZ
+#define ANV_TRACE_PAYLOAD_SZ 192
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum anv_trace_result {
+    ANV_TRACE_OK = 0,
+    ANV_TRACE_INVALID_PARAMS = 1,
+    ANV_TRACE_ALLOC_ERROR = 2,
+    /**
+     * The writer thread could not be started.
+     */
+    ANV_TRACE_THREAD_ERROR = 10,
+} anv_trace_result;
+
+/**
+ * What to do with records which do not fit in a full ring (asynchronous mode
+ * only).
+ */
+typedef enum anv_trace_overflow {
+    /** Drop the record, see anv_trace_stats. */
+    ANV_TRACE_OVERFLOW_DROP = 0,
+    /** Wait for the writer to make room. */
+    ANV_TRACE_OVERFLOW_BLOCK = 1,
+} anv_trace_overflow;
+
+typedef struct anv_trace_options {
+    FILE *out_file;
+    /** Records queued at most by each thread, 0 for 4096. Async only. */
+    size_t ring_capacity;
+    /** Records formatted in a single batch, 0 for 256. Async only. */
+    size_t batch_sz;
+    /** Microseconds the writer sleeps once all rings are empty, 0 for 1000. */
+    unsigned long idle_us;
+    anv_trace_overflow overflow;
+} anv_trace_options;
+
+typedef struct anv_trace_stats {
+    /** Lines written. */
+    size_t written_count;
+    /** Records dropped because of full rings. */
+    size_t dropped_count;
+} anv_trace_stats;
+
+/**
+ * Start tracing to file with default options.
+ */
+anv_trace_result anv_trace_init(FILE *file);
+
+anv_trace_result anv_trace_init_with_options(const anv_trace_options *options);
+
+/**
+ * Write everything queued so far, stop the writer thread and release all
+ * rings. No other thread may be tracing.
+ */
+void anv_trace_quit(void);
+
+/**
+ * Wait until all the records queued so far are written and flush the file.
+ */
+void anv_trace_flush(void);
+
+void anv_trace_get_stats(anv_trace_stats *out_stats);
+
+void anv_trace_(
+    const char *filename,
+    int line,
+    const char *func,
+    int level,
+    const char *format,
+    ...
+)
+#ifdef __GNUC__
+    __attribute__((format(printf, 5, 6)))
+#endif
+    ;
+
+#define anv_trace(level, ...)                                                  \
+    do {                                                                       \
+        if ((level) >= ANV_TRACE_MIN_LEVEL) {                                  \
+            anv_trace_(__FILE__, __LINE__, __func__, (level), __VA_ARGS__);    \
+        }                                                                      \
+    } while (0)
+
+#if ANV_TRACE_MIN_LEVEL <= ANV_TRACE_DEBUG
+#define anv_traced(...)                                                        \
+    anv_trace_(__FILE__, __LINE__, __func__, ANV_TRACE_DEBUG, __VA_ARGS__)
+#else
+#define anv_traced(...) ((void)0)
+#endif
+
+#if ANV_TRACE_MIN_LEVEL <= ANV_TRACE_INFO
+#define anv_tracei(...)                                                        \
+    anv_trace_(__FILE__, __LINE__, __func__, ANV_TRACE_INFO, __VA_ARGS__)
+#else
+#define anv_tracei(...) ((void)0)
+#endif
+
+#if ANV_TRACE_MIN_LEVEL <= ANV_TRACE_WARNING
+#define anv_tracew(...)                                                        \
+    anv_trace_(__FILE__, __LINE__, __func__, ANV_TRACE_WARNING, __VA_ARGS__)
+#else
+#define anv_tracew(...) ((void)0)
+#endif
+
+#if ANV_TRACE_MIN_LEVEL <= ANV_TRACE_ERROR
+#define anv_tracee(...)                                                        \
+    anv_trace_(__FILE__, __LINE__, __func__, ANV_TRACE_ERROR, __VA_ARGS__)
+#else
+#define anv_tracee(...) ((void)0)
+#endif
+
+#define anv_tracef(...)                                                        \
+    anv_trace_(__FILE__, __LINE__, __func__, ANV_TRACE_FATAL, __VA_ARGS__)
+
+#define anv_trace_enter() anv_traced("<< entering \"%s\"", __func__)
+#define anv_trace_leave() anv_traced(">> leaving  \"%s\"", __func__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ANV_TRACE_2_H */
+
+#ifdef ANV_TRACE_IMPLEMENTATION
+
+#include <stdarg.h>
+#include <stdint.h> /* for uint64_t, intmax_t */
+#include <stdlib.h> /* for malloc(), qsort() */
+#include <string.h> /* for memcpy(), strrchr() */
+#include <time.h>
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/time.h> /* for gettimeofday() */
+#define ANV_TRACE__HAS_GETTIMEOFDAY
+#endif
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+#include <pthread.h>
+#include <sched.h> /* for sched_yield() */
+
+#include "anv_ring.h"
+#endif
+
+#ifndef anv_trace__assert
+#include <assert.h>
+#define anv_trace__assert(cond, msg) assert((cond) && (msg))
+#endif
+
+#ifdef __GNUC__
+#define ANV_TRACE__LIKELY(x)   __builtin_expect((x), 1)
+#define ANV_TRACE__UNLIKELY(x) __builtin_expect((x), 0)
+#define ANV_TRACE__ADD(ptr, n) __atomic_fetch_add((ptr), (n), __ATOMIC_RELAXED)
+#define ANV_TRACE__LOAD(ptr)   __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ANV_TRACE__STORE(ptr, val)                                             \
+    __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else
+#define ANV_TRACE__LIKELY(x)       (x)
+#define ANV_TRACE__UNLIKELY(x)     (x)
+#define ANV_TRACE__ADD(ptr, n)     (*(ptr) += (n))
+#define ANV_TRACE__LOAD(ptr)       (*(ptr))
+#define ANV_TRACE__STORE(ptr, val) (*(ptr) = (val))
+#endif
+
+#define ANV_TRACE__DEFAULT_RING_CAPACITY 4096
+#define ANV_TRACE__DEFAULT_BATCH_SZ      256
+#define ANV_TRACE__DEFAULT_IDLE_US       1000
+
+#ifdef ANV_TRACE_NO_PRETTY_PRINT
+#define ANV_TRACE__FORMAT_HEADER                                               \
+    "== [MESSAGE] [%s: LINE | %s] Begin Trace (%d/%.2d/%.2d - "                \
+    "%.2d:%.2d:%.2d)\n\n"
+#define ANV_TRACE__FORMAT_PREFIX "-- [%s] [%.6f] [%s:%d | %s] "
+#define ANV_TRACE__FORMAT_FOOTER                                               \
+    "\n== [MESSAGE] [%s: LINE | %s] End Trace   (%d/%.2d/%.2d - "              \
+    "%.2d:%.2d:%.2d)\n"
+#else
+#define ANV_TRACE__FORMAT_HEADER                                               \
+    "== [MESSAGE] [%25s: LINE | %-20s] Begin Trace (%d/%.2d/%.2d - "           \
+    "%.2d:%.2d:%.2d)\n\n"
+#define ANV_TRACE__FORMAT_PREFIX "-- [%-7s] [%12.6f] [%25s:%5d | %-20s] "
+#define ANV_TRACE__FORMAT_FOOTER                                               \
+    "\n== [MESSAGE] [%25s: LINE | %-20s] End Trace   (%d/%.2d/%.2d - "         \
+    "%.2d:%.2d:%.2d)\n"
+#endif
+
+#define ANV_TRACE__TRUNCATED "[truncated]"
+
+static struct {
+    int initialized;
+    FILE *out_file;
+    uint64_t start_ns;
+    size_t written_count;
+    size_t dropped_count;
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    anv_trace_options options;
+    /** Guards producers and consumer side of all rings. */
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    pthread_t writer;
+    pthread_key_t producer_key;
+    struct anv_trace__producer *producers;
+    int stop;
+    /** Batch buffer, only used with the mutex held. */
+    struct anv_trace__record *batch;
+#endif
+} anv_trace__state;
+
+static uint64_t
+anv_trace__now_ns(void)
+{
+#if defined(ANV_TRACE__HAS_GETTIMEOFDAY) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#elif defined(ANV_TRACE__HAS_GETTIMEOFDAY)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000000u + (uint64_t)tv.tv_usec * 1000u;
+#else
+    // the Microsoft CRT clock() measures wall time.
+    return (uint64_t)((double)clock() / CLOCKS_PER_SEC * 1e9);
+#endif
+}
+
+static const char *
+anv_trace__get_filename(const char *file)
+{
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return (strrchr(file, '\\') ? strrchr(file, '\\') + 1 : file);
+#else
+    return (strrchr(file, '/') ? strrchr(file, '/') + 1 : file);
+#endif
+}
+
+static const char *
+anv_trace__tostr(int level)
+{
+    switch (level) {
+        case ANV_TRACE_DEBUG:
+            return "Debug";
+        case ANV_TRACE_INFO:
+            return "Info";
+        case ANV_TRACE_WARNING:
+            return "Warning";
+        case ANV_TRACE_ERROR:
+            return "Error";
+        case ANV_TRACE_FATAL:
+            return "Fatal";
+        default:
+            anv_trace__assert(0, "unknown trace level");
+            return "Unknown";
+    }
+}
+
+static void
+anv_trace__print_sep(const char *format)
+{
+    time_t raw = time(NULL);
+    struct tm *t = localtime(&raw);
+    fprintf(
+        anv_trace__state.out_file,
+        format,
+        "FILENAME",
+        "FUNCTION",
+        t->tm_year + 1900,
+        t->tm_mon + 1,
+        t->tm_mday,
+        t->tm_hour,
+        t->tm_min,
+        t->tm_sec
+    );
+}
+
+/*
+ * Write line prefix to buff, return its length.
+ */
+static size_t
+anv_trace__prefix(
+    char *buff,
+    const char *filename,
+    int line,
+    const char *func,
+    int level,
+    uint64_t timestamp_ns
+)
+{
+    int len = snprintf(
+        buff,
+        ANV_TRACE_MAX_LINE_LEN,
+        ANV_TRACE__FORMAT_PREFIX,
+        anv_trace__tostr(level),
+        (double)(timestamp_ns - anv_trace__state.start_ns) * 1e-9,
+        anv_trace__get_filename(filename),
+        line,
+        func
+    );
+    if (ANV_TRACE__UNLIKELY(len < 0)) {
+        return 0;
+    }
+    return (size_t)len < ANV_TRACE_MAX_LINE_LEN ? (size_t)len
+                                                : ANV_TRACE_MAX_LINE_LEN - 1;
+}
+
+/*
+ * Terminate the line of len chars and write it at once.
+ */
+static void
+anv_trace__write_line(char *buff, size_t len)
+{
+    if (len > ANV_TRACE_MAX_LINE_LEN - 2) {
+        len = ANV_TRACE_MAX_LINE_LEN - 2;
+    }
+    buff[len++] = '\n';
+    fwrite(buff, 1, len, anv_trace__state.out_file);
+    ANV_TRACE__ADD(&anv_trace__state.written_count, 1);
+}
+
+static void
+anv_trace__write_sync(
+    const char *filename,
+    int line,
+    const char *func,
+    int level,
+    uint64_t timestamp_ns,
+    const char *format,
+    va_list args
+)
+{
+    char buff[ANV_TRACE_MAX_LINE_LEN];
+    size_t len
+        = anv_trace__prefix(buff, filename, line, func, level, timestamp_ns);
+    int msg_len
+        = vsnprintf(buff + len, ANV_TRACE_MAX_LINE_LEN - len, format, args);
+    if (msg_len > 0) {
+        len += (size_t)msg_len;
+    }
+    anv_trace__write_line(buff, len);
+}
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+
+/*
+ * Binary trace call, args are formatted by the writer.
+ */
+typedef struct anv_trace__record {
+    const char *filename;
+    const char *func;
+    const char *format;
+    uint64_t timestamp_ns;
+    int line;
+    int level;
+    /** Conversions stored in payload, the rest of the message is cut. */
+    unsigned short args_count;
+    unsigned char truncated;
+    /** Position in the writer batch before sorting. */
+    size_t batch_index;
+    unsigned char payload[ANV_TRACE_PAYLOAD_SZ];
+} anv_trace__record;
+
+typedef struct anv_trace__producer {
+    anv_ring_t ring;
+    /** Set once the owning thread has exited. */
+    int retired;
+    struct anv_trace__producer *next;
+} anv_trace__producer;
+
+typedef enum anv_trace__arg_kind {
+    ANV_TRACE__ARG_NONE,
+    ANV_TRACE__ARG_INT,
+    ANV_TRACE__ARG_UINT,
+    ANV_TRACE__ARG_DOUBLE,
+    ANV_TRACE__ARG_STRING,
+    ANV_TRACE__ARG_CHAR,
+    ANV_TRACE__ARG_POINTER,
+    ANV_TRACE__ARG_UNSUPPORTED,
+} anv_trace__arg_kind;
+
+typedef enum anv_trace__length {
+    ANV_TRACE__LEN_NONE,
+    ANV_TRACE__LEN_HH,
+    ANV_TRACE__LEN_H,
+    ANV_TRACE__LEN_L,
+    ANV_TRACE__LEN_LL,
+    ANV_TRACE__LEN_J,
+    ANV_TRACE__LEN_Z,
+    ANV_TRACE__LEN_T,
+    ANV_TRACE__LEN_BIG_L,
+} anv_trace__length;
+
+/*
+ * A printf conversion spec, from '%' to the conversion char included.
+ */
+typedef struct anv_trace__spec {
+    const char *flags;
+    size_t flags_len;
+    /** -1 when not set. */
+    int width;
+    int precision;
+    /** Set for '*', the value is then taken from the args. */
+    int width_star;
+    int precision_star;
+    anv_trace__length length;
+    char conversion;
+    anv_trace__arg_kind kind;
+} anv_trace__spec;
+
+/*
+ * Parse the spec starting right after a '%', return the char after it or NULL
+ * at the end of the format.
+ */
+static const char *
+anv_trace__parse_spec(const char *p, anv_trace__spec *spec)
+{
+    spec->flags = p;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        ++p;
+    }
+    spec->flags_len = (size_t)(p - spec->flags);
+
+    spec->width = -1;
+    spec->width_star = 0;
+    if (*p == '*') {
+        spec->width_star = 1;
+        ++p;
+    } else if (*p >= '0' && *p <= '9') {
+        spec->width = 0;
+        while (*p >= '0' && *p <= '9') {
+            spec->width = spec->width * 10 + (*p++ - '0');
+        }
+    }
+    spec->precision = -1;
+    spec->precision_star = 0;
+    if (*p == '.') {
+        ++p;
+        spec->precision = 0;
+        if (*p == '*') {
+            spec->precision_star = 1;
+            ++p;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p++ - '0');
+            }
+        }
+    }
+
+    spec->length = ANV_TRACE__LEN_NONE;
+    switch (*p) {
+        case 'h':
+            spec->length = p[1] == 'h' ? ANV_TRACE__LEN_HH : ANV_TRACE__LEN_H;
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            spec->length = p[1] == 'l' ? ANV_TRACE__LEN_LL : ANV_TRACE__LEN_L;
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'j':
+            spec->length = ANV_TRACE__LEN_J;
+            ++p;
+            break;
+        case 'z':
+            spec->length = ANV_TRACE__LEN_Z;
+            ++p;
+            break;
+        case 't':
+            spec->length = ANV_TRACE__LEN_T;
+            ++p;
+            break;
+        case 'L':
+            spec->length = ANV_TRACE__LEN_BIG_L;
+            ++p;
+            break;
+        default:
+            break;
+    }
+
+    spec->conversion = *p;
+    switch (*p) {
+        case 'd':
+        case 'i':
+            spec->kind = ANV_TRACE__ARG_INT;
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            spec->kind = ANV_TRACE__ARG_UINT;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec->kind = ANV_TRACE__ARG_DOUBLE;
+            break;
+        case 's':
+            spec->kind = spec->length == ANV_TRACE__LEN_L
+                ? ANV_TRACE__ARG_UNSUPPORTED
+                : ANV_TRACE__ARG_STRING;
+            break;
+        case 'c':
+            spec->kind = spec->length == ANV_TRACE__LEN_L
+                ? ANV_TRACE__ARG_UNSUPPORTED
+                : ANV_TRACE__ARG_CHAR;
+            break;
+        case 'p':
+            spec->kind = ANV_TRACE__ARG_POINTER;
+            break;
+        case 'n':
+            spec->kind = ANV_TRACE__ARG_NONE;
+            break;
+        case '\0':
+            return NULL;
+        default:
+            spec->kind = ANV_TRACE__ARG_UNSUPPORTED;
+            break;
+    }
+    return p + 1;
+}
+
+static intmax_t
+anv_trace__va_int(va_list *args, anv_trace__length length)
+{
+    switch (length) {
+        case ANV_TRACE__LEN_HH:
+            return (signed char)va_arg(*args, int);
+        case ANV_TRACE__LEN_H:
+            return (short)va_arg(*args, int);
+        case ANV_TRACE__LEN_L:
+            return va_arg(*args, long);
+        case ANV_TRACE__LEN_LL:
+            return va_arg(*args, long long);
+        case ANV_TRACE__LEN_J:
+            return va_arg(*args, intmax_t);
+        case ANV_TRACE__LEN_Z:
+            return (intmax_t)va_arg(*args, size_t);
+        case ANV_TRACE__LEN_T:
+            return va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, int);
+    }
+}
+
+static uintmax_t
+anv_trace__va_uint(va_list *args, anv_trace__length length)
+{
+    switch (length) {
+        case ANV_TRACE__LEN_HH:
+            return (unsigned char)va_arg(*args, unsigned int);
+        case ANV_TRACE__LEN_H:
+            return (unsigned short)va_arg(*args, unsigned int);
+        case ANV_TRACE__LEN_L:
+            return va_arg(*args, unsigned long);
+        case ANV_TRACE__LEN_LL:
+            return va_arg(*args, unsigned long long);
+        case ANV_TRACE__LEN_J:
+            return va_arg(*args, uintmax_t);
+        case ANV_TRACE__LEN_Z:
+            return va_arg(*args, size_t);
+        case ANV_TRACE__LEN_T:
+            return (uintmax_t)va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, unsigned int);
+    }
+}
+
+/*
+ * Append sz bytes to the record payload, return 0 if they do not fit.
+ */
+static int
+anv_trace__store(
+    anv_trace__record *record, size_t *used, const void *value, size_t sz
+)
+{
+    if (ANV_TRACE__UNLIKELY(*used + sz > ANV_TRACE_PAYLOAD_SZ)) {
+        return 0;
+    }
+    memcpy(record->payload + *used, value, sz);
+    *used += sz;
+    return 1;
+}
+
+/*
+ * Copy args to the record payload following format.
+ */
+static void
+anv_trace__capture(
+    anv_trace__record *record, const char *format, va_list *args
+)
+{
+    size_t used = 0;
+    record->args_count = 0;
+    record->truncated = 0;
+    const char *p = format;
+    while ((p = strchr(p, '%')) != NULL) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        anv_trace__spec spec;
+        p = anv_trace__parse_spec(p + 1, &spec);
+        if (!p) {
+            return;
+        }
+        int ok = 1;
+        if (spec.width_star) {
+            int width = va_arg(*args, int);
+            ok = anv_trace__store(record, &used, &width, sizeof(width));
+        }
+        int precision = spec.precision;
+        if (ok && spec.precision_star) {
+            precision = va_arg(*args, int);
+            ok = anv_trace__store(record, &used, &precision, sizeof(precision));
+        }
+        if (ok) {
+            switch (spec.kind) {
+                case ANV_TRACE__ARG_INT: {
+                    intmax_t value = anv_trace__va_int(args, spec.length);
+                    ok = anv_trace__store(record, &used, &value, sizeof(value));
+                    break;
+                }
+                case ANV_TRACE__ARG_UINT: {
+                    uintmax_t value = anv_trace__va_uint(args, spec.length);
+                    ok = anv_trace__store(record, &used, &value, sizeof(value));
+                    break;
+                }
+                case ANV_TRACE__ARG_DOUBLE: {
+                    double value = spec.length == ANV_TRACE__LEN_BIG_L
+                        ? (double)va_arg(*args, long double)
+                        : va_arg(*args, double);
+                    ok = anv_trace__store(record, &used, &value, sizeof(value));
+                    break;
+                }
+                case ANV_TRACE__ARG_CHAR: {
+                    int value = va_arg(*args, int);
+                    ok = anv_trace__store(record, &used, &value, sizeof(value));
+                    break;
+                }
+                case ANV_TRACE__ARG_POINTER: {
+                    void *value = va_arg(*args, void *);
+                    ok = anv_trace__store(record, &used, &value, sizeof(value));
+                    break;
+                }
+                case ANV_TRACE__ARG_STRING: {
+                    const char *value = va_arg(*args, const char *);
+                    if (!value) {
+                        value = "(null)";
+                    }
+                    // with a precision, value may not be null terminated.
+                    // Strings are cut to the room left, the cut part is
+                    // still printed.
+                    size_t len = 0;
+                    if (precision >= 0) {
+                        while (len < (size_t)precision && value[len]) {
+                            ++len;
+                        }
+                    } else {
+                        len = strlen(value);
+                    }
+                    if (used + len + 1 > ANV_TRACE_PAYLOAD_SZ) {
+                        if (used + 1 >= ANV_TRACE_PAYLOAD_SZ) {
+                            ok = 0;
+                            break;
+                        }
+                        len = ANV_TRACE_PAYLOAD_SZ - used - 1;
+                        record->truncated = 1;
+                    }
+                    memcpy(record->payload + used, value, len);
+                    record->payload[used + len] = '\0';
+                    used += len + 1;
+                    break;
+                }
+                case ANV_TRACE__ARG_NONE:
+                    (void)va_arg(*args, void *);
+                    break;
+                case ANV_TRACE__ARG_UNSUPPORTED:
+                    ok = 0;
+                    break;
+            }
+        }
+        if (!ok) {
+            record->truncated = 1;
+            return;
+        }
+        ++record->args_count;
+        if (record->truncated) {
+            return;
+        }
+    }
+}
+
+static int
+anv_trace__load_int(const anv_trace__record *record, size_t *used)
+{
+    int value;
+    memcpy(&value, record->payload + *used, sizeof(value));
+    *used += sizeof(value);
+    return value;
+}
+
+/*
+ * Format a single conversion with its stored arg to out, return the number of
+ * chars written.
+ */
+static size_t
+anv_trace__replay_spec(
+    const anv_trace__record *record,
+    size_t *used,
+    anv_trace__spec *spec,
+    char *out,
+    size_t out_sz
+)
+{
+    int width = spec->width;
+    int precision = spec->precision;
+    if (spec->width_star) {
+        width = anv_trace__load_int(record, used);
+    }
+    if (spec->precision_star) {
+        precision = anv_trace__load_int(record, used);
+        // negative precisions are ignored, like printf does.
+        if (precision < 0) {
+            precision = -1;
+        }
+    }
+
+    // rebuild the spec with actual numbers and the widest length modifier.
+    char fmt[48];
+    size_t n = 0;
+    fmt[n++] = '%';
+    for (size_t i = 0; i < spec->flags_len && n < 8; ++i) {
+        fmt[n++] = spec->flags[i];
+    }
+    if (width < -1 || (spec->width_star && width == -1)) {
+        // negative '*' widths mean left aligned.
+        fmt[n++] = '-';
+        width = -width;
+    }
+    int len = 0;
+    if (width >= 0) {
+        len = snprintf(fmt + n, sizeof(fmt) - n, "%d", width);
+        n += len > 0 ? (size_t)len : 0;
+    }
+    if (precision >= 0) {
+        len = snprintf(fmt + n, sizeof(fmt) - n, ".%d", precision);
+        n += len > 0 ? (size_t)len : 0;
+    }
+    if (spec->kind == ANV_TRACE__ARG_INT || spec->kind == ANV_TRACE__ARG_UINT) {
+        fmt[n++] = 'j';
+    }
+    fmt[n++] = spec->conversion;
+    fmt[n] = '\0';
+
+    len = 0;
+    switch (spec->kind) {
+        case ANV_TRACE__ARG_INT: {
+            intmax_t value;
+            memcpy(&value, record->payload + *used, sizeof(value));
+            *used += sizeof(value);
+            len = snprintf(out, out_sz, fmt, value);
+            break;
+        }
+        case ANV_TRACE__ARG_UINT: {
+            uintmax_t value;
+            memcpy(&value, record->payload + *used, sizeof(value));
+            *used += sizeof(value);
+            len = snprintf(out, out_sz, fmt, value);
+            break;
+        }
+        case ANV_TRACE__ARG_DOUBLE: {
+            double value;
+            memcpy(&value, record->payload + *used, sizeof(value));
+            *used += sizeof(value);
+            len = snprintf(out, out_sz, fmt, value);
+            break;
+        }
+        case ANV_TRACE__ARG_CHAR:
+            len = snprintf(out, out_sz, fmt, anv_trace__load_int(record, used));
+            break;
+        case ANV_TRACE__ARG_POINTER: {
+            void *value;
+            memcpy(&value, record->payload + *used, sizeof(value));
+            *used += sizeof(value);
+            len = snprintf(out, out_sz, fmt, value);
+            break;
+        }
+        case ANV_TRACE__ARG_STRING: {
+            const char *value = (const char *)record->payload + *used;
+            *used += strlen(value) + 1;
+            len = snprintf(out, out_sz, fmt, value);
+            break;
+        }
+        default:
+            break;
+    }
+    if (len < 0) {
+        return 0;
+    }
+    return (size_t)len < out_sz ? (size_t)len : out_sz - 1;
+}
+
+/*
+ * Format the message of record to out, return its length.
+ */
+static size_t
+anv_trace__replay(const anv_trace__record *record, char *out, size_t out_sz)
+{
+    size_t n = 0;
+    size_t used = 0;
+    size_t args_count = 0;
+    const char *p = record->format;
+    while (*p && n + 1 < out_sz) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+        if (args_count == record->args_count) {
+            if (record->truncated) {
+                int len = snprintf(out + n, out_sz - n, ANV_TRACE__TRUNCATED);
+                n += len > 0 ? (size_t)len : 0;
+            }
+            break;
+        }
+        anv_trace__spec spec;
+        p = anv_trace__parse_spec(p + 1, &spec);
+        if (!p) {
+            break;
+        }
+        n += anv_trace__replay_spec(record, &used, &spec, out + n, out_sz - n);
+        ++args_count;
+        // the last stored arg was cut, the rest of the message is lost.
+        if (args_count == record->args_count && record->truncated) {
+            int len = snprintf(out + n, out_sz - n, ANV_TRACE__TRUNCATED);
+            n += len > 0 ? (size_t)len : 0;
+            break;
+        }
+    }
+    if (n >= out_sz) {
+        n = out_sz - 1;
+    }
+    return n;
+}
+
+static void
+anv_trace__write_record(const anv_trace__record *record)
+{
+    char buff[ANV_TRACE_MAX_LINE_LEN];
+    size_t len = anv_trace__prefix(
+        buff,
+        record->filename,
+        record->line,
+        record->func,
+        record->level,
+        record->timestamp_ns
+    );
+    len += anv_trace__replay(record, buff + len, ANV_TRACE_MAX_LINE_LEN - len);
+    anv_trace__write_line(buff, len);
+}
+
+static int
+anv_trace__compare_records(const void *a, const void *b)
+{
+    const anv_trace__record *ra = (const anv_trace__record *)a;
+    const anv_trace__record *rb = (const anv_trace__record *)b;
+    if (ra->timestamp_ns != rb->timestamp_ns) {
+        return ra->timestamp_ns < rb->timestamp_ns ? -1 : 1;
+    }
+    // same thread records keep their order.
+    return ra->batch_index < rb->batch_index ? -1 : 1;
+}
+
+/*
+ * Pop up to share records from each ring into the batch, release exited
+ * threads rings once empty. Set *out_next to the first ring left unvisited by
+ * a full batch, NULL if all were visited. Must hold the mutex.
+ */
+static size_t
+anv_trace__fill_batch(
+    size_t count, size_t share, anv_trace__producer ***out_next
+)
+{
+    size_t batch_sz = anv_trace__state.options.batch_sz;
+    anv_trace__producer **link = &anv_trace__state.producers;
+    while (*link && count < batch_sz) {
+        anv_trace__producer *producer = *link;
+        int retired = ANV_TRACE__LOAD(&producer->retired);
+        size_t room = batch_sz - count;
+        count += anv_ring_pop_n(
+            producer->ring,
+            anv_trace__state.batch + count,
+            share < room ? share : room
+        );
+        // retired is read first: nothing can be pushed after it is set.
+        if (retired && anv_ring_length(producer->ring) == 0) {
+            *link = producer->next;
+            anv_ring_destroy(producer->ring);
+            free(producer);
+            continue;
+        }
+        link = &producer->next;
+    }
+    *out_next = link;
+    return count;
+}
+
+/*
+ * Write a batch of records from all rings and return how many were written.
+ * Each ring gets an equal share of the batch first, so that busy threads
+ * cannot starve the others, then the rest is filled in list order. With more
+ * rings than batch slots, the rings left out start the next batch. Must hold
+ * the mutex.
+ */
+static size_t
+anv_trace__drain_batch(void)
+{
+    size_t batch_sz = anv_trace__state.options.batch_sz;
+    size_t producers_count = 0;
+    for (anv_trace__producer *producer = anv_trace__state.producers; producer;
+         producer = producer->next) {
+        ++producers_count;
+    }
+    if (producers_count == 0) {
+        return 0;
+    }
+    size_t share = batch_sz / producers_count;
+    anv_trace__producer **next;
+    size_t count = anv_trace__fill_batch(0, share > 0 ? share : 1, &next);
+    if (*next) {
+        // rotate the list so that the unvisited rings come first.
+        anv_trace__producer *tail = *next;
+        while (tail->next) {
+            tail = tail->next;
+        }
+        tail->next = anv_trace__state.producers;
+        anv_trace__state.producers = *next;
+        *next = NULL;
+    } else if (count < batch_sz) {
+        count = anv_trace__fill_batch(count, batch_sz, &next);
+    }
+    if (count == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        anv_trace__state.batch[i].batch_index = i;
+    }
+    qsort(
+        anv_trace__state.batch,
+        count,
+        sizeof(anv_trace__record),
+        anv_trace__compare_records
+    );
+    for (size_t i = 0; i < count; ++i) {
+        anv_trace__write_record(&anv_trace__state.batch[i]);
+    }
+    return count;
+}
+
+static void
+anv_trace__drain_all(void)
+{
+    while (anv_trace__drain_batch() > 0) {
+    }
+    fflush(anv_trace__state.out_file);
+}
+
+static void *
+anv_trace__writer_main(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    while (!anv_trace__state.stop) {
+        size_t written = 0;
+        size_t count;
+        while ((count = anv_trace__drain_batch()) > 0) {
+            written += count;
+        }
+        if (written > 0) {
+            fflush(anv_trace__state.out_file);
+            continue;
+        }
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        uint64_t wake_us = (uint64_t)now.tv_sec * 1000000u
+            + (uint64_t)now.tv_usec + anv_trace__state.options.idle_us;
+        struct timespec deadline;
+        deadline.tv_sec = (time_t)(wake_us / 1000000u);
+        deadline.tv_nsec = (long)(wake_us % 1000000u) * 1000;
+        pthread_cond_timedwait(
+            &anv_trace__state.wakeup, &anv_trace__state.mutex, &deadline
+        );
+    }
+    anv_trace__drain_all();
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+    return NULL;
+}
+
+static void
+anv_trace__producer_exit(void *arg)
+{
+    ANV_TRACE__STORE(&((anv_trace__producer *)arg)->retired, 1);
+}
+
+/*
+ * Ring of the calling thread, created on first use. NULL on alloc errors.
+ */
+static anv_trace__producer *
+anv_trace__get_producer(void)
+{
+    anv_trace__producer *producer = (anv_trace__producer *)pthread_getspecific(
+        anv_trace__state.producer_key
+    );
+    if (ANV_TRACE__LIKELY(producer != NULL)) {
+        return producer;
+    }
+
+    producer = (anv_trace__producer *)malloc(sizeof(anv_trace__producer));
+    if (ANV_TRACE__UNLIKELY(!producer)) {
+        return NULL;
+    }
+    producer->ring = anv_ring_new(
+        ANV_RING_SPSC,
+        anv_trace__state.options.ring_capacity,
+        sizeof(anv_trace__record)
+    );
+    if (ANV_TRACE__UNLIKELY(!producer->ring)) {
+        free(producer);
+        return NULL;
+    }
+    producer->retired = 0;
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    producer->next = anv_trace__state.producers;
+    anv_trace__state.producers = producer;
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+    pthread_setspecific(anv_trace__state.producer_key, producer);
+    return producer;
+}
+
+static void
+anv_trace__write_async(
+    const char *filename,
+    int line,
+    const char *func,
+    int level,
+    uint64_t timestamp_ns,
+    const char *format,
+    va_list *args
+)
+{
+    anv_trace__producer *producer = anv_trace__get_producer();
+    if (ANV_TRACE__UNLIKELY(!producer)) {
+        ANV_TRACE__ADD(&anv_trace__state.dropped_count, 1);
+        return;
+    }
+    anv_trace__record record;
+    record.filename = filename;
+    record.func = func;
+    record.format = format;
+    record.timestamp_ns = timestamp_ns;
+    record.line = line;
+    record.level = level;
+    anv_trace__capture(&record, format, args);
+
+    while (anv_ring_push(producer->ring, &record) != ANV_RING_RESULT_OK) {
+        if (anv_trace__state.options.overflow != ANV_TRACE_OVERFLOW_BLOCK) {
+            ANV_TRACE__ADD(&anv_trace__state.dropped_count, 1);
+            return;
+        }
+        pthread_cond_signal(&anv_trace__state.wakeup);
+        sched_yield();
+    }
+}
+
+#endif /* ANV_TRACE_ENABLE_ASYNC */
+
+anv_trace_result
+anv_trace_init(FILE *file)
+{
+    anv_trace_options options;
+    memset(&options, 0, sizeof(options));
+    options.out_file = file;
+    return anv_trace_init_with_options(&options);
+}
+
+anv_trace_result
+anv_trace_init_with_options(const anv_trace_options *options)
+{
+    if (ANV_TRACE__UNLIKELY(!options || !options->out_file)) {
+        anv_trace__assert(0, "invalid params");
+        return ANV_TRACE_INVALID_PARAMS;
+    }
+    if (ANV_TRACE__UNLIKELY(anv_trace__state.initialized)) {
+        anv_trace__assert(0, "anv_trace already initialized");
+        return ANV_TRACE_INVALID_PARAMS;
+    }
+
+    memset(&anv_trace__state, 0, sizeof(anv_trace__state));
+    anv_trace__state.out_file = options->out_file;
+    anv_trace__state.start_ns = anv_trace__now_ns();
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    anv_trace__state.options = *options;
+    if (!anv_trace__state.options.ring_capacity) {
+        anv_trace__state.options.ring_capacity
+            = ANV_TRACE__DEFAULT_RING_CAPACITY;
+    }
+    if (!anv_trace__state.options.batch_sz) {
+        anv_trace__state.options.batch_sz = ANV_TRACE__DEFAULT_BATCH_SZ;
+    }
+    if (!anv_trace__state.options.idle_us) {
+        anv_trace__state.options.idle_us = ANV_TRACE__DEFAULT_IDLE_US;
+    }
+    anv_trace__state.batch = (anv_trace__record *)malloc(
+        anv_trace__state.options.batch_sz * sizeof(anv_trace__record)
+    );
+    if (ANV_TRACE__UNLIKELY(!anv_trace__state.batch)) {
+        return ANV_TRACE_ALLOC_ERROR;
+    }
+    if (pthread_key_create(
+            &anv_trace__state.producer_key, anv_trace__producer_exit
+        )
+        != 0) {
+        free(anv_trace__state.batch);
+        return ANV_TRACE_ALLOC_ERROR;
+    }
+    pthread_mutex_init(&anv_trace__state.mutex, NULL);
+    pthread_cond_init(&anv_trace__state.wakeup, NULL);
+#endif
+
+    anv_trace__print_sep(ANV_TRACE__FORMAT_HEADER);
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    if (pthread_create(
+            &anv_trace__state.writer, NULL, anv_trace__writer_main, NULL
+        )
+        != 0) {
+        pthread_cond_destroy(&anv_trace__state.wakeup);
+        pthread_mutex_destroy(&anv_trace__state.mutex);
+        pthread_key_delete(anv_trace__state.producer_key);
+        free(anv_trace__state.batch);
+        return ANV_TRACE_THREAD_ERROR;
+    }
+#endif
+
+    anv_trace__state.initialized = 1;
+    return ANV_TRACE_OK;
+}
+
+void
+anv_trace_quit(void)
+{
+    if (ANV_TRACE__UNLIKELY(!anv_trace__state.initialized)) {
+        anv_trace__assert(0, "anv_trace not initialized");
+        return;
+    }
+    anv_trace__state.initialized = 0;
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    anv_trace__state.stop = 1;
+    pthread_cond_signal(&anv_trace__state.wakeup);
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+    pthread_join(anv_trace__state.writer, NULL);
+
+    while (anv_trace__state.producers) {
+        anv_trace__producer *next = anv_trace__state.producers->next;
+        anv_ring_destroy(anv_trace__state.producers->ring);
+        free(anv_trace__state.producers);
+        anv_trace__state.producers = next;
+    }
+    pthread_key_delete(anv_trace__state.producer_key);
+    pthread_cond_destroy(&anv_trace__state.wakeup);
+    pthread_mutex_destroy(&anv_trace__state.mutex);
+    free(anv_trace__state.batch);
+    anv_trace__state.batch = NULL;
+#endif
+
+    anv_trace__print_sep(ANV_TRACE__FORMAT_FOOTER);
+    fflush(anv_trace__state.out_file);
+}
+
+void
+anv_trace_flush(void)
+{
+    if (ANV_TRACE__UNLIKELY(!anv_trace__state.initialized)) {
+        return;
+    }
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    anv_trace__drain_all();
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+#else
+    fflush(anv_trace__state.out_file);
+#endif
+}
+
+void
+anv_trace_get_stats(anv_trace_stats *out_stats)
+{
+    if (ANV_TRACE__UNLIKELY(!out_stats)) {
+        anv_trace__assert(0, "invalid null stats");
+        return;
+    }
+    out_stats->written_count = ANV_TRACE__LOAD(&anv_trace__state.written_count);
+    out_stats->dropped_count = ANV_TRACE__LOAD(&anv_trace__state.dropped_count);
+}
+
+void
+anv_trace_(
+    const char *filename,
+    int line,
+    const char *func,
+    int level,
+    const char *format,
+    ...
+)
+{
+    if (ANV_TRACE__UNLIKELY(!anv_trace__state.initialized)) {
+        anv_trace__assert(0, "anv_trace not initialized");
+        return;
+    }
+    uint64_t timestamp_ns = anv_trace__now_ns();
+    va_list args;
+    va_start(args, format);
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    if (ANV_TRACE__LIKELY(level < ANV_TRACE_FATAL)) {
+        anv_trace__write_async(
+            filename, line, func, level, timestamp_ns, format, &args
+        );
+        va_end(args);
+        return;
+    }
+    // write what is queued first, then the fatal message right away.
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    anv_trace__drain_all();
+    anv_trace__write_sync(
+        filename, line, func, level, timestamp_ns, format, args
+    );
+    fflush(anv_trace__state.out_file);
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+#else
+    anv_trace__write_sync(
+        filename, line, func, level, timestamp_ns, format, args
+    );
+#endif
+    va_end(args);
+}
+
+#endif /* ANV_TRACE_IMPLEMENTATION */
@@ -11,6 +11,14 @@
  *  - Rename max_align_t to h_max_align_t to prevent conflicts on Linux.
  *  - Rename realloc_t to h_realloc_t to prevent conflicts.
  *  - Add C++ extern C wrapper.
+ *  - Add arena backed hierarchies (h_arena_new, h_arena_malloc).
+ *  - Free children with an iterative walk so deep hierarchies can not
+ *    overflow the stack.
+ *  - Add optional parent pointers (HALLOC_PARENT_POINTERS) for O(depth) cycle
+ *    checks in hattach and h_parent/h_root queries.
+ *  - Never write to the shared list sentinel nor lazily to halloc_allocator,
+ *    so that disjoint hierarchies can be used from different threads. Add
+ *    halloc_init and per arena allocators (h_arena_new_with).
  *
  *  https://github.com/anvouk/anv
  */
@@ -46,8 +54,33 @@ void *h_realloc(void *p, size_t len);
 void h_free(void *p);
 char *h_strdup(const char *str);
 
-#ifdef __cplusplus
-}
+/*
+ * arena api
+ *
+ * h_arena_new allocates a root block which owns an arena. Blocks allocated
+ * with h_arena_malloc under the root (or any of its arena descendants) are
+ * bump allocated from chunks owned by the root and are all released at once
+ * when the root is freed. Freeing or shrinking a single arena block does not
+ * give its memory back until then.
+ *
+ * Regular blocks can still be attached anywhere inside an arena hierarchy,
+ * but arena blocks must never be attached outside of their root's hierarchy.
+ */
+void *h_arena_new(size_t len, size_t chunk_sz);
+void *h_arena_malloc(void *parent, size_t len);
+
+/*
+ * parent api
+ *
+ * Define HALLOC_PARENT_POINTERS (everywhere halloc.h is included) to store a
+ * parent pointer in every block. hattach's debug cycle check then walks up
+ * the hierarchy in O(depth) instead of scanning the whole attached subtree,
+ * at the cost of one pointer per block and of realloc updating the parent
+ * pointer of every child of a moved block.
+ */
+#ifdef HALLOC_PARENT_POINTERS
+void *h_parent(void *block);
+void *h_root(void *block);
 #endif
 
 /*
@@ -57,6 +90,32 @@ typedef void *(*h_realloc_t)(void *ptr, size_t len);
 
 extern h_realloc_t halloc_allocator;
 
+/*
+ * threads
+ *
+ * halloc keeps no global mutable state besides halloc_allocator, which is
+ * only read (NULL means libc). Set it with halloc_init, or directly, before
+ * starting any other thread using halloc and never change it afterwards.
+ *
+ * Hierarchies not sharing any block can be built and freed from different
+ * threads at the same time without any locking. A single block must never be
+ * touched by two threads at once though, attaching to the same parent
+ * included. To build parts of one tree in parallel without locks, attach one
+ * slot block per worker under the shared parent before starting the workers:
+ * each worker then only attaches under its own slot. Once all workers are
+ * done the tree can be used as a whole again by a single thread.
+ *
+ * Each arena can also use its own allocator (h_arena_new_with), e.g. an
+ * unsynchronized per thread one. All the arena memory, root block included,
+ * comes from it.
+ */
+void halloc_init(h_realloc_t allocator);
+void *h_arena_new_with(size_t len, size_t chunk_sz, h_realloc_t allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
 #ifdef HALLOC_IMPLEMENTATION
 
 #include <assert.h> /* asssert */
@@ -89,7 +148,7 @@ struct hlist_item {
 };
 
 /*
- * shared tail sentinel
+ * shared tail sentinel, never written to (see threads)
  */
 struct hlist_item hlist_null;
 
@@ -151,7 +210,9 @@ hlist_add(hlist_head_t *h, hlist_item_t *i)
     assert(h && i);
 
     next = i->next = h->next;
-    next->prev = &i->next;
+    if (next != &hlist_null) {
+        next->prev = &i->next;
+    }
     h->next = i;
     i->prev = &h->next;
 }
@@ -163,7 +224,9 @@ hlist_del(hlist_item_t *i)
     assert(i);
 
     next = i->next;
-    next->prev = i->prev;
+    if (next != &hlist_null) {
+        next->prev = i->prev;
+    }
     *i->prev = next;
 
     hlist_init_item(i);
@@ -174,14 +237,18 @@ hlist_relink(hlist_item_t *i)
 {
     assert(i);
     *i->prev = i;
-    i->next->prev = &i->next;
+    if (i->next != &hlist_null) {
+        i->next->prev = &i->next;
+    }
 }
 
 static_inline void
 hlist_relink_head(hlist_head_t *h)
 {
     assert(h);
-    h->next->prev = &h->next;
+    if (h->next != &hlist_null) {
+        h->next->prev = &h->next;
+    }
 }
 
 /*
@@ -208,25 +275,70 @@ typedef struct hblock {
 #endif
     hlist_item_t siblings; /* 2 pointers */
     hlist_head_t children; /* 1 pointer  */
+    struct harena *arena;  /* owning arena, NULL for regular blocks */
+#ifdef HALLOC_PARENT_POINTERS
+    struct hblock *parent; /* NULL when detached */
+#endif
     h_max_align_t data[1]; /* not allocated, see below */
 } hblock_t;
 
+/*
+ * arena state, owned by its root block
+ */
+typedef struct harena_chunk {
+    struct harena_chunk *next;
+    size_t size;
+    size_t used;
+    h_max_align_t data[1]; /* not allocated */
+} harena_chunk_t;
+
+typedef struct harena {
+    h_realloc_t alloc;      /* for chunks, root block and harena itself */
+    harena_chunk_t *chunks; /* current chunk first */
+    size_t chunk_sz;
+    struct hblock *root;
+    /* set once a block from elsewhere got attached inside the hierarchy */
+    int has_foreign;
+} harena_t;
+
+/*
+ * arena blocks are prefixed with their length, needed by realloc
+ */
+typedef union harena_len {
+    size_t len;
+    h_max_align_t align;
+} harena_len_t;
+
+#define HARENA_DEFAULT_CHUNK_SZ 16384
+
 h_realloc_t halloc_allocator = NULL;
 
 #define sizeof_hblock offsetof(hblock_t, data)
+#define sizeof_hchunk offsetof(harena_chunk_t, data)
 
-#define allocator halloc_allocator
+#define allocator (halloc_allocator ? halloc_allocator : _realloc)
 
 /*
  * static methods
  */
 static int _ok_to_multiply(size_t a, size_t b);
 
-static void _set_allocator(void);
 static void *_realloc(void *ptr, size_t n);
 
+#ifndef NDEBUG
 static int _relate(hblock_t *b, hblock_t *p);
+#endif
 static void _free_children(hblock_t *p);
+static void _free_block(hblock_t *p);
+#ifdef HALLOC_PARENT_POINTERS
+static void _reparent_children(hblock_t *p);
+#endif
+
+static void _init_block(hblock_t *p, harena_t *a);
+static h_realloc_t _block_allocator(hblock_t *p);
+
+static hblock_t *_arena_alloc(harena_t *a, size_t len);
+static void _arena_free(harena_t *a);
 
 /*
  * core API
@@ -236,12 +348,6 @@ halloc(void *ptr, size_t len)
 {
     hblock_t *p;
 
-    /* set up default allocator */
-    if (!allocator) {
-        _set_allocator();
-        assert(allocator);
-    }
-
     /* a quick overflow check */
     if (len + sizeof_hblock < sizeof_hblock) {
         return NULL;
@@ -257,11 +363,7 @@ halloc(void *ptr, size_t len)
         if (!p) {
             return NULL;
         }
-#ifndef NDEBUG
-        p->magic = HH_MAGIC;
-#endif
-        hlist_init(&p->children);
-        hlist_init_item(&p->siblings);
+        _init_block(p, NULL);
 
         return p->data;
     }
@@ -273,12 +375,30 @@ halloc(void *ptr, size_t len)
     if (len) {
         int listed = hlist_item_listed(&p->siblings);
 
-        p = allocator(p, len + sizeof_hblock);
-        if (!p) {
-            return NULL;
+        if (p->arena && p->arena->root != p) {
+            /* arena block, move it to a new spot of the arena */
+            hblock_t *q = _arena_alloc(p->arena, len);
+            size_t old_len;
+            if (!q) {
+                return NULL;
+            }
+            old_len = ((harena_len_t *)p - 1)->len;
+            memcpy(q, p, sizeof_hblock + (old_len < len ? old_len : len));
+            p = q;
+        } else {
+            p = _block_allocator(p)(p, len + sizeof_hblock);
+            if (!p) {
+                return NULL;
+            }
+            if (p->arena) {
+                p->arena->root = p;
+            }
         }
 
         hlist_relink_head(&p->children);
+#ifdef HALLOC_PARENT_POINTERS
+        _reparent_children(p);
+#endif
 
         if (listed) {
             hlist_relink(&p->siblings);
@@ -290,9 +410,15 @@ halloc(void *ptr, size_t len)
     }
 
     /* free */
-    _free_children(p);
+    if (!p->arena || p->arena->has_foreign) {
+        _free_children(p);
+    }
+    /*
+     * else every descendant lives in the arena: nothing to walk, the chunks
+     * go away with the root
+     */
     hlist_del(&p->siblings);
-    allocator(p, 0);
+    _free_block(p);
 
     return NULL;
 }
@@ -312,6 +438,9 @@ hattach(void *block, void *parent)
     assert(b->magic == HH_MAGIC);
 
     hlist_del(&b->siblings);
+#ifdef HALLOC_PARENT_POINTERS
+    b->parent = NULL;
+#endif
 
     if (!parent) {
         return;
@@ -323,9 +452,17 @@ hattach(void *block, void *parent)
 
     /* sanity checks */
     assert(b != p); /* trivial */
-    assert(!_relate(p, b)); /* heavy ! */
+    assert(!_relate(p, b)); /* heavy without parent pointers ! */
+    assert(!b->arena || b->arena->root == b || b->arena == p->arena);
+
+    if (p->arena && b->arena != p->arena) {
+        p->arena->has_foreign = 1;
+    }
 
     hlist_add(&p->children, &b->siblings);
+#ifdef HALLOC_PARENT_POINTERS
+    b->parent = p;
+#endif
 }
 
 /*
@@ -370,6 +507,89 @@ h_strdup(const char *str)
     return ptr ? (ptr[len] = 0, memcpy(ptr, str, len)) : NULL;
 }
 
+/*
+ * arena api
+ */
+void *
+h_arena_new(size_t len, size_t chunk_sz)
+{
+    return h_arena_new_with(len, chunk_sz, NULL);
+}
+
+void *
+h_arena_new_with(size_t len, size_t chunk_sz, h_realloc_t alloc)
+{
+    hblock_t *p;
+    harena_t *a;
+
+    if (!alloc) {
+        alloc = allocator;
+    }
+
+    /* a quick overflow check */
+    if (!len || len + sizeof_hblock < sizeof_hblock) {
+        return NULL;
+    }
+
+    a = alloc(0, sizeof(harena_t));
+    if (!a) {
+        return NULL;
+    }
+
+    p = alloc(0, len + sizeof_hblock);
+    if (!p) {
+        alloc(a, 0);
+        return NULL;
+    }
+
+    a->alloc = alloc;
+    a->chunks = NULL;
+    a->chunk_sz = chunk_sz ? chunk_sz : HARENA_DEFAULT_CHUNK_SZ;
+    a->root = p;
+    a->has_foreign = 0;
+    _init_block(p, a);
+
+    return p->data;
+}
+
+void *
+h_arena_malloc(void *parent, size_t len)
+{
+    hblock_t *p, *b;
+
+    if (!parent) {
+        return halloc(0, len);
+    }
+
+    p = structof(parent, hblock_t, data);
+    assert(p->magic == HH_MAGIC);
+
+    if (!p->arena) {
+        void *ptr = halloc(0, len);
+        if (ptr) {
+            hattach(ptr, parent);
+        }
+        return ptr;
+    }
+
+    if (!len) {
+        return NULL;
+    }
+
+    b = _arena_alloc(p->arena, len);
+    if (!b) {
+        return NULL;
+    }
+    _init_block(b, p->arena);
+#ifdef HALLOC_PARENT_POINTERS
+    b->parent = p;
+#endif
+
+    hlist_add(&p->children, &b->siblings);
+
+    return b->data;
+}
+
 /*
  * static stuff
  */
@@ -383,19 +603,16 @@ _ok_to_multiply(size_t a, size_t b)
         || (SIZE_T_MAX / a < b);
 }
 
-static void
-_set_allocator(void)
+void
+halloc_init(h_realloc_t alloc)
 {
-    void *p;
-    assert(!allocator);
-
     /*
      * Do not try to rely on realloc to free memory even if it supported.
      * The _realloc wrapper does a good job anyway without really any penalty
      * so let's not do any 'clever' stuff where it's not necesseary.
      * A.V.
      */
-    allocator = _realloc;
+    halloc_allocator = alloc ? alloc : _realloc;
 }
 
 static void *
@@ -411,6 +628,74 @@ _realloc(void *ptr, size_t n)
     return NULL;
 }
 
+#ifdef HALLOC_PARENT_POINTERS
+
+void *
+h_parent(void *block)
+{
+    hblock_t *b;
+
+    if (!block) {
+        return NULL;
+    }
+
+    b = structof(block, hblock_t, data);
+    assert(b->magic == HH_MAGIC);
+
+    return b->parent ? b->parent->data : NULL;
+}
+
+void *
+h_root(void *block)
+{
+    hblock_t *b;
+
+    if (!block) {
+        return NULL;
+    }
+
+    b = structof(block, hblock_t, data);
+    assert(b->magic == HH_MAGIC);
+
+    while (b->parent) {
+        b = b->parent;
+    }
+    return b->data;
+}
+
+static void
+_reparent_children(hblock_t *p)
+{
+    hlist_item_t *i;
+    hlist_for_each(i, &p->children)
+    {
+        structof(i, hblock_t, siblings)->parent = p;
+    }
+}
+
+#ifndef NDEBUG
+/*
+ * b is a descendant of p if p is found going up from b, O(depth)
+ */
+static int
+_relate(hblock_t *b, hblock_t *p)
+{
+    /* a leaf can not be anyone's ancestor */
+    if (!b || !p || p->children.next == &hlist_null) {
+        return 0;
+    }
+
+    for (b = b->parent; b; b = b->parent) {
+        if (b == p) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif /* NDEBUG */
+
+#elif !defined(NDEBUG)
+
 static int
 _relate(hblock_t *b, hblock_t *p)
 {
@@ -435,10 +720,12 @@ _relate(hblock_t *b, hblock_t *p)
     return 0;
 }
 
+#endif /* HALLOC_PARENT_POINTERS */
+
 static void
 _free_children(hblock_t *p)
 {
-    hlist_item_t *i, *tmp;
+    hlist_item_t *i;
 
 #ifndef NDEBUG
     /*
@@ -448,12 +735,125 @@ _free_children(hblock_t *p)
     assert(p && p->magic == HH_MAGIC);
     p->magic = 0;
 #endif
-    hlist_for_each_safe(i, tmp, &p->children)
-    {
+    /*
+     * iterative post-order walk: grandchildren are hoisted into p's own list
+     * until the first child is a leaf, so no recursion (and no stack) is
+     * needed however deep the hierarchy is. Every block is moved at most
+     * once.
+     */
+    while ((i = p->children.next) != &hlist_null) {
         hblock_t *q = structof(i, hblock_t, siblings);
-        _free_children(q);
-        allocator(q, 0);
+        hlist_item_t *c = q->children.next;
+
+        assert(q->magic == HH_MAGIC);
+
+        /* other arena roots own their descendants' memory, free them whole */
+        if (c != &hlist_null && !(q->arena && q->arena->root == q)) {
+            hlist_del(c);
+            hlist_add(&p->children, c);
+#ifdef HALLOC_PARENT_POINTERS
+            structof(c, hblock_t, siblings)->parent = p;
+#endif
+            continue;
+        }
+
+        hlist_del(i);
+        if (c != &hlist_null) {
+            halloc(q->data, 0);
+        } else {
+#ifndef NDEBUG
+            q->magic = 0;
+#endif
+            _free_block(q);
+        }
+    }
+}
+
+static void
+_init_block(hblock_t *p, harena_t *a)
+{
+#ifndef NDEBUG
+    p->magic = HH_MAGIC;
+#endif
+    hlist_init(&p->children);
+    hlist_init_item(&p->siblings);
+    p->arena = a;
+#ifdef HALLOC_PARENT_POINTERS
+    p->parent = NULL;
+#endif
+}
+
+/*
+ * allocator the block itself comes from, arena roots use their arena's one
+ */
+static h_realloc_t
+_block_allocator(hblock_t *p)
+{
+    return p->arena && p->arena->root == p ? p->arena->alloc : allocator;
+}
+
+static void
+_free_block(hblock_t *p)
+{
+    harena_t *a = p->arena;
+
+    if (!a) {
+        allocator(p, 0);
+    } else if (a->root == p) {
+        h_realloc_t alloc = a->alloc;
+        _arena_free(a);
+        alloc(p, 0);
+    }
+    /* else the block lives in the arena chunks, released with the root */
+}
+
+static hblock_t *
+_arena_alloc(harena_t *a, size_t len)
+{
+    harena_chunk_t *c = a->chunks;
+    size_t align = sizeof(h_max_align_t);
+    size_t need;
+
+    /* a quick overflow check */
+    if (len > SIZE_T_MAX - sizeof(harena_len_t) - sizeof_hblock - align) {
+        return NULL;
+    }
+    need = sizeof(harena_len_t) + sizeof_hblock + len + align - 1;
+    need -= need % align;
+
+    if (!c || c->size - c->used < need) {
+        size_t size = need > a->chunk_sz ? need : a->chunk_sz;
+        if (size > SIZE_T_MAX - sizeof_hchunk) {
+            return NULL;
+        }
+        c = a->alloc(0, sizeof_hchunk + size);
+        if (!c) {
+            return NULL;
+        }
+        c->size = size;
+        c->used = 0;
+        c->next = a->chunks;
+        a->chunks = c;
+    }
+
+    {
+        harena_len_t *l = (harena_len_t *)((char *)c->data + c->used);
+        c->used += need;
+        l->len = len;
+        return (hblock_t *)(l + 1);
+    }
+}
+
+static void
+_arena_free(harena_t *a)
+{
+    harena_chunk_t *c = a->chunks;
+    while (c) {
+        harena_chunk_t *next = c->next;
+        a->alloc(c, 0);
+        c = next;
     }
+    a->alloc(a, 0);
 }
 
 #undef structof
@@ -466,7 +866,9 @@ _free_children(hblock_t *p)
 #undef hlist_for_each_safe
 
 #undef HH_MAGIC
+#undef HARENA_DEFAULT_CHUNK_SZ
 #undef sizeof_hblock
+#undef sizeof_hchunk
 #undef allocator
 
 #undef SIZE_T_MAX
@@ -0,0 +1,288 @@
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_ARENA_IMPLEMENTATION
+#define anv_arena__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_arena.h"
+
+#define ANV_ARR_IMPLEMENTATION
+#define anv_arr__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_arr.h"
+
+#include <stdint.h>
+#include <string.h>
+
+ANV_TESTSUITE_FIXTURE(anv_arena_init_allocates_nothing)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 0);
+    expect(!arena.first);
+    expect(arena.chunk_sz == ANV_ARENA_DEFAULT_CHUNK_SIZE);
+    expect(anv_arena_used(&arena) == 0);
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_alloc_is_aligned_and_contiguous)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 1024);
+
+    unsigned char *a = anv_arena_alloc(&arena, 3);
+    unsigned char *b = anv_arena_alloc(&arena, 20);
+    expect(a && b);
+    expect((uintptr_t)a % ANV_ARENA_ALIGNMENT == 0);
+    expect((uintptr_t)b % ANV_ARENA_ALIGNMENT == 0);
+    expect(b == a + ANV_ARENA_ALIGNMENT);
+    memset(a, 1, 3);
+    memset(b, 2, 20);
+    expect(a[2] == 1);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_alloc_aligned_ok)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 1024);
+
+    expect(anv_arena_alloc(&arena, 1));
+    void *mem = anv_arena_alloc_aligned(&arena, 100, 256);
+    expect(mem);
+    expect((uintptr_t)mem % 256 == 0);
+    // bigger than a chunk.
+    mem = anv_arena_alloc_aligned(&arena, 1024, 512);
+    expect(mem);
+    expect((uintptr_t)mem % 512 == 0);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_alloc_invalid_params_is_null)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 0);
+    expect(!anv_arena_alloc(NULL, 10));
+    expect(!anv_arena_alloc(&arena, 0));
+    expect(!anv_arena_alloc_aligned(&arena, 10, 0));
+    expect(!anv_arena_alloc_aligned(&arena, 10, 24));
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_alloc_spans_multiple_chunks)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 256);
+
+    int *items[200];
+    for (int i = 0; i < 200; ++i) {
+        items[i] = anv_arena_alloc(&arena, sizeof(int) * 8);
+        expect(items[i]);
+        *items[i] = i;
+    }
+    for (int i = 0; i < 200; ++i) {
+        expect(*items[i] == i);
+    }
+    expect(arena.first != arena.current);
+
+    // oversized allocations get their own chunk.
+    void *big = anv_arena_alloc(&arena, 10000);
+    expect(big);
+    memset(big, 0xaa, 10000);
+    expect(*items[199] == 199);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_realloc_last_grows_in_place)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 1024);
+
+    expect(anv_arena_alloc(&arena, 16));
+    char *mem = anv_arena_alloc(&arena, 10);
+    expect(mem);
+    memcpy(mem, "abcdefghi", 10);
+    size_t used = anv_arena_used(&arena);
+
+    char *grown = anv_arena_realloc(&arena, mem, 500);
+    expect(grown == mem);
+    expect(anv_arena_used(&arena) == used + 490);
+    expect(strcmp(grown, "abcdefghi") == 0);
+
+    char *shrunk = anv_arena_realloc(&arena, grown, 10);
+    expect(shrunk == mem);
+    expect(anv_arena_used(&arena) == used);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_realloc_not_last_copies)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 1024);
+
+    char *mem = anv_arena_alloc(&arena, 10);
+    expect(mem);
+    memcpy(mem, "abcdefghi", 10);
+    expect(anv_arena_alloc(&arena, 16));
+
+    char *moved = anv_arena_realloc(&arena, mem, 100);
+    expect(moved);
+    expect(moved != mem);
+    expect(strcmp(moved, "abcdefghi") == 0);
+
+    // does not fit in the current chunk anymore.
+    char *big = anv_arena_realloc(&arena, moved, 2000);
+    expect(big);
+    expect(big != moved);
+    expect(strcmp(big, "abcdefghi") == 0);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_realloc_null_is_alloc)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 0);
+    expect(anv_arena_realloc(&arena, NULL, 10));
+    expect(anv_arena_used(&arena) == 10);
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_free_reclaims_only_last)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 1024);
+
+    void *a = anv_arena_alloc(&arena, 16);
+    void *b = anv_arena_alloc(&arena, 16);
+    expect(anv_arena_used(&arena) == 32);
+
+    anv_arena_free(&arena, a);
+    expect(anv_arena_used(&arena) == 32);
+    anv_arena_free(&arena, b);
+    expect(anv_arena_used(&arena) == 16);
+    expect(anv_arena_alloc(&arena, 16) == b);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_rewind_releases_after_marker)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 256);
+
+    expect(anv_arena_alloc(&arena, 100));
+    anv_arena_marker marker = anv_arena_mark(&arena);
+    void *after = anv_arena_alloc(&arena, 100);
+    expect(after);
+    for (int i = 0; i < 20; ++i) {
+        expect(anv_arena_alloc(&arena, 100));
+    }
+
+    anv_arena_rewind(&arena, marker);
+    expect(anv_arena_used(&arena) == 100);
+    expect(anv_arena_alloc(&arena, 100) == after);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_reset_reuses_chunks)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 256);
+
+    void *first = anv_arena_alloc(&arena, 200);
+    for (int i = 0; i < 20; ++i) {
+        expect(anv_arena_alloc(&arena, 200));
+    }
+    anv_arena__chunk *chunks = arena.first;
+
+    anv_arena_reset(&arena);
+    expect(anv_arena_used(&arena) == 0);
+    expect(arena.first == chunks);
+    expect(anv_arena_alloc(&arena, 200) == first);
+    for (int i = 0; i < 20; ++i) {
+        expect(anv_arena_alloc(&arena, 200));
+    }
+    expect(arena.first == chunks);
+    expect(anv_arena_used(&arena) == 21 * 200);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_meta_allocator_ok)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 0);
+
+    int meta = 42;
+    void *mem = anv_meta_malloc_with(
+        anv_arena_allocator(&arena), &meta, sizeof(meta), 100
+    );
+    expect(mem);
+    expect(anv_meta_get_allocator(mem) == anv_arena_allocator(&arena));
+    memset(mem, 0x11, 100);
+    mem = anv_meta_realloc(mem, 1000);
+    expect(mem);
+    expect(*(int *)anv_meta_get(mem) == 42);
+    expect(((unsigned char *)mem)[99] == 0x11);
+    anv_meta_free(mem);
+    expect(anv_arena_used(&arena) == 0);
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arena_batch_of_arrays_reset_ok)
+{
+    anv_arena arena;
+    anv_arena_init(&arena, 4096);
+
+    anv_arr_options options = {
+        .arr_capacity = 4,
+        .item_sz = sizeof(int),
+        .allocator = anv_arena_allocator(&arena),
+    };
+    for (int batch = 0; batch < 3; ++batch) {
+        anv_arr_t arrs[50];
+        for (int i = 0; i < 50; ++i) {
+            arrs[i] = anv_arr_new_with_options(&options);
+            expect(arrs[i]);
+            for (int j = 0; j < 100; ++j) {
+                expect(anv_arr_push(arrs[i], &j) == ANV_ARR_RESULT_OK);
+            }
+        }
+        for (int i = 0; i < 50; ++i) {
+            expect(anv_arr_length(arrs[i]) == 100);
+            expect(*anv_arr_get(arrs[i], int, 99) == 99);
+        }
+        anv_arena_reset(&arena);
+    }
+
+    anv_arena_destroy(&arena);
+}
+
+ANV_TESTSUITE(
+    tests_anv_arena,
+    ANV_TESTSUITE_REGISTER(anv_arena_init_allocates_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arena_alloc_is_aligned_and_contiguous),
+    ANV_TESTSUITE_REGISTER(anv_arena_alloc_aligned_ok),
+    ANV_TESTSUITE_REGISTER(anv_arena_alloc_invalid_params_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arena_alloc_spans_multiple_chunks),
+    ANV_TESTSUITE_REGISTER(anv_arena_realloc_last_grows_in_place),
+    ANV_TESTSUITE_REGISTER(anv_arena_realloc_not_last_copies),
+    ANV_TESTSUITE_REGISTER(anv_arena_realloc_null_is_alloc),
+    ANV_TESTSUITE_REGISTER(anv_arena_free_reclaims_only_last),
+    ANV_TESTSUITE_REGISTER(anv_arena_rewind_releases_after_marker),
+    ANV_TESTSUITE_REGISTER(anv_arena_reset_reuses_chunks),
+    ANV_TESTSUITE_REGISTER(anv_arena_meta_allocator_ok),
+    ANV_TESTSUITE_REGISTER(anv_arena_batch_of_arrays_reset_ok),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_arena, stdout);
+}
@@ -4,8 +4,14 @@
 #define anv_meta__assert(cond, errmsg) ((void)(cond))
 #define ANV_ARR_IMPLEMENTATION
 #define anv_arr__assert(cond, errmsg) ((void)(cond))
+#ifndef _WIN32
+#define ANV_ARR_ENABLE_THREADS
+#endif
 #include "../include/anv_arr.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct item_t {
     int a;
 } item_t;
@@ -381,6 +387,221 @@ ANV_TESTSUITE_FIXTURE(anv_arr_config_reallocator_fn_restore_default_ok)
     anv_arr_destroy(arr);
 }
 
+ANV_TESTSUITE_FIXTURE(anv_arr_reallocator_builtins_always_grow)
+{
+    expect(anv_arr_reallocator_linear(0) == 8);
+    expect(anv_arr_reallocator_linear(100) == 108);
+    expect(anv_arr_reallocator_1_5x(0) > 0);
+    expect(anv_arr_reallocator_1_5x(100) == 150);
+    expect(anv_arr_reallocator_2x(0) > 0);
+    expect(anv_arr_reallocator_2x(100) == 200);
+    expect(anv_arr_reallocator_2x((size_t)-1 / 2 + 1) == (size_t)-1);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_with_default_reallocator_grows_geometrically)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 10000; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_length(arr) == 10000);
+    expect(anv_arr_capacity(arr) >= 10000);
+    // 1 -> 9 -> 18 -> ... -> 18432
+    expect(anv_arr_grow_count(arr) == 12);
+    expect(anv_arr_get(arr, item_t, 9999)->a == 9999);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_capacity_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_capacity(arr) == 10);
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_capacity(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_capacity_with_null_arr_returns_0)
+{
+    expect(anv_arr_capacity(NULL) == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_after_shrink_to_fit_empty_array_is_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 10 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 1);
+    expect(anv_arr_get(arr, item_t, 0)->a == 10);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_reserve_ok)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 10 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_reserve(arr, 1000) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_capacity(arr) == 1000);
+    expect(anv_arr_grow_count(arr) == 1);
+    expect(anv_arr_length(arr) == 1);
+    expect(anv_arr_get(arr, item_t, 0)->a == 10);
+
+    for (int i = 1; i < 1000; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+    expect(anv_arr_grow_count(arr) == 1);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_reserve_smaller_capacity_does_nothing)
+{
+    anv_arr_t arr = anv_arr_new(100, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_reserve(arr, 10) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_capacity(arr) == 100);
+    expect(anv_arr_grow_count(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_reserve_with_null_arr_returns_invalid_params)
+{
+    void *mem = NULL;
+    expect(anv_arr_reserve(mem, 10) == ANV_ARR_RESULT_INVALID_PARAMS);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_resize_bigger_zeroes_new_items)
+{
+    anv_arr_t arr = anv_arr_new(2, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 10 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_resize(arr, 50) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 50);
+    expect(anv_arr_capacity(arr) == 50);
+    expect(anv_arr_grow_count(arr) == 1);
+
+    expect(anv_arr_get(arr, item_t, 0)->a == 10);
+    for (size_t i = 1; i < 50; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == 0);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_resize_smaller_keeps_capacity)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 10 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 20 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_resize(arr, 1) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 1);
+    expect(anv_arr_capacity(arr) == 10);
+    expect(anv_arr_get(arr, item_t, 0)->a == 10);
+    expect(anv_arr_get(arr, item_t, 1) == NULL);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_resize_with_null_arr_returns_invalid_params)
+{
+    void *mem = NULL;
+    expect(anv_arr_resize(mem, 10) == ANV_ARR_RESULT_INVALID_PARAMS);
+}
+
+typedef struct growth_ctx_t {
+    size_t step;
+    int calls;
+} growth_ctx_t;
+
+static size_t
+custom_growth(void *user_ctx, size_t old_capacity)
+{
+    growth_ctx_t *ctx = user_ctx;
+    ctx->calls++;
+    return old_capacity + ctx->step;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_ok)
+{
+    anv_arr_t arr = anv_arr_new_with_options(&(anv_arr_options) {
+        .arr_capacity = 4,
+        .item_sz = sizeof(item_t),
+    });
+    expect(arr);
+
+    expect(anv_arr_capacity(arr) == 4);
+    expect(anv_arr_length(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_null_is_null)
+{
+    expect(!anv_arr_new_with_options(NULL));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_growth_fn_is_used)
+{
+    growth_ctx_t ctx = { .step = 3, .calls = 0 };
+    anv_arr_t arr = anv_arr_new_with_options(&(anv_arr_options) {
+        .arr_capacity = 1,
+        .item_sz = sizeof(item_t),
+        .growth_fn = custom_growth,
+        .growth_ctx = &ctx,
+    });
+    expect(arr);
+
+    for (int i = 0; i < 10; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    // 1 -> 4 -> 7 -> 10
+    expect(ctx.calls == 3);
+    expect(anv_arr_capacity(arr) == 10);
+    expect(anv_arr_get(arr, item_t, 9)->a == 9);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_growth_fn_ignores_global)
+{
+    growth_ctx_t ctx = { .step = 2, .calls = 0 };
+    anv_arr_config_reallocator_fn(custom_reallocator);
+    anv_arr_t arr = anv_arr_new_with_options(&(anv_arr_options) {
+        .arr_capacity = 1,
+        .item_sz = sizeof(item_t),
+        .growth_fn = custom_growth,
+        .growth_ctx = &ctx,
+    });
+    anv_arr_config_reallocator_fn(NULL);
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 2 }) == ANV_ARR_RESULT_OK);
+
+    expect(ctx.calls == 1);
+    expect(anv_arr_capacity(arr) == 3);
+
+    anv_arr_destroy(arr);
+}
+
 ANV_TESTSUITE_FIXTURE(anv_arr_get_with_no_elements_returns_null)
 {
     anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
@@ -611,77 +832,2026 @@ ANV_TESTSUITE_FIXTURE(
     anv_arr_destroy(arr);
 }
 
-ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_fit_empty_array_is_ok)
+ANV_TESTSUITE_FIXTURE(anv_arr_push_n_ok)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+
+    item_t items[100];
+    for (int i = 0; i < 100; ++i) {
+        items[i].a = i;
+    }
+    expect(anv_arr_push_new(arr, item_t, { .a = -1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_n(arr, items, 100) == ANV_ARR_RESULT_OK);
+
+    expect(anv_arr_length(arr) == 101);
+    expect(anv_arr_grow_count(arr) == 1);
+    expect(anv_arr_get(arr, item_t, 0)->a == -1);
+    for (size_t i = 0; i < 100; ++i) {
+        expect((size_t)anv_arr_get(arr, item_t, i + 1)->a == i);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_n_with_null_items_is_zeroed)
 {
     anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
     expect(arr);
 
-    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
-    expect(anv_arr_length(arr) == 0);
+    expect(anv_arr_push_n(arr, NULL, 3) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 3);
+    expect(anv_arr_get(arr, item_t, 2)->a == 0);
 
     anv_arr_destroy(arr);
 }
 
-ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_array_with_elements_is_ok)
+ANV_TESTSUITE_FIXTURE(anv_arr_push_n_with_null_arr_is_param_error)
+{
+    anv_arr_t *ptr = NULL;
+    item_t item = { .a = 100 };
+    expect(anv_arr_push_n(ptr, &item, 1) == ANV_ARR_RESULT_INVALID_PARAMS);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_range_ok)
+{
+    anv_arr_t arr = anv_arr_new(5, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 5; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    item_t items[2] = { { .a = 100 }, { .a = 200 } };
+    expect(anv_arr_insert_range(arr, 1, items, 2) == ANV_ARR_RESULT_OK);
+
+    // [0, 100, 200, 3, 4, 1, 2]
+    int expected[] = { 0, 100, 200, 3, 4, 1, 2 };
+    expect(anv_arr_length(arr) == 7);
+    for (size_t i = 0; i < 7; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_range_bigger_than_tail_ok)
+{
+    anv_arr_t arr = anv_arr_new(3, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 3; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    item_t items[4] = { { .a = 10 }, { .a = 20 }, { .a = 30 }, { .a = 40 } };
+    expect(anv_arr_insert_range(arr, 2, items, 4) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 0, 1, 10, 20, 30, 40, 2 };
+    expect(anv_arr_length(arr) == 7);
+    for (size_t i = 0; i < 7; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_range_with_empty_array_is_ok)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+
+    item_t items[2] = { { .a = 10 }, { .a = 20 } };
+    expect(anv_arr_insert_range(arr, 0, items, 2) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 2);
+    expect(anv_arr_get(arr, item_t, 1)->a == 20);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_range_with_out_of_bounds_index_is_error)
 {
     anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
     expect(arr);
 
-    item_t item1 = { .a = 69 };
-    expect(anv_arr_push(arr, &item1) == ANV_ARR_RESULT_OK);
-    item_t item2 = { .a = 690 };
-    expect(anv_arr_push(arr, &item2) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 10 }) == ANV_ARR_RESULT_OK);
+    item_t items[2] = { { .a = 10 }, { .a = 20 } };
+    expect(
+        anv_arr_insert_range(arr, 1, items, 2)
+        == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_range_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 8; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_remove_range(arr, 1, 2) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 0, 6, 7, 3, 4, 5 };
+    expect(anv_arr_length(arr) == 6);
+    for (size_t i = 0; i < 6; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_range_bigger_than_tail_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 6; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_remove_range(arr, 1, 4) == ANV_ARR_RESULT_OK);
 
-    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
     expect(anv_arr_length(arr) == 2);
+    expect(anv_arr_get(arr, item_t, 0)->a == 0);
+    expect(anv_arr_get(arr, item_t, 1)->a == 5);
 
-    item_t *found_item_0 = anv_arr_get(arr, item_t, 0);
-    expect(found_item_0);
-    expect(found_item_0->a == 69);
-    item_t *found_item_1 = anv_arr_get(arr, item_t, 1);
-    expect(found_item_1);
-    expect(found_item_1->a == 690);
+    expect(anv_arr_remove_range(arr, 0, 2) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 0);
 
     anv_arr_destroy(arr);
 }
 
-ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_fit_with_null_arr_returns_invalid_params
-)
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_range_out_of_bounds_is_error)
 {
-    void *mem = NULL;
-    expect(anv_arr_shrink_to_fit(mem) == ANV_ARR_RESULT_INVALID_PARAMS);
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_n(arr, NULL, 3) == ANV_ARR_RESULT_OK);
+    expect(
+        anv_arr_remove_range(arr, 2, 2) == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+    expect(
+        anv_arr_remove_range(arr, 1, (size_t)-1)
+        == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+    expect(anv_arr_length(arr) == 3);
+
+    anv_arr_destroy(arr);
 }
 
-ANV_TESTSUITE_FIXTURE(
-    anv_arr_shrink_to_fit_with_invalid_arr_returns_invalid_params
-)
+ANV_TESTSUITE_FIXTURE(anv_arr_extend_ok)
 {
-    void *mem = malloc(10);
-    expect(mem);
+    anv_arr_t dst = anv_arr_new(1, sizeof(item_t));
+    expect(dst);
+    anv_arr_t src = anv_arr_new(10, sizeof(item_t));
+    expect(src);
+
+    expect(anv_arr_push_new(dst, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(src, item_t, { .a = 2 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(src, item_t, { .a = 3 }) == ANV_ARR_RESULT_OK);
+
+    expect(anv_arr_extend(dst, src) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(dst) == 3);
+    expect(anv_arr_length(src) == 2);
+    for (size_t i = 0; i < 3; ++i) {
+        expect((size_t)anv_arr_get(dst, item_t, i)->a == i + 1);
+    }
 
-    expect(anv_arr_shrink_to_fit(mem) == ANV_ARR_RESULT_INVALID_PARAMS);
+    anv_arr_destroy(src);
+    anv_arr_destroy(dst);
+}
 
-    free(mem);
+ANV_TESTSUITE_FIXTURE(anv_arr_extend_with_itself_ok)
+{
+    anv_arr_t arr = anv_arr_new(2, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 2 }) == ANV_ARR_RESULT_OK);
+
+    expect(anv_arr_extend(arr, arr) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 1, 2, 1, 2 };
+    expect(anv_arr_length(arr) == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
 }
 
-ANV_TESTSUITE(
-    tests_anv_arr,
-    ANV_TESTSUITE_REGISTER(anv_arr_new_with_capacity_0_is_null),
-    ANV_TESTSUITE_REGISTER(anv_arr_new_with_capacity_1234_is_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_new_with_invalid_alloc_is_null),
-    ANV_TESTSUITE_REGISTER(anv_arr_destroy_with_null_arr_does_nothing),
-    ANV_TESTSUITE_REGISTER(anv_arr_destroy_with_invalid_arr_does_nothing),
-    ANV_TESTSUITE_REGISTER(anv_arr_length_with_0_elements_returns_0),
-    ANV_TESTSUITE_REGISTER(anv_arr_length_with_n_elements_returns_n),
-    ANV_TESTSUITE_REGISTER(anv_arr_push_with_1_element_under_capacity_is_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_null_arr_is_param_error),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_invalid_arr_is_param_error),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_null_item_is_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_out_of_bounds_index_is_error),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_empty_array_is_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_not_empty_array_is_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_multiple_check_ordering_ok),
-    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_array_expansion_ok),
+ANV_TESTSUITE_FIXTURE(anv_arr_extend_with_different_item_sz_is_param_error)
+{
+    anv_arr_t dst = anv_arr_new(1, sizeof(item_t));
+    expect(dst);
+    anv_arr_t src = anv_arr_new(1, sizeof(item_t) * 2);
+    expect(src);
+
+    expect(anv_arr_extend(dst, src) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    anv_arr_destroy(src);
+    anv_arr_destroy(dst);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_slow_keeps_ordering)
+{
+    anv_arr_t arr = anv_arr_new(3, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 3; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    item_t item = { .a = 100 };
+    expect(anv_arr_insert_slow(arr, 1, &item) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 0, 100, 1, 2 };
+    expect(anv_arr_length(arr) == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_slow_with_out_of_bounds_index_is_error)
+{
+    anv_arr_t arr = anv_arr_new(3, sizeof(item_t));
+    expect(arr);
+
+    item_t item = { .a = 100 };
+    expect(
+        anv_arr_insert_slow(arr, 1, &item) == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_first_ok)
+{
+    anv_arr_t arr = anv_arr_new(3, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 3; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    item_t item = { .a = 100 };
+    expect(anv_arr_push_first(arr, &item) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 100, 1, 2, 0 };
+    expect(anv_arr_length(arr) == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_first_slow_keeps_ordering)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 5; ++i) {
+        expect(
+            anv_arr_push_first_slow(arr, &(item_t) { .a = i })
+            == ANV_ARR_RESULT_OK
+        );
+    }
+
+    expect(anv_arr_length(arr) == 5);
+    for (size_t i = 0; i < 5; ++i) {
+        expect((size_t)anv_arr_get(arr, item_t, i)->a == 4 - i);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_pop_first_slow_keeps_ordering)
+{
+    anv_arr_t arr = anv_arr_new(4, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 4; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        item_t *item = anv_arr_pop_first_slow(arr, item_t);
+        expect(item);
+        expect(item->a == i);
+        expect(anv_arr_length(arr) == (size_t)(3 - i));
+        for (size_t j = 0; j < anv_arr_length(arr); ++j) {
+            expect((size_t)anv_arr_get(arr, item_t, j)->a == i + 1 + j);
+        }
+    }
+    expect(!anv_arr_pop_first_slow(arr, item_t));
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_pop_first_slow_with_null_arr_returns_null)
+{
+    expect(anv_arr_pop_first_slow(NULL, item_t) == NULL);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_replace_ok)
+{
+    anv_arr_t arr = anv_arr_new(4, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_push_new(arr, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 2 }) == ANV_ARR_RESULT_OK);
+
+    item_t item = { .a = 100 };
+    expect(anv_arr_replace(arr, 1, &item) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 2);
+    expect(anv_arr_get(arr, item_t, 0)->a == 1);
+    expect(anv_arr_get(arr, item_t, 1)->a == 100);
+
+    expect(anv_arr_replace(arr, 0, NULL) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_get(arr, item_t, 0)->a == 0);
+
+    expect(
+        anv_arr_replace(arr, 2, &item) == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_slow_keeps_ordering)
+{
+    anv_arr_t arr = anv_arr_new(5, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 5; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_remove_slow(arr, 1) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_remove_slow(arr, 3) == ANV_ARR_RESULT_OK);
+
+    int expected[] = { 0, 2, 3 };
+    expect(anv_arr_length(arr) == 3);
+    for (size_t i = 0; i < 3; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    expect(anv_arr_remove_slow(arr, 3) == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_slow_with_null_arr_returns_invalid_params)
+{
+    expect(anv_arr_remove_slow(NULL, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+}
+
+static int
+is_odd_item(void *user_ctx, void *item)
+{
+    (void)user_ctx;
+    return ((item_t *)item)->a % 2 != 0;
+}
+
+static int
+is_below_item(void *user_ctx, void *item)
+{
+    return ((item_t *)item)->a < *(int *)user_ctx;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_if_keeps_ordering)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    int values[] = { 1, 2, 3, 3, 4, 6, 7, 8, 9, 9 };
+    for (size_t i = 0; i < 10; ++i) {
+        item_t item = { .a = values[i] };
+        expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+    }
+
+    size_t removed = 0;
+    expect(
+        anv_arr_remove_if(arr, is_odd_item, NULL, &removed) == ANV_ARR_RESULT_OK
+    );
+
+    int expected[] = { 2, 4, 6, 8 };
+    expect(removed == 6);
+    expect(anv_arr_length(arr) == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_if_all_and_none_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 10; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    int threshold = 0;
+    size_t removed = 1;
+    expect(
+        anv_arr_remove_if(arr, is_below_item, &threshold, &removed)
+        == ANV_ARR_RESULT_OK
+    );
+    expect(removed == 0);
+    expect(anv_arr_length(arr) == 10);
+
+    threshold = 100;
+    expect(
+        anv_arr_remove_if(arr, is_below_item, &threshold, NULL)
+        == ANV_ARR_RESULT_OK
+    );
+    expect(anv_arr_length(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_if_with_null_pred_returns_invalid_params)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(
+        anv_arr_remove_if(arr, NULL, NULL, NULL)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+
+    anv_arr_destroy(arr);
+}
+
+static uint32_t
+test_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static int
+cmp_item(const void *a, const void *b)
+{
+    int va = ((const item_t *)a)->a;
+    int vb = ((const item_t *)b)->a;
+    return (va > vb) - (va < vb);
+}
+
+typedef struct big_item_t {
+    uint64_t key;
+    char payload[40];
+} big_item_t;
+
+static int
+cmp_big_item(const void *a, const void *b)
+{
+    uint64_t va = ((const big_item_t *)a)->key;
+    uint64_t vb = ((const big_item_t *)b)->key;
+    return (va > vb) - (va < vb);
+}
+
+typedef struct pair_item_t {
+    uint64_t key;
+    uint64_t value;
+} pair_item_t;
+
+static int
+cmp_pair_item(const void *a, const void *b)
+{
+    uint64_t va = ((const pair_item_t *)a)->key;
+    uint64_t vb = ((const pair_item_t *)b)->key;
+    return (va > vb) - (va < vb);
+}
+
+#define item_less(x, y) ((x)->a < (y)->a)
+ANV_ARR_DEFINE_SORT(sort_items, item_t, item_less)
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_random_items_ok)
+{
+    anv_arr_t arr = anv_arr_new(1000, sizeof(item_t));
+    expect(arr);
+
+    uint32_t state = 42;
+    for (int i = 0; i < 1000; ++i) {
+        item_t item = { .a = (int)(test_rand(&state) % 100) - 50 };
+        expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_sort(arr, cmp_item) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 1000);
+    for (size_t i = 1; i < 1000; ++i) {
+        expect(
+            anv_arr_get(arr, item_t, i - 1)->a <= anv_arr_get(arr, item_t, i)->a
+        );
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_patterns_ok)
+{
+    anv_arr_t arr = anv_arr_new(5000, sizeof(item_t));
+    expect(arr);
+
+    // sorted, reversed, all equal and organ pipe patterns
+    for (int pattern = 0; pattern < 4; ++pattern) {
+        expect(anv_arr_resize(arr, 0) == ANV_ARR_RESULT_OK);
+        for (int i = 0; i < 5000; ++i) {
+            int values[] = { i, 5000 - i, 7, i < 2500 ? i : 5000 - i };
+            item_t item = { .a = values[pattern] };
+            expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+        }
+        expect(anv_arr_sort(arr, cmp_item) == ANV_ARR_RESULT_OK);
+        for (size_t i = 1; i < 5000; ++i) {
+            expect(
+                anv_arr_get(arr, item_t, i - 1)->a
+                <= anv_arr_get(arr, item_t, i)->a
+            );
+        }
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_16_bytes_and_big_items_ok)
+{
+    anv_arr_t pairs = anv_arr_new(500, sizeof(pair_item_t));
+    expect(pairs);
+    anv_arr_t bigs = anv_arr_new(500, sizeof(big_item_t));
+    expect(bigs);
+
+    uint32_t state = 7;
+    for (uint64_t i = 0; i < 500; ++i) {
+        uint64_t key = test_rand(&state);
+        pair_item_t pair = { .key = key, .value = key * 2 };
+        expect(anv_arr_push(pairs, &pair) == ANV_ARR_RESULT_OK);
+        big_item_t big = { .key = key };
+        big.payload[39] = (char)key;
+        expect(anv_arr_push(bigs, &big) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_sort(pairs, cmp_pair_item) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_sort(bigs, cmp_big_item) == ANV_ARR_RESULT_OK);
+    for (size_t i = 1; i < 500; ++i) {
+        pair_item_t *pair = anv_arr_get(pairs, pair_item_t, i);
+        expect(anv_arr_get(pairs, pair_item_t, i - 1)->key <= pair->key);
+        expect(pair->value == pair->key * 2);
+        big_item_t *big = anv_arr_get(bigs, big_item_t, i);
+        expect(anv_arr_get(bigs, big_item_t, i - 1)->key <= big->key);
+        expect(big->payload[39] == (char)big->key);
+    }
+
+    anv_arr_destroy(bigs);
+    anv_arr_destroy(pairs);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_with_null_params_returns_invalid_params)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_sort(NULL, cmp_item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_sort(arr, NULL) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_define_sort_ok)
+{
+    anv_arr_t arr = anv_arr_new(3000, sizeof(item_t));
+    expect(arr);
+
+    uint32_t state = 1;
+    for (int i = 0; i < 3000; ++i) {
+        item_t item = { .a = (int)(test_rand(&state) % 1000) };
+        expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+    }
+
+    sort_items(arr);
+    for (size_t i = 1; i < 3000; ++i) {
+        expect(
+            anv_arr_get(arr, item_t, i - 1)->a <= anv_arr_get(arr, item_t, i)->a
+        );
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_radix_unsigned_is_stable)
+{
+    anv_arr_t arr = anv_arr_new(2000, sizeof(pair_item_t));
+    expect(arr);
+
+    uint32_t state = 3;
+    for (uint64_t i = 0; i < 2000; ++i) {
+        pair_item_t pair = { .key = test_rand(&state) % 300, .value = i };
+        expect(anv_arr_push(arr, &pair) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(
+        anv_arr_sort_radix(arr, offsetof(pair_item_t, key), 8, 0)
+        == ANV_ARR_RESULT_OK
+    );
+    for (size_t i = 1; i < 2000; ++i) {
+        pair_item_t *prev = anv_arr_get(arr, pair_item_t, i - 1);
+        pair_item_t *curr = anv_arr_get(arr, pair_item_t, i);
+        expect(prev->key <= curr->key);
+        expect(prev->key != curr->key || prev->value < curr->value);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_radix_signed_ok)
+{
+    anv_arr_t arr = anv_arr_new(1000, sizeof(item_t));
+    expect(arr);
+
+    uint32_t state = 9;
+    for (int i = 0; i < 1000; ++i) {
+        item_t item = { .a = (int)(test_rand(&state) % 2000000) - 1000000 };
+        expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(
+        anv_arr_sort_radix(arr, offsetof(item_t, a), sizeof(int), 1)
+        == ANV_ARR_RESULT_OK
+    );
+    for (size_t i = 1; i < 1000; ++i) {
+        expect(
+            anv_arr_get(arr, item_t, i - 1)->a <= anv_arr_get(arr, item_t, i)->a
+        );
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_radix_with_invalid_key_is_param_error)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_sort_radix(arr, 0, 3, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_sort_radix(arr, 2, 4, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    anv_arr_destroy(arr);
+}
+
+#ifdef ANV_ARR_ENABLE_THREADS
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_parallel_ok)
+{
+    size_t n = ANV_ARR_PARALLEL_SORT_THRESHOLD * 3 + 17;
+    anv_arr_t arr = anv_arr_new(n, sizeof(pair_item_t));
+    expect(arr);
+
+    uint32_t state = 11;
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        pair_item_t pair = { .key = test_rand(&state), .value = 0 };
+        pair.value = pair.key + 1;
+        checksum += pair.key;
+        expect(anv_arr_push(arr, &pair) == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_sort_parallel(arr, cmp_pair_item, 5) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == n);
+    for (size_t i = 0; i < n; ++i) {
+        pair_item_t *pair = anv_arr_get(arr, pair_item_t, i);
+        if (i > 0) {
+            expect(anv_arr_get(arr, pair_item_t, i - 1)->key <= pair->key);
+        }
+        expect(pair->value == pair->key + 1);
+        checksum -= pair->key;
+    }
+    expect(checksum == 0);
+
+    anv_arr_destroy(arr);
+}
+#endif
+
+ANV_ARR_DEFINE_LOWER_BOUND(lower_bound_items, item_t, item_less)
+
+static anv_arr_t
+new_sorted_items(size_t n, int step)
+{
+    anv_arr_t arr = anv_arr_new(n, sizeof(item_t));
+    for (size_t i = 0; i < n; ++i) {
+        item_t item = { .a = (int)i * step };
+        anv_arr_push(arr, &item);
+    }
+    return arr;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_bsearch_finds_existing_items)
+{
+    anv_arr_t arr = new_sorted_items(100, 2);
+    expect(arr);
+
+    for (int i = 0; i < 100; ++i) {
+        item_t key = { .a = i * 2 };
+        item_t *it = anv_arr_bsearch(arr, item_t, &key, cmp_item);
+        expect(it);
+        expect(it->a == i * 2);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_bsearch_missing_item_returns_null)
+{
+    anv_arr_t arr = new_sorted_items(100, 2);
+    expect(arr);
+
+    item_t key = { .a = 33 };
+    expect(!anv_arr_bsearch(arr, item_t, &key, cmp_item));
+    key.a = -1;
+    expect(!anv_arr_bsearch(arr, item_t, &key, cmp_item));
+    key.a = 1000;
+    expect(!anv_arr_bsearch(arr, item_t, &key, cmp_item));
+    expect(!anv_arr_bsearch(arr, item_t, &key, NULL));
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_lower_and_upper_bound_with_duplicates_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    int values[] = { 1, 3, 3, 3, 5, 7 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        anv_arr_result res = anv_arr_push_new(arr, item_t, { .a = values[i] });
+        expect(res == ANV_ARR_RESULT_OK);
+    }
+
+    item_t key = { .a = 3 };
+    expect(anv_arr_lower_bound(arr, &key, cmp_item) == 1);
+    expect(anv_arr_upper_bound(arr, &key, cmp_item) == 4);
+    expect(anv_arr_lower_bound_branchless(arr, &key, cmp_item) == 1);
+    expect(lower_bound_items(arr, &key) == 1);
+
+    key.a = 0;
+    expect(anv_arr_lower_bound(arr, &key, cmp_item) == 0);
+    expect(anv_arr_upper_bound(arr, &key, cmp_item) == 0);
+
+    key.a = 7;
+    expect(anv_arr_lower_bound(arr, &key, cmp_item) == 5);
+    expect(anv_arr_upper_bound(arr, &key, cmp_item) == 6);
+
+    key.a = 8;
+    expect(anv_arr_lower_bound(arr, &key, cmp_item) == 6);
+    expect(anv_arr_lower_bound_branchless(arr, &key, cmp_item) == 6);
+    expect(lower_bound_items(arr, &key) == 6);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_lower_bound_on_empty_array_returns_0)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    item_t key = { .a = 3 };
+    expect(anv_arr_lower_bound(arr, &key, cmp_item) == 0);
+    expect(anv_arr_upper_bound(arr, &key, cmp_item) == 0);
+    expect(anv_arr_lower_bound_branchless(arr, &key, cmp_item) == 0);
+    expect(lower_bound_items(arr, &key) == 0);
+    expect(!anv_arr_bsearch(arr, item_t, &key, cmp_item));
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_lower_bound_branchless_matches_lower_bound)
+{
+    for (size_t n = 1; n < 70; ++n) {
+        anv_arr_t arr = new_sorted_items(n, 3);
+        expect(arr);
+        for (int k = -2; k < (int)n * 3 + 2; ++k) {
+            item_t key = { .a = k };
+            size_t expected = anv_arr_lower_bound(arr, &key, cmp_item);
+            expect(anv_arr_lower_bound_branchless(arr, &key, cmp_item)
+                   == expected);
+            expect(lower_bound_items(arr, &key) == expected);
+        }
+        anv_arr_destroy(arr);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_sorted_keeps_array_sorted)
+{
+    anv_arr_t arr = anv_arr_new(1, sizeof(pair_item_t));
+    expect(arr);
+
+    uint32_t state = 3;
+    for (uint32_t i = 0; i < 300; ++i) {
+        pair_item_t pair = { .key = test_rand(&state) % 20, .value = i };
+        anv_arr_result res = anv_arr_insert_sorted(arr, &pair, cmp_pair_item);
+        expect(res == ANV_ARR_RESULT_OK);
+    }
+
+    expect(anv_arr_length(arr) == 300);
+    for (size_t i = 1; i < 300; ++i) {
+        pair_item_t *prev = anv_arr_get(arr, pair_item_t, i - 1);
+        pair_item_t *pair = anv_arr_get(arr, pair_item_t, i);
+        expect(prev->key <= pair->key);
+        // Equal items keep their insertion order.
+        if (prev->key == pair->key) {
+            expect(prev->value < pair->value);
+        }
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_sorted_with_null_item_is_param_error)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(
+        anv_arr_insert_sorted(arr, NULL, cmp_item)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_eytzinger_matches_sorted_searches)
+{
+    for (size_t n = 1; n < 70; ++n) {
+        anv_arr_t arr = new_sorted_items(n, 2);
+        expect(arr);
+        anv_arr_t eyt_arr = anv_arr_eytzinger_new(arr);
+        expect(eyt_arr);
+        expect(anv_arr_length(eyt_arr) == n);
+
+        for (int k = -1; k < (int)n * 2 + 1; ++k) {
+            item_t key = { .a = k };
+            item_t *expected = anv_arr_get(
+                arr, item_t, anv_arr_lower_bound(arr, &key, cmp_item)
+            );
+            item_t *it = anv_arr_eytzinger_lower_bound(
+                eyt_arr, item_t, &key, cmp_item
+            );
+            expect(expected ? it && it->a == expected->a : !it);
+
+            int present = k % 2 == 0 && k >= 0 && k < (int)n * 2;
+            it = anv_arr_eytzinger_bsearch(eyt_arr, item_t, &key, cmp_item);
+            expect(present ? it && it->a == k : !it);
+        }
+
+        anv_arr_destroy(eyt_arr);
+        anv_arr_destroy(arr);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_eytzinger_of_empty_array_finds_nothing)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+    anv_arr_t eyt_arr = anv_arr_eytzinger_new(arr);
+    expect(eyt_arr);
+
+    item_t key = { .a = 1 };
+    expect(!anv_arr_eytzinger_lower_bound(eyt_arr, item_t, &key, cmp_item));
+    expect(!anv_arr_eytzinger_bsearch(eyt_arr, item_t, &key, cmp_item));
+
+    anv_arr_destroy(eyt_arr);
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_eytzinger_rejects_mutators)
+{
+    anv_arr_t arr = new_sorted_items(20, 2);
+    expect(arr);
+    anv_arr_t eyt_arr = anv_arr_eytzinger_new(arr);
+    expect(eyt_arr);
+    expect(anv_arr_is_readonly(eyt_arr));
+    expect(!anv_arr_is_readonly(arr));
+    expect(!anv_arr_is_mapped(eyt_arr));
+    expect(anv_arr_capacity(eyt_arr) == 20);
+    item_t before[20];
+    memcpy(before, eyt_arr, sizeof(before));
+
+    item_t item = { .a = 3 };
+    expect(anv_arr_push(eyt_arr, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_insert(eyt_arr, 0, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(
+        anv_arr_insert_sorted(eyt_arr, &item, cmp_item)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(anv_arr_replace(eyt_arr, 0, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_swap(eyt_arr, 0, 1) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_remove(eyt_arr, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_sort(eyt_arr, cmp_item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    sort_items(eyt_arr);
+    expect(anv_arr_reserve(eyt_arr, 100) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_resize(eyt_arr, 5) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_pop(eyt_arr, item_t) == NULL);
+    expect(anv_arr_shrink_to_fit(eyt_arr) == ANV_ARR_RESULT_OK);
+
+    expect(anv_arr_length(eyt_arr) == 20);
+    expect(memcmp(before, eyt_arr, sizeof(before)) == 0);
+    item_t key = { .a = 8 };
+    expect(anv_arr_eytzinger_bsearch(eyt_arr, item_t, &key, cmp_item));
+
+    anv_arr_destroy(eyt_arr);
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_data_begin_end_span_all_items)
+{
+    anv_arr_t arr = new_sorted_items(50, 1);
+    expect(arr);
+
+    item_t *data = anv_arr_data(arr, item_t);
+    expect(data == anv_arr_get(arr, item_t, 0));
+    expect(anv_arr_begin(arr, item_t) == data);
+    expect(anv_arr_end(arr, item_t) == data + 50);
+    for (int i = 0; i < 50; ++i) {
+        expect(data[i].a == i);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_data_with_invalid_arr_is_null)
+{
+    void *mem = malloc(10);
+    expect(mem);
+
+    expect(!anv_arr_data(NULL, item_t));
+    expect(!anv_arr_data(mem, item_t));
+
+    free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_foreach_visits_all_items_in_order)
+{
+    anv_arr_t arr = new_sorted_items(100, 1);
+    expect(arr);
+
+    int expected = 0;
+    anv_arr_foreach(arr, item_t, it)
+    {
+        expect(it->a == expected);
+        ++expected;
+    }
+    expect(expected == 100);
+
+    anv_arr_foreach(arr, item_t, it)
+    {
+        it->a *= 2;
+    }
+    expect(anv_arr_get(arr, item_t, 99)->a == 198);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_foreach_on_empty_array_does_nothing)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    int visited = 0;
+    anv_arr_foreach(arr, item_t, it)
+    {
+        (void)it;
+        ++visited;
+    }
+    expect(visited == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_ARR_DEFINE(int_arr, int)
+ANV_ARR_DEFINE(ptr_arr, void *)
+
+static int
+cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_push_grows_and_keeps_items)
+{
+    int_arr arr = int_arr_new(2);
+    expect(arr);
+
+    for (int i = 0; i < 1000; ++i) {
+        expect(int_arr_push(&arr, i) == ANV_ARR_RESULT_OK);
+    }
+    expect(int_arr_length(arr) == 1000);
+    expect(int_arr_capacity(arr) >= 1000);
+    for (int i = 0; i < 1000; ++i) {
+        expect(arr[i] == i);
+        expect(*int_arr_at(arr, (size_t)i) == i);
+    }
+    expect(!int_arr_at(arr, 1000));
+
+    int_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_set_pop_and_clear_ok)
+{
+    int_arr arr = int_arr_new(10);
+    expect(arr);
+
+    expect(int_arr_set(arr, 0, 1) == ANV_ARR_RESULT_INDEX_OUT_OF_BOUNDS);
+    expect(!int_arr_pop(arr));
+
+    expect(int_arr_push(&arr, 1) == ANV_ARR_RESULT_OK);
+    expect(int_arr_push(&arr, 2) == ANV_ARR_RESULT_OK);
+    expect(int_arr_set(arr, 1, 20) == ANV_ARR_RESULT_OK);
+
+    int *popped = int_arr_pop(arr);
+    expect(popped && *popped == 20);
+    expect(int_arr_length(arr) == 1);
+
+    int_arr_clear(arr);
+    expect(int_arr_length(arr) == 0);
+    expect(int_arr_capacity(arr) == 10);
+
+    int_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_reserve_ok)
+{
+    int_arr arr = int_arr_new(1);
+    expect(arr);
+
+    expect(int_arr_reserve(&arr, 500) == ANV_ARR_RESULT_OK);
+    expect(int_arr_capacity(arr) == 500);
+    for (int i = 0; i < 500; ++i) {
+        expect(int_arr_push(&arr, i) == ANV_ARR_RESULT_OK);
+    }
+    expect(int_arr_capacity(arr) == 500);
+
+    int_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_is_interoperable_with_anv_arr)
+{
+    int_arr arr = int_arr_new(4);
+    expect(arr);
+
+    for (int i = 10; i > 0; --i) {
+        expect(int_arr_push(&arr, i) == ANV_ARR_RESULT_OK);
+    }
+    int value = 0;
+    expect(anv_arr_push(arr, &value) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 11);
+    expect(int_arr_length(arr) == 11);
+
+    expect(anv_arr_sort(arr, cmp_int) == ANV_ARR_RESULT_OK);
+    for (int i = 0; i <= 10; ++i) {
+        expect(arr[i] == i);
+    }
+
+    int_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_pointer_items_ok)
+{
+    ptr_arr arr = ptr_arr_new(1);
+    expect(arr);
+
+    int values[3] = { 1, 2, 3 };
+    for (int i = 0; i < 3; ++i) {
+        expect(ptr_arr_push(&arr, &values[i]) == ANV_ARR_RESULT_OK);
+    }
+    expect(ptr_arr_length(arr) == 3);
+    expect(*(int *)arr[2] == 3);
+    expect(*ptr_arr_at(arr, 0) == &values[0]);
+
+    ptr_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_inline_uses_buffer_until_full)
+{
+    ANV_ARR_INLINE_BUFFER(buffer, 8, sizeof(item_t));
+    anv_arr_t arr = anv_arr_new_inline(buffer, sizeof(buffer), sizeof(item_t));
+    expect(arr);
+    expect(anv_arr_is_inline(arr));
+    expect(anv_arr_capacity(arr) >= 8);
+    expect((unsigned char *)arr > (unsigned char *)buffer);
+    expect((unsigned char *)arr < (unsigned char *)buffer + sizeof(buffer));
+
+    size_t capacity = anv_arr_capacity(arr);
+    for (int i = 0; i < (int)capacity; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+    expect(anv_arr_is_inline(arr));
+    expect(anv_arr_grow_count(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_inline_moves_to_heap_on_overflow)
+{
+    ANV_ARR_INLINE_BUFFER(buffer, 4, sizeof(item_t));
+    anv_arr_t arr = anv_arr_new_inline(buffer, sizeof(buffer), sizeof(item_t));
+    expect(arr);
+
+    for (int i = 0; i < 100; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+    expect(!anv_arr_is_inline(arr));
+    expect(anv_arr_length(arr) == 100);
+    expect(anv_arr_grow_count(arr) > 0);
+    for (int i = 0; i < 100; ++i) {
+        expect(anv_arr_get(arr, item_t, (size_t)i)->a == i);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_inline_shrink_to_fit_stays_inline)
+{
+    ANV_ARR_INLINE_BUFFER(buffer, 4, sizeof(item_t));
+    anv_arr_t arr = anv_arr_new_inline(buffer, sizeof(buffer), sizeof(item_t));
+    expect(arr);
+
+    size_t capacity = anv_arr_capacity(arr);
+    expect(anv_arr_push_new(arr, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_is_inline(arr));
+    expect(anv_arr_capacity(arr) == capacity);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_inline_with_too_small_buffer_is_null)
+{
+    size_t buffer[2];
+    expect(!anv_arr_new_inline(buffer, sizeof(buffer), sizeof(item_t)));
+    expect(!anv_arr_new_inline(NULL, 0, sizeof(item_t)));
+}
+
+typedef struct alloc_counts_t {
+    int mallocs, reallocs, frees;
+} alloc_counts_t;
+
+static void *
+counting_malloc(void *ctx, size_t sz)
+{
+    ((alloc_counts_t *)ctx)->mallocs++;
+    return malloc(sz);
+}
+
+static void *
+counting_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    ((alloc_counts_t *)ctx)->reallocs++;
+    return realloc(mem, new_sz);
+}
+
+static void
+counting_free(void *ctx, void *mem)
+{
+    ((alloc_counts_t *)ctx)->frees++;
+    free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_custom_allocator_ok)
+{
+    alloc_counts_t counts = { 0, 0, 0 };
+    anv_meta_allocator allocator = {
+        counting_malloc, counting_realloc, counting_free, &counts
+    };
+    anv_arr_options options = {
+        .arr_capacity = 2,
+        .item_sz = sizeof(item_t),
+        .allocator = &allocator,
+    };
+    anv_arr_t arr = anv_arr_new_with_options(&options);
+    expect(arr);
+    expect(counts.mallocs == 1);
+
+    for (int i = 0; i < 100; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+    expect(counts.reallocs == (int)anv_arr_grow_count(arr));
+    expect(anv_arr_get(arr, item_t, 99)->a == 99);
+
+    anv_arr_destroy(arr);
+    expect(counts.frees == 1);
+}
+
+static void *
+failing_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    (void)ctx;
+    (void)mem;
+    (void)new_sz;
+    return NULL;
+}
+
+/*
+ * Allocator whose realloc always moves the block and poisons the old one,
+ * blocks start with their size.
+ */
+static void *
+moving_malloc(void *ctx, size_t sz)
+{
+    (void)ctx;
+    size_t *mem = malloc(sizeof(size_t) * 2 + sz);
+    if (!mem) {
+        return NULL;
+    }
+    mem[0] = sz;
+    return mem + 2;
+}
+
+static void
+moving_free(void *ctx, void *mem)
+{
+    (void)ctx;
+    if (mem) {
+        size_t *block = (size_t *)mem - 2;
+        memset(mem, 0xab, block[0]);
+        free(block);
+    }
+}
+
+static void *
+moving_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    void *new_mem = moving_malloc(ctx, new_sz);
+    if (new_mem && mem) {
+        size_t old_sz = ((size_t *)mem - 2)[0];
+        memcpy(new_mem, mem, old_sz < new_sz ? old_sz : new_sz);
+        moving_free(ctx, mem);
+    }
+    return new_mem;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_own_items_while_growing_ok)
+{
+    anv_meta_allocator allocator = {
+        moving_malloc, moving_realloc, moving_free, NULL
+    };
+    anv_arr_options options = {
+        .arr_capacity = 4,
+        .item_sz = sizeof(item_t),
+        .allocator = &allocator,
+    };
+    anv_arr_t arr = anv_arr_new_with_options(&options);
+    expect(arr);
+    for (int i = 0; i < 4; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+    }
+
+    // full: both grow the array, moving the pushed items.
+    anv_arr_t before = arr;
+    expect(
+        anv_arr_push_n(arr, anv_arr_get(arr, item_t, 0), 4) == ANV_ARR_RESULT_OK
+    );
+    expect(arr != before);
+    while (anv_arr_length(arr) < anv_arr_capacity(arr)) {
+        expect(anv_arr_push_new(arr, item_t, { .a = 9 }) == ANV_ARR_RESULT_OK);
+    }
+    size_t length = anv_arr_length(arr);
+    before = arr;
+    expect(anv_arr_push(arr, anv_arr_get(arr, item_t, 1)) == ANV_ARR_RESULT_OK);
+    expect(arr != before);
+    expect(anv_arr_get(arr, item_t, length)->a == 1);
+
+    int expected[] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+    for (size_t i = 0; i < 8; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == expected[i]);
+    }
+
+    // the source range overlaps the spots of the new items.
+    expect(
+        anv_arr_insert_range(arr, 1, anv_arr_get(arr, item_t, 0), 3)
+        == ANV_ARR_RESULT_OK
+    );
+    int inserted[] = { 0, 0, 1, 2, 0, 1, 2, 3 };
+    for (size_t i = 0; i < 8; ++i) {
+        expect(anv_arr_get(arr, item_t, i)->a == inserted[i]);
+    }
+    // the items moved away from the range spots end up last.
+    length = anv_arr_length(arr);
+    expect(anv_arr_get(arr, item_t, length - 3)->a == 1);
+    expect(anv_arr_get(arr, item_t, length - 2)->a == 2);
+    expect(anv_arr_get(arr, item_t, length - 1)->a == 3);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_with_failing_realloc_keeps_array)
+{
+    alloc_counts_t counts = { 0, 0, 0 };
+    anv_meta_allocator allocator = {
+        counting_malloc, failing_realloc, counting_free, &counts
+    };
+    anv_arr_options options = {
+        .arr_capacity = 2,
+        .item_sz = sizeof(item_t),
+        .allocator = &allocator,
+    };
+    anv_arr_t arr = anv_arr_new_with_options(&options);
+    expect(arr);
+    expect(anv_arr_push_new(arr, item_t, { .a = 1 }) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_push_new(arr, item_t, { .a = 2 }) == ANV_ARR_RESULT_OK);
+    anv_arr_t before = arr;
+    expect(
+        anv_arr_push_new(arr, item_t, { .a = 3 }) == ANV_ARR_RESULT_ALLOC_ERROR
+    );
+    // the array is still usable after an out of memory error.
+    expect(arr == before);
+    expect(counts.frees == 0);
+    expect(anv_arr_length(arr) == 2);
+    expect(anv_arr_get(arr, item_t, 1)->a == 2);
+
+    anv_arr_destroy(arr);
+    expect(counts.frees == 1);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_new_with_options_cache_line_aligned_ok)
+{
+    anv_arr_options options = {
+        .arr_capacity = 3,
+        .item_sz = sizeof(item_t),
+        .alignment = ANV_ARR_CACHE_LINE_SIZE,
+    };
+    anv_arr_t arr = anv_arr_new_with_options(&options);
+    expect(arr);
+    expect((size_t)arr % ANV_ARR_CACHE_LINE_SIZE == 0);
+
+    for (int i = 0; i < 1000; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { .a = i }) == ANV_ARR_RESULT_OK);
+        expect((size_t)arr % ANV_ARR_CACHE_LINE_SIZE == 0);
+    }
+    expect(anv_arr_get(arr, item_t, 999)->a == 999);
+
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect((size_t)arr % ANV_ARR_CACHE_LINE_SIZE == 0);
+    expect(anv_arr_get(arr, item_t, 500)->a == 500);
+
+    anv_arr_destroy(arr);
+}
+
+typedef struct huge_item_t {
+    int a;
+    char payload[508];
+} huge_item_t;
+
+static int
+cmp_huge_item(const void *a, const void *b)
+{
+    int va = ((const huge_item_t *)a)->a;
+    int vb = ((const huge_item_t *)b)->a;
+    return (va > vb) - (va < vb);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_huge_items_swap_and_sort_ok)
+{
+    anv_arr_t arr = anv_arr_new(4, sizeof(huge_item_t));
+    expect(arr);
+    // the metadata header does not grow with the item size.
+    expect(anv_meta_getsz(arr) < sizeof(huge_item_t));
+
+    for (int i = 0; i < 4; ++i) {
+        huge_item_t item = { .a = 3 - i };
+        memset(item.payload, 'a' + i, sizeof(item.payload));
+        expect(anv_arr_push(arr, &item) == ANV_ARR_RESULT_OK);
+    }
+    expect(anv_arr_capacity(arr) == 4);
+
+    expect(anv_arr_swap(arr, 0, 3) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_get(arr, huge_item_t, 0)->a == 0);
+    expect(anv_arr_get(arr, huge_item_t, 0)->payload[507] == 'd');
+    expect(anv_arr_get(arr, huge_item_t, 3)->a == 3);
+    expect(anv_arr_get(arr, huge_item_t, 3)->payload[0] == 'a');
+
+    expect(anv_arr_sort(arr, cmp_huge_item) == ANV_ARR_RESULT_OK);
+    for (int i = 0; i < 4; ++i) {
+        huge_item_t *item = anv_arr_get(arr, huge_item_t, i);
+        expect(item->a == i);
+        expect(item->payload[100] == 'a' + 3 - i);
+    }
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_fit_empty_array_is_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 0);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_array_with_elements_is_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+
+    item_t item1 = { .a = 69 };
+    expect(anv_arr_push(arr, &item1) == ANV_ARR_RESULT_OK);
+    item_t item2 = { .a = 690 };
+    expect(anv_arr_push(arr, &item2) == ANV_ARR_RESULT_OK);
+
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == 2);
+
+    item_t *found_item_0 = anv_arr_get(arr, item_t, 0);
+    expect(found_item_0);
+    expect(found_item_0->a == 69);
+    item_t *found_item_1 = anv_arr_get(arr, item_t, 1);
+    expect(found_item_1);
+    expect(found_item_1->a == 690);
+
+    anv_arr_destroy(arr);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_shrink_to_fit_with_null_arr_returns_invalid_params
+)
+{
+    void *mem = NULL;
+    expect(anv_arr_shrink_to_fit(mem) == ANV_ARR_RESULT_INVALID_PARAMS);
+}
+
+ANV_TESTSUITE_FIXTURE(
+    anv_arr_shrink_to_fit_with_invalid_arr_returns_invalid_params
+)
+{
+    void *mem = malloc(10);
+    expect(mem);
+
+    expect(anv_arr_shrink_to_fit(mem) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_get_usage_ok)
+{
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+    for (int i = 0; i < 4; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { i }) == ANV_ARR_RESULT_OK);
+    }
+
+    anv_arr_usage usage;
+    expect(anv_arr_get_usage(arr, &usage) == ANV_ARR_RESULT_OK);
+    expect(usage.item_bytes == 4 * sizeof(item_t));
+    expect(usage.capacity_bytes == 10 * sizeof(item_t));
+    expect(usage.slack_bytes == 6 * sizeof(item_t));
+    expect(
+        usage.overhead_bytes
+        == sizeof(item_t) + (size_t)anv_meta_get_offset(arr)
+    );
+    expect(usage.grow_count == 0);
+    expect(anv_arr_get_usage(NULL, &usage) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_get_usage(arr, NULL) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    anv_arr_destroy(arr);
+}
+
+#ifdef ANV_ARR_ENABLE_STATS
+ANV_TESTSUITE_FIXTURE(anv_arr_stats_track_growth)
+{
+    anv_arr_stats_reset();
+    anv_arr_stats before;
+    anv_arr_stats_snapshot(&before);
+
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+    for (int i = 0; i < 100; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { i }) == ANV_ARR_RESULT_OK);
+    }
+    anv_arr_stats stats;
+    anv_arr_stats_snapshot(&stats);
+    size_t grows = anv_arr_grow_count(arr);
+    expect(grows > 0);
+    expect(stats.created_count == 1);
+    expect(stats.live_count == before.live_count + 1);
+    expect(stats.grow_count == grows);
+    expect(stats.realloc_count == grows);
+    expect(stats.grow_moves <= grows);
+    expect(
+        stats.live_capacity_bytes - before.live_capacity_bytes
+        == anv_arr_capacity(arr) * sizeof(item_t)
+    );
+
+    expect(anv_arr_shrink_to_fit(arr) == ANV_ARR_RESULT_OK);
+    anv_arr_destroy(arr);
+    anv_arr_stats_snapshot(&stats);
+    expect(stats.destroyed_count == 1);
+    expect(stats.realloc_count == grows + 1);
+    expect(stats.live_count == before.live_count);
+    expect(stats.live_capacity_bytes == before.live_capacity_bytes);
+    expect(stats.grow_count_histogram[grows] == 1);
+    // 100 items long: 2^6 <= 100 < 2^7.
+    expect(stats.length_histogram[6] == 1);
+}
+
+// registered only when available.
+#define STATS_FIXTURES ANV_TESTSUITE_REGISTER(anv_arr_stats_track_growth),
+#else
+#define STATS_FIXTURES
+#endif
+
+static int
+item_cmp(const void *a, const void *b)
+{
+    return ((const item_t *)a)->a - ((const item_t *)b)->a;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_save_and_map_readonly_ok)
+{
+    const char *filename = "anv_arr_map_readonly.bin";
+    anv_arr_t arr = anv_arr_new(1, sizeof(item_t));
+    expect(arr);
+    for (int i = 0; i < 10000; ++i) {
+        expect(anv_arr_push_new(arr, item_t, { i * 2 }) == ANV_ARR_RESULT_OK);
+    }
+    expect(anv_arr_save(arr, filename) == ANV_ARR_RESULT_OK);
+
+    anv_arr_t view = NULL;
+    expect(anv_arr_map_readonly(filename, &view) == ANV_ARR_RESULT_OK);
+    expect(view);
+    expect(anv_arr_is_mapped(view));
+    expect(!anv_arr_is_mapped(arr));
+    expect(anv_arr_length(view) == 10000);
+    expect(anv_arr_capacity(view) == 10000);
+    expect((size_t)view % 16 == 0);
+    expect(memcmp(view, arr, 10000 * sizeof(item_t)) == 0);
+    expect(anv_arr_get(view, item_t, 9999)->a == 19998);
+    expect(anv_arr_get(view, item_t, 10000) == NULL);
+    item_t key = { 1234 };
+    expect(anv_arr_bsearch(view, item_t, &key, item_cmp)->a == 1234);
+
+    anv_arr_usage usage;
+    expect(anv_arr_get_usage(view, &usage) == ANV_ARR_RESULT_OK);
+    expect(usage.item_bytes == 10000 * sizeof(item_t));
+    expect(usage.slack_bytes == 0);
+    expect(usage.overhead_bytes == 256);
+
+    // views cannot grow.
+    expect(
+        anv_arr_push_new(view, item_t, { 0 }) == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(anv_arr_shrink_to_fit(view) == ANV_ARR_RESULT_OK);
+
+    // can be copied to a regular array.
+    anv_arr_t eyt_arr = anv_arr_eytzinger_new(view);
+    expect(eyt_arr);
+    expect(anv_arr_eytzinger_bsearch(eyt_arr, item_t, &key, item_cmp));
+    anv_arr_destroy(eyt_arr);
+
+    anv_arr_destroy(view);
+    anv_arr_destroy(arr);
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_save_and_map_empty_array_ok)
+{
+    const char *filename = "anv_arr_map_empty.bin";
+    anv_arr_t arr = anv_arr_new(8, sizeof(item_t));
+    expect(arr);
+    expect(anv_arr_save(arr, filename) == ANV_ARR_RESULT_OK);
+
+    FILE *file = fopen(filename, "rb");
+    expect(file);
+    anv_arr_file_header header;
+    expect(fread(&header, sizeof(header), 1, file) == 1);
+    fclose(file);
+    expect(memcmp(header.magic, "ANVARR", 6) == 0);
+    expect(header.version == ANV_ARR_FILE_VERSION);
+    expect(header.item_sz == sizeof(item_t));
+    expect(header.length == 0);
+    expect(header.capacity == 8);
+
+    anv_arr_t view = NULL;
+    expect(anv_arr_map_readonly(filename, &view) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(view) == 0);
+    expect(anv_arr_get(view, item_t, 0) == NULL);
+    anv_arr_destroy(view);
+    anv_arr_destroy(arr);
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_map_readonly_invalid_files_fail)
+{
+    const char *filename = "anv_arr_map_invalid.bin";
+    anv_arr_t view = (anv_arr_t)&view;
+    expect(
+        anv_arr_map_readonly("anv_arr_missing.bin", &view)
+        == ANV_ARR_RESULT_IO_ERROR
+    );
+    expect(view == NULL);
+    expect(anv_arr_map_readonly(NULL, &view) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(anv_arr_save(NULL, filename) == ANV_ARR_RESULT_INVALID_PARAMS);
+
+    FILE *file = fopen(filename, "wb");
+    expect(file);
+    fprintf(file, "not an array file, but long enough for a header.");
+    fclose(file);
+    expect(
+        anv_arr_map_readonly(filename, &view) == ANV_ARR_RESULT_BAD_FORMAT
+    );
+
+    // truncated items.
+    anv_arr_t arr = anv_arr_new(100, sizeof(item_t));
+    expect(arr);
+    expect(anv_arr_resize(arr, 100) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_save(arr, filename) == ANV_ARR_RESULT_OK);
+    file = fopen(filename, "r+b");
+    expect(file);
+    anv_arr_file_header header;
+    expect(fread(&header, sizeof(header), 1, file) == 1);
+    header.length = 101;
+    rewind(file);
+    expect(fwrite(&header, sizeof(header), 1, file) == 1);
+    fclose(file);
+    expect(
+        anv_arr_map_readonly(filename, &view) == ANV_ARR_RESULT_BAD_FORMAT
+    );
+    expect(view == NULL);
+
+    anv_arr_destroy(arr);
+    remove(filename);
+}
+
+#define VIEW_LENGTH 100
+
+/*
+ * Save VIEW_LENGTH items in descending order and map them back.
+ */
+static anv_arr_t
+new_mapped_view(const char *filename)
+{
+    anv_arr_t arr = anv_arr_new(VIEW_LENGTH, sizeof(item_t));
+    if (!arr) {
+        return NULL;
+    }
+    for (int i = 0; i < VIEW_LENGTH; ++i) {
+        item_t item = { VIEW_LENGTH - i };
+        anv_arr_push(arr, &item);
+    }
+    anv_arr_t view = NULL;
+    if (anv_arr_save(arr, filename) != ANV_ARR_RESULT_OK
+        || anv_arr_map_readonly(filename, &view) != ANV_ARR_RESULT_OK) {
+        view = NULL;
+    }
+    anv_arr_destroy(arr);
+    return view;
+}
+
+static int
+is_view_unchanged(anv_arr_t view)
+{
+    if (anv_arr_length(view) != VIEW_LENGTH) {
+        return 0;
+    }
+    for (int i = 0; i < VIEW_LENGTH; ++i) {
+        if (anv_arr_get(view, item_t, i)->a != VIEW_LENGTH - i) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void
+destroy_mapped_view(anv_arr_t view, const char *filename)
+{
+    anv_arr_destroy(view);
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_push.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t item = { 0 };
+    expect(anv_arr_push(view, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_push_n_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_push_n.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t items[2] = { { 0 }, { 0 } };
+    expect(anv_arr_push_n(view, items, 2) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_insert.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t item = { 0 };
+    expect(anv_arr_insert(view, 3, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_slow_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_insert_slow.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t item = { 0 };
+    expect(
+        anv_arr_insert_slow(view, 3, &item) == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_range_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_insert_range.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t items[2] = { { 0 }, { 0 } };
+    expect(
+        anv_arr_insert_range(view, 3, items, 2)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_extend_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_extend.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    anv_arr_t arr = anv_arr_new(10, sizeof(item_t));
+    expect(arr);
+    expect(anv_arr_extend(view, arr) == ANV_ARR_RESULT_INVALID_PARAMS);
+    // views can still be the source.
+    expect(anv_arr_extend(arr, view) == ANV_ARR_RESULT_OK);
+    expect(anv_arr_length(arr) == VIEW_LENGTH);
+    expect(is_view_unchanged(view));
+    anv_arr_destroy(arr);
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_insert_sorted_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_insert_sorted.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t item = { 0 };
+    expect(
+        anv_arr_insert_sorted(view, &item, item_cmp)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_pop_on_mapped_view_is_null)
+{
+    const char *filename = "anv_arr_view_pop.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_pop(view, item_t) == NULL);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_pop_first_slow_on_mapped_view_is_null)
+{
+    const char *filename = "anv_arr_view_pop_first_slow.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_pop_first_slow(view, item_t) == NULL);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_swap_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_swap.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_swap(view, 0, 1) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_remove.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_remove(view, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_replace_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_replace.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    item_t item = { 0 };
+    expect(anv_arr_replace(view, 0, &item) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_slow_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_remove_slow.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_remove_slow(view, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_if_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_remove_if.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    size_t removed = 1;
+    expect(
+        anv_arr_remove_if(view, is_odd_item, NULL, &removed)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(removed == 0);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_remove_range_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_remove_range.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(
+        anv_arr_remove_range(view, 0, 2) == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_reserve_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_reserve.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(
+        anv_arr_reserve(view, VIEW_LENGTH * 2) == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(anv_arr_capacity(view) == VIEW_LENGTH);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_resize_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_resize.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_resize(view, 10) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_sort.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(anv_arr_sort(view, item_cmp) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_define_sort_on_mapped_view_does_nothing)
+{
+    const char *filename = "anv_arr_view_define_sort.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    // items are saved in descending order.
+    sort_items(view);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_radix_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_sort_radix.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(
+        anv_arr_sort_radix(view, offsetof(item_t, a), sizeof(int), 1)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+#ifdef ANV_ARR_ENABLE_THREADS
+ANV_TESTSUITE_FIXTURE(anv_arr_sort_parallel_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_sort_parallel.bin";
+    anv_arr_t view = new_mapped_view(filename);
+    expect(view);
+    expect(
+        anv_arr_sort_parallel(view, item_cmp, 4)
+        == ANV_ARR_RESULT_INVALID_PARAMS
+    );
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+// registered only when available.
+#define THREADS_FIXTURES                                                       \
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_parallel_ok),                          \
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_parallel_on_mapped_view_is_param_error),
+#else
+#define THREADS_FIXTURES
+#endif
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_set_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_typed_set.bin";
+    int_arr view = (int_arr)new_mapped_view(filename);
+    expect(view);
+    expect(int_arr_set(view, 0, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_push_on_mapped_view_is_param_error)
+{
+    const char *filename = "anv_arr_view_typed_push.bin";
+    int_arr view = (int_arr)new_mapped_view(filename);
+    expect(view);
+    expect(int_arr_push(&view, 0) == ANV_ARR_RESULT_INVALID_PARAMS);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_pop_on_mapped_view_is_null)
+{
+    const char *filename = "anv_arr_view_typed_pop.bin";
+    int_arr view = (int_arr)new_mapped_view(filename);
+    expect(view);
+    expect(int_arr_pop(view) == NULL);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_arr_typed_clear_on_mapped_view_does_nothing)
+{
+    const char *filename = "anv_arr_view_typed_clear.bin";
+    int_arr view = (int_arr)new_mapped_view(filename);
+    expect(view);
+    int_arr_clear(view);
+    expect(is_view_unchanged(view));
+    destroy_mapped_view(view, filename);
+}
+
+ANV_TESTSUITE(
+    tests_anv_arr,
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_capacity_0_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_capacity_1234_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_invalid_alloc_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_destroy_with_null_arr_does_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_destroy_with_invalid_arr_does_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_length_with_0_elements_returns_0),
+    ANV_TESTSUITE_REGISTER(anv_arr_length_with_n_elements_returns_n),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_with_1_element_under_capacity_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_null_arr_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_invalid_arr_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_null_item_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_out_of_bounds_index_is_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_empty_array_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_not_empty_array_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_multiple_check_ordering_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_with_array_expansion_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_insert_new_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_push_with_null_arr_is_param_error),
     ANV_TESTSUITE_REGISTER(anv_arr_push_with_null_item_is_ok),
@@ -694,6 +2864,25 @@ ANV_TESTSUITE(
     ANV_TESTSUITE_REGISTER(anv_arr_pop_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_config_reallocator_fn_custom_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_config_reallocator_fn_restore_default_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_reallocator_builtins_always_grow),
+    ANV_TESTSUITE_REGISTER(
+        anv_arr_push_with_default_reallocator_grows_geometrically
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_capacity_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_capacity_with_null_arr_returns_0),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_after_shrink_to_fit_empty_array_is_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_reserve_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_reserve_smaller_capacity_does_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_reserve_with_null_arr_returns_invalid_params
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_resize_bigger_zeroes_new_items),
+    ANV_TESTSUITE_REGISTER(anv_arr_resize_smaller_keeps_capacity),
+    ANV_TESTSUITE_REGISTER(anv_arr_resize_with_null_arr_returns_invalid_params
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_null_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_growth_fn_is_used),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_growth_fn_ignores_global),
     ANV_TESTSUITE_REGISTER(anv_arr_get_with_no_elements_returns_null),
     ANV_TESTSUITE_REGISTER(anv_arr_get_with_null_arr_returns_null),
     ANV_TESTSUITE_REGISTER(anv_arr_get_with_invalid_arr_returns_null),
@@ -720,6 +2909,76 @@ ANV_TESTSUITE(
     ANV_TESTSUITE_REGISTER(
         anv_arr_remove_when_index_out_of_bounds_return_out_of_bounds_err
     ),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_n_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_n_with_null_items_is_zeroed),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_n_with_null_arr_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_range_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_range_bigger_than_tail_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_range_with_empty_array_is_ok),
+    ANV_TESTSUITE_REGISTER(
+        anv_arr_insert_range_with_out_of_bounds_index_is_error
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_range_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_range_bigger_than_tail_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_range_out_of_bounds_is_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_extend_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_extend_with_itself_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_extend_with_different_item_sz_is_param_error
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_slow_keeps_ordering),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_slow_with_out_of_bounds_index_is_error
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_first_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_first_slow_keeps_ordering),
+    ANV_TESTSUITE_REGISTER(anv_arr_pop_first_slow_keeps_ordering),
+    ANV_TESTSUITE_REGISTER(anv_arr_pop_first_slow_with_null_arr_returns_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_replace_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_slow_keeps_ordering),
+    ANV_TESTSUITE_REGISTER(
+        anv_arr_remove_slow_with_null_arr_returns_invalid_params
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_if_keeps_ordering),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_if_all_and_none_ok),
+    ANV_TESTSUITE_REGISTER(
+        anv_arr_remove_if_with_null_pred_returns_invalid_params
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_random_items_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_patterns_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_16_bytes_and_big_items_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_with_null_params_returns_invalid_params
+    ),
+    ANV_TESTSUITE_REGISTER(anv_arr_define_sort_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_radix_unsigned_is_stable),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_radix_signed_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_radix_with_invalid_key_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_bsearch_finds_existing_items),
+    ANV_TESTSUITE_REGISTER(anv_arr_bsearch_missing_item_returns_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_lower_and_upper_bound_with_duplicates_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_lower_bound_on_empty_array_returns_0),
+    ANV_TESTSUITE_REGISTER(anv_arr_lower_bound_branchless_matches_lower_bound),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_sorted_keeps_array_sorted),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_sorted_with_null_item_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_eytzinger_matches_sorted_searches),
+    ANV_TESTSUITE_REGISTER(anv_arr_eytzinger_of_empty_array_finds_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_eytzinger_rejects_mutators),
+    ANV_TESTSUITE_REGISTER(anv_arr_data_begin_end_span_all_items),
+    ANV_TESTSUITE_REGISTER(anv_arr_data_with_invalid_arr_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_foreach_visits_all_items_in_order),
+    ANV_TESTSUITE_REGISTER(anv_arr_foreach_on_empty_array_does_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_push_grows_and_keeps_items),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_set_pop_and_clear_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_reserve_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_is_interoperable_with_anv_arr),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_pointer_items_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_inline_uses_buffer_until_full),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_inline_moves_to_heap_on_overflow),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_inline_shrink_to_fit_stays_inline),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_inline_with_too_small_buffer_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_custom_allocator_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_own_items_while_growing_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_with_failing_realloc_keeps_array),
+    ANV_TESTSUITE_REGISTER(anv_arr_new_with_options_cache_line_aligned_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_huge_items_swap_and_sort_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_shrink_to_fit_empty_array_is_ok),
     ANV_TESTSUITE_REGISTER(anv_arr_shrink_to_array_with_elements_is_ok),
     ANV_TESTSUITE_REGISTER(
@@ -728,11 +2987,41 @@ ANV_TESTSUITE(
     ANV_TESTSUITE_REGISTER(
         anv_arr_shrink_to_fit_with_invalid_arr_returns_invalid_params
     ),
+    ANV_TESTSUITE_REGISTER(anv_arr_get_usage_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_save_and_map_readonly_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_save_and_map_empty_array_ok),
+    ANV_TESTSUITE_REGISTER(anv_arr_map_readonly_invalid_files_fail),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_push_n_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_slow_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_range_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_extend_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_insert_sorted_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_pop_on_mapped_view_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_pop_first_slow_on_mapped_view_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_swap_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_replace_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_slow_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_if_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_remove_range_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_reserve_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_resize_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_define_sort_on_mapped_view_does_nothing),
+    ANV_TESTSUITE_REGISTER(anv_arr_sort_radix_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_set_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_push_on_mapped_view_is_param_error),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_pop_on_mapped_view_is_null),
+    ANV_TESTSUITE_REGISTER(anv_arr_typed_clear_on_mapped_view_does_nothing),
+    THREADS_FIXTURES
+    STATS_FIXTURES
 );
 
 int
 main(void)
 {
     anv_testsuite_catch_crashes();
-    ANV_TESTSUITE_RUN(tests_anv_arr, stdout);
+    return ANV_TESTSUITE_RUN(tests_anv_arr, stdout);
 }
@@ -0,0 +1,255 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/anv_testsuite_2.h"
+#include "../include/anv_bench_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_ARR_IMPLEMENTATION
+#define anv_arr__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_arr.h"
+
+static const anv_bench_config fast_config = {
+    .sample_time_s = 0.0005,
+    .warmup_time_s = -1,
+    .samples = 7,
+};
+
+static size_t setup_calls;
+
+ANV_BENCH_CASE(bench_sum)
+{
+    ++setup_calls;
+    int values[64];
+    for (int i = 0; i < 64; ++i) {
+        values[i] = i;
+    }
+    state->items_per_iteration = 64;
+    state->bytes_per_iteration = sizeof(values);
+
+    ANV_BENCH_LOOP(state)
+    {
+        int sum = 0;
+        for (int i = 0; i < 64; ++i) {
+            sum += values[i];
+        }
+        anv_bench_do_not_optimize(&sum);
+    }
+}
+
+ANV_BENCH_CASE(bench_arr_push)
+{
+    anv_arr_t arr = anv_arr_new(16, sizeof(int));
+    ANV_BENCH_LOOP(state)
+    {
+        int value = (int)anv_bench__i;
+        anv_arr_push(arr, &value);
+    }
+    anv_bench_clobber_memory();
+    anv_arr_destroy(arr);
+}
+
+ANV_BENCH_CASE(bench_skipped)
+{
+    anv_bench_skip(state, "not supported");
+}
+
+ANV_BENCH_CASE(bench_without_loop)
+{
+    (void)state;
+}
+
+static size_t arg_sum;
+
+ANV_BENCH_CASE(bench_paused_setup)
+{
+    arg_sum += *(const size_t *)state->arg;
+    volatile size_t sink = 0;
+    ANV_BENCH_LOOP(state)
+    {
+        anv_bench_pause(state);
+        // this is not timed.
+        for (size_t i = 0; i < 2000; ++i) {
+            sink += i;
+        }
+        anv_bench_resume(state);
+        sink += anv_bench__i;
+    }
+    anv_bench_pause(state);
+}
+
+ANV_BENCH_SUITE(
+    ok_benchmarks,
+    ANV_BENCH_REGISTER(bench_sum),
+    ANV_BENCH_REGISTER(bench_arr_push),
+);
+
+ANV_BENCH_SUITE(
+    bad_benchmarks,
+    ANV_BENCH_REGISTER(bench_skipped),
+    ANV_BENCH_REGISTER(bench_without_loop),
+);
+
+ANV_TESTSUITE_FIXTURE(anv_bench_clock_is_monotonic)
+{
+    uint64_t a = anv_bench_now_ns();
+    uint64_t b = anv_bench_now_ns();
+    expect(b >= a);
+    expect(strcmp(anv_bench_clock_name(), "clock()") != 0);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_measure_computes_stats)
+{
+    double samples[ANV_BENCH_MAX_SAMPLES];
+    anv_bench_result result;
+    const char *error = NULL;
+    setup_calls = 0;
+    expect(
+        anv_bench__measure(
+            &ok_benchmarks[0], &fast_config, samples, &result, &error
+        )
+        == 0
+    );
+    expect(!error);
+    expect(result.samples == 7);
+    // calibration calls plus one call per sample.
+    expect(setup_calls > 7);
+    expect(result.iterations > 1);
+    expect(result.min_ns > 0);
+    expect(result.min_ns <= result.median_ns);
+    expect(result.median_ns <= result.p99_ns);
+    expect(result.p99_ns <= result.max_ns);
+    expect(result.stddev_ns >= 0);
+    expect(result.items_per_s > 0);
+    expect(result.bytes_per_s == result.items_per_s * sizeof(int));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_sqrt_ok)
+{
+    expect(anv_bench__sqrt(0) == 0);
+    expect(anv_bench__sqrt(-1) == 0);
+    double root = anv_bench__sqrt(2);
+    expect(root > 1.41421 && root < 1.41422);
+    root = anv_bench__sqrt(0.25);
+    expect(root > 0.49999 && root < 0.50001);
+    root = anv_bench__sqrt(1e12);
+    expect(root > 999999.99 && root < 1000000.01);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_errors_are_reported)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    anv_bench_config config = fast_config;
+    config.format = ANV_BENCH_FORMAT_CSV;
+    expect(ANV_BENCH_RUN(bad_benchmarks, out, &config) == 2);
+
+    char buff[512];
+    rewind(out);
+    size_t len = fread(buff, 1, sizeof(buff) - 1, out);
+    buff[len] = '\0';
+    fclose(out);
+    expect(strstr(buff, "bench_skipped,,,,,,,,,,,\"not supported\""));
+    expect(strstr(buff, "ANV_BENCH_LOOP not found"));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_formats_ok)
+{
+    anv_bench_config config = fast_config;
+    const anv_bench_format formats[] = {
+        ANV_BENCH_FORMAT_TEXT,
+        ANV_BENCH_FORMAT_CSV,
+        ANV_BENCH_FORMAT_JSON,
+    };
+    const char *expected[] = { "bench_arr_push", "name,iterations", "]\n}" };
+    for (size_t i = 0; i < 3; ++i) {
+        FILE *out = tmpfile();
+        expect(out);
+        config.format = formats[i];
+        config.filter = "arr";
+        expect(ANV_BENCH_RUN(ok_benchmarks, out, &config) == 0);
+
+        char buff[1024];
+        rewind(out);
+        size_t len = fread(buff, 1, sizeof(buff) - 1, out);
+        buff[len] = '\0';
+        fclose(out);
+        expect(strstr(buff, expected[i]));
+        // filtered out.
+        expect(!strstr(buff, "bench_sum"));
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_runtime_cases_with_args)
+{
+    static const size_t args[] = { 1, 10 };
+    anv_bench_case cases[2] = {
+        ANV_BENCH_REGISTER_ARG("paused_1", bench_paused_setup, &args[0]),
+        ANV_BENCH_REGISTER_ARG("paused_10", bench_paused_setup, &args[1]),
+    };
+    // registered without arg.
+    expect(!ok_benchmarks[0].arg);
+
+    double samples[ANV_BENCH_MAX_SAMPLES];
+    anv_bench_result result;
+    const char *error = NULL;
+    arg_sum = 0;
+    expect(anv_bench__measure(&cases[1], &fast_config, samples, &result, &error)
+           == 0);
+    expect(!error);
+    expect(arg_sum > 0 && arg_sum % 10 == 0);
+    // the paused loop would take way longer than this.
+    expect(result.median_ns < 1000);
+
+    FILE *out = tmpfile();
+    expect(out);
+    anv_bench_config config = fast_config;
+    config.format = ANV_BENCH_FORMAT_CSV;
+    expect(ANV_BENCH_RUN_CASES("runtime", cases, 2, out, &config) == 0);
+
+    char buff[1024];
+    rewind(out);
+    size_t len = fread(buff, 1, sizeof(buff) - 1, out);
+    buff[len] = '\0';
+    fclose(out);
+    expect(strstr(buff, "paused_1,"));
+    expect(strstr(buff, "paused_10,"));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_bench_config_from_args_ok)
+{
+    char *argv[] = {
+        "bench",
+        "--json",
+        "--filter=arr",
+        "--samples=12",
+        "--sample-time=0.5",
+        "--warmup=-1",
+        "--unknown",
+    };
+    anv_bench_config config = { 0 };
+    anv_bench_config_from_args(&config, 7, argv);
+    expect(config.format == ANV_BENCH_FORMAT_JSON);
+    expect(strcmp(config.filter, "arr") == 0);
+    expect(config.samples == 12);
+    expect(config.sample_time_s == 0.5);
+    expect(config.warmup_time_s == -1);
+}
+
+ANV_TESTSUITE(
+    tests_anv_bench_2,
+    ANV_TESTSUITE_REGISTER(anv_bench_clock_is_monotonic),
+    ANV_TESTSUITE_REGISTER(anv_bench_measure_computes_stats),
+    ANV_TESTSUITE_REGISTER(anv_bench_sqrt_ok),
+    ANV_TESTSUITE_REGISTER(anv_bench_errors_are_reported),
+    ANV_TESTSUITE_REGISTER(anv_bench_formats_ok),
+    ANV_TESTSUITE_REGISTER(anv_bench_runtime_cases_with_args),
+    ANV_TESTSUITE_REGISTER(anv_bench_config_from_args_ok),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_bench_2, stdout);
+}
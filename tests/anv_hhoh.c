@@ -0,0 +1,211 @@
+// fileno() and fdopen() with -std=c99.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 1
+#endif
+
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_HHOH_IMPLEMENTATION
+#include "../include/anv_hhoh.h"
+
+#define FILE_SZ (64 * 1024 + 100)
+
+static unsigned char
+pattern_at(size_t i)
+{
+    return (unsigned char)(i * 31 + i / 4093);
+}
+
+/*
+ * Write FILE_SZ pattern bytes to filename.
+ */
+static int
+write_pattern(const char *filename)
+{
+    ANV_HANDLE hd;
+    if (!anv_hhoh_open_file(&hd, filename, "wb")) {
+        return 0;
+    }
+    for (size_t i = 0; i < FILE_SZ; ++i) {
+        fputc(pattern_at(i), hd.file);
+    }
+    return anv_hhoh_close_auto(&hd);
+}
+
+static int
+matches_pattern(const void *buff, size_t sz, size_t from)
+{
+    const unsigned char *bytes = buff;
+    for (size_t i = 0; i < sz; ++i) {
+        if (bytes[i] != pattern_at(from + i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+ANV_TESTSUITE_FIXTURE(hhoh_open_convert_close)
+{
+    const char *filename = "anv_hhoh_convert.bin";
+    expect(write_pattern(filename));
+
+    ANV_HANDLE hd;
+    expect(anv_hhoh_open_file(&hd, filename, "rb"));
+    expect(hd.current == ANV_HHOH_HANDLE_FILE);
+    expect(anv_hhoh_file_to_cfd(&hd));
+    expect(hd.current == ANV_HHOH_HANDLE_C_FD);
+    uint64_t sz = 0;
+    expect(anv_hhoh_get_size(&hd, &sz));
+    expect(sz == FILE_SZ);
+    expect(anv_hhoh_cfd_to_file(&hd, "rb"));
+    expect(hd.current == ANV_HHOH_HANDLE_FILE);
+    expect(fgetc(hd.file) == pattern_at(0));
+    expect(anv_hhoh_close_auto(&hd));
+    expect(hd.current == ANV_HHOH_HANDLE_INVALID);
+
+    expect(!anv_hhoh_open_read(&hd, "anv_hhoh_missing.bin", 0));
+    expect(hd.current == ANV_HHOH_HANDLE_INVALID);
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(hhoh_read_at)
+{
+    const char *filename = "anv_hhoh_read_at.bin";
+    expect(write_pattern(filename));
+
+    ANV_HANDLE hd;
+    expect(anv_hhoh_open_read(&hd, filename, 0));
+    static unsigned char buff[FILE_SZ + 512];
+    size_t read_sz = 0;
+    expect(anv_hhoh_read_at(&hd, buff, 1000, 5000, &read_sz));
+    expect(read_sz == 1000);
+    expect(matches_pattern(buff, read_sz, 5000));
+    // offsets do not depend on previous reads.
+    expect(anv_hhoh_read_at(&hd, buff, 10, 3, &read_sz));
+    expect(read_sz == 10);
+    expect(matches_pattern(buff, read_sz, 3));
+    expect(anv_hhoh_read_at(&hd, buff, sizeof(buff), 0, &read_sz));
+    expect(read_sz == FILE_SZ);
+    expect(matches_pattern(buff, read_sz, 0));
+    expect(anv_hhoh_read_at(&hd, buff, 512, FILE_SZ - 12, &read_sz));
+    expect(read_sz == 12);
+    expect(matches_pattern(buff, read_sz, FILE_SZ - 12));
+    expect(anv_hhoh_read_at(&hd, buff, 512, FILE_SZ + 4096, &read_sz));
+    expect(read_sz == 0);
+    expect(anv_hhoh_close_auto(&hd));
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(hhoh_unbuffered_read_batch)
+{
+    enum { REQ_SZ = 4096, REQS_COUNT = 18 };
+    const char *filename = "anv_hhoh_batch.bin";
+    expect(write_pattern(filename));
+
+    ANV_HANDLE hd;
+    expect(anv_hhoh_open_read(
+        &hd, filename, ANV_HHOH_OPEN_UNBUFFERED | ANV_HHOH_OPEN_OVERLAPPED
+    ));
+    anv_hhoh_read_req reqs[REQS_COUNT];
+    memset(reqs, 0, sizeof(reqs));
+    // submitted backwards, the last two requests reach past the end.
+    for (size_t i = 0; i < REQS_COUNT; ++i) {
+        reqs[i].buff = anv_hhoh_alloc_aligned(REQ_SZ);
+        expect(reqs[i].buff);
+        expect((uintptr_t)reqs[i].buff % ANV_HHOH_SECTOR_SIZE == 0);
+        reqs[i].sz = REQ_SZ;
+        reqs[i].offset = (uint64_t)(REQS_COUNT - 1 - i) * REQ_SZ;
+    }
+    expect(anv_hhoh_read_batch(&hd, reqs, REQS_COUNT, 4));
+    size_t total = 0;
+    for (size_t i = 0; i < REQS_COUNT; ++i) {
+        expect(reqs[i].success);
+        size_t offset = (size_t)reqs[i].offset;
+        size_t expected_sz = offset >= FILE_SZ ? 0
+                           : FILE_SZ - offset < REQ_SZ
+                               ? FILE_SZ - offset
+                               : REQ_SZ;
+        expect(reqs[i].read_sz == expected_sz);
+        expect(matches_pattern(reqs[i].buff, reqs[i].read_sz, offset));
+        total += reqs[i].read_sz;
+        anv_hhoh_free_aligned(reqs[i].buff);
+    }
+    expect(total == FILE_SZ);
+    anv_hhoh_free_aligned(NULL);
+    expect(anv_hhoh_close_auto(&hd));
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(hhoh_read_batch_deep_queue)
+{
+    const char *filename = "anv_hhoh_deep_queue.bin";
+    expect(write_pattern(filename));
+
+    ANV_HANDLE hd;
+    expect(anv_hhoh_open_read(&hd, filename, 0));
+    static unsigned char buffs[3][1000];
+    anv_hhoh_read_req reqs[3];
+    memset(reqs, 0, sizeof(reqs));
+    for (size_t i = 0; i < 3; ++i) {
+        reqs[i].buff = buffs[i];
+        reqs[i].sz = sizeof(buffs[i]);
+        reqs[i].offset = 20000 * i + 7;
+    }
+    // more depth than requests.
+    expect(anv_hhoh_read_batch(&hd, reqs, 3, 100));
+    for (size_t i = 0; i < 3; ++i) {
+        expect(reqs[i].success);
+        expect(reqs[i].read_sz == sizeof(buffs[i]));
+        expect(matches_pattern(buffs[i], reqs[i].read_sz, 20000 * i + 7));
+    }
+    expect(anv_hhoh_read_batch(&hd, reqs, 0, 100));
+    expect(anv_hhoh_close_auto(&hd));
+    remove(filename);
+}
+
+ANV_TESTSUITE_FIXTURE(hhoh_map_view)
+{
+    const char *filename = "anv_hhoh_view.bin";
+    expect(write_pattern(filename));
+
+    ANV_HANDLE hd;
+    expect(anv_hhoh_open_read(&hd, filename, 0));
+    anv_hhoh_view view;
+    expect(anv_hhoh_map_view(&hd, 5000, 1000, &view));
+    expect(view.sz == 1000);
+    expect(matches_pattern(view.data, view.sz, 5000));
+    expect(anv_hhoh_unmap_view(&view));
+    expect(view.base == NULL);
+    expect(!anv_hhoh_unmap_view(&view));
+
+    // sz 0 maps the rest of the file.
+    anv_hhoh_view rest;
+    expect(anv_hhoh_map_view(&hd, 60000, 0, &rest));
+    expect(rest.sz == (size_t)(FILE_SZ - 60000));
+    // views outlive the handle.
+    expect(anv_hhoh_close_auto(&hd));
+    expect(matches_pattern(rest.data, rest.sz, 60000));
+    expect(anv_hhoh_unmap_view(&rest));
+
+    expect(anv_hhoh_open_read(&hd, filename, 0));
+    expect(!anv_hhoh_map_view(&hd, FILE_SZ, 0, &view));
+    expect(!anv_hhoh_map_view(&hd, 100, FILE_SZ, &view));
+    expect(anv_hhoh_close_auto(&hd));
+    remove(filename);
+}
+
+ANV_TESTSUITE(
+    tests_anv_hhoh,
+    ANV_TESTSUITE_REGISTER(hhoh_open_convert_close),
+    ANV_TESTSUITE_REGISTER(hhoh_read_at),
+    ANV_TESTSUITE_REGISTER(hhoh_unbuffered_read_batch),
+    ANV_TESTSUITE_REGISTER(hhoh_read_batch_deep_queue),
+    ANV_TESTSUITE_REGISTER(hhoh_map_view),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_hhoh, stdout);
+}
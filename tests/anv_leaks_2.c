@@ -0,0 +1,297 @@
+#include "../include/anv_testsuite_2.h"
+
+#ifdef ANV_LEAKS_ENABLE_THREADS
+#include <pthread.h>
+#endif
+
+#define ANV_LEAKS_IMPLEMENTATION
+#include "../include/anv_leaks_2.h"
+
+ANV_TESTSUITE_FIXTURE(leaks_tracks_live_blocks)
+{
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    void *a = malloc(10);
+    int leak_line = __LINE__ + 1;
+    void *b = malloc(20);
+    free(a);
+
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.malloc_count == 2);
+    expect(stats.free_count == 1);
+    expect(stats.live_count == 1);
+    expect(stats.live_bytes == 20);
+    expect(stats.total_allocated == 30);
+    expect(stats.total_freed == 10);
+
+    anv_leak_info *leaks = NULL;
+    size_t count = 0;
+    expect(anv_leaks_get_leaks(&leaks, &count) == ANV_LEAKS_OK);
+    expect(count == 1);
+    expect(leaks[0].address == b);
+    expect(leaks[0].bytes == 20);
+    expect(leaks[0].line == leak_line);
+    expect(strcmp(leaks[0].filename, __FILE__) == 0);
+    anv_leaks_free_leaks(leaks);
+
+    free(b);
+    free(NULL);
+    expect(anv_leaks_get_leaks(&leaks, &count) == ANV_LEAKS_OK);
+    expect(count == 0 && leaks == NULL);
+    anv_leaks_shutdown();
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_realloc_and_calloc)
+{
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    int *mem = calloc(4, sizeof(int));
+    expect(mem && mem[3] == 0);
+    mem = realloc(mem, 1024 * sizeof(int));
+    expect(mem);
+    void *other = realloc(NULL, 8);
+    expect(realloc(other, 0) == NULL);
+
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.calloc_count == 1);
+    expect(stats.realloc_count == 2);
+    expect(stats.free_count == 1);
+    expect(stats.live_count == 1);
+    expect(stats.live_bytes == 1024 * sizeof(int));
+
+    free(mem);
+    anv_leaks_get_stats(&stats);
+    expect(stats.live_count == 0 && stats.live_bytes == 0);
+    expect(stats.total_allocated == stats.total_freed);
+    anv_leaks_shutdown();
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_many_blocks)
+{
+    enum { COUNT = 10000 };
+    static void *blocks[COUNT];
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    for (size_t i = 0; i < COUNT; ++i) {
+        blocks[i] = malloc(i % 64 + 1);
+        expect(blocks[i]);
+    }
+    // free every other block, tables must survive holes.
+    for (size_t i = 0; i < COUNT; i += 2) {
+        free(blocks[i]);
+    }
+
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.live_count == COUNT / 2);
+    expect(stats.untracked_count == 0);
+
+    anv_leak_info *leaks = NULL;
+    size_t count = 0;
+    expect(anv_leaks_get_leaks(&leaks, &count) == ANV_LEAKS_OK);
+    expect(count == COUNT / 2);
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += leaks[i].bytes;
+    }
+    expect(bytes == stats.live_bytes);
+    anv_leaks_free_leaks(leaks);
+
+    for (size_t i = 1; i < COUNT; i += 2) {
+        free(blocks[i]);
+    }
+    anv_leaks_get_stats(&stats);
+    expect(stats.live_count == 0);
+    anv_leaks_shutdown();
+}
+
+static void *
+alloc_small(void)
+{
+    return malloc(8);
+}
+
+static void *
+alloc_big(void)
+{
+    return malloc(1000);
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_sites_aggregated)
+{
+    void *blocks[30];
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    for (int i = 0; i < 20; ++i) {
+        blocks[i] = alloc_small();
+    }
+    for (int i = 20; i < 30; ++i) {
+        blocks[i] = alloc_big();
+    }
+    for (int i = 0; i < 5; ++i) {
+        free(blocks[i]);
+        free(blocks[20 + i]);
+    }
+
+    anv_leaks_site *sites = NULL;
+    size_t count = 0;
+    expect(anv_leaks_get_sites(&sites, &count) == ANV_LEAKS_OK);
+    expect(count == 2);
+    // sorted by live bytes.
+    expect(sites[0].live_count == 5 && sites[0].live_bytes == 5000);
+    expect(sites[0].total_count == 10 && sites[0].total_bytes == 10000);
+    expect(sites[1].live_count == 15 && sites[1].live_bytes == 120);
+    expect(sites[1].total_count == 20 && sites[1].total_bytes == 160);
+    expect(sites[0].line != sites[1].line);
+    anv_leaks_free_sites(sites);
+
+    for (int i = 5; i < 20; ++i) {
+        free(blocks[i]);
+    }
+    for (int i = 25; i < 30; ++i) {
+        free(blocks[i]);
+    }
+    anv_leaks_shutdown();
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_sampling)
+{
+    enum { COUNT = 1000 };
+    static void *blocks[COUNT];
+    anv_leaks_options options = { .sample_rate = 4, .log_file = NULL };
+    expect(anv_leaks_init(&options) == ANV_LEAKS_OK);
+    for (size_t i = 0; i < COUNT; ++i) {
+        blocks[i] = malloc(16);
+    }
+
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.malloc_count == COUNT);
+    expect(stats.live_count == COUNT / 4);
+    expect(stats.untracked_count == COUNT - COUNT / 4);
+
+    // freeing untracked blocks is fine when sampling.
+    for (size_t i = 0; i < COUNT; ++i) {
+        blocks[i] = realloc(blocks[i], 32);
+    }
+    anv_leaks_get_stats(&stats);
+    expect(stats.live_count == COUNT / 4);
+    expect(stats.live_bytes == COUNT / 4 * 32);
+    for (size_t i = 0; i < COUNT; ++i) {
+        free(blocks[i]);
+    }
+    anv_leaks_get_stats(&stats);
+    expect(stats.free_count == COUNT);
+    expect(stats.live_count == 0);
+    anv_leaks_shutdown();
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_report)
+{
+    FILE *log = tmpfile();
+    FILE *report = tmpfile();
+    expect(log && report);
+    anv_leaks_options options = { .sample_rate = 1, .log_file = log };
+    expect(anv_leaks_init(&options) == ANV_LEAKS_OK);
+    void *mem = alloc_big();
+    anv_leaks_report(report, 10);
+    free(mem);
+    anv_leaks_shutdown();
+
+    char buff[1024];
+    rewind(report);
+    buff[fread(buff, 1, sizeof(buff) - 1, report)] = '\0';
+    expect(strstr(buff, "anv_leaks: 1 live blocks, 1000 bytes"));
+    expect(strstr(buff, "live: 1 blocks, 1000 bytes"));
+    rewind(log);
+    buff[fread(buff, 1, sizeof(buff) - 1, log)] = '\0';
+    expect(strstr(buff, "malloc(1000)"));
+    expect(strstr(buff, "free(1000)"));
+    fclose(log);
+    fclose(report);
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_untracked_before_init)
+{
+    void *mem = malloc(10);
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.malloc_count == 0);
+    anv_leaks_shutdown();
+    free(mem);
+}
+
+#ifdef ANV_LEAKS_ENABLE_THREADS
+#define THREADS_COUNT 4
+#define THREAD_ALLOCS 5000
+
+static void *
+thread_alloc(void *arg)
+{
+    void **blocks = (void **)arg;
+    for (size_t i = 0; i < THREAD_ALLOCS; ++i) {
+        blocks[i] = malloc(i % 32 + 1);
+        if (i % 3 == 0) {
+            free(blocks[i]);
+            blocks[i] = NULL;
+        }
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(leaks_threads)
+{
+    static void *blocks[THREADS_COUNT][THREAD_ALLOCS];
+    pthread_t threads[THREADS_COUNT];
+    expect(anv_leaks_init(NULL) == ANV_LEAKS_OK);
+    for (size_t i = 0; i < THREADS_COUNT; ++i) {
+        expect(pthread_create(&threads[i], NULL, thread_alloc, blocks[i]) == 0);
+    }
+    for (size_t i = 0; i < THREADS_COUNT; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size_t live = 0;
+    for (size_t i = 0; i < THREADS_COUNT; ++i) {
+        for (size_t j = 0; j < THREAD_ALLOCS; ++j) {
+            live += blocks[i][j] != NULL;
+        }
+    }
+    anv_leaks_stats stats;
+    anv_leaks_get_stats(&stats);
+    expect(stats.malloc_count == THREADS_COUNT * THREAD_ALLOCS);
+    expect(stats.live_count == live);
+
+    for (size_t i = 0; i < THREADS_COUNT; ++i) {
+        for (size_t j = 0; j < THREAD_ALLOCS; ++j) {
+            free(blocks[i][j]);
+        }
+    }
+    anv_leaks_get_stats(&stats);
+    expect(stats.live_count == 0);
+    anv_leaks_shutdown();
+}
+
+// registered only when available.
+#define THREADS_FIXTURES ANV_TESTSUITE_REGISTER(leaks_threads),
+#else
+#define THREADS_FIXTURES
+#endif
+
+ANV_TESTSUITE(
+    tests_anv_leaks_2,
+    ANV_TESTSUITE_REGISTER(leaks_tracks_live_blocks),
+    ANV_TESTSUITE_REGISTER(leaks_realloc_and_calloc),
+    ANV_TESTSUITE_REGISTER(leaks_many_blocks),
+    ANV_TESTSUITE_REGISTER(leaks_sites_aggregated),
+    ANV_TESTSUITE_REGISTER(leaks_sampling),
+    ANV_TESTSUITE_REGISTER(leaks_report),
+    ANV_TESTSUITE_REGISTER(leaks_untracked_before_init),
+    THREADS_FIXTURES
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_leaks_2, stdout);
+}
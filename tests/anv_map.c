@@ -0,0 +1,342 @@
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_MAP_IMPLEMENTATION
+#define anv_map__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_map.h"
+
+#include <stdint.h>
+#include <string.h>
+
+ANV_TESTSUITE_FIXTURE(anv_map_new_ok)
+{
+    anv_map_t map = anv_map_new(100, sizeof(int), sizeof(int));
+    expect(map);
+    expect(anv_map_length(map) == 0);
+    expect(anv_map_capacity(map) >= 100);
+    expect((uintptr_t)map % ANV_MAP_ALIGNMENT == 0);
+    anv_map_destroy(map);
+
+    map = anv_map_new(0, sizeof(int), 0);
+    expect(map);
+    expect(anv_map_capacity(map) > 0);
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_invalid_params)
+{
+    expect(!anv_map_new(10, 0, sizeof(int)));
+    expect(!anv_map_new((size_t)-1, sizeof(int), sizeof(int)));
+    expect(!anv_map_new_with_options(NULL));
+    expect(anv_map_length(NULL) == 0);
+
+    int key = 1;
+    anv_map_t map = NULL;
+    expect(anv_map_put(map, &key, &key) == ANV_MAP_RESULT_INVALID_PARAMS);
+    expect(!anv_map_get(NULL, &key));
+    expect(anv_map_remove(NULL, &key) == ANV_MAP_RESULT_INVALID_PARAMS);
+
+    map = anv_map_new(10, sizeof(int), sizeof(int));
+    expect(anv_map_put(map, NULL, &key) == ANV_MAP_RESULT_INVALID_PARAMS);
+    expect(!anv_map_get(map, NULL));
+    anv_map_destroy(map);
+    anv_map_destroy(NULL);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_put_get_overwrite)
+{
+    anv_map_t map = anv_map_new(8, sizeof(int), sizeof(double));
+    expect(map);
+
+    int key = 42;
+    double value = 1.5;
+    expect(anv_map_put(map, &key, &value) == ANV_MAP_RESULT_OK);
+    expect(anv_map_length(map) == 1);
+    double *found = anv_map_get(map, &key);
+    expect(found && *found == 1.5);
+
+    value = 3.0;
+    expect(anv_map_put(map, &key, &value) == ANV_MAP_RESULT_OK);
+    expect(anv_map_length(map) == 1);
+    expect(*(double *)anv_map_get(map, &key) == 3.0);
+
+    // a NULL value is zeroed.
+    expect(anv_map_put(map, &key, NULL) == ANV_MAP_RESULT_OK);
+    expect(*(double *)anv_map_get(map, &key) == 0.0);
+
+    int missing = 7;
+    expect(!anv_map_get(map, &missing));
+    expect(!anv_map_contains(map, &missing));
+    expect(anv_map_contains(map, &key));
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_grows_keeping_items)
+{
+    anv_map_t map = anv_map_new(4, sizeof(uint32_t), sizeof(uint32_t));
+    expect(map);
+
+    for (uint32_t i = 0; i < 100000; ++i) {
+        uint32_t value = i * 3;
+        expect(anv_map_put(map, &i, &value) == ANV_MAP_RESULT_OK);
+    }
+    expect(anv_map_length(map) == 100000);
+    expect(anv_map_capacity(map) >= 100000);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        uint32_t *value = anv_map_get(map, &i);
+        expect(value && *value == i * 3);
+    }
+    uint32_t missing = 100000;
+    expect(!anv_map_get(map, &missing));
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_remove_ok)
+{
+    anv_map_t map = anv_map_new(64, sizeof(int), sizeof(int));
+    expect(map);
+
+    for (int i = 0; i < 50; ++i) {
+        expect(anv_map_put(map, &i, &i) == ANV_MAP_RESULT_OK);
+    }
+    for (int i = 0; i < 50; i += 2) {
+        expect(anv_map_remove(map, &i) == ANV_MAP_RESULT_OK);
+    }
+    expect(anv_map_length(map) == 25);
+    int key = 0;
+    expect(anv_map_remove(map, &key) == ANV_MAP_RESULT_KEY_NOT_FOUND);
+    for (int i = 0; i < 50; ++i) {
+        int *value = anv_map_get(map, &i);
+        if (i % 2) {
+            expect(value && *value == i);
+        } else {
+            expect(!value);
+        }
+    }
+    expect(anv_map_put(map, &key, &key) == ANV_MAP_RESULT_OK);
+    expect(anv_map_length(map) == 26);
+    expect(anv_map_contains(map, &key));
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_churn_does_not_grow)
+{
+    anv_map_t map = anv_map_new(1000, sizeof(uint64_t), sizeof(uint64_t));
+    expect(map);
+    size_t capacity = anv_map_capacity(map);
+
+    // a sliding window of 500 keys: tombstones must be recycled.
+    for (uint64_t i = 0; i < 200000; ++i) {
+        expect(anv_map_put(map, &i, &i) == ANV_MAP_RESULT_OK);
+        if (i >= 500) {
+            uint64_t old = i - 500;
+            expect(anv_map_remove(map, &old) == ANV_MAP_RESULT_OK);
+        }
+    }
+    expect(anv_map_length(map) == 500);
+    expect(anv_map_capacity(map) == capacity);
+    for (uint64_t i = 200000 - 500; i < 200000; ++i) {
+        uint64_t *value = anv_map_get(map, &i);
+        expect(value && *value == i);
+    }
+
+    anv_map_destroy(map);
+}
+
+static size_t
+constant_hash(const void *key, size_t key_sz)
+{
+    (void)key;
+    (void)key_sz;
+    return 1234;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_colliding_hashes_ok)
+{
+    anv_map_options options = {
+        .capacity = 16,
+        .key_sz = sizeof(int),
+        .value_sz = sizeof(int),
+        .hash_fn = constant_hash,
+    };
+    anv_map_t map = anv_map_new_with_options(&options);
+    expect(map);
+
+    for (int i = 0; i < 300; ++i) {
+        int value = -i;
+        expect(anv_map_put(map, &i, &value) == ANV_MAP_RESULT_OK);
+    }
+    for (int i = 0; i < 300; i += 3) {
+        expect(anv_map_remove(map, &i) == ANV_MAP_RESULT_OK);
+    }
+    for (int i = 0; i < 300; ++i) {
+        int *value = anv_map_get(map, &i);
+        if (i % 3) {
+            expect(value && *value == -i);
+        } else {
+            expect(!value);
+        }
+    }
+    expect(anv_map_length(map) == 200);
+
+    anv_map_destroy(map);
+}
+
+static size_t
+string_hash(const void *key, size_t key_sz)
+{
+    (void)key_sz;
+    const char *str = *(const char *const *)key;
+    return anv_map_hash_bytes(str, strlen(str));
+}
+
+static int
+string_equals(const void *a, const void *b, size_t key_sz)
+{
+    (void)key_sz;
+    return strcmp(*(const char *const *)a, *(const char *const *)b) == 0;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_custom_callbacks_string_keys)
+{
+    anv_map_options options = {
+        .key_sz = sizeof(const char *),
+        .value_sz = sizeof(int),
+        .hash_fn = string_hash,
+        .equals_fn = string_equals,
+    };
+    anv_map_t map = anv_map_new_with_options(&options);
+    expect(map);
+
+    const char *names[] = { "alpha", "beta", "gamma", "delta" };
+    for (int i = 0; i < 4; ++i) {
+        expect(anv_map_put(map, &names[i], &i) == ANV_MAP_RESULT_OK);
+    }
+    // a different pointer to an equal string.
+    char buffer[8];
+    strcpy(buffer, "gamma");
+    const char *lookup = buffer;
+    int *value = anv_map_get(map, &lookup);
+    expect(value && *value == 2);
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_as_set)
+{
+    anv_map_t set = anv_map_new(0, sizeof(uint16_t), 0);
+    expect(set);
+
+    for (uint16_t i = 0; i < 1000; i += 5) {
+        expect(anv_map_put(set, &i, NULL) == ANV_MAP_RESULT_OK);
+    }
+    expect(anv_map_length(set) == 200);
+    for (uint16_t i = 0; i < 1000; ++i) {
+        expect(anv_map_contains(set, &i) == (i % 5 == 0));
+    }
+
+    anv_map_destroy(set);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_next_visits_all_once)
+{
+    anv_map_t map = anv_map_new(0, sizeof(int), sizeof(int));
+    expect(map);
+
+    int seen[500];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < 500; ++i) {
+        expect(anv_map_put(map, &i, &i) == ANV_MAP_RESULT_OK);
+    }
+    for (int i = 0; i < 500; i += 7) {
+        expect(anv_map_remove(map, &i) == ANV_MAP_RESULT_OK);
+    }
+
+    size_t cursor = 0;
+    void *key;
+    void *value;
+    size_t count = 0;
+    while (anv_map_next(map, &cursor, &key, &value)) {
+        expect(*(int *)key == *(int *)value);
+        ++seen[*(int *)key];
+        ++count;
+    }
+    expect(count == anv_map_length(map));
+    for (int i = 0; i < 500; ++i) {
+        expect(seen[i] == (i % 7 ? 1 : 0));
+    }
+    expect(!anv_map_next(map, &cursor, NULL, NULL));
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_reserve_avoids_moves)
+{
+    anv_map_t map = anv_map_new(0, sizeof(int), sizeof(int));
+    expect(map);
+
+    expect(anv_map_reserve(map, 5000) == ANV_MAP_RESULT_OK);
+    expect(anv_map_capacity(map) >= 5000);
+    anv_map_t reserved = map;
+    for (int i = 0; i < 5000; ++i) {
+        expect(anv_map_put(map, &i, &i) == ANV_MAP_RESULT_OK);
+    }
+    expect(map == reserved);
+
+    anv_map_clear(map);
+    expect(anv_map_length(map) == 0);
+    int key = 10;
+    expect(!anv_map_get(map, &key));
+    expect(anv_map_put(map, &key, &key) == ANV_MAP_RESULT_OK);
+    expect(anv_map_length(map) == 1);
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_map_values_are_aligned)
+{
+    anv_map_t map = anv_map_new(0, 3, sizeof(uint64_t));
+    expect(map);
+
+    for (int i = 0; i < 100; ++i) {
+        char key[3] = { (char)i, 'k', 'y' };
+        uint64_t value = (uint64_t)i << 40;
+        expect(anv_map_put(map, key, &value) == ANV_MAP_RESULT_OK);
+    }
+    for (int i = 0; i < 100; ++i) {
+        char key[3] = { (char)i, 'k', 'y' };
+        uint64_t *value = anv_map_get(map, key);
+        expect(value);
+        expect((uintptr_t)value % sizeof(uint64_t) == 0);
+        expect(*value == (uint64_t)i << 40);
+    }
+
+    anv_map_destroy(map);
+}
+
+ANV_TESTSUITE(
+    tests_anv_map,
+    ANV_TESTSUITE_REGISTER(anv_map_new_ok),
+    ANV_TESTSUITE_REGISTER(anv_map_invalid_params),
+    ANV_TESTSUITE_REGISTER(anv_map_put_get_overwrite),
+    ANV_TESTSUITE_REGISTER(anv_map_grows_keeping_items),
+    ANV_TESTSUITE_REGISTER(anv_map_remove_ok),
+    ANV_TESTSUITE_REGISTER(anv_map_churn_does_not_grow),
+    ANV_TESTSUITE_REGISTER(anv_map_colliding_hashes_ok),
+    ANV_TESTSUITE_REGISTER(anv_map_custom_callbacks_string_keys),
+    ANV_TESTSUITE_REGISTER(anv_map_as_set),
+    ANV_TESTSUITE_REGISTER(anv_map_next_visits_all_once),
+    ANV_TESTSUITE_REGISTER(anv_map_reserve_avoids_moves),
+    ANV_TESTSUITE_REGISTER(anv_map_values_are_aligned),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_map, stdout);
+}
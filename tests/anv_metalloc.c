@@ -1,10 +1,14 @@
 #include "../include/anv_testsuite_2.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 // disable debug assertion to enable testing invalid cases in prod.
 #define anv_meta__assert(cond, errmsg) ((void)(cond))
 
+// small enough to test large blocks without touching hundreds of MB.
+#define ANV_METALLOC_LARGE_THRESHOLD 65536
+
 #define ANV_METALLOC_IMPLEMENTATION
 #include "../include/anv_metalloc.h"
 
@@ -215,6 +219,20 @@ ANV_TESTSUITE_FIXTURE(anv_meta_get_when_no_metadata_return_empty_metadata)
     anv_meta_free(mem);
 }
 
+ANV_TESTSUITE_FIXTURE(anv_meta_get_unchecked_same_as_anv_meta_get)
+{
+    metadata_t meta = { 10, 20 };
+    void *mem = anv_meta_malloc(&meta, sizeof(metadata_t), 100);
+    expect(mem);
+
+    metadata_t *found_meta = (metadata_t *)anv_meta_get_unchecked(mem);
+    expect(found_meta == anv_meta_get(mem));
+    expect(found_meta->a == 10);
+    expect(found_meta->b == 20);
+
+    anv_meta_free(mem);
+}
+
 ANV_TESTSUITE_FIXTURE(anv_meta_get_when_null_mem_return_0)
 {
     expect(anv_meta_get(NULL) == 0);
@@ -307,6 +325,32 @@ ANV_TESTSUITE_FIXTURE(anv_meta_get_offset_when_invalid_mem_return_0)
     free(mem);
 }
 
+ANV_TESTSUITE_FIXTURE(anv_meta_init_buffer_ok)
+{
+    size_t buffer[8];
+    metadata_t meta = { 10, 20 };
+    void *mem
+        = anv_meta_init_buffer(buffer, sizeof(buffer), &meta, sizeof(meta));
+    expect(mem);
+    expect(anv_meta_isvalid(mem));
+    expect(anv_meta_getsz(mem) == sizeof(metadata_t));
+    expect(anv_meta_get(mem) == (void *)buffer);
+    expect(((metadata_t *)anv_meta_get(mem))->b == 20);
+    size_t header_sz = ANV_META_BUFFER_SIZE(sizeof(meta), 0);
+    expect(header_sz == (size_t)anv_meta_get_offset(mem));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_init_buffer_too_small_fail)
+{
+    size_t buffer[8];
+    size_t header_sz = ANV_META_BUFFER_SIZE(sizeof(metadata_t), 0);
+    expect(!anv_meta_init_buffer(buffer, header_sz, NULL, sizeof(metadata_t)));
+    expect(anv_meta_init_buffer(
+        buffer, header_sz + 1, NULL, sizeof(metadata_t)
+    ));
+    expect(!anv_meta_init_buffer(NULL, sizeof(buffer), NULL, 1));
+}
+
 ANV_TESTSUITE_FIXTURE(anv_meta_realloc_simple_ok)
 {
     metadata_t meta = { 10, 20 };
@@ -493,6 +537,402 @@ ANV_TESTSUITE_FIXTURE(anv_meta_realloc_change_data)
     anv_meta_free(new_mem);
 }
 
+typedef struct counting_ctx_t {
+    int mallocs, reallocs, frees;
+} counting_ctx_t;
+
+static void *
+counting_malloc(void *ctx, size_t sz)
+{
+    ((counting_ctx_t *)ctx)->mallocs++;
+    return malloc(sz);
+}
+
+static void *
+counting_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    ((counting_ctx_t *)ctx)->reallocs++;
+    return realloc(mem, new_sz);
+}
+
+static void
+counting_free(void *ctx, void *mem)
+{
+    ((counting_ctx_t *)ctx)->frees++;
+    free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_with_uses_allocator)
+{
+    counting_ctx_t counts = { 0, 0, 0 };
+    anv_meta_allocator allocator = {
+        counting_malloc, counting_realloc, counting_free, &counts
+    };
+
+    metadata_t meta = { 10, 20 };
+    void *mem = anv_meta_malloc_with(&allocator, &meta, sizeof(meta), 10);
+    expect(mem);
+    expect(counts.mallocs == 1);
+    expect(anv_meta_get_allocator(mem) == &allocator);
+
+    mem = anv_meta_realloc(mem, 100);
+    expect(mem);
+    expect(counts.reallocs == 1);
+    expect(((metadata_t *)anv_meta_get(mem))->b == 20);
+    expect(anv_meta_get_allocator(mem) == &allocator);
+
+    anv_meta_free(mem);
+    expect(counts.frees == 1);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_default_allocator_is_remembered_per_block)
+{
+    counting_ctx_t counts = { 0, 0, 0 };
+    anv_meta_allocator allocator = {
+        counting_malloc, counting_realloc, counting_free, &counts
+    };
+
+    expect(!anv_meta_get_default_allocator());
+    void *libc_mem = anv_meta_malloc(NULL, sizeof(metadata_t), 10);
+    expect(libc_mem);
+    expect(!anv_meta_get_allocator(libc_mem));
+
+    anv_meta_set_default_allocator(&allocator);
+    expect(anv_meta_get_default_allocator() == &allocator);
+    void *mem = anv_meta_malloc(NULL, sizeof(metadata_t), 10);
+    expect(mem);
+    expect(counts.mallocs == 1);
+    anv_meta_set_default_allocator(NULL);
+
+    // Each block is released by the allocator it was allocated with.
+    anv_meta_free(libc_mem);
+    expect(counts.frees == 0);
+    anv_meta_free(mem);
+    expect(counts.frees == 1);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_aligned_data_is_aligned)
+{
+    for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+        metadata_t meta = { 10, 20 };
+        void *mem = anv_meta_malloc_aligned(&meta, sizeof(meta), 10, alignment);
+        expect(mem);
+        expect((size_t)mem % alignment == 0);
+        expect(anv_meta_get_alignment(mem) == alignment);
+        expect(anv_meta_getsz(mem) == sizeof(metadata_t));
+        expect(((metadata_t *)anv_meta_get(mem))->a == 10);
+        expect(anv_meta_get_unchecked(mem) == anv_meta_get(mem));
+        anv_meta_free(mem);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_aligned_metadata_is_aligned)
+{
+    unsigned char meta[40] = { 7 };
+    for (anv_meta_size_t meta_sz = 1; meta_sz <= sizeof(meta); ++meta_sz) {
+        for (size_t alignment = 1; alignment <= 128; alignment *= 4) {
+            unsigned char *mem
+                = anv_meta_malloc_aligned(meta, meta_sz, 10, alignment);
+            expect(mem);
+            expect((size_t)mem % alignment == 0);
+            expect((size_t)anv_meta_get(mem) % 16 == 0);
+            expect(anv_meta_get_unchecked(mem) == anv_meta_get(mem));
+            expect(*(unsigned char *)anv_meta_get(mem) == 7);
+
+            // realloc moves both to their new aligned spots.
+            mem = anv_meta_realloc(mem, 5000);
+            expect(mem);
+            expect((size_t)mem % alignment == 0);
+            expect((size_t)anv_meta_get(mem) % 16 == 0);
+            expect(*(unsigned char *)anv_meta_get(mem) == 7);
+            anv_meta_free(mem);
+        }
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_realloc_aligned_keeps_alignment_and_data)
+{
+    metadata_t meta = { 10, 20 };
+    unsigned char *mem = anv_meta_malloc_aligned(&meta, sizeof(meta), 16, 64);
+    expect(mem);
+    for (int i = 0; i < 16; ++i) {
+        mem[i] = (unsigned char)i;
+    }
+
+    for (size_t sz = 32; sz <= 64 * 1024; sz *= 2) {
+        mem = anv_meta_realloc(mem, sz);
+        expect(mem);
+        expect((size_t)mem % 64 == 0);
+        expect(((metadata_t *)anv_meta_get(mem))->b == 20);
+        for (int i = 0; i < 16; ++i) {
+            expect(mem[i] == (unsigned char)i);
+        }
+    }
+
+    anv_meta_free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_aligned_with_invalid_alignment_fail)
+{
+    expect(!anv_meta_malloc_aligned(NULL, sizeof(metadata_t), 10, 0));
+    expect(!anv_meta_malloc_aligned(NULL, sizeof(metadata_t), 10, 48));
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_get_alignment_of_regular_block_is_0)
+{
+    void *mem = anv_meta_malloc(NULL, sizeof(metadata_t), 10);
+    expect(mem);
+    expect(anv_meta_get_alignment(mem) == 0);
+    anv_meta_free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_max_metadata_sz_roundtrip)
+{
+#ifdef ANV_METALLOC_COMPACT
+    // compact mode stores up to 64k of metadata.
+    unsigned char meta[1000];
+#else
+    unsigned char meta[255];
+#endif
+    for (size_t i = 0; i < sizeof(meta); ++i) {
+        meta[i] = (unsigned char)i;
+    }
+    unsigned char *mem = anv_meta_malloc(meta, sizeof(meta), 10);
+    expect(mem);
+    expect(anv_meta_getsz(mem) == sizeof(meta));
+    memset(mem, 0xff, 10);
+    unsigned char *stored = anv_meta_get(mem);
+    for (size_t i = 0; i < sizeof(meta); ++i) {
+        expect(stored[i] == (unsigned char)i);
+    }
+    anv_meta_free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_malloc_compact_data_is_aligned)
+{
+#ifdef ANV_METALLOC_COMPACT
+    for (anv_meta_size_t meta_sz = 1; meta_sz < 40; ++meta_sz) {
+        unsigned char meta[40] = { 0 };
+        void *mem = anv_meta_malloc(meta, meta_sz, 10);
+        expect(mem);
+        // libc malloc already returns blocks aligned to max_align_t.
+        expect((size_t)mem % ANV_METALLOC_COMPACT_ALIGNMENT == 0);
+        anv_meta_free(mem);
+    }
+#else
+    // regular headers are never padded.
+    expect(ANV_META_BUFFER_SIZE(1, 0) == 1 + ANV_META_OVERHEAD);
+#endif
+}
+
+static void *
+libc_malloc(void *ctx, size_t sz)
+{
+    (void)ctx;
+    return malloc(sz);
+}
+
+static void *
+failing_realloc(void *ctx, void *mem, size_t new_sz)
+{
+    (void)ctx;
+    (void)mem;
+    (void)new_sz;
+    return NULL;
+}
+
+static void
+libc_free(void *ctx, void *mem)
+{
+    (void)ctx;
+    free(mem);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_realloc_failure_keeps_block)
+{
+    anv_meta_allocator allocator = {
+        libc_malloc, failing_realloc, libc_free, NULL
+    };
+    metadata_t meta = { 1, 2 };
+    char *mem = anv_meta_malloc_with(&allocator, &meta, sizeof(meta), 16);
+    expect(mem);
+    memcpy(mem, "still here", 11);
+#ifdef ANV_METALLOC_ENABLE_STATS
+    anv_meta_stats before;
+    anv_meta_stats_snapshot(&before);
+#endif
+
+    expect(anv_meta_realloc(mem, 1024) == NULL);
+    expect(anv_meta_isvalid(mem));
+    expect(strcmp(mem, "still here") == 0);
+    expect(((metadata_t *)anv_meta_get(mem))->b == 2);
+#ifdef ANV_METALLOC_ENABLE_STATS
+    anv_meta_stats stats;
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.failed_count == before.failed_count + 1);
+    expect(stats.free_count == before.free_count);
+    expect(stats.live_count == before.live_count);
+#endif
+    anv_meta_free(mem);
+}
+
+#ifdef ANV_METALLOC_ENABLE_LARGE_BLOCKS
+static int
+check_pattern(const unsigned char *mem, size_t sz)
+{
+    for (size_t i = 0; i < sz; i += 4093) {
+        if (mem[i] != (unsigned char)(i % 251)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void
+fill_pattern(unsigned char *mem, size_t from, size_t to)
+{
+    for (size_t i = (from + 4092) / 4093 * 4093; i < to; i += 4093) {
+        mem[i] = (unsigned char)(i % 251);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_large_block_grows_in_place)
+{
+    metadata_t meta = { 3, 4 };
+    unsigned char *mem = anv_meta_malloc(&meta, sizeof(meta), 100000);
+    expect(mem);
+    fill_pattern(mem, 0, 100000);
+
+    // grows inside its reservation.
+    unsigned char *grown = anv_meta_realloc(mem, 1000000);
+    expect(grown == mem);
+    expect(check_pattern(grown, 100000));
+    fill_pattern(grown, 100000, 1000000);
+    grown[999999] = 1;
+
+    // shrinking stays in place as well.
+    grown = anv_meta_realloc(grown, 200000);
+    expect(grown == mem);
+    expect(check_pattern(grown, 200000));
+
+    // out of reservation, moved once.
+    grown = anv_meta_realloc(grown, 8000000);
+    expect(grown);
+    expect(check_pattern(grown, 200000));
+    expect(((metadata_t *)anv_meta_get(grown))->a == 3);
+    expect(anv_meta_getsz(grown) == sizeof(meta));
+    expect(anv_meta_get_allocator(grown) == NULL);
+    grown[7999999] = 1;
+    anv_meta_free(grown);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_small_block_moves_to_large)
+{
+    metadata_t meta = { 5, 6 };
+    unsigned char *mem = anv_meta_malloc(&meta, sizeof(meta), 1000);
+    expect(mem);
+    fill_pattern(mem, 0, 1000);
+    mem = anv_meta_realloc(mem, 500000);
+    expect(mem);
+    expect(check_pattern(mem, 1000));
+    expect(((metadata_t *)anv_meta_get(mem))->b == 6);
+    // now large, next growth is in place.
+    unsigned char *grown = anv_meta_realloc(mem, 1000000);
+    expect(grown == mem);
+    anv_meta_free(grown);
+
+    // aligned blocks always come from malloc.
+    mem = anv_meta_malloc_aligned(&meta, sizeof(meta), 100000, 64);
+    expect(mem);
+    expect((size_t)mem % 64 == 0);
+    mem = anv_meta_realloc(mem, 200000);
+    expect(mem && (size_t)mem % 64 == 0);
+    expect(anv_meta_get_alignment(mem) == 64);
+    anv_meta_free(mem);
+}
+
+// registered only when available.
+#define LARGE_FIXTURES                                                         \
+    ANV_TESTSUITE_REGISTER(anv_meta_large_block_grows_in_place),               \
+    ANV_TESTSUITE_REGISTER(anv_meta_small_block_moves_to_large),
+#else
+#define LARGE_FIXTURES
+#endif
+
+#ifdef ANV_METALLOC_ENABLE_STATS
+ANV_TESTSUITE_FIXTURE(anv_meta_stats_count_blocks)
+{
+    metadata_t meta = { 1, 2 };
+    anv_meta_stats before;
+    anv_meta_stats_snapshot(&before);
+
+    void *a = anv_meta_malloc(&meta, sizeof(meta), 100);
+    void *b = anv_meta_malloc_aligned(&meta, sizeof(meta), 50, 64);
+    expect(a && b);
+    anv_meta_stats stats;
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.alloc_count == before.alloc_count + 2);
+    expect(stats.live_count == before.live_count + 2);
+    expect(stats.live_requested_bytes == before.live_requested_bytes + 150);
+    size_t a_sz = ANV_META_BUFFER_SIZE(sizeof(meta), 100);
+    expect(
+        stats.live_allocated_bytes - before.live_allocated_bytes
+        >= a_sz + ANV_META_BUFFER_SIZE(sizeof(meta), 50)
+    );
+    expect(stats.peak_allocated_bytes >= stats.live_allocated_bytes);
+
+    a = anv_meta_realloc(a, 1000);
+    expect(a);
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.realloc_count == before.realloc_count + 1);
+    expect(stats.live_requested_bytes == before.live_requested_bytes + 1050);
+    expect(stats.total_requested_bytes == before.total_requested_bytes + 1150);
+
+    anv_meta_free(a);
+    anv_meta_free(b);
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.free_count == before.free_count + 2);
+    expect(stats.live_count == before.live_count);
+    expect(stats.live_requested_bytes == before.live_requested_bytes);
+    expect(stats.live_allocated_bytes == before.live_allocated_bytes);
+}
+
+static void *
+failing_malloc(void *ctx, size_t sz)
+{
+    (void)ctx;
+    (void)sz;
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_meta_stats_failures_and_reset)
+{
+    anv_meta_allocator failing = { failing_malloc, NULL, NULL, NULL };
+    metadata_t meta = { 1, 2 };
+    anv_meta_stats_reset();
+    expect(!anv_meta_malloc_with(&failing, &meta, sizeof(meta), 10));
+    // buffers are not counted.
+    char buffer[ANV_META_BUFFER_SIZE(sizeof(metadata_t), 16)];
+    expect(anv_meta_init_buffer(buffer, sizeof(buffer), &meta, sizeof(meta)));
+
+    anv_meta_stats stats;
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.failed_count == 1);
+    expect(stats.alloc_count == 0);
+    anv_meta_stats_reset();
+    anv_meta_stats_snapshot(&stats);
+    expect(stats.failed_count == 0);
+    expect(stats.peak_allocated_bytes == stats.live_allocated_bytes);
+}
+
+// registered only when available.
+#define STATS_FIXTURES                                                         \
+    ANV_TESTSUITE_REGISTER(anv_meta_stats_count_blocks),                       \
+    ANV_TESTSUITE_REGISTER(anv_meta_stats_failures_and_reset),
+#else
+#define STATS_FIXTURES
+#endif
+
 ANV_TESTSUITE(
     tests_anv_metalloc,
     ANV_TESTSUITE_REGISTER(anv_meta_malloc_simple_ok),
@@ -513,6 +953,7 @@ ANV_TESTSUITE(
     ANV_TESTSUITE_REGISTER(anv_meta_getsz_when_invalid_mem_return_0),
     ANV_TESTSUITE_REGISTER(anv_meta_get_ok_when_metadata_exists),
     ANV_TESTSUITE_REGISTER(anv_meta_get_when_no_metadata_return_empty_metadata),
+    ANV_TESTSUITE_REGISTER(anv_meta_get_unchecked_same_as_anv_meta_get),
     ANV_TESTSUITE_REGISTER(anv_meta_get_when_null_mem_return_0),
     ANV_TESTSUITE_REGISTER(anv_meta_get_when_invalid_mem_return_0),
     ANV_TESTSUITE_REGISTER(anv_meta_set_ok),
@@ -525,6 +966,8 @@ ANV_TESTSUITE(
     ANV_TESTSUITE_REGISTER(anv_meta_get_offset_ok),
     ANV_TESTSUITE_REGISTER(anv_meta_get_offset_when_null_mem_return_0),
     ANV_TESTSUITE_REGISTER(anv_meta_get_offset_when_invalid_mem_return_0),
+    ANV_TESTSUITE_REGISTER(anv_meta_init_buffer_ok),
+    ANV_TESTSUITE_REGISTER(anv_meta_init_buffer_too_small_fail),
     ANV_TESTSUITE_REGISTER(anv_meta_realloc_simple_ok),
     ANV_TESTSUITE_REGISTER(anv_meta_realloc_simple_fail_on_null_mem),
     ANV_TESTSUITE_REGISTER(anv_meta_realloc_get_offset_ok),
@@ -536,11 +979,23 @@ ANV_TESTSUITE(
         anv_meta_realloc_set_metadata_when_before_was_not_present
     ),
     ANV_TESTSUITE_REGISTER(anv_meta_realloc_change_data),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_with_uses_allocator),
+    ANV_TESTSUITE_REGISTER(anv_meta_default_allocator_is_remembered_per_block),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_aligned_data_is_aligned),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_aligned_metadata_is_aligned),
+    ANV_TESTSUITE_REGISTER(anv_meta_realloc_aligned_keeps_alignment_and_data),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_aligned_with_invalid_alignment_fail),
+    ANV_TESTSUITE_REGISTER(anv_meta_get_alignment_of_regular_block_is_0),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_max_metadata_sz_roundtrip),
+    ANV_TESTSUITE_REGISTER(anv_meta_malloc_compact_data_is_aligned),
+    ANV_TESTSUITE_REGISTER(anv_meta_realloc_failure_keeps_block),
+    LARGE_FIXTURES
+    STATS_FIXTURES
 );
 
 int
 main(void)
 {
     anv_testsuite_catch_crashes();
-    ANV_TESTSUITE_RUN(tests_anv_metalloc, stdout);
+    return ANV_TESTSUITE_RUN(tests_anv_metalloc, stdout);
 }
@@ -0,0 +1,306 @@
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_POOL_IMPLEMENTATION
+#define anv_pool__assert(cond, errmsg) ((void)(cond))
+#ifndef _WIN32
+#define ANV_POOL_ENABLE_THREADS
+#endif
+#include "../include/anv_pool.h"
+
+#define ANV_ARR_IMPLEMENTATION
+#define anv_arr__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_arr.h"
+
+#define HALLOC_IMPLEMENTATION
+#include "../repackages/halloc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+ANV_TESTSUITE_FIXTURE(anv_pool_alloc_rounds_to_size_class)
+{
+    anv_pool *pool = anv_pool_new();
+    expect(pool);
+
+    void *a = anv_pool_alloc(pool, 1);
+    void *b = anv_pool_alloc(pool, 17);
+    void *c = anv_pool_alloc(pool, 1000);
+    expect(a && b && c);
+    expect(anv_pool_usable_size(a) == 16);
+    expect(anv_pool_usable_size(b) == 32);
+    expect(anv_pool_usable_size(c) == 1024);
+    expect((uintptr_t)a % 16 == 0);
+    expect((uintptr_t)b % 16 == 0);
+    expect((uintptr_t)c % 16 == 0);
+
+    anv_pool_free(pool, a);
+    anv_pool_free(pool, b);
+    anv_pool_free(pool, c);
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_alloc_invalid_params_is_null)
+{
+    anv_pool *pool = anv_pool_new();
+    expect(!anv_pool_alloc(NULL, 10));
+    expect(!anv_pool_alloc(pool, 0));
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_free_then_alloc_reuses_block)
+{
+    anv_pool *pool = anv_pool_new();
+    void *a = anv_pool_alloc(pool, 40);
+    expect(a);
+    anv_pool_free(pool, a);
+    expect(anv_pool_alloc(pool, 48) == a);
+    anv_pool_free(pool, NULL);
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_many_allocs_are_distinct)
+{
+    anv_pool *pool = anv_pool_new();
+    enum { COUNT = 20000 };
+    static uint64_t *items[COUNT];
+
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < COUNT; ++i) {
+            items[i] = anv_pool_alloc(pool, 24);
+            expect(items[i]);
+            items[i][0] = (uint64_t)i;
+            items[i][2] = (uint64_t)i * 3;
+        }
+        for (int i = 0; i < COUNT; ++i) {
+            expect(items[i][0] == (uint64_t)i);
+            expect(items[i][2] == (uint64_t)i * 3);
+        }
+        for (int i = 0; i < COUNT; ++i) {
+            anv_pool_free(pool, items[i]);
+        }
+    }
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_large_allocs_use_malloc)
+{
+    anv_pool *pool = anv_pool_new();
+    unsigned char *big = anv_pool_alloc(pool, 100000);
+    expect(big);
+    expect(anv_pool_usable_size(big) == 100000);
+    memset(big, 0xab, 100000);
+    unsigned char *other = anv_pool_alloc(pool, 5000);
+    expect(other);
+    anv_pool_free(pool, big);
+    // other is released by destroy.
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_large_realloc_keeps_data)
+{
+    anv_pool *pool = anv_pool_new();
+    unsigned char *mem = anv_pool_alloc(pool, 2000);
+    expect(mem);
+    expect((size_t)mem % 16 == 0);
+    for (size_t i = 0; i < 2000; ++i) {
+        mem[i] = (unsigned char)i;
+    }
+    for (size_t sz = 4000; sz <= 256000; sz *= 2) {
+        mem = anv_pool_realloc(pool, mem, sz);
+        expect(mem);
+        expect((size_t)mem % 16 == 0);
+        expect(anv_pool_usable_size(mem) == sz);
+        for (size_t i = 0; i < 2000; ++i) {
+            expect(mem[i] == (unsigned char)i);
+        }
+    }
+    // small objects stay small objects next to big ones.
+    unsigned char *small = anv_pool_alloc(pool, 100);
+    expect(small);
+    expect(anv_pool_usable_size(small) == 112);
+    anv_pool_free(pool, small);
+    anv_pool_free(pool, mem);
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_realloc_ok)
+{
+    anv_pool *pool = anv_pool_new();
+    char *mem = anv_pool_realloc(pool, NULL, 20);
+    expect(mem);
+    memcpy(mem, "hello pool", 11);
+
+    // same size class.
+    expect(anv_pool_realloc(pool, mem, 30) == mem);
+
+    char *grown = anv_pool_realloc(pool, mem, 600);
+    expect(grown);
+    expect(anv_pool_usable_size(grown) == 640);
+    expect(strcmp(grown, "hello pool") == 0);
+
+    char *big = anv_pool_realloc(pool, grown, 4000);
+    expect(big);
+    expect(strcmp(big, "hello pool") == 0);
+    expect(anv_pool_realloc(pool, big, 3000) == big);
+
+    char *small = anv_pool_realloc(pool, big, 16);
+    expect(small);
+    expect(anv_pool_usable_size(small) == 16);
+    expect(memcmp(small, "hello pool", 10) == 0);
+
+    expect(!anv_pool_realloc(pool, small, 0));
+    anv_pool_free(pool, small);
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_meta_allocator_with_anv_arr_ok)
+{
+    anv_pool *pool = anv_pool_new();
+    anv_arr_options options = {
+        .arr_capacity = 2,
+        .item_sz = sizeof(int),
+        .allocator = anv_pool_allocator(pool),
+    };
+    anv_arr_t arrs[100];
+    for (int i = 0; i < 100; ++i) {
+        arrs[i] = anv_arr_new_with_options(&options);
+        expect(arrs[i]);
+        for (int j = 0; j < 300; ++j) {
+            expect(anv_arr_push(arrs[i], &j) == ANV_ARR_RESULT_OK);
+        }
+    }
+    for (int i = 0; i < 100; ++i) {
+        expect(*anv_arr_get(arrs[i], int, 299) == 299);
+        anv_arr_destroy(arrs[i]);
+    }
+    anv_pool_destroy(pool);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_halloc_allocator_ok)
+{
+    anv_pool *pool = anv_pool_new();
+    anv_pool_set_halloc_pool(pool);
+    h_realloc_t old_allocator = halloc_allocator;
+    halloc_allocator = anv_pool_halloc_realloc;
+
+    char *root = h_malloc(32);
+    expect(root);
+    for (int i = 0; i < 100; ++i) {
+        char *child = h_strdup("child");
+        expect(child);
+        hattach(child, root);
+    }
+    root = h_realloc(root, 2000);
+    expect(root);
+    h_free(root);
+
+    halloc_allocator = old_allocator;
+    anv_pool_set_halloc_pool(NULL);
+    anv_pool_destroy(pool);
+}
+
+#ifdef ANV_POOL_ENABLE_THREADS
+
+#include <pthread.h>
+
+#define POOL_THREADS_COUNT 8
+#define POOL_THREAD_ITEMS  2000
+
+typedef struct pool_job_t {
+    anv_pool *pool;
+    int id;
+    int ok;
+    uint32_t *kept[POOL_THREAD_ITEMS];
+} pool_job_t;
+
+static void *
+pool_job_fn(void *ctx)
+{
+    pool_job_t *job = ctx;
+    uint32_t *tmp[64];
+    job->ok = 1;
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 64; ++i) {
+            tmp[i] = anv_pool_alloc(job->pool, 8 + (size_t)(i % 8) * 16);
+            if (!tmp[i]) {
+                job->ok = 0;
+                return NULL;
+            }
+            tmp[i][0] = (uint32_t)(job->id * 1000 + i);
+        }
+        for (int i = 0; i < 64; ++i) {
+            if (tmp[i][0] != (uint32_t)(job->id * 1000 + i)) {
+                job->ok = 0;
+            }
+            anv_pool_free(job->pool, tmp[i]);
+        }
+    }
+    // freed later by the main thread.
+    for (int i = 0; i < POOL_THREAD_ITEMS; ++i) {
+        job->kept[i] = anv_pool_alloc(job->pool, 32);
+        if (!job->kept[i]) {
+            job->ok = 0;
+            return NULL;
+        }
+        job->kept[i][0] = (uint32_t)(job->id * POOL_THREAD_ITEMS + i);
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_pool_threads_alloc_and_cross_free_ok)
+{
+    anv_pool *pool = anv_pool_new();
+    static pool_job_t jobs[POOL_THREADS_COUNT];
+    pthread_t threads[POOL_THREADS_COUNT];
+    for (int i = 0; i < POOL_THREADS_COUNT; ++i) {
+        jobs[i].pool = pool;
+        jobs[i].id = i;
+        expect(pthread_create(&threads[i], NULL, pool_job_fn, &jobs[i]) == 0);
+    }
+    for (int i = 0; i < POOL_THREADS_COUNT; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    for (int i = 0; i < POOL_THREADS_COUNT; ++i) {
+        expect(jobs[i].ok);
+        for (int j = 0; j < POOL_THREAD_ITEMS; ++j) {
+            expect(jobs[i].kept[j][0] == (uint32_t)(i * POOL_THREAD_ITEMS + j));
+            anv_pool_free(pool, jobs[i].kept[j]);
+        }
+    }
+    anv_pool_thread_release(pool);
+    anv_pool_destroy(pool);
+}
+
+#else
+
+ANV_TESTSUITE_FIXTURE(anv_pool_threads_alloc_and_cross_free_ok)
+{
+    anv_pool *pool = anv_pool_new();
+    expect(pool);
+    anv_pool_destroy(pool);
+}
+
+#endif /* ANV_POOL_ENABLE_THREADS */
+
+ANV_TESTSUITE(
+    tests_anv_pool,
+    ANV_TESTSUITE_REGISTER(anv_pool_alloc_rounds_to_size_class),
+    ANV_TESTSUITE_REGISTER(anv_pool_alloc_invalid_params_is_null),
+    ANV_TESTSUITE_REGISTER(anv_pool_free_then_alloc_reuses_block),
+    ANV_TESTSUITE_REGISTER(anv_pool_many_allocs_are_distinct),
+    ANV_TESTSUITE_REGISTER(anv_pool_large_allocs_use_malloc),
+    ANV_TESTSUITE_REGISTER(anv_pool_large_realloc_keeps_data),
+    ANV_TESTSUITE_REGISTER(anv_pool_realloc_ok),
+    ANV_TESTSUITE_REGISTER(anv_pool_meta_allocator_with_anv_arr_ok),
+    ANV_TESTSUITE_REGISTER(anv_pool_halloc_allocator_ok),
+    ANV_TESTSUITE_REGISTER(anv_pool_threads_alloc_and_cross_free_ok),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_pool, stdout);
+}
@@ -0,0 +1,338 @@
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_RING_IMPLEMENTATION
+#define anv_ring__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_ring.h"
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct huge_item_t {
+    uint64_t id;
+    char data[27];
+} huge_item_t;
+
+ANV_TESTSUITE_FIXTURE(anv_ring_new_rounds_capacity)
+{
+    anv_ring_t ring = anv_ring_new(ANV_RING_SPSC, 100, sizeof(int));
+    expect(ring);
+    expect(anv_ring_capacity(ring) == 128);
+    expect(anv_ring_item_sz(ring) == sizeof(int));
+    expect(anv_ring_kind_of(ring) == ANV_RING_SPSC);
+    expect(anv_ring_length(ring) == 0);
+    expect((uintptr_t)ring % ANV_RING_CACHE_LINE_SIZE == 0);
+    anv_ring_destroy(ring);
+
+    ring = anv_ring_new(ANV_RING_MPMC, 0, sizeof(int));
+    expect(ring);
+    expect(anv_ring_capacity(ring) == 2);
+    expect(anv_ring_kind_of(ring) == ANV_RING_MPMC);
+    anv_ring_destroy(ring);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_invalid_params)
+{
+    expect(!anv_ring_new(ANV_RING_SPSC, 16, 0));
+    expect(!anv_ring_new((anv_ring_kind)42, 16, 4));
+    expect(!anv_ring_new(ANV_RING_MPMC, (size_t)-1, 4));
+    expect(anv_ring_capacity(NULL) == 0);
+    int value = 1;
+    expect(anv_ring_push(NULL, &value) == ANV_RING_RESULT_INVALID_PARAMS);
+    expect(anv_ring_pop(NULL, &value) == ANV_RING_RESULT_INVALID_PARAMS);
+    expect(anv_ring_push_n(NULL, &value, 1) == 0);
+
+    anv_ring_t ring = anv_ring_new(ANV_RING_MPMC, 4, sizeof(int));
+    expect(anv_ring_push(ring, NULL) == ANV_RING_RESULT_INVALID_PARAMS);
+    expect(anv_ring_pop(ring, NULL) == ANV_RING_RESULT_INVALID_PARAMS);
+    anv_ring_destroy(ring);
+    anv_ring_destroy(NULL);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_fifo_full_empty)
+{
+    for (int kind = ANV_RING_SPSC; kind <= ANV_RING_MPMC; ++kind) {
+        anv_ring_t ring = anv_ring_new((anv_ring_kind)kind, 8, sizeof(int));
+        expect(ring);
+
+        int value = -1;
+        expect(anv_ring_pop(ring, &value) == ANV_RING_RESULT_EMPTY);
+        // several laps to exercise wrap around.
+        for (int lap = 0; lap < 5; ++lap) {
+            for (int i = 0; i < 8; ++i) {
+                int item = lap * 100 + i;
+                expect(anv_ring_push(ring, &item) == ANV_RING_RESULT_OK);
+            }
+            expect(anv_ring_length(ring) == 8);
+            expect(anv_ring_push(ring, &value) == ANV_RING_RESULT_FULL);
+            for (int i = 0; i < 5; ++i) {
+                expect(anv_ring_pop(ring, &value) == ANV_RING_RESULT_OK);
+                expect(value == lap * 100 + i);
+            }
+            expect(anv_ring_length(ring) == 3);
+            for (int i = 5; i < 8; ++i) {
+                expect(anv_ring_pop(ring, &value) == ANV_RING_RESULT_OK);
+                expect(value == lap * 100 + i);
+            }
+            expect(anv_ring_pop(ring, &value) == ANV_RING_RESULT_EMPTY);
+            // shift the start so the next lap does not begin at slot 0.
+            expect(anv_ring_push(ring, &value) == ANV_RING_RESULT_OK);
+            expect(anv_ring_pop(ring, &value) == ANV_RING_RESULT_OK);
+        }
+
+        anv_ring_destroy(ring);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_batches)
+{
+    for (int kind = ANV_RING_SPSC; kind <= ANV_RING_MPMC; ++kind) {
+        anv_ring_t ring = anv_ring_new((anv_ring_kind)kind, 16, sizeof(int));
+        expect(ring);
+
+        int items[40];
+        int out[40];
+        for (int i = 0; i < 40; ++i) {
+            items[i] = i;
+        }
+        expect(anv_ring_push_n(ring, items, 10) == 10);
+        expect(anv_ring_pop_n(ring, out, 7) == 7);
+        // wraps around, only 13 slots left.
+        expect(anv_ring_push_n(ring, items + 10, 30) == 13);
+        expect(anv_ring_push_n(ring, items, 1) == 0);
+        expect(anv_ring_length(ring) == 16);
+        expect(anv_ring_pop_n(ring, out + 7, 40) == 16);
+        for (int i = 0; i < 23; ++i) {
+            expect(out[i] == i);
+        }
+        expect(anv_ring_pop_n(ring, out, 1) == 0);
+        expect(anv_ring_push_n(ring, items, 0) == 0);
+
+        anv_ring_destroy(ring);
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_huge_items)
+{
+    for (int kind = ANV_RING_SPSC; kind <= ANV_RING_MPMC; ++kind) {
+        anv_ring_t ring
+            = anv_ring_new((anv_ring_kind)kind, 4, sizeof(huge_item_t));
+        expect(ring);
+        for (uint64_t i = 0; i < 20; ++i) {
+            huge_item_t item;
+            item.id = i;
+            memset(item.data, (int)i, sizeof(item.data));
+            expect(anv_ring_push(ring, &item) == ANV_RING_RESULT_OK);
+            huge_item_t out;
+            expect(anv_ring_pop(ring, &out) == ANV_RING_RESULT_OK);
+            expect(out.id == i);
+            expect(out.data[26] == (char)i);
+        }
+        anv_ring_destroy(ring);
+    }
+}
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <sched.h>
+
+#define THREADED_ITEMS 200000
+#define MPMC_THREADS   4
+
+static void *
+spsc_producer(void *arg)
+{
+    anv_ring_t ring = arg;
+    uint32_t batch[7];
+    uint32_t next = 0;
+    while (next < THREADED_ITEMS) {
+        if (next % 3 == 0) {
+            if (anv_ring_push(ring, &next) == ANV_RING_RESULT_OK) {
+                ++next;
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+        size_t count = 0;
+        while (count < 7 && next + count < THREADED_ITEMS) {
+            batch[count] = next + (uint32_t)count;
+            ++count;
+        }
+        size_t pushed = anv_ring_push_n(ring, batch, count);
+        if (pushed == 0) {
+            sched_yield();
+        }
+        next += (uint32_t)pushed;
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_spsc_threaded_keeps_order)
+{
+    anv_ring_t ring = anv_ring_new(ANV_RING_SPSC, 64, sizeof(uint32_t));
+    expect(ring);
+
+    pthread_t producer;
+    expect(pthread_create(&producer, NULL, spsc_producer, ring) == 0);
+
+    uint32_t expected = 0;
+    int in_order = 1;
+    uint32_t out[5];
+    while (expected < THREADED_ITEMS) {
+        size_t count = anv_ring_pop_n(ring, out, 5);
+        if (count == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            in_order &= out[i] == expected++;
+        }
+    }
+    pthread_join(producer, NULL);
+    expect(in_order);
+    expect(anv_ring_length(ring) == 0);
+
+    anv_ring_destroy(ring);
+}
+
+typedef struct mpmc_worker {
+    anv_ring_t ring;
+    uint32_t base;
+    uint64_t sum;
+    size_t count;
+    /* last value seen from each producer, to check per producer order. */
+    uint32_t last[MPMC_THREADS];
+    int in_order;
+} mpmc_worker;
+
+static void *
+mpmc_producer(void *arg)
+{
+    mpmc_worker *worker = arg;
+    uint32_t next = 0;
+    uint32_t batch[3];
+    while (next < THREADED_ITEMS) {
+        size_t count = 0;
+        while (count < 3 && next + count < THREADED_ITEMS) {
+            batch[count] = worker->base + next + (uint32_t)count;
+            ++count;
+        }
+        size_t pushed = anv_ring_push_n(worker->ring, batch, count);
+        if (pushed == 0) {
+            sched_yield();
+        }
+        next += (uint32_t)pushed;
+    }
+    return NULL;
+}
+
+static uint64_t mpmc_popped;
+
+static void *
+mpmc_consumer(void *arg)
+{
+    mpmc_worker *worker = arg;
+    uint32_t out[4];
+    uint64_t total = (uint64_t)THREADED_ITEMS * MPMC_THREADS;
+    while (__atomic_load_n(&mpmc_popped, __ATOMIC_RELAXED) < total) {
+        size_t count = anv_ring_pop_n(worker->ring, out, 4);
+        if (count == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t producer = out[i] / THREADED_ITEMS;
+            uint32_t value = out[i] % THREADED_ITEMS + 1;
+            worker->in_order &= value > worker->last[producer];
+            worker->last[producer] = value;
+            worker->sum += out[i];
+        }
+        worker->count += count;
+        __atomic_add_fetch(&mpmc_popped, (uint64_t)count, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_mpmc_threaded_no_loss)
+{
+    anv_ring_t ring = anv_ring_new(ANV_RING_MPMC, 128, sizeof(uint32_t));
+    expect(ring);
+
+    mpmc_worker producers[MPMC_THREADS];
+    mpmc_worker consumers[MPMC_THREADS];
+    pthread_t threads[2 * MPMC_THREADS];
+    memset(producers, 0, sizeof(producers));
+    memset(consumers, 0, sizeof(consumers));
+    mpmc_popped = 0;
+
+    for (int i = 0; i < MPMC_THREADS; ++i) {
+        consumers[i].ring = ring;
+        consumers[i].in_order = 1;
+        expect(
+            pthread_create(&threads[i], NULL, mpmc_consumer, &consumers[i])
+            == 0
+        );
+        producers[i].ring = ring;
+        producers[i].base = (uint32_t)i * THREADED_ITEMS;
+        expect(
+            pthread_create(
+                &threads[MPMC_THREADS + i], NULL, mpmc_producer, &producers[i]
+            )
+            == 0
+        );
+    }
+    for (int i = 0; i < 2 * MPMC_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64_t n = (uint64_t)THREADED_ITEMS * MPMC_THREADS;
+    uint64_t sum = 0;
+    size_t count = 0;
+    for (int i = 0; i < MPMC_THREADS; ++i) {
+        sum += consumers[i].sum;
+        count += consumers[i].count;
+        expect(consumers[i].in_order);
+    }
+    expect(count == n);
+    expect(sum == n * (n - 1) / 2);
+    expect(anv_ring_length(ring) == 0);
+
+    anv_ring_destroy(ring);
+}
+
+#else
+
+ANV_TESTSUITE_FIXTURE(anv_ring_spsc_threaded_keeps_order)
+{
+    anv_ring_t ring = anv_ring_new(ANV_RING_SPSC, 64, sizeof(uint32_t));
+    expect(anv_ring_capacity(ring) == 64);
+    anv_ring_destroy(ring);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_ring_mpmc_threaded_no_loss)
+{
+    anv_ring_t ring = anv_ring_new(ANV_RING_MPMC, 128, sizeof(uint32_t));
+    expect(anv_ring_capacity(ring) == 128);
+    anv_ring_destroy(ring);
+}
+
+#endif /* _WIN32 */
+
+ANV_TESTSUITE(
+    tests_anv_ring,
+    ANV_TESTSUITE_REGISTER(anv_ring_new_rounds_capacity),
+    ANV_TESTSUITE_REGISTER(anv_ring_invalid_params),
+    ANV_TESTSUITE_REGISTER(anv_ring_fifo_full_empty),
+    ANV_TESTSUITE_REGISTER(anv_ring_batches),
+    ANV_TESTSUITE_REGISTER(anv_ring_huge_items),
+    ANV_TESTSUITE_REGISTER(anv_ring_spsc_threaded_keeps_order),
+    ANV_TESTSUITE_REGISTER(anv_ring_mpmc_threaded_no_loss),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_ring, stdout);
+}
@@ -0,0 +1,196 @@
+#include "../include/anv_testsuite_2.h"
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define anv_meta__assert(cond, errmsg) ((void)(cond))
+#define ANV_SOA_IMPLEMENTATION
+#define anv_soa__assert(cond, errmsg) ((void)(cond))
+#include "../include/anv_soa.h"
+
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    COL_ID,
+    COL_PRICE,
+    COL_TAG,
+    COLS_COUNT,
+};
+
+static const size_t sizes[COLS_COUNT] = { sizeof(int), sizeof(double), 3 };
+
+static int
+push_order(anv_soa_t *refsoa, int id, double price)
+{
+    char tag[3] = { 't', (char)('a' + id % 26), 'g' };
+    const void *fields[COLS_COUNT] = { &id, &price, tag };
+    return anv_soa__push(refsoa, fields) == ANV_SOA_RESULT_OK;
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_new_ok)
+{
+    anv_soa_t soa = anv_soa_new(10, COLS_COUNT, sizes);
+    expect(soa);
+    expect(anv_soa_length(soa) == 0);
+    expect(anv_soa_capacity(soa) == 10);
+    expect(anv_soa_columns_count(soa) == COLS_COUNT);
+    expect(anv_soa_item_sz(soa, COL_PRICE) == sizeof(double));
+    expect(anv_soa_item_sz(soa, COL_TAG) == 3);
+    for (size_t i = 0; i < COLS_COUNT; ++i) {
+        void *column = anv_soa_column(soa, void, i);
+        expect(column);
+        expect((uintptr_t)column % ANV_SOA_ALIGNMENT == 0);
+    }
+    anv_soa_destroy(soa);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_invalid_params)
+{
+    const size_t zero_sizes[2] = { 4, 0 };
+    expect(!anv_soa_new(0, COLS_COUNT, sizes));
+    expect(!anv_soa_new(10, 0, sizes));
+    expect(!anv_soa_new(10, 2, NULL));
+    expect(!anv_soa_new(10, 2, zero_sizes));
+    expect(!anv_soa_new((size_t)-1, COLS_COUNT, sizes));
+    expect(anv_soa_length(NULL) == 0);
+
+    anv_soa_t soa = anv_soa_new(10, COLS_COUNT, sizes);
+    expect(!anv_soa_column(soa, void, COLS_COUNT));
+    expect(!anv_soa_get(soa, int, COL_ID, 0));
+    expect(anv_soa_remove(soa, 0) == ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS);
+    expect(anv_soa_pop(soa) == ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS);
+    expect(
+        anv_soa_set(soa, COL_ID, 0, NULL) == ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS
+    );
+    expect(
+        anv_soa_set(soa, COLS_COUNT, 0, NULL) == ANV_SOA_RESULT_INVALID_PARAMS
+    );
+    anv_soa_destroy(soa);
+    anv_soa_destroy(NULL);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_push_get_ok)
+{
+    anv_soa_t soa = anv_soa_new(4, COLS_COUNT, sizes);
+    expect(soa);
+
+    expect(push_order(&soa, 7, 1.25));
+    expect(push_order(&soa, 8, 2.5));
+    expect(anv_soa_length(soa) == 2);
+    expect(*anv_soa_get(soa, int, COL_ID, 1) == 8);
+    expect(*anv_soa_get(soa, double, COL_PRICE, 0) == 1.25);
+    expect(memcmp(anv_soa_get(soa, char, COL_TAG, 0), "thg", 3) == 0);
+    expect(!anv_soa_get(soa, int, COL_ID, 2));
+
+    // NULL fields are zeroed.
+    expect(anv_soa_push(soa, NULL) == ANV_SOA_RESULT_OK);
+    int id = 9;
+    const void *fields[COLS_COUNT] = { &id, NULL, NULL };
+    expect(anv_soa_push(soa, fields) == ANV_SOA_RESULT_OK);
+    expect(*anv_soa_get(soa, int, COL_ID, 2) == 0);
+    expect(*anv_soa_get(soa, int, COL_ID, 3) == 9);
+    expect(*anv_soa_get(soa, double, COL_PRICE, 3) == 0.0);
+
+    double price = 4.0;
+    expect(anv_soa_set(soa, COL_PRICE, 3, &price) == ANV_SOA_RESULT_OK);
+    expect(*anv_soa_get(soa, double, COL_PRICE, 3) == 4.0);
+
+    anv_soa_destroy(soa);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_grow_keeps_columns)
+{
+    anv_soa_t soa = anv_soa_new(1, COLS_COUNT, sizes);
+    expect(soa);
+
+    for (int i = 0; i < 10000; ++i) {
+        expect(push_order(&soa, i, i * 0.5));
+    }
+    expect(anv_soa_length(soa) == 10000);
+    expect(anv_soa_capacity(soa) >= 10000);
+
+    int *ids = anv_soa_column(soa, int, COL_ID);
+    double *prices = anv_soa_column(soa, double, COL_PRICE);
+    char *tags = anv_soa_column(soa, char, COL_TAG);
+    expect((uintptr_t)ids % ANV_SOA_ALIGNMENT == 0);
+    expect((uintptr_t)prices % ANV_SOA_ALIGNMENT == 0);
+    expect((uintptr_t)tags % ANV_SOA_ALIGNMENT == 0);
+    for (int i = 0; i < 10000; ++i) {
+        expect(ids[i] == i);
+        expect(prices[i] == i * 0.5);
+        expect(tags[i * 3 + 1] == (char)('a' + i % 26));
+    }
+
+    anv_soa_destroy(soa);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_remove_swaps_last)
+{
+    anv_soa_t soa = anv_soa_new(8, COLS_COUNT, sizes);
+    expect(soa);
+
+    for (int i = 0; i < 5; ++i) {
+        expect(push_order(&soa, i, i * 10.0));
+    }
+    // same semantics of anv_arr_remove: the last record takes its place.
+    expect(anv_soa_remove(soa, 1) == ANV_SOA_RESULT_OK);
+    expect(anv_soa_length(soa) == 4);
+    expect(*anv_soa_get(soa, int, COL_ID, 1) == 4);
+    expect(*anv_soa_get(soa, double, COL_PRICE, 1) == 40.0);
+    expect(anv_soa_get(soa, char, COL_TAG, 1)[1] == 'e');
+
+    // removing the last one just shrinks.
+    expect(anv_soa_remove(soa, 3) == ANV_SOA_RESULT_OK);
+    expect(anv_soa_length(soa) == 3);
+    expect(*anv_soa_get(soa, int, COL_ID, 2) == 2);
+
+    expect(anv_soa_pop(soa) == ANV_SOA_RESULT_OK);
+    expect(anv_soa_length(soa) == 2);
+    expect(anv_soa_remove(soa, 2) == ANV_SOA_RESULT_INDEX_OUT_OF_BOUNDS);
+
+    anv_soa_clear(soa);
+    expect(anv_soa_length(soa) == 0);
+    expect(anv_soa_capacity(soa) == 8);
+
+    anv_soa_destroy(soa);
+}
+
+ANV_TESTSUITE_FIXTURE(anv_soa_reserve_ok)
+{
+    anv_soa_t soa = anv_soa_new(2, COLS_COUNT, sizes);
+    expect(soa);
+    expect(push_order(&soa, 1, 1.0));
+    expect(push_order(&soa, 2, 2.0));
+
+    expect(anv_soa_reserve(soa, 1000) == ANV_SOA_RESULT_OK);
+    expect(anv_soa_capacity(soa) >= 1000);
+    expect(*anv_soa_get(soa, int, COL_ID, 1) == 2);
+    expect(*anv_soa_get(soa, double, COL_PRICE, 0) == 1.0);
+
+    anv_soa_t reserved = soa;
+    for (int i = 0; i < 998; ++i) {
+        expect(push_order(&soa, i, 0.0));
+    }
+    expect(soa == reserved);
+    // smaller reserves are a no-op.
+    expect(anv_soa_reserve(soa, 10) == ANV_SOA_RESULT_OK);
+    expect(soa == reserved);
+
+    anv_soa_destroy(soa);
+}
+
+ANV_TESTSUITE(
+    tests_anv_soa,
+    ANV_TESTSUITE_REGISTER(anv_soa_new_ok),
+    ANV_TESTSUITE_REGISTER(anv_soa_invalid_params),
+    ANV_TESTSUITE_REGISTER(anv_soa_push_get_ok),
+    ANV_TESTSUITE_REGISTER(anv_soa_grow_keeps_columns),
+    ANV_TESTSUITE_REGISTER(anv_soa_remove_swaps_last),
+    ANV_TESTSUITE_REGISTER(anv_soa_reserve_ok),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_soa, stdout);
+}
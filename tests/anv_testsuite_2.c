@@ -0,0 +1,303 @@
+#include "../include/anv_testsuite_2.h"
+
+/*
+ * Inner suites, run by the fixtures below with their output redirected.
+ */
+
+ANV_TESTSUITE_FIXTURE(inner_success)
+{
+    fprintf(out_file, "inner_success output ");
+    expect(1);
+}
+
+ANV_TESTSUITE_FIXTURE(inner_failure)
+{
+    expect_msg(0, "inner_failure message");
+}
+
+ANV_TESTSUITE_FIXTURE(inner_crash)
+{
+    (void)out_res;
+    fprintf(out_file, "before crash ");
+    raise(SIGABRT);
+}
+
+ANV_TESTSUITE_FIXTURE(inner_exit)
+{
+    (void)out_res;
+    (void)out_file;
+    exit(3);
+}
+
+ANV_TESTSUITE_FIXTURE(inner_slow)
+{
+    double start = anv_testsuite__wall_time();
+    while (anv_testsuite__wall_time() - start < 0.005) {
+    }
+    (void)out_file;
+    expect(1);
+}
+
+ANV_TESTSUITE_FIXTURE(inner_hang)
+{
+    (void)out_res;
+    (void)out_file;
+    volatile int forever = 1;
+    while (forever) {
+    }
+}
+
+static int inner_each_calls = 0;
+
+static void
+inner_before_each(void)
+{
+    ++inner_each_calls;
+}
+
+ANV_TESTSUITE_WITH_CONFIG(
+    inner_forked,
+    ANV_TESTSUITE_REGISTER(inner_success),
+    ANV_TESTSUITE_REGISTER(inner_crash),
+    ANV_TESTSUITE_REGISTER(inner_failure),
+    ANV_TESTSUITE_REGISTER(inner_exit),
+    ANV_TESTSUITE_REGISTER(inner_success),
+) {
+    .before_each = inner_before_each,
+    .jobs = 3,
+};
+
+ANV_TESTSUITE_WITH_CONFIG(
+    inner_sequential,
+    ANV_TESTSUITE_REGISTER(inner_success),
+    ANV_TESTSUITE_REGISTER(inner_failure),
+) {
+    .before_each = inner_before_each,
+};
+
+ANV_TESTSUITE_WITH_CONFIG(
+    inner_timed,
+    ANV_TESTSUITE_REGISTER(inner_success),
+    ANV_TESTSUITE_REGISTER_WITH_BUDGET(inner_slow, 0.001),
+    ANV_TESTSUITE_REGISTER(inner_failure),
+) {
+    .budget_s = 60,
+};
+
+ANV_TESTSUITE_WITH_CONFIG(
+    inner_timeout,
+    ANV_TESTSUITE_REGISTER(inner_hang),
+    ANV_TESTSUITE_REGISTER(inner_success),
+) {
+    .jobs = 2,
+    .timeout_s = 0.5,
+};
+
+static int
+inner_setup_fails(FILE *out_file)
+{
+    (void)out_file;
+    return 1;
+}
+
+ANV_TESTSUITE_WITH_CONFIG(
+    inner_bad_setup,
+    ANV_TESTSUITE_REGISTER(inner_success),
+    ANV_TESTSUITE_REGISTER(inner_success),
+) {
+    .setup = inner_setup_fails,
+};
+
+/*
+ * Read whole file content into buff.
+ */
+static void
+read_output(FILE *file, char *buff, size_t buff_sz)
+{
+    rewind(file);
+    size_t len = fread(buff, 1, buff_sz - 1, file);
+    buff[len] = '\0';
+    fclose(file);
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_sequential_returns_fails)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    inner_each_calls = 0;
+    // the suite is run in-process unless forced by ANV_TESTSUITE_JOBS.
+    expect(ANV_TESTSUITE_RUN(inner_sequential, out) == 1);
+
+    char buff[2048];
+    read_output(out, buff, sizeof(buff));
+    expect(strstr(buff, "inner_success output "));
+    expect(strstr(buff, "inner_failure message"));
+    expect(strstr(buff, "Results: "));
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_setup_failure_fails_all)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    expect(ANV_TESTSUITE_RUN(inner_bad_setup, out) == 2);
+    fclose(out);
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_budget_flagged)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    // over budget fixtures do not fail.
+    expect(ANV_TESTSUITE_RUN(inner_timed, out) == 1);
+
+    char buff[2048];
+    read_output(out, buff, sizeof(buff));
+    const char *slow = strstr(buff, "inner_slow");
+    expect(slow);
+    expect(strstr(slow, "OVER BUDGET (1.000 ms)"));
+    expect(strstr(buff, "Over budget: "));
+    // only inner_slow is over budget.
+    expect(!strstr(strstr(slow, "OVER BUDGET") + 1, "OVER BUDGET"));
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_junit_report)
+{
+    FILE *out = tmpfile();
+    FILE *report = tmpfile();
+    expect(out && report);
+    expect(
+        ANV_TESTSUITE_RUN_WITH_REPORT(
+            inner_timed, out, ANV_TESTSUITE_REPORT_JUNIT, report
+        )
+        == 1
+    );
+    fclose(out);
+
+    char buff[4096];
+    read_output(report, buff, sizeof(buff));
+    expect(strstr(
+        buff,
+        "<testsuite name=\"inner_timed\" tests=\"3\" failures=\"1\""
+    ));
+    expect(strstr(buff, "<testcase name=\"inner_success\""));
+    expect(strstr(buff, "<property name=\"cpu_time\""));
+    expect(strstr(buff, "<property name=\"over_budget\" value=\"true\"/>"));
+    expect(strstr(buff, "<failure message=\"expect failed\"/>"));
+    expect(strstr(buff, "</testsuites>\n"));
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_json_report)
+{
+    FILE *out = tmpfile();
+    FILE *report = tmpfile();
+    expect(out && report);
+    expect(
+        ANV_TESTSUITE_RUN_WITH_REPORT(
+            inner_timed, out, ANV_TESTSUITE_REPORT_JSON, report
+        )
+        == 1
+    );
+    fclose(out);
+
+    char buff[4096];
+    read_output(report, buff, sizeof(buff));
+    expect(strstr(buff, "\"suite\": \"inner_timed\""));
+    expect(strstr(buff, "\"failures\": 1,\n  \"over_budget\": 1,"));
+    expect(strstr(
+        buff,
+        "{\"name\": \"inner_failure\", \"success\": false, "
+        "\"reason\": \"expect failed\""
+    ));
+    const char *slow = strstr(buff, "\"name\": \"inner_slow\"");
+    expect(slow);
+    expect(strstr(slow, "\"budget_s\": 0.001000, \"over_budget\": true}"));
+}
+
+#ifdef ANV_TESTSUITE__HAS_FORK
+ANV_TESTSUITE_FIXTURE(testsuite_forked_timeout)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    expect(ANV_TESTSUITE_RUN(inner_timeout, out) == 1);
+
+    char buff[2048];
+    read_output(out, buff, sizeof(buff));
+    const char *hang = strstr(buff, "inner_hang");
+    expect(hang);
+    expect(strstr(hang, "TIMEOUT"));
+    expect(strstr(hang, "LIMIT:         '0.500 s'"));
+    expect(strstr(hang, "inner_success"));
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_forked_isolates_fixtures)
+{
+    FILE *out = tmpfile();
+    expect(out);
+    inner_each_calls = 0;
+    expect(ANV_TESTSUITE_RUN(inner_forked, out) == 3);
+    // before_each runs in the child processes.
+    expect(inner_each_calls == 0);
+
+    char buff[4096];
+    read_output(out, buff, sizeof(buff));
+    // printed in registration order.
+    const char *expected[] = {
+        "[000]  inner_success",
+        "inner_success output ",
+        "[001]  inner_crash",
+        "before crash ",
+        "CRASH",
+        "REASON:        'SIGABRT'",
+        "[002]  inner_failure",
+        "inner_failure message",
+        "[003]  inner_exit",
+        "REASON:        'exit(3)'",
+        "[004]  inner_success",
+        "Results: ",
+    };
+    const char *pos = buff;
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+        pos = strstr(pos, expected[i]);
+        expect_msg(pos, expected[i]);
+    }
+    expect(strstr(pos, "2/5"));
+}
+
+ANV_TESTSUITE_FIXTURE(testsuite_jobs_resolved)
+{
+    const char *env = getenv("ANV_TESTSUITE_JOBS");
+    anv_testsuite_config config = { 0 };
+    config.jobs = -1;
+    expect(anv_testsuite__jobs(&config) >= 1);
+    config.jobs = 4;
+    // the environment wins.
+    int expected = env && *env ? atoi(env) : 4;
+    int jobs = anv_testsuite__jobs(&config);
+    expect(expected < 0 ? jobs >= 1 : jobs == expected);
+}
+
+// registered only when available.
+#define FORK_FIXTURES                                                          \
+    ANV_TESTSUITE_REGISTER(testsuite_forked_timeout),                          \
+    ANV_TESTSUITE_REGISTER(testsuite_forked_isolates_fixtures),                \
+    ANV_TESTSUITE_REGISTER(testsuite_jobs_resolved),
+#else
+#define FORK_FIXTURES
+#endif
+
+ANV_TESTSUITE(
+    tests_anv_testsuite_2,
+    ANV_TESTSUITE_REGISTER(testsuite_sequential_returns_fails),
+    ANV_TESTSUITE_REGISTER(testsuite_setup_failure_fails_all),
+    ANV_TESTSUITE_REGISTER(testsuite_budget_flagged),
+    ANV_TESTSUITE_REGISTER(testsuite_junit_report),
+    ANV_TESTSUITE_REGISTER(testsuite_json_report),
+    FORK_FIXTURES
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_testsuite_2, stdout);
+}
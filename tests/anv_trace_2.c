@@ -0,0 +1,428 @@
+#include "../include/anv_testsuite_2.h"
+
+// debug traces are compiled out.
+#define ANV_TRACE_MIN_LEVEL ANV_TRACE_INFO
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+#include <pthread.h>
+#include <sched.h>
+
+#define ANV_METALLOC_IMPLEMENTATION
+#define ANV_RING_IMPLEMENTATION
+#endif
+
+#define ANV_TRACE_IMPLEMENTATION
+#include "../include/anv_trace_2.h"
+
+/*
+ * Read whole file content into buff and close it.
+ */
+static size_t
+read_trace(FILE *file, char *buff, size_t buff_sz)
+{
+    rewind(file);
+    size_t len = fread(buff, 1, buff_sz - 1, file);
+    buff[len] = '\0';
+    fclose(file);
+    return len;
+}
+
+ANV_TESTSUITE_FIXTURE(trace_writes_levels)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    anv_tracei("Hello %s!", "Info");
+    anv_tracew("Hello %s!", "Warning");
+    anv_tracee("Hello %s!", "Error");
+    anv_tracef("Hello %s!", "Fatal");
+    anv_trace(ANV_TRACE_WARNING, "no args");
+    anv_trace_quit();
+
+    char buff[4096];
+    read_trace(file, buff, sizeof(buff));
+    expect(strstr(buff, "Begin Trace"));
+    expect(strstr(buff, "-- [Info   ] ["));
+    expect(strstr(buff, "anv_trace_2.c:"));
+    expect(strstr(buff, "| trace_writes_levels ] Hello Info!\n"));
+    expect(strstr(buff, "] Hello Warning!\n"));
+    expect(strstr(buff, "] Hello Error!\n"));
+    expect(strstr(buff, "-- [Fatal  ] ["));
+    expect(strstr(buff, "] no args\n"));
+    expect(strstr(buff, "End Trace"));
+    // fatal messages come after queued ones.
+    expect(strstr(buff, "Hello Error!") < strstr(buff, "Hello Fatal!"));
+}
+
+static int side_effects = 0;
+
+static int
+side_effect(void)
+{
+    return ++side_effects;
+}
+
+ANV_TESTSUITE_FIXTURE(trace_min_level_compiled_out)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    side_effects = 0;
+    anv_traced("debug %d", side_effect());
+    anv_trace(ANV_TRACE_DEBUG, "debug %d", side_effect());
+    anv_trace_enter();
+    anv_tracei("info %d", side_effect());
+    anv_trace_quit();
+    expect(side_effects == 1);
+
+    char buff[4096];
+    read_trace(file, buff, sizeof(buff));
+    expect(!strstr(buff, "Debug"));
+    expect(strstr(buff, "] info 1\n"));
+}
+
+ANV_TESTSUITE_FIXTURE(trace_formats_like_printf)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    int local = 0;
+    const char *null_str = NULL;
+#define FORMAT_CASES                                                           \
+    "[%5d|%-5s|%08.3f|%x|%llu|%zu|%c|%%|%*d|%-*d|%.*s|%p|%hhd|%+.2e|%s|%5.1s]"
+#define FORMAT_ARGS                                                            \
+    -42, "ab", 3.14159, 255u, 1234567890123ull, (size_t)7, 'z', 4, 1, -4, 2,   \
+        3, "abcdef", (void *)&local, 300, 12345.678, null_str, "xyz"
+    anv_tracei(FORMAT_CASES, FORMAT_ARGS);
+    anv_tracew("%ld %lu %jd %td %hu %o %#X %g %i", -5L, 5UL, (intmax_t)-9,
+               (ptrdiff_t)-3, (unsigned short)65535, 8u, 255u, 0.5, 11);
+    anv_trace_quit();
+
+    char expected[512];
+    char buff[4096];
+    read_trace(file, buff, sizeof(buff));
+    snprintf(expected, sizeof(expected), FORMAT_CASES "\n", FORMAT_ARGS);
+    expect_msg(strstr(buff, expected), expected);
+    snprintf(
+        expected,
+        sizeof(expected),
+        "%ld %lu %jd %td %hu %o %#X %g %i\n",
+        -5L,
+        5UL,
+        (intmax_t)-9,
+        (ptrdiff_t)-3,
+        (unsigned short)65535,
+        8u,
+        255u,
+        0.5,
+        11
+    );
+    expect_msg(strstr(buff, expected), expected);
+#undef FORMAT_CASES
+#undef FORMAT_ARGS
+}
+
+ANV_TESTSUITE_FIXTURE(trace_long_messages_are_cut)
+{
+    static char long_str[ANV_TRACE_MAX_LINE_LEN * 2];
+    memset(long_str, 'a', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    anv_tracei("%s %d", long_str, 1);
+    anv_tracei("after");
+    anv_trace_quit();
+
+    static char buff[ANV_TRACE_MAX_LINE_LEN * 8];
+    read_trace(file, buff, sizeof(buff));
+    char *line = strstr(buff, "aaaa");
+    expect(line);
+    char *end = strchr(line, '\n');
+    expect(end);
+    // the whole line fits in ANV_TRACE_MAX_LINE_LEN.
+    expect((size_t)(end - line) < ANV_TRACE_MAX_LINE_LEN);
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    // the marker follows the cut string.
+    expect(strstr(line, "a" ANV_TRACE__TRUNCATED "\n"));
+#endif
+    expect(strstr(end, "] after\n"));
+
+    anv_trace_stats stats;
+    anv_trace_get_stats(&stats);
+    expect(stats.written_count == 2);
+}
+
+ANV_TESTSUITE_FIXTURE(trace_cut_string_ends_with_marker)
+{
+    char long_str[400];
+    memset(long_str, 'x', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    anv_tracei("%s END-OF-MSG", long_str);
+    anv_trace_quit();
+
+    static char buff[ANV_TRACE_MAX_LINE_LEN * 4];
+    read_trace(file, buff, sizeof(buff));
+    char *line = strstr(buff, "xxxx");
+    expect(line);
+#ifdef ANV_TRACE_ENABLE_ASYNC
+    // only the payload is cut, the text after the string is dropped with it.
+    expect(strstr(line, "x" ANV_TRACE__TRUNCATED "\n"));
+    expect(!strstr(line, "END-OF-MSG"));
+#else
+    expect(strstr(line, "x END-OF-MSG\n"));
+#endif
+}
+
+ANV_TESTSUITE_FIXTURE(trace_string_precision_bounds_reads)
+{
+    // not null terminated.
+    char *str = malloc(4);
+    expect(str);
+    memcpy(str, "abcd", 4);
+
+    FILE *file = tmpfile();
+    expect(file);
+    expect(anv_trace_init(file) == ANV_TRACE_OK);
+    anv_tracei("[%.*s] [%.2s] [%.4s]", 4, str, str, str);
+    anv_trace_quit();
+    free(str);
+
+    char buff[4096];
+    read_trace(file, buff, sizeof(buff));
+    expect(strstr(buff, "] [abcd] [ab] [abcd]\n"));
+}
+
+#ifdef ANV_TRACE_ENABLE_ASYNC
+#define THREADS_COUNT 4
+#define THREAD_TRACES 1000
+
+static size_t
+count_lines(const char *buff, const char *prefix)
+{
+    size_t count = 0;
+    for (const char *p = strstr(buff, prefix); p; p = strstr(p + 1, prefix)) {
+        ++count;
+    }
+    return count;
+}
+
+static void *
+thread_trace(void *arg)
+{
+    int id = *(int *)arg;
+    for (int i = 0; i < THREAD_TRACES; ++i) {
+        anv_tracei("thread %d seq %d", id, i);
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(trace_async_threads_keep_order)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    anv_trace_options options = {
+        .out_file = file,
+        .ring_capacity = 64,
+        .batch_sz = 32,
+        .idle_us = 100,
+        .overflow = ANV_TRACE_OVERFLOW_BLOCK,
+    };
+    expect(anv_trace_init_with_options(&options) == ANV_TRACE_OK);
+    pthread_t threads[THREADS_COUNT];
+    int ids[THREADS_COUNT];
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        ids[i] = i;
+        expect(pthread_create(&threads[i], NULL, thread_trace, &ids[i]) == 0);
+    }
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    anv_trace_stats stats;
+    anv_trace_get_stats(&stats);
+    expect(stats.dropped_count == 0);
+    anv_trace_quit();
+    anv_trace_get_stats(&stats);
+    expect(stats.written_count == THREADS_COUNT * THREAD_TRACES);
+
+    static char buff[THREADS_COUNT * THREAD_TRACES * 128];
+    read_trace(file, buff, sizeof(buff));
+    expect(count_lines(buff, "-- [Info") == THREADS_COUNT * THREAD_TRACES);
+    // each thread messages are written in order.
+    int next_seq[THREADS_COUNT] = { 0 };
+    for (const char *p = strstr(buff, "] thread "); p;
+         p = strstr(p + 1, "] thread ")) {
+        int id = -1;
+        int seq = -1;
+        expect(sscanf(p, "] thread %d seq %d", &id, &seq) == 2);
+        expect(id >= 0 && id < THREADS_COUNT);
+        expect(seq == next_seq[id]);
+        ++next_seq[id];
+    }
+}
+
+ANV_TESTSUITE_FIXTURE(trace_async_flush_and_drop)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    anv_trace_options options = {
+        .out_file = file,
+        .ring_capacity = 8,
+        // the writer only runs on flush.
+        .idle_us = 10000000,
+        .overflow = ANV_TRACE_OVERFLOW_DROP,
+    };
+    expect(anv_trace_init_with_options(&options) == ANV_TRACE_OK);
+    anv_tracei("first %d", 1);
+    anv_trace_flush();
+    char buff[8192];
+    fflush(file);
+    rewind(file);
+    buff[fread(buff, 1, sizeof(buff) - 1, file)] = '\0';
+    expect(strstr(buff, "] first 1\n"));
+    fseek(file, 0, SEEK_END);
+
+    for (int i = 0; i < 100; ++i) {
+        anv_tracei("burst %d", i);
+    }
+    anv_trace_stats stats;
+    anv_trace_get_stats(&stats);
+    expect(stats.dropped_count > 0);
+    anv_trace_quit();
+    anv_trace_get_stats(&stats);
+    expect(stats.written_count + stats.dropped_count == 101);
+
+    read_trace(file, buff, sizeof(buff));
+    expect(count_lines(buff, "] burst ") == stats.written_count - 1);
+}
+
+#define SLOW_COUNT  3
+#define SLOW_TRACES 4
+#define HOT_TRACES  40
+
+static int producers_ready;
+static int producers_go;
+
+/*
+ * Register the thread ring, wait for the go and queue traces lines.
+ */
+static void *
+thread_trace_when_told(void *arg)
+{
+    int id = *(int *)arg;
+    anv_tracei("ready %d", id);
+    __atomic_add_fetch(&producers_ready, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&producers_go, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+    int traces = id < SLOW_COUNT ? SLOW_TRACES : HOT_TRACES;
+    for (int i = 0; i < traces; ++i) {
+        anv_tracei("producer %d seq %d", id, i);
+    }
+    return NULL;
+}
+
+ANV_TESTSUITE_FIXTURE(trace_async_hot_producer_does_not_starve_others)
+{
+    FILE *file = tmpfile();
+    expect(file);
+    anv_trace_options options = {
+        .out_file = file,
+        .ring_capacity = 64,
+        .batch_sz = 8,
+        .idle_us = 10000000,
+        .overflow = ANV_TRACE_OVERFLOW_DROP,
+    };
+    expect(anv_trace_init_with_options(&options) == ANV_TRACE_OK);
+    producers_ready = 0;
+    producers_go = 0;
+    // the hot thread is the newest producer.
+    pthread_t threads[SLOW_COUNT + 1];
+    int ids[SLOW_COUNT + 1];
+    for (int i = 0; i <= SLOW_COUNT; ++i) {
+        ids[i] = i;
+        expect(
+            pthread_create(&threads[i], NULL, thread_trace_when_told, &ids[i])
+            == 0
+        );
+        while (__atomic_load_n(&producers_ready, __ATOMIC_SEQ_CST) <= i) {
+            sched_yield();
+        }
+    }
+    anv_trace_flush();
+    fflush(file);
+    long before = ftell(file);
+
+    // keep the writer away and drain a single batch.
+    pthread_mutex_lock(&anv_trace__state.mutex);
+    __atomic_store_n(&producers_go, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i <= SLOW_COUNT; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    expect(anv_trace__drain_batch() == 8);
+    pthread_mutex_unlock(&anv_trace__state.mutex);
+    anv_trace_flush();
+
+    char buff[16384];
+    fflush(file);
+    fseek(file, before, SEEK_SET);
+    size_t len = fread(buff, 1, sizeof(buff) - 1, file);
+    buff[len] = '\0';
+    // the first 8 lines hold 2 records of each producer.
+    char *line = buff;
+    int seen[SLOW_COUNT + 1] = { 0 };
+    for (int i = 0; i < 8; ++i) {
+        char *p = strstr(line, "] producer ");
+        expect(p);
+        int id = -1;
+        expect(sscanf(p, "] producer %d", &id) == 1);
+        expect(id >= 0 && id <= SLOW_COUNT);
+        ++seen[id];
+        line = strchr(p, '\n');
+        expect(line);
+    }
+    for (int i = 0; i <= SLOW_COUNT; ++i) {
+        expect(seen[i] == 2);
+    }
+    anv_trace_quit();
+    anv_trace_stats stats;
+    anv_trace_get_stats(&stats);
+    expect(stats.dropped_count == 0);
+    read_trace(file, buff, sizeof(buff));
+    expect(
+        count_lines(buff, "] producer ")
+        == SLOW_COUNT * SLOW_TRACES + HOT_TRACES
+    );
+}
+
+// registered only when available.
+#define ASYNC_FIXTURES                                                         \
+    ANV_TESTSUITE_REGISTER(trace_async_threads_keep_order),                    \
+    ANV_TESTSUITE_REGISTER(trace_async_flush_and_drop),                        \
+    ANV_TESTSUITE_REGISTER(trace_async_hot_producer_does_not_starve_others),
+#else
+#define ASYNC_FIXTURES
+#endif
+
+ANV_TESTSUITE(
+    tests_anv_trace_2,
+    ANV_TESTSUITE_REGISTER(trace_writes_levels),
+    ANV_TESTSUITE_REGISTER(trace_min_level_compiled_out),
+    ANV_TESTSUITE_REGISTER(trace_formats_like_printf),
+    ANV_TESTSUITE_REGISTER(trace_long_messages_are_cut),
+    ANV_TESTSUITE_REGISTER(trace_cut_string_ends_with_marker),
+    ANV_TESTSUITE_REGISTER(trace_string_precision_bounds_reads),
+    ASYNC_FIXTURES
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_anv_trace_2, stdout);
+}
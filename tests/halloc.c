@@ -0,0 +1,287 @@
+#include "../include/anv_testsuite_2.h"
+
+#define HALLOC_IMPLEMENTATION
+#include "../repackages/halloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static long live_blocks = 0;
+
+static void *
+counting_realloc(void *ptr, size_t len)
+{
+    if (!len) {
+        live_blocks -= ptr ? 1 : 0;
+        free(ptr);
+        return NULL;
+    }
+    live_blocks += ptr ? 0 : 1;
+    return realloc(ptr, len);
+}
+
+static void
+use_counting_allocator(void)
+{
+    halloc_allocator = counting_realloc;
+    live_blocks = 0;
+}
+
+ANV_TESTSUITE_FIXTURE(halloc_free_root_frees_children)
+{
+    use_counting_allocator();
+    char *root = h_malloc(16);
+    expect(root);
+    for (int i = 0; i < 10; ++i) {
+        char *child = h_strdup("child");
+        expect(child);
+        hattach(child, root);
+        hattach(h_malloc(8), child);
+    }
+    expect(live_blocks == 21);
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(halloc_free_deep_hierarchy_is_iterative)
+{
+    use_counting_allocator();
+    // deep enough to overflow the stack with a recursive free.
+    char *root = h_malloc(8);
+    char *parent = root;
+    for (int i = 0; i < 1000000; ++i) {
+        char *child = h_malloc(8);
+        expect(child);
+        hattach(child, parent);
+        parent = child;
+    }
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(h_arena_malloc_uses_few_allocations)
+{
+    use_counting_allocator();
+    char *root = h_arena_new(32, 65536);
+    expect(root);
+    long after_root = live_blocks;
+    char *parent = root;
+    for (int i = 0; i < 100000; ++i) {
+        char *child = h_arena_malloc(i % 16 ? parent : root, 24);
+        expect(child);
+        memset(child, 'x', 24);
+        if (i % 16 == 0) {
+            parent = child;
+        }
+    }
+    // one allocation per chunk instead of one per node.
+    expect(live_blocks - after_root < 200);
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(h_arena_realloc_keeps_data_and_children)
+{
+    use_counting_allocator();
+    char *root = h_arena_new(8, 0);
+    char *node = h_arena_malloc(root, 6);
+    expect(node);
+    memcpy(node, "arena", 6);
+    char *child = h_arena_malloc(node, 8);
+    expect(child);
+    memcpy(child, "child", 6);
+
+    node = h_realloc(node, 5000);
+    expect(node);
+    expect(strcmp(node, "arena") == 0);
+
+    // the child is still linked to the moved node.
+    h_free(node);
+    root = h_realloc(root, 1000);
+    expect(root);
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(h_arena_with_regular_and_nested_arena_blocks)
+{
+    use_counting_allocator();
+    char *root = h_arena_new(8, 1024);
+    char *node = h_arena_malloc(root, 16);
+    expect(node);
+
+    // regular blocks attached inside an arena hierarchy are freed as usual.
+    char *regular = h_malloc(100);
+    hattach(regular, node);
+    hattach(h_malloc(10), regular);
+    char *in_regular = h_arena_malloc(regular, 10);
+    expect(in_regular);
+
+    char *nested = h_arena_new(8, 1024);
+    hattach(nested, node);
+    for (int i = 0; i < 100; ++i) {
+        expect(h_arena_malloc(nested, 64));
+    }
+
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(h_arena_malloc_with_non_arena_parent_attaches)
+{
+    use_counting_allocator();
+    char *root = h_malloc(8);
+    char *child = h_arena_malloc(root, 8);
+    expect(child);
+    expect(live_blocks == 2);
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+ANV_TESTSUITE_FIXTURE(halloc_reparent_and_realloc_keeps_hierarchy)
+{
+    use_counting_allocator();
+    char *root = h_malloc(8);
+    char *a = h_malloc(8);
+    char *b = h_malloc(8);
+    char *leaf = h_malloc(8);
+    hattach(a, root);
+    hattach(b, root);
+    hattach(leaf, a);
+
+    // move leaf under b, then grow b so that it likely moves.
+    hattach(leaf, b);
+    b = h_realloc(b, 100000);
+    expect(b);
+#ifdef HALLOC_PARENT_POINTERS
+    expect(h_parent(root) == NULL);
+    expect(h_parent(a) == root);
+    expect(h_parent(leaf) == b);
+    expect(h_root(leaf) == root);
+    hattach(b, NULL);
+    expect(h_parent(b) == NULL);
+    expect(h_root(leaf) == b);
+    hattach(b, a);
+    expect(h_root(leaf) == root);
+#endif
+
+    h_free(root);
+    expect(live_blocks == 0);
+}
+
+static long context_blocks = 0;
+
+static void *
+context_realloc(void *ptr, size_t len)
+{
+    if (!len) {
+        context_blocks -= ptr ? 1 : 0;
+        free(ptr);
+        return NULL;
+    }
+    context_blocks += ptr ? 0 : 1;
+    return realloc(ptr, len);
+}
+
+ANV_TESTSUITE_FIXTURE(h_arena_new_with_uses_its_own_allocator)
+{
+    use_counting_allocator();
+    context_blocks = 0;
+    char *root = h_arena_new_with(16, 1024, context_realloc);
+    expect(root);
+    for (int i = 0; i < 1000; ++i) {
+        expect(h_arena_malloc(root, 32));
+    }
+    root = h_realloc(root, 5000);
+    expect(root);
+    hattach(h_malloc(8), root);
+    expect(live_blocks == 1);
+    expect(context_blocks > 2);
+    h_free(root);
+    expect(live_blocks == 0);
+    expect(context_blocks == 0);
+}
+
+#ifndef _WIN32
+
+#include <pthread.h>
+
+#define HALLOC_WORKERS_COUNT 4
+
+static void *
+halloc_worker_fn(void *slot)
+{
+    char *parent = slot;
+    for (int i = 0; i < 20000; ++i) {
+        char *child = h_malloc(16);
+        if (!child) {
+            return NULL;
+        }
+        hattach(child, i % 8 ? parent : slot);
+        if (i % 8 == 0) {
+            parent = child;
+        }
+        // arena subtrees of their own, freed right away.
+        if (i % 1000 == 0) {
+            char *arena = h_arena_new(8, 0);
+            for (int j = 0; j < 100; ++j) {
+                h_arena_malloc(arena, 24);
+            }
+            h_free(arena);
+        }
+    }
+    return slot;
+}
+
+ANV_TESTSUITE_FIXTURE(halloc_workers_build_slots_in_parallel)
+{
+    halloc_init(NULL);
+    char *root = h_malloc(8);
+    char *slots[HALLOC_WORKERS_COUNT];
+    pthread_t threads[HALLOC_WORKERS_COUNT];
+    for (int i = 0; i < HALLOC_WORKERS_COUNT; ++i) {
+        slots[i] = h_malloc(8);
+        hattach(slots[i], root);
+    }
+    for (int i = 0; i < HALLOC_WORKERS_COUNT; ++i) {
+        expect(
+            pthread_create(&threads[i], NULL, halloc_worker_fn, slots[i]) == 0
+        );
+    }
+    for (int i = 0; i < HALLOC_WORKERS_COUNT; ++i) {
+        void *res = NULL;
+        pthread_join(threads[i], &res);
+        expect(res == slots[i]);
+    }
+    h_free(root);
+}
+
+#else
+
+ANV_TESTSUITE_FIXTURE(halloc_workers_build_slots_in_parallel)
+{
+    halloc_init(NULL);
+    expect(halloc_allocator);
+}
+
+#endif /* _WIN32 */
+
+ANV_TESTSUITE(
+    tests_halloc,
+    ANV_TESTSUITE_REGISTER(halloc_free_root_frees_children),
+    ANV_TESTSUITE_REGISTER(halloc_free_deep_hierarchy_is_iterative),
+    ANV_TESTSUITE_REGISTER(h_arena_malloc_uses_few_allocations),
+    ANV_TESTSUITE_REGISTER(h_arena_realloc_keeps_data_and_children),
+    ANV_TESTSUITE_REGISTER(h_arena_with_regular_and_nested_arena_blocks),
+    ANV_TESTSUITE_REGISTER(h_arena_malloc_with_non_arena_parent_attaches),
+    ANV_TESTSUITE_REGISTER(halloc_reparent_and_realloc_keeps_hierarchy),
+    ANV_TESTSUITE_REGISTER(h_arena_new_with_uses_its_own_allocator),
+    ANV_TESTSUITE_REGISTER(halloc_workers_build_slots_in_parallel),
+);
+
+int
+main(void)
+{
+    anv_testsuite_catch_crashes();
+    return ANV_TESTSUITE_RUN(tests_halloc, stdout);
+}